@@ -0,0 +1,79 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	// Every allocation starts with its size, keeping what follows aligned for any type
+	std::size_t const header_size(16);
+
+	std::atomic< long long > allocated_bytes(0);
+
+	void * allocate(std::size_t size) {
+		void * block = std::malloc(size + header_size);
+		if (block == NULL) {
+			return NULL;
+		}
+
+		*static_cast< std::size_t * >(block) = size;
+		allocated_bytes += size;
+		return static_cast< char * >(block) + header_size;
+	}
+
+	void deallocate(void * pointer) {
+		if (pointer != NULL) {
+			char * block = static_cast< char * >(pointer) - header_size;
+			allocated_bytes -= *reinterpret_cast< std::size_t * >(block);
+			std::free(block);
+		}
+	}
+}
+
+/*
+	Replacing the global allocation functions counts the memory in use portably, without asking the C library
+*/
+void * operator new(std::size_t size) {
+	void * pointer = allocate(size);
+	if (pointer == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return pointer;
+}
+
+void * operator new(std::size_t size, std::nothrow_t const &) throw() {
+	return allocate(size);
+}
+
+void operator delete(void * pointer) throw() {
+	deallocate(pointer);
+}
+
+void operator delete(void * pointer, std::nothrow_t const &) throw() {
+	deallocate(pointer);
+}
+
+namespace benchmark {
+	/*
+		Returns the number of bytes currently allocated with new
+	*/
+	long long allocated() {
+		return allocated_bytes;
+	}
+}
@@ -0,0 +1,215 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <debug.hpp>
+
+extern "C" {
+#include <sys/stat.h>
+}
+
+namespace benchmark {
+	typedef std::chrono::steady_clock clock;
+
+	long long allocated();
+
+	/*
+		Returns the number of seconds since a point in time
+	*/
+	double since(clock::time_point start) {
+		return std::chrono::duration< double >(clock::now() - start).count();
+	}
+
+	/*
+		Runs an operation several times and returns the median duration in seconds
+	*/
+	template< typename F >
+	double median(unsigned int runs, F operation) {
+		std::vector< double > durations;
+		durations.reserve(runs);
+
+		for (unsigned int i = 0; i < runs; ++i) {
+			clock::time_point start = clock::now();
+			operation();
+			durations.push_back(since(start));
+		}
+
+		std::sort(durations.begin(), durations.end());
+		return durations[durations.size() / 2];
+	}
+
+	unsigned long long file_size(std::string const & path) {
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 ? info.st_size : 0;
+	}
+
+	/*
+		Reads every argument as a positive number, returning false if any of them isn't one
+	*/
+	bool numbers(std::vector< std::string > const & arguments, std::vector< unsigned long long > & values) {
+		for (std::vector< std::string >::const_iterator i = arguments.begin(); i != arguments.end(); ++i) {
+			unsigned long long value = std::strtoull(i->c_str(), nullptr, 10);
+			if (value == 0) {
+				return false;
+			}
+
+			values.push_back(value);
+		}
+
+		return true;
+	}
+
+	/*
+		The measurements taken in one run of a benchmark, printed in the order they were added
+	*/
+	class Result {
+		std::vector< std::pair< std::string, std::string > > fields_;
+
+	public:
+		void add(std::string const & name, double value) {
+			std::ostringstream text;
+			text << std::fixed << std::setprecision(3) << value;
+			fields_.push_back(std::make_pair(name, text.str()));
+		}
+
+		void count(std::string const & name, unsigned long long value) {
+			fields_.push_back(std::make_pair(name, std::to_string(value)));
+		}
+
+		void text(std::string const & name, std::string const & value) {
+			std::string quoted("\"");
+			for (std::string::const_iterator i = value.begin(); i != value.end(); ++i) {
+				if ((*i == '"') || (*i == '\\')) {
+					quoted += '\\';
+				}
+
+				quoted += *i;
+			}
+
+			fields_.push_back(std::make_pair(name, quoted + "\""));
+		}
+
+		std::vector< std::pair< std::string, std::string > > const & fields() const {
+			return fields_;
+		}
+	};
+
+	/*
+		Prints the results of a benchmark as JSON
+	*/
+	void print(std::string const & benchmark, std::vector< Result > const & results) {
+		std::cout << "{\n"
+		          << "\t\"name\": \"" NAME "\",\n"
+		          << "\t\"version\": \"" VERSION "\",\n"
+		          << "\t\"benchmark\": \"" << benchmark << "\",\n"
+		          << "\t\"results\": [";
+
+		for (std::vector< Result >::const_iterator i = results.begin(); i != results.end(); ++i) {
+			std::cout << (i == results.begin() ? "\n" : ",\n") << "\t\t{";
+
+			std::vector< std::pair< std::string, std::string > > const & fields = i->fields();
+			for (std::size_t j = 0; j < fields.size(); ++j) {
+				std::cout << (j == 0 ? "\n" : ",\n") << "\t\t\t\"" << fields[j].first << "\": " << fields[j].second;
+			}
+
+			std::cout << "\n\t\t}";
+		}
+
+		std::cout << "\n\t]\n}" << std::endl;
+	}
+}
+
+#include "hash_benchmark.hpp"
+#include "history_benchmark.hpp"
+#include "inspector_benchmark.hpp"
+#include "items_benchmark.hpp"
+#include "library_benchmark.hpp"
+#include "pipeline_benchmark.hpp"
+#include "playlist_benchmark.hpp"
+#include "prune_benchmark.hpp"
+#include "roots_benchmark.hpp"
+#include "shuffle_benchmark.hpp"
+#include "tags_benchmark.hpp"
+#include "volume_benchmark.hpp"
+
+namespace {
+	/*
+		A benchmark that can be picked by name
+	*/
+	struct Benchmark {
+		char const * name;
+		char const * arguments;
+		bool (* run)(std::vector< std::string > const & arguments);
+	};
+
+	Benchmark const benchmarks[] = {
+		{"library", "[--database path] [items...]", benchmark::library::run},
+		{"inspector", "[batch sizes...]", benchmark::inspector::run},
+		{"hash", "files...", benchmark::hash::run},
+		{"history", "[plays...]", benchmark::history::run},
+		{"items", "[items...]", benchmark::items::run},
+		{"pipeline", "[runs]", benchmark::pipeline::run},
+		{"playlist", "[entries...]", benchmark::playlist::run},
+		{"prune", "[--directory path] [files...]", benchmark::prune::run},
+		{"roots", "[items...]", benchmark::roots::run},
+		{"shuffle", "[items...]", benchmark::shuffle::run},
+		{"tags", "[runs]", benchmark::tags::run},
+		{"volume", "[items...]", benchmark::volume::run}
+	};
+
+	std::size_t const benchmark_count(sizeof(benchmarks) / sizeof(benchmarks[0]));
+}
+
+/*
+	Usage: mp_benchmark [benchmark] [arguments...]
+
+	The library benchmark is run if no other is named.
+*/
+int main(int argc, char ** argv) {
+	std::vector< std::string > arguments(argv + 1, argv + argc);
+	std::string name("library");
+
+	if (!arguments.empty() && std::isalpha(static_cast< unsigned char >(arguments[0][0]))) {
+		name = arguments[0];
+		arguments.erase(arguments.begin());
+	}
+
+	// Diagnostics would otherwise be interleaved with the results
+	dprint_enable(false);
+
+	for (std::size_t i = 0; i < benchmark_count; ++i) {
+		if ((name == benchmarks[i].name) && benchmarks[i].run(arguments)) {
+			return 0;
+		}
+	}
+
+	std::cerr << "Usage:" << std::endl;
+	for (std::size_t i = 0; i < benchmark_count; ++i) {
+		std::cerr << "\t" << argv[0] << " " << benchmarks[i].name << " " << benchmarks[i].arguments << std::endl;
+	}
+
+	return 1;
+}
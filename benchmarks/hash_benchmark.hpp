@@ -0,0 +1,73 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <core/hash.hpp>
+
+namespace benchmark {
+	namespace hash {
+		/*
+			Measures sampled and full fingerprints of each file given, which should be real media large enough for
+			sampling to matter. The first full read of a file may come from disk, so the median of several runs is
+			reported alongside it.
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			if (arguments.empty()) {
+				return false;
+			}
+
+			std::vector< Result > results;
+			volatile unsigned long long sink = 0;
+
+			for (std::vector< std::string >::const_iterator i = arguments.begin(); i != arguments.end(); ++i) {
+				unsigned long long size = file_size(*i);
+				if (size == 0) {
+					std::cerr << "Unable to read " << *i << std::endl;
+					continue;
+				}
+
+				std::cerr << "Benchmarking " << *i << std::endl;
+
+				clock::time_point start = clock::now();
+				sink += core::Hash::file(*i, true);
+				double first_full = since(start);
+
+				double full = median(5, [&]() {
+					sink += core::Hash::file(*i, true);
+				});
+
+				double sampled = median(101, [&]() {
+					sink += core::Hash::file(*i);
+				});
+
+				Result result;
+				result.text("file", *i);
+				result.count("bytes", size);
+				result.add("sampled_ms", sampled * 1e3);
+				result.add("full_first_ms", first_full * 1e3);
+				result.add("full_ms", full * 1e3);
+				result.add("full_mib_per_second", (size / 1048576.0) / full);
+				results.push_back(result);
+			}
+
+			print("hash", results);
+			return true;
+		}
+	}
+}
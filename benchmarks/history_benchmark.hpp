@@ -0,0 +1,89 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <toolkit/history.hpp>
+#include <toolkit/library.hpp>
+
+namespace benchmark {
+	namespace history {
+		/*
+			Records plays written one at a time into a file-backed library, then the same number through History
+		*/
+		Result measure(std::string const & location, unsigned long long plays) {
+			std::string const journal(location + ".journal");
+			Result result;
+			result.count("plays", plays);
+
+			{
+				toolkit::Library library(location);
+				library.add("Song", "file:///song.ogg", toolkit::Library::Type::Music);
+
+				clock::time_point start = clock::now();
+				for (unsigned long long i = 0; i < plays; ++i) {
+					unsigned long long sequence = library.playSequence() + 1;
+					library.addPlays(std::vector< toolkit::LibraryPlay >(1, toolkit::LibraryPlay(sequence, "file:///song.ogg",
+					                 false, i)));
+				}
+				result.add("direct_us", since(start) / plays * 1e6);
+
+				start = clock::now();
+				{
+					toolkit::History history(library, journal);
+					for (unsigned long long i = 0; i < plays; ++i) {
+						history.played("file:///song.ogg");
+					}
+				}
+				result.add("batched_us", since(start) / plays * 1e6);
+			}
+
+			// The library writes its snapshot when it closes, so its files are removed after
+			std::remove(journal.c_str());
+			std::remove(location.c_str());
+			std::remove((location + ".snapshot").c_str());
+
+			return result;
+		}
+
+		/*
+			Records each number of plays given, or 2,000
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::vector< unsigned long long > counts;
+			if (!numbers(arguments, counts)) {
+				return false;
+			}
+
+			if (counts.empty()) {
+				counts.push_back(2000);
+			}
+
+			std::vector< Result > results;
+
+			for (std::vector< unsigned long long >::const_iterator i = counts.begin(); i != counts.end(); ++i) {
+				std::cerr << "Benchmarking " << *i << " plays" << std::endl;
+				results.push_back(measure("history_benchmark.db", *i));
+			}
+
+			print("history", results);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,176 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <core/filesystem.hpp>
+#include <toolkit/inspector.hpp>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+}
+
+namespace benchmark {
+	namespace inspector {
+		// Number of files inspected for each batch size
+		unsigned int const files(256);
+
+		std::string const directory("benchmark_media");
+
+		std::string path(unsigned int file) {
+			return directory + "/" + std::to_string(file) + ".ogg";
+		}
+
+		/*
+			Fills the directory with copies of the test media, written out to disk so they can be dropped from memory
+			before each run. Returns the URIs of the copies, or nothing if the test media couldn't be found.
+		*/
+		std::vector< std::string > create() {
+			static char const * const sources[] = { "tests/audio.ogg", "tests/video.ogg", "tests/multi.ogg" };
+			std::vector< std::string > uris;
+
+			mkdir(directory.c_str(), 0755);
+
+			for (unsigned int i = 0; i < files; ++i) {
+				{
+					std::ifstream source(sources[i % 3], std::ios::binary);
+					if (!source) {
+						return std::vector< std::string >();
+					}
+
+					std::ofstream destination(path(i).c_str(), std::ios::binary);
+					destination << source.rdbuf();
+				}
+
+				int fd = open(path(i).c_str(), O_RDONLY | O_CLOEXEC);
+				if (fd >= 0) {
+					fsync(fd);
+					close(fd);
+				}
+
+				uris.push_back(core::Path(core::Path::current() + "/" + path(i)).toUri());
+			}
+
+			return uris;
+		}
+
+		/*
+			Asks the kernel to forget the contents of every file, so the next run has to read them from disk
+		*/
+		void drop() {
+			for (unsigned int i = 0; i < files; ++i) {
+				int fd = open(path(i).c_str(), O_RDONLY | O_CLOEXEC);
+				if (fd >= 0) {
+					posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+					close(fd);
+				}
+			}
+		}
+
+		void remove() {
+			for (unsigned int i = 0; i < files; ++i) {
+				std::remove(path(i).c_str());
+			}
+
+			rmdir(directory.c_str());
+		}
+
+		/*
+			Inspects every file with one inspector, handing it the URIs a batch at a time, and returns the time taken in
+			seconds
+		*/
+		double measure(std::vector< std::string > const & uris, unsigned long long batch_size) {
+			toolkit::Inspector inspector(10000);
+			unsigned int valid = 0;
+
+			clock::time_point start = clock::now();
+
+			for (std::vector< std::string >::const_iterator i = uris.begin(); i != uris.end();) {
+				std::vector< std::string >::const_iterator end = i + std::min< std::ptrdiff_t >(batch_size, uris.end() - i);
+				inspector.inspectMany(std::vector< std::string >(i, end), [&](toolkit::InspectorResult const & result) {
+					valid += result.valid();
+				});
+
+				i = end;
+			}
+
+			double seconds = since(start);
+
+			if (valid != uris.size()) {
+				std::cerr << "Only " << valid << " of " << uris.size() << " files could be inspected" << std::endl;
+			}
+
+			return seconds;
+		}
+
+		/*
+			Measures how quickly a batch of files is inspected, both from disk and from memory, at each batch size. A
+			batch size of one reads nothing ahead.
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::vector< unsigned long long > batch_sizes;
+			if (!numbers(arguments, batch_sizes)) {
+				return false;
+			}
+
+			if (batch_sizes.empty()) {
+				batch_sizes.push_back(1);
+				batch_sizes.push_back(16);
+				batch_sizes.push_back(256);
+			}
+
+			std::vector< std::string > uris = create();
+			if (uris.empty()) {
+				std::cerr << "The test media in tests/ is needed to benchmark the inspector" << std::endl;
+				remove();
+				return true;
+			}
+
+			std::vector< Result > results;
+
+			for (std::vector< unsigned long long >::const_iterator i = batch_sizes.begin(); i != batch_sizes.end(); ++i) {
+				std::cerr << "Benchmarking batches of " << *i << " files" << std::endl;
+
+				drop();
+				double cold = measure(uris, *i);
+
+				double warm = median(5, [&]() {
+					measure(uris, *i);
+				});
+
+				Result result;
+				result.count("batch_size", *i);
+				result.count("files", files);
+				result.add("cold_seconds", cold);
+				result.add("cold_files_per_second", files / cold);
+				result.add("warm_seconds", warm);
+				result.add("warm_files_per_second", files / warm);
+				results.push_back(result);
+			}
+
+			remove();
+			print("inspector", results);
+			return true;
+		}
+	}
+}
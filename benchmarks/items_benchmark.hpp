@@ -0,0 +1,105 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <toolkit/library.hpp>
+
+namespace benchmark {
+	namespace items {
+		/*
+			An item allocated on its own, as items were before they were stored in tables
+		*/
+		struct SeparateItem {
+			long long id;
+			std::string title;
+			std::string uri;
+			std::string thumbnail_file;
+		};
+
+		std::string uri(unsigned long long item) {
+			std::string album = std::to_string(item / 12);
+			return "file:///home/user/Music/Artist " + album + "/Album " + album + "/" + std::to_string(item) + ".ogg";
+		}
+
+		std::string thumbnail(unsigned long long item) {
+			return "file:///home/user/.cache/thumbnails/album-" + std::to_string(item / 12) + ".png";
+		}
+
+		/*
+			Compares the memory used by items held in a table against the same items allocated separately, for each
+			number of items given, or for 1M items
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::vector< unsigned long long > sizes;
+			if (!numbers(arguments, sizes)) {
+				return false;
+			}
+
+			if (sizes.empty()) {
+				sizes.push_back(1000000);
+			}
+
+			std::vector< Result > results;
+
+			for (std::vector< unsigned long long >::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+				std::cerr << "Benchmarking " << *i << " items" << std::endl;
+
+				unsigned long long separate_bytes;
+				{
+					long long base = allocated();
+					std::vector< SeparateItem > items;
+					items.reserve(*i);
+
+					for (unsigned long long j = 0; j < *i; ++j) {
+						SeparateItem item = {static_cast< long long >(j), "Track number " + std::to_string(j), uri(j), thumbnail(j)};
+						items.push_back(std::move(item));
+					}
+
+					separate_bytes = allocated() - base;
+				}
+
+				unsigned long long table_bytes;
+				unsigned long long table_memory;
+				{
+					long long base = allocated();
+					toolkit::LibraryItemTable table;
+					table.reserve(*i);
+
+					for (unsigned long long j = 0; j < *i; ++j) {
+						table.add(j, "Track number " + std::to_string(j), uri(j), thumbnail(j));
+					}
+
+					table_bytes = allocated() - base;
+					table_memory = table.memory();
+				}
+
+				Result result;
+				result.count("items", *i);
+				result.count("separate_bytes", separate_bytes);
+				result.count("table_bytes", table_bytes);
+				result.count("table_memory_bytes", table_memory);
+				result.add("saving", static_cast< double >(separate_bytes) / table_bytes);
+				results.push_back(result);
+			}
+
+			print("items", results);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,349 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <core/filesystem.hpp>
+#include <toolkit/library.hpp>
+#include <toolkit/library_search.hpp>
+
+namespace benchmark {
+	namespace library {
+		/*
+			Generates a deterministic library whose shape resembles a real collection: a few prolific artists, albums
+			of varying length with the occasional single or large compilation, and titles of a few common words
+		*/
+		class Generator {
+			std::mt19937 random_;
+			std::vector< std::string > words_;
+			std::vector< std::string > artists_;
+
+			std::string artist_;
+			std::string album_;
+			std::string directory_;
+			unsigned int album_left_;
+			unsigned int track_;
+
+			double uniform() {
+				return std::uniform_real_distribution< double >(0.0, 1.0)(random_);
+			}
+
+			/*
+				Picks a word, favouring the start of the vocabulary in the way natural language favours common words
+			*/
+			std::string const & word() {
+				double u = uniform();
+				return words_[static_cast< std::size_t >(words_.size() * u * u * u)];
+			}
+
+			std::string phrase(unsigned int minimum, unsigned int maximum) {
+				unsigned int length = std::min(maximum, minimum + std::poisson_distribution< unsigned int >(1.5)(random_));
+				std::string result = word();
+
+				for (unsigned int i = 1; i < length; ++i) {
+					result += ' ';
+					result += word();
+				}
+
+				return result;
+			}
+
+			void next_album() {
+				double u = uniform();
+
+				if ((u < 0.3) || artists_.empty()) {
+					artists_.push_back(phrase(1, 3));
+					artist_ = artists_.back();
+				} else {
+					// Artists that already have several albums are the most likely to have another
+					artist_ = artists_[static_cast< std::size_t >(artists_.size() * u * u)];
+				}
+
+				u = uniform();
+
+				if (u < 0.08) {
+					album_left_ = 1;
+				} else if (u < 0.11) {
+					album_left_ = std::uniform_int_distribution< unsigned int >(40, 120)(random_);
+				} else {
+					double length = std::lognormal_distribution< double >(2.4, 0.5)(random_);
+					album_left_ = std::max(2u, std::min(40u, static_cast< unsigned int >(length)));
+				}
+
+				std::string name = phrase(1, 5);
+				album_ = name + " (" + artist_ + ")";
+				directory_ = "/media/music/" + artist_ + "/" + name + "/";
+				track_ = 0;
+			}
+
+		public:
+			Generator(unsigned int seed)
+				: random_(seed), album_left_(0), track_(0) {
+				static char const * const syllables[] = {
+					"a", "ba", "be", "ca", "da", "de", "el", "fa", "go", "ha", "in", "ka", "la", "le", "lo", "ma", "mi",
+					"mo", "na", "ne", "no", "or", "pa", "ra", "re", "ri", "ro", "sa", "se", "so", "ta", "te", "ti", "to",
+					"un", "va", "ve", "wa", "yo", "za"
+				};
+				std::size_t const syllable_count = sizeof(syllables) / sizeof(syllables[0]);
+
+				words_.reserve(5000);
+
+				for (unsigned int i = 0; i < 5000; ++i) {
+					// Common words are short, rare words are long
+					unsigned int length = 1 + (i >= 40) + (i >= 400) + std::uniform_int_distribution< unsigned int >(0, 1)(random_);
+					std::string word;
+
+					for (unsigned int j = 0; j < length; ++j) {
+						word += syllables[std::uniform_int_distribution< std::size_t >(0, syllable_count - 1)(random_)];
+					}
+
+					word[0] = static_cast< char >(std::toupper(static_cast< unsigned char >(word[0])));
+					words_.push_back(word);
+				}
+			}
+
+			std::string const & word(std::size_t rank) const {
+				return words_[std::min(rank, words_.size() - 1)];
+			}
+
+			/*
+				Adds the next generated item to the library
+			*/
+			void add(toolkit::Library & library) {
+				if (uniform() < 0.08) {
+					std::string title = phrase(1, 6);
+
+					if (uniform() < 0.5) {
+						title += " (" + std::to_string(std::uniform_int_distribution< unsigned int >(1930, 2011)(random_)) + ")";
+					}
+
+					library.add(title, core::Path("/media/films/" + title + ".mkv").toUri(), toolkit::Library::Type::Movies);
+					return;
+				}
+
+				if (album_left_ == 0) {
+					next_album();
+				}
+
+				std::string title = phrase(1, 8);
+
+				if (uniform() < 0.05) {
+					title += uniform() < 0.5 ? " (Live)" : " (Remastered)";
+				}
+
+				++track_;
+				--album_left_;
+
+				std::string number = (track_ < 10 ? "0" : "") + std::to_string(track_);
+				library.add(title, core::Path(directory_ + number + " " + title + ".ogg").toUri(),
+				            toolkit::Library::Type::Music, "", album_);
+			}
+		};
+
+		/*
+			Builds a library of the given size from scratch and measures it through a full session and a restart
+		*/
+		Result measure(std::string const & location, unsigned long long items) {
+			Result result;
+			result.count("items", items);
+
+			std::remove(location.c_str());
+			std::remove((location + ".snapshot").c_str());
+
+			Generator generator(items);
+			std::vector< std::string > terms;
+			terms.push_back(generator.word(0));
+			terms.push_back(generator.word(100));
+			terms.push_back(generator.word(3000));
+
+			// A fuzzy query is a common word with a typing mistake in it
+			std::string fuzzy = generator.word(200);
+			fuzzy.erase(fuzzy.size() / 2, 1);
+
+			volatile std::size_t sink = 0;
+
+			{
+				toolkit::Library * library = new toolkit::Library(location);
+
+				clock::time_point start = clock::now();
+
+				for (unsigned long long i = 0; i < items; i += 1000) {
+					// The importer commits in batches of about this size
+					library->begin();
+
+					for (unsigned long long j = i; (j < items) && (j < i + 1000); ++j) {
+						generator.add(*library);
+					}
+
+					library->commit();
+				}
+
+				double import_seconds = since(start);
+				result.add("import_seconds", import_seconds);
+				result.add("import_items_per_second", items / import_seconds);
+
+				result.add("count_us", median(101, [&]() {
+					sink += library->count(toolkit::Library::Type::All);
+				}) * 1e6);
+
+				result.add("facets_ms", median(5, [&]() {
+					sink += library->facets().size();
+				}) * 1e3);
+
+				result.add("list_ms", median(5, [&]() {
+					sink += library->list(toolkit::Library::Type::All).size();
+				}) * 1e3);
+
+				result.add("search_ms", median(15, [&]() {
+					for (std::vector< std::string >::const_iterator i = terms.begin(); i != terms.end(); ++i) {
+						sink += library->search(toolkit::Library::Type::All, *i).size();
+					}
+				}) * 1e3 / terms.size());
+
+				start = clock::now();
+				sink += library->search(toolkit::Library::Type::All, fuzzy, toolkit::Library::Match::Fuzzy).size();
+				result.add("fuzzy_build_ms", since(start) * 1e3);
+
+				result.add("fuzzy_search_ms", median(15, [&]() {
+					sink += library->search(toolkit::Library::Type::All, fuzzy, toolkit::Library::Match::Fuzzy).size();
+				}) * 1e3);
+
+				// Search as you type reports its slowest keystroke, as that is the one the browser stalls on
+				std::string typed = terms[0] + " " + terms[1];
+				double slowest = 0.0;
+				{
+					toolkit::LibrarySearch search(*library);
+					sink += search.search(toolkit::Library::Type::All, "").size();
+
+					for (std::size_t length = 1; length <= typed.size(); ++length) {
+						start = clock::now();
+						sink += search.search(toolkit::Library::Type::All, typed.substr(0, length)).size();
+						slowest = std::max(slowest, since(start));
+					}
+				}
+				result.add("typing_slowest_ms", slowest * 1e3);
+
+				// Plays of every seventh item, the last half of them recent and every fifth one skipped
+				toolkit::LibraryItemTable listed = library->list(toolkit::Library::Type::All);
+				std::vector< toolkit::LibraryPlay > plays;
+				unsigned long long sequence = library->playSequence();
+				for (std::size_t i = 0; i < listed.size(); i += 7) {
+					plays.push_back(toolkit::LibraryPlay(++sequence, listed[i].uri(), plays.size() % 5 == 0, i));
+				}
+				library->addPlays(plays);
+
+				typedef toolkit::LibraryRule Rule;
+				std::vector< Rule > rules;
+				rules.push_back(Rule(Rule::Field::LastPlayed, Rule::Comparison::Greater,
+				                     static_cast< long long >(listed.size() / 2)));
+				rules.push_back(Rule(Rule::Field::Type, Rule::Comparison::Is, "music"));
+				rules.push_back(Rule(Rule::Field::Plays, Rule::Comparison::Greater, 0LL));
+				rules.push_back(Rule(Rule::Field::Plays, Rule::Comparison::Less, 100LL));
+				rules.push_back(Rule(Rule::Field::Skips, Rule::Comparison::Is, 0LL));
+				rules.push_back(Rule(Rule::Field::Title, Rule::Comparison::IsNot, terms[0]));
+				rules.push_back(Rule(Rule::Field::Duration, Rule::Comparison::IsNot, 0LL));
+				library->setSmartPlaylist("Benchmark", rules);
+
+				start = clock::now();
+				std::size_t matched = library->smartPlaylist("Benchmark").size();
+				result.add("smart_playlist_ms", since(start) * 1e3);
+				result.count("smart_playlist_items", matched);
+
+				result.add("smart_playlist_cached_us", median(101, [&]() {
+					sink += library->smartPlaylist("Benchmark").size();
+				}) * 1e6);
+
+				// Closing writes the snapshot that the next start up lists from
+				start = clock::now();
+				delete library;
+				result.add("close_ms", since(start) * 1e3);
+			}
+
+			result.count("database_bytes", file_size(location));
+			result.count("snapshot_bytes", file_size(location + ".snapshot"));
+
+			{
+				clock::time_point start = clock::now();
+				toolkit::Library library(location);
+				result.add("open_ms", since(start) * 1e3);
+
+				result.add("snapshot_list_ms", median(5, [&]() {
+					sink += library.list(toolkit::Library::Type::All).size();
+				}) * 1e3);
+
+				// Dropping leading articles from the collation means making every item's key again
+				library.setCollation(std::make_shared< toolkit::LibraryCollation >("C", std::vector< std::string >()));
+
+				start = clock::now();
+				while (library.rekey()) {}
+				result.add("rekey_ms", since(start) * 1e3);
+
+				result.add("collated_list_ms", median(5, [&]() {
+					sink += library.list(toolkit::Library::Type::All).size();
+				}) * 1e3);
+			}
+
+			std::remove(location.c_str());
+			std::remove((location + ".snapshot").c_str());
+
+			return result;
+		}
+
+		/*
+			Builds libraries of each size given, or of 10k, 100k and 1M items
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::string location("benchmark.db");
+			std::vector< std::string > rest;
+
+			for (std::size_t i = 0; i < arguments.size(); ++i) {
+				if ((arguments[i] == "--database") && (i + 1 < arguments.size())) {
+					location = arguments[++i];
+				} else {
+					rest.push_back(arguments[i]);
+				}
+			}
+
+			std::vector< unsigned long long > sizes;
+			if (!numbers(rest, sizes)) {
+				return false;
+			}
+
+			if (sizes.empty()) {
+				sizes.push_back(10000);
+				sizes.push_back(100000);
+				sizes.push_back(1000000);
+			}
+
+			std::vector< Result > results;
+
+			for (std::vector< unsigned long long >::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+				std::cerr << "Benchmarking " << *i << " items" << std::endl;
+				results.push_back(measure(location, *i));
+			}
+
+			print("library", results);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,103 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <core/filesystem.hpp>
+#include <toolkit/inspector.hpp>
+
+namespace benchmark {
+	namespace pipeline {
+		/*
+			Inspects each file in turn, either with a new pipeline for each or by reusing one pipeline for all of them
+		*/
+		Result measure(std::string const & source, std::vector< std::string > const & uris, unsigned long long runs,
+		               bool reuse) {
+			toolkit::Inspector recycled(0, false);
+			unsigned long long setup = 0;
+			unsigned long long valid = 0;
+
+			clock::time_point start = clock::now();
+
+			for (unsigned long long i = 0; i < runs; ++i) {
+				for (std::vector< std::string >::const_iterator uri = uris.begin(); uri != uris.end(); ++uri) {
+					if (reuse) {
+						valid += recycled.inspect(*uri);
+						setup += recycled.setupTime();
+					} else {
+						toolkit::Inspector fresh(*uri, 0, false);
+						valid += fresh.valid();
+						setup += fresh.setupTime();
+					}
+				}
+			}
+
+			double seconds = since(start);
+			unsigned long long files = runs * uris.size();
+
+			if (valid != files) {
+				std::cerr << "Only " << valid << " of " << files << " files could be inspected" << std::endl;
+			}
+
+			Result result;
+			result.text("source", source);
+			result.text("pipeline", reuse ? "recycled" : "new");
+			result.count("files", files);
+			result.add("setup_us", static_cast< double >(setup) / files);
+			result.add("file_ms", seconds * 1e3 / files);
+			result.add("files_per_second", files / seconds);
+			return result;
+		}
+
+		/*
+			Compares a new pipeline for each file against one reused for every file, over the test media inspected the
+			given number of times, or 50. Each sample is then timed on its own, to compare how long audio and video
+			sources take to read.
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::vector< unsigned long long > runs;
+			if (!numbers(arguments, runs) || (runs.size() > 1)) {
+				return false;
+			}
+
+			if (runs.empty()) {
+				runs.push_back(50);
+			}
+
+			static char const * const samples[] = { "audio.ogg", "video.ogg", "multi.ogg" };
+			std::size_t const sample_count = sizeof(samples) / sizeof(samples[0]);
+
+			std::vector< std::string > uris;
+			for (std::size_t i = 0; i < sample_count; ++i) {
+				uris.push_back(core::Path(core::Path::current() + "/tests/" + samples[i]).toUri());
+			}
+
+			std::vector< Result > results;
+			results.push_back(measure("all", uris, runs[0], false));
+			results.push_back(measure("all", uris, runs[0], true));
+
+			for (std::size_t i = 0; i < sample_count; ++i) {
+				results.push_back(measure(samples[i], std::vector< std::string >(1, uris[i]), runs[0], true));
+			}
+
+			print("pipeline", results);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,96 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <toolkit/library.hpp>
+#include <toolkit/playlist.hpp>
+
+namespace benchmark {
+	namespace playlist {
+		/*
+			Imports an extended M3U of the given length into a file-backed library, then reopens it
+		*/
+		Result measure(std::string const & location, unsigned long long entries) {
+			std::string const m3u_path(location + ".m3u");
+			Result result;
+			result.count("entries", entries);
+
+			{
+				std::ofstream m3u(m3u_path.c_str());
+				m3u << "#EXTM3U\n";
+				for (unsigned long long i = 0; i < entries; ++i) {
+					m3u << "#EXTINF:200,Track " << i << "\n/music/" << i / 12 << "/" << i << ".ogg\n";
+				}
+			}
+
+			volatile std::size_t sink = 0;
+
+			{
+				toolkit::Library library(location);
+
+				clock::time_point start = clock::now();
+				{
+					toolkit::Playlist playlist(library, "Imported");
+					sink += playlist.import(m3u_path);
+				}
+				double import_seconds = since(start);
+				result.add("import_ms", import_seconds * 1e3);
+				result.add("import_entries_per_second", entries / import_seconds);
+
+				result.add("open_ms", median(5, [&]() {
+					sink += toolkit::Playlist(library, "Imported").size();
+				}) * 1e3);
+			}
+
+			// The library writes its snapshot when it closes, so its files are removed after
+			std::remove(m3u_path.c_str());
+			std::remove(location.c_str());
+			std::remove((location + ".snapshot").c_str());
+
+			return result;
+		}
+
+		/*
+			Imports playlists of each length given, or of 10k and 100k entries
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::vector< unsigned long long > sizes;
+			if (!numbers(arguments, sizes)) {
+				return false;
+			}
+
+			if (sizes.empty()) {
+				sizes.push_back(10000);
+				sizes.push_back(100000);
+			}
+
+			std::vector< Result > results;
+
+			for (std::vector< unsigned long long >::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+				std::cerr << "Benchmarking " << *i << " entries" << std::endl;
+				results.push_back(measure("playlist_benchmark.db", *i));
+			}
+
+			print("playlist", results);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,125 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <core/filesystem.hpp>
+#include <toolkit/library.hpp>
+
+namespace benchmark {
+	namespace prune {
+		/*
+			Creates the files for a library of the given size in directories of 100, leaves one in ten of them out, and
+			compares checking each file in turn against pruning
+		*/
+		Result measure(std::string const & base, unsigned long long files) {
+			unsigned long long const per_directory = 100;
+			Result result;
+			result.count("files", files);
+
+			toolkit::Library library("");
+			library.begin();
+			for (unsigned long long i = 0; i < files; ++i) {
+				std::string directory = base + std::to_string(i / per_directory);
+				std::string path = directory + "/" + std::to_string(i % per_directory) + ".ogg";
+				if (i % per_directory == 0) {
+					core::Path(directory).create();
+				}
+
+				if (i % 10 != 0) {
+					std::ofstream(path.c_str()) << i;
+				}
+
+				library.add(std::to_string(i), core::Path(path).toUri(), toolkit::Library::Type::Music);
+			}
+			library.commit();
+
+			clock::time_point start = clock::now();
+			unsigned long long missing = 0;
+			toolkit::LibraryItemTable items = library.list(toolkit::Library::Type::All);
+			for (std::size_t i = 0; i < items.size(); ++i) {
+				if (!core::Path::exists(core::Path::fromUri(items[i].uri()))) {
+					++missing;
+				}
+			}
+			result.add("check_each_ms", since(start) * 1e3);
+
+			start = clock::now();
+			result.count("pruned", library.prune());
+			result.add("prune_ms", since(start) * 1e3);
+			result.count("missing", missing);
+
+			for (unsigned long long i = 0; i < files; ++i) {
+				std::remove((base + std::to_string(i / per_directory) + "/" + std::to_string(i % per_directory) +
+				             ".ogg").c_str());
+				if (i % per_directory == per_directory - 1) {
+					core::Path::remove(base + std::to_string(i / per_directory));
+				}
+			}
+			core::Path::remove(base + std::to_string((files - 1) / per_directory));
+
+			return result;
+		}
+
+		/*
+			Prunes libraries of each size given, or of 10k and 100k files, in a directory that may be given to measure
+			a slower disk or a network share
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::string base(core::Path::current() + "/prune_benchmark");
+			std::vector< std::string > rest;
+
+			for (std::size_t i = 0; i < arguments.size(); ++i) {
+				if ((arguments[i] == "--directory") && (i + 1 < arguments.size())) {
+					base = arguments[++i];
+				} else {
+					rest.push_back(arguments[i]);
+				}
+			}
+
+			std::vector< unsigned long long > sizes;
+			if (!numbers(rest, sizes)) {
+				return false;
+			}
+
+			if (sizes.empty()) {
+				sizes.push_back(10000);
+				sizes.push_back(100000);
+			}
+
+			if (!core::Path(base).create()) {
+				std::cerr << "Unable to create " << base << std::endl;
+				return false;
+			}
+
+			std::vector< Result > results;
+
+			for (std::vector< unsigned long long >::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+				std::cerr << "Benchmarking " << *i << " files" << std::endl;
+				results.push_back(measure(base + "/", *i));
+			}
+
+			core::Path::remove(base);
+
+			print("prune", results);
+			return true;
+		}
+	}
+}
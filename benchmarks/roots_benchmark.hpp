@@ -0,0 +1,88 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <toolkit/library.hpp>
+
+namespace benchmark {
+	namespace roots {
+		/*
+			Returns the size of a library of generated items, with or without a root that they are stored relative to
+		*/
+		unsigned long long size(std::string const & location, unsigned long long items, bool rooted) {
+			{
+				toolkit::Library library(location);
+				if (rooted) {
+					library.addRoot("file:///media/");
+				}
+
+				library::Generator generator(items);
+				for (unsigned long long i = 0; i < items; i += 1000) {
+					library.begin();
+
+					for (unsigned long long j = i; (j < items) && (j < i + 1000); ++j) {
+						generator.add(library);
+					}
+
+					library.commit();
+				}
+			}
+
+			unsigned long long bytes = file_size(location);
+			std::remove(location.c_str());
+			std::remove((location + ".snapshot").c_str());
+
+			return bytes;
+		}
+
+		/*
+			Compares databases of each size given, or of 100k items
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::vector< unsigned long long > sizes;
+			if (!numbers(arguments, sizes)) {
+				return false;
+			}
+
+			if (sizes.empty()) {
+				sizes.push_back(100000);
+			}
+
+			std::vector< Result > results;
+
+			for (std::vector< unsigned long long >::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+				std::cerr << "Benchmarking " << *i << " items" << std::endl;
+
+				unsigned long long full = size("roots_benchmark.db", *i, false);
+				unsigned long long rooted = size("roots_benchmark.db", *i, true);
+
+				Result result;
+				result.count("items", *i);
+				result.count("full_uri_bytes", full);
+				result.count("rooted_bytes", rooted);
+				result.add("saving", 1.0 - static_cast< double >(rooted) / full);
+				results.push_back(result);
+			}
+
+			print("roots", results);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,84 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <toolkit/library.hpp>
+#include <toolkit/shuffle.hpp>
+
+namespace benchmark {
+	namespace shuffle {
+		/*
+			Sets up a shuffle of one type of item and picks from it, with films every tenth item so that a shuffle of
+			them skips over nine IDs in ten
+		*/
+		void measure(toolkit::Library & library, toolkit::Library::Type type, std::string const & prefix,
+		             Result & result) {
+			unsigned int const picks = 10000;
+			volatile std::size_t sink = 0;
+
+			clock::time_point start = clock::now();
+			toolkit::Shuffle shuffle(library, type, "", 7);
+			result.add(prefix + "_setup_ms", since(start) * 1e3);
+
+			start = clock::now();
+			for (unsigned int i = 0; i < picks; ++i) {
+				sink += shuffle.next().size();
+			}
+			result.add(prefix + "_pick_us", since(start) / picks * 1e6);
+		}
+
+		/*
+			Shuffles libraries of each size given, or of 200k and 1M items
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::vector< unsigned long long > sizes;
+			if (!numbers(arguments, sizes)) {
+				return false;
+			}
+
+			if (sizes.empty()) {
+				sizes.push_back(200000);
+				sizes.push_back(1000000);
+			}
+
+			std::vector< Result > results;
+
+			for (std::vector< unsigned long long >::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+				std::cerr << "Benchmarking " << *i << " items" << std::endl;
+
+				toolkit::Library library("");
+				library.begin();
+				for (unsigned long long j = 0; j < *i; ++j) {
+					library.add("Item " + std::to_string(j), "file:///media/" + std::to_string(j) + ".ogg",
+					            (j % 10 == 9) ? toolkit::Library::Type::Movies : toolkit::Library::Type::Music);
+				}
+				library.commit();
+
+				Result result;
+				result.count("items", *i);
+				measure(library, toolkit::Library::Type::Music, "music", result);
+				measure(library, toolkit::Library::Type::Movies, "movies", result);
+				results.push_back(result);
+			}
+
+			print("shuffle", results);
+			return true;
+		}
+	}
+}
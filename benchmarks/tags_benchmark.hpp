@@ -0,0 +1,81 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <core/filesystem.hpp>
+#include <toolkit/inspector.hpp>
+#include <toolkit/tag_reader.hpp>
+
+namespace benchmark {
+	namespace tags {
+		/*
+			Compares reading the headers of each test sample natively against inspecting it with a pipeline, reading
+			each the given number of times, or 50
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::vector< unsigned long long > runs;
+			if (!numbers(arguments, runs) || (runs.size() > 1)) {
+				return false;
+			}
+
+			if (runs.empty()) {
+				runs.push_back(50);
+			}
+
+			static char const * const samples[] = { "audio.ogg", "video.ogg", "multi.ogg" };
+
+			toolkit::TagReader reader;
+			toolkit::Inspector inspector(0, false);
+			std::vector< Result > results;
+
+			for (std::size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+				std::string uri = core::Path(core::Path::current() + "/tests/" + samples[i]).toUri();
+				unsigned long long read = 0;
+
+				clock::time_point start = clock::now();
+				for (unsigned long long run = 0; run < runs[0]; ++run) {
+					read += reader.read(uri);
+				}
+				double native = since(start);
+
+				start = clock::now();
+				for (unsigned long long run = 0; run < runs[0]; ++run) {
+					read += inspector.inspect(uri);
+				}
+				double pipeline = since(start);
+
+				if (read != 2 * runs[0]) {
+					std::cerr << samples[i] << " couldn't be read every time" << std::endl;
+				}
+
+				Result result;
+				result.text("sample", samples[i]);
+				result.count("runs", runs[0]);
+				result.add("native_us", native * 1e6 / runs[0]);
+				result.add("pipeline_us", pipeline * 1e6 / runs[0]);
+				result.add("speedup", pipeline / native);
+				results.push_back(result);
+			}
+
+			print("tags", results);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,96 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <toolkit/library.hpp>
+
+namespace benchmark {
+	namespace volume {
+		/*
+			Times attaching a drive of generated items that has already been indexed, and listing it with the library's
+			own items
+		*/
+		Result attach(std::string const & location, unsigned long long items) {
+			{
+				toolkit::Library library("");
+				library.attachVolume("drive", "file:///media/", location);
+
+				library::Generator generator(items);
+				for (unsigned long long i = 0; i < items; i += 1000) {
+					library.begin();
+
+					for (unsigned long long j = i; (j < items) && (j < i + 1000); ++j) {
+						generator.add(library);
+					}
+
+					library.commit();
+				}
+			}
+
+			toolkit::Library library("");
+			library.add("Local", "file:///home/music/local.ogg", toolkit::Library::Type::Music);
+
+			clock::time_point start = clock::now();
+			library.attachVolume("drive", "file:///media/", location);
+			unsigned long long count = library.count(toolkit::Library::Type::All);
+			double attaching = since(start);
+
+			start = clock::now();
+			unsigned long long listed = library.list(toolkit::Library::Type::All).size();
+			double listing = since(start);
+
+			library.detachVolume("drive");
+			std::remove(location.c_str());
+
+			Result result;
+			result.count("items", items);
+			result.count("counted", count);
+			result.count("listed", listed);
+			result.add("attach_ms", attaching * 1e3);
+			result.add("list_ms", listing * 1e3);
+			return result;
+		}
+
+		/*
+			Attaches volumes of each size given, or of 100k items
+		*/
+		bool run(std::vector< std::string > const & arguments) {
+			std::vector< unsigned long long > sizes;
+			if (!numbers(arguments, sizes)) {
+				return false;
+			}
+
+			if (sizes.empty()) {
+				sizes.push_back(100000);
+			}
+
+			std::vector< Result > results;
+
+			for (std::vector< unsigned long long >::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+				std::cerr << "Benchmarking " << *i << " items" << std::endl;
+				results.push_back(attach("volume_benchmark.db", *i));
+			}
+
+			print("volume", results);
+			return true;
+		}
+	}
+}
@@ -20,6 +20,7 @@
 
 #include "core/database.hpp"
 #include "core/filesystem.hpp"
+#include "core/hash.hpp"
 #include "core/noncopiable.hpp"
 
 #endif
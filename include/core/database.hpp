@@ -48,6 +48,13 @@ namespace core {
 
 		void clear();
 
+		long long lastInsertId() const;
+		long long changes() const;
+
+		bool begin();
+		bool commit();
+		bool rollback();
+
 		std::vector< std::string > tables();
 	};
 
@@ -39,11 +39,14 @@ namespace core {
 		bool create();
 
 		std::string toString() const;
+		std::string toUri() const;
 
 		static std::string current();
 		static std::string data();
 		static std::string home();
 
+		static std::string fromUri(std::string const uri);
+
 		static bool exists(std::string const path);
 		static bool remove(std::string const path);
 	};
@@ -0,0 +1,34 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _CORE_HASH_HPP
+#define _CORE_HASH_HPP
+
+#include <string>
+
+namespace core {
+	/*
+		Fast non-cryptographic hashing for fingerprinting file contents
+	*/
+	class Hash {
+	public:
+		static unsigned long long data(void const * data, unsigned long long size, unsigned long long seed = 0);
+		static unsigned long long file(std::string const path, bool full = false);
+	};
+}
+
+#endif
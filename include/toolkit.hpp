@@ -19,8 +19,14 @@
 #define _TOOLKIT_HPP
 
 #include "toolkit/configuration.hpp"
+#include "toolkit/history.hpp"
+#include "toolkit/importer.hpp"
 #include "toolkit/inspector.hpp"
+#include "toolkit/inspector_pool.hpp"
 #include "toolkit/interface.hpp"
 #include "toolkit/library.hpp"
+#include "toolkit/library_search.hpp"
+#include "toolkit/playlist.hpp"
+#include "toolkit/watcher.hpp"
 
 #endif
@@ -0,0 +1,49 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_HISTORY_HPP
+#define _TOOLKIT_HISTORY_HPP
+
+#include <string>
+#include <core/noncopiable.hpp>
+
+namespace toolkit {
+	class HistoryPrivate;
+	class Library;
+
+	/*
+		Records plays and skips without waiting on the library, writing them in batches and keeping a journal of those
+		not yet written in case the programme stops before they are
+	*/
+	class History
+			: core::NonCopiable {
+		HistoryPrivate * p;
+
+	public:
+		History(Library & library, std::string journal, unsigned int threshold = 64, unsigned int interval = 5000);
+		~History();
+
+		void played(std::string uri);
+		void skipped(std::string uri);
+
+		unsigned long long pending() const;
+		bool process();
+		void flush();
+	};
+}
+
+#endif
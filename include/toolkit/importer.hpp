@@ -0,0 +1,52 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_IMPORTER_HPP
+#define _TOOLKIT_IMPORTER_HPP
+
+#include <memory>
+#include <string>
+#include <core/noncopiable.hpp>
+
+namespace toolkit {
+	class ImporterPrivate;
+	class InspectorCache;
+	class Library;
+
+	/*
+		Adds the media files beneath a directory to the library, linking copies of the same file to one item. Files in
+		the cache, if there is one, aren't inspected again unless they have changed.
+	*/
+	class Importer
+			: core::NonCopiable {
+		ImporterPrivate * p;
+
+	public:
+		enum class Mode {
+		    Full,
+		    Incremental
+		};
+
+		Importer(Library & library, unsigned int threads = 0, bool full_hash = false,
+		         std::shared_ptr< InspectorCache > cache = nullptr);
+		~Importer();
+
+		unsigned long long scan(std::string directory, Mode mode = Mode::Incremental, bool recursive = true) const;
+	};
+}
+
+#endif
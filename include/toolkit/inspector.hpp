@@ -18,25 +18,83 @@
 #ifndef _TOOLKIT_INSPECTOR_HPP
 #define _TOOLKIT_INSPECTOR_HPP
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 #include <core/noncopiable.hpp>
+#include <toolkit/media_details.hpp>
 
 namespace toolkit {
+	class InspectorCache;
 	class InspectorPrivate;
 
+	/*
+		The outcome of inspecting a single URI in a batch, or on an inspector pool or queue
+	*/
+	class InspectorResult {
+		unsigned long long index_;
+
+		std::string uri_;
+
+		bool valid_;
+		bool audio_;
+		bool video_;
+
+		std::string title_;
+		std::string album_;
+		MediaDetails details_;
+
+	public:
+		InspectorResult(unsigned long long index, std::string uri, bool valid = false, bool audio = false,
+		                bool video = false, std::string title = std::string(), std::string album = std::string(),
+		                MediaDetails details = MediaDetails());
+
+		unsigned long long index() const;
+		std::string uri() const;
+
+		bool valid() const;
+		bool audio() const;
+		bool video() const;
+
+		std::string album() const;
+		std::string title() const;
+		MediaDetails details() const;
+	};
+
+	/*
+		Finds the streams and tags of a media source, waiting up to timeout milliseconds for it to be read. One
+		inspector can inspect many sources in turn, reusing its pipeline for each of them. Unless native is false,
+		local files in common formats have their headers read directly without a pipeline. With a cache, local files
+		that were inspected before and haven't changed since aren't read at all.
+
+		Given a batch of URIs, an inspector reads ahead the next few local files while it inspects the current one,
+		and answers those in the cache as soon as it comes to them.
+	*/
 	class Inspector
 			: core::NonCopiable {
 		InspectorPrivate * p;
 
 	public:
-		Inspector(std::string uri);
+		Inspector(unsigned int timeout = 0, bool native = true);
+		Inspector(std::string uri, unsigned int timeout = 0, bool native = true);
 		~Inspector();
 
+		void setCache(std::shared_ptr< InspectorCache > cache);
+
+		bool inspect(std::string const & uri) const;
+		void inspectMany(std::vector< std::string > const & uris,
+		                 std::function< void (InspectorResult const &) > callback) const;
+		unsigned long long setupTime() const;
+
+		bool valid() const;
+
 		bool audio() const;
 		bool video() const;
 
 		std::string album() const;
 		std::string title() const;
+		MediaDetails details() const;
 	};
 }
 
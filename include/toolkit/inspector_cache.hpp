@@ -0,0 +1,60 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_INSPECTOR_CACHE_HPP
+#define _TOOLKIT_INSPECTOR_CACHE_HPP
+
+#include <mutex>
+#include <string>
+#include <core/database.hpp>
+#include <toolkit/inspector.hpp>
+#include <toolkit/library.hpp>
+
+namespace toolkit {
+	/*
+		Remembers what was found by inspecting local files, so a file that hasn't changed is never inspected twice.
+		Files are known by their device and inode, and an entry only matches while the file's size and modification
+		time are the same. One cache can be shared by inspectors on different threads.
+	*/
+	class InspectorCache
+			: private core::Database {
+		mutable std::mutex mutex_;
+
+		unsigned long long hits_;
+		unsigned long long misses_;
+
+		core::Statement * find_stmt_;
+		core::Statement * store_stmt_;
+
+		void initialise_db();
+
+	public:
+		InspectorCache();
+		InspectorCache(std::string location);
+		~InspectorCache();
+
+		static LibraryFile identify(std::string const & uri);
+
+		bool find(LibraryFile const & file, InspectorResult & result);
+		void store(LibraryFile const & file, InspectorResult const & result);
+
+		unsigned long long hits() const;
+		unsigned long long misses() const;
+	};
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_INSPECTOR_POOL_HPP
+#define _TOOLKIT_INSPECTOR_POOL_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <core/noncopiable.hpp>
+#include <toolkit/inspector.hpp>
+
+namespace toolkit {
+	class InspectorPoolPrivate;
+
+	/*
+		Inspects many URIs at once on a set of worker threads
+	*/
+	class InspectorPool
+			: core::NonCopiable {
+		InspectorPoolPrivate * p;
+
+	public:
+		InspectorPool(unsigned int threads = 0, unsigned int queue_size = 0, unsigned int timeout = 10000);
+		~InspectorPool();
+
+		unsigned int threads() const;
+		void setCache(std::shared_ptr< InspectorCache > cache);
+
+		void inspect(std::vector< std::string > const & uris,
+		             std::function< void (InspectorResult const &) > callback) const;
+	};
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_INSPECTOR_QUEUE_HPP
+#define _TOOLKIT_INSPECTOR_QUEUE_HPP
+
+#include <functional>
+#include <string>
+#include <core/noncopiable.hpp>
+#include <toolkit/inspector.hpp>
+
+namespace toolkit {
+	class InspectorQueuePrivate;
+
+	/*
+		Inspects URIs without waiting for them, calling back on the GLib main context that was the thread default
+		when the queue was created. A few sources are read at once, and each is given up on once its timeout in
+		milliseconds has passed, so a slow source never holds up the rest.
+	*/
+	class InspectorQueue
+			: core::NonCopiable {
+		InspectorQueuePrivate * p;
+
+	public:
+		InspectorQueue(unsigned int timeout = 10000, unsigned int concurrency = 4);
+		~InspectorQueue();
+
+		unsigned long long inspect(std::string uri, std::function< void (InspectorResult const &) > callback,
+		                           unsigned int timeout = 0) const;
+		bool cancel(unsigned long long id) const;
+		void cancelAll() const;
+
+		unsigned long long pending() const;
+		void wait() const;
+	};
+}
+
+#endif
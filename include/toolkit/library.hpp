@@ -18,28 +18,235 @@
 #ifndef _TOOLKIT_LIBRARY_HPP
 #define _TOOLKIT_LIBRARY_HPP
 
+#include <functional>
+#include <locale>
+#include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <core/database.hpp>
+#include <toolkit/media_details.hpp>
 
 namespace toolkit {
+	class LibrarySmartPlaylist;
+	class LibrarySnapshot;
+	class LibraryTrigramIndex;
+	class LibraryVolume;
+
+	class LibraryItemTablePrivate;
+
+	/*
+		A view of a single item in a library item table
+	*/
 	class LibraryItem {
+		friend class LibraryItemTable;
+
+		std::shared_ptr< LibraryItemTablePrivate const > table_;
+		std::size_t index_;
+
+		LibraryItem(std::shared_ptr< LibraryItemTablePrivate const > table, std::size_t index);
+
+	public:
+		long long id() const;
+
+		std::string title() const;
+		std::string uri() const;
+		std::string thumbnailFile() const;
+	};
+
+	/*
+		A list of library items, stored as arrays of IDs and offsets into a shared string arena
+	*/
+	class LibraryItemTable {
+		std::shared_ptr< LibraryItemTablePrivate > p;
+
+		void detach();
+
+	public:
+		LibraryItemTable();
+
+		void reserve(std::size_t size);
+		void add(long long id, std::string const & title, std::string const & uri,
+		         std::string const & thumbnail_file = std::string());
+
+		bool empty() const;
+		std::size_t size() const;
+
+		LibraryItem at(std::size_t index) const;
+		LibraryItem operator[](std::size_t index) const;
+
+		unsigned long long memory() const;
+	};
+
+	/*
+		The state of a file on disk when it was last inspected
+	*/
+	class LibraryFile {
+		std::string path_;
+
+		unsigned long long device_;
+		unsigned long long inode_;
+		unsigned long long size_;
+		long long modified_;
+
+		unsigned long long hash_;
+
+	public:
+		LibraryFile(std::string path, unsigned long long device, unsigned long long inode, unsigned long long size,
+		            long long modified, unsigned long long hash = 0);
+
+		std::string path() const;
+
+		unsigned long long device() const;
+		unsigned long long inode() const;
+		unsigned long long size() const;
+		long long modified() const;
+
+		unsigned long long hash() const;
+		void setHash(unsigned long long hash);
+
+		bool unchanged(LibraryFile const & file) const;
+	};
+
+	/*
+		The number of items sharing a type, album or directory
+	*/
+	class LibraryFacet {
+	public:
+		enum class Kind {
+		    Type,
+		    Album,
+		    Directory
+		};
+
+	private:
+		Kind kind_;
+		std::string name_;
+		unsigned long long count_;
+
+	public:
+		LibraryFacet(Kind kind, std::string name, unsigned long long count);
+
+		Kind kind() const;
+		std::string name() const;
+		unsigned long long count() const;
+	};
+
+	/*
+		An entry in a playlist, ordered by a position key that leaves gaps for entries to be placed between others
+	*/
+	class LibraryPlaylistEntry {
 		long long id_;
+		long long position_;
 
-		std::string title_;
 		std::string uri_;
-		std::string thumbnail_;
+		std::string title_;
 
 	public:
-		LibraryItem(long long id, std::string title, std::string uri, std::string thumbnail_file = std::string());
-		LibraryItem(LibraryItem const & library_item);
-		LibraryItem(LibraryItem && library_item);
+		LibraryPlaylistEntry(long long id, long long position, std::string uri, std::string title);
 
 		long long id() const;
+		long long position() const;
+		void setPosition(long long position);
 
+		std::string uri() const;
 		std::string title() const;
+	};
+
+	/*
+		A single play or skip of an item, numbered in the order they happened
+	*/
+	class LibraryPlay {
+		unsigned long long sequence_;
+		std::string uri_;
+		bool skipped_;
+		long long time_;
+
+	public:
+		LibraryPlay(unsigned long long sequence, std::string uri, bool skipped, long long time);
+
+		unsigned long long sequence() const;
 		std::string uri() const;
-		std::string thumbnailFile() const;
+		bool skipped() const;
+		long long time() const;
+	};
+
+	/*
+		How often an item has been played and skipped, and when it was last played
+	*/
+	class LibraryPlayStatistics {
+		unsigned long long plays_;
+		unsigned long long skips_;
+		long long last_played_;
+
+	public:
+		LibraryPlayStatistics(unsigned long long plays = 0, unsigned long long skips = 0, long long last_played = 0);
+
+		unsigned long long plays() const;
+		unsigned long long skips() const;
+		long long lastPlayed() const;
+	};
+
+	/*
+		A condition on items for a smart playlist
+	*/
+	class LibraryRule {
+	public:
+		enum class Field {
+		    Type,
+		    Album,
+		    Title,
+		    Plays,
+		    Skips,
+		    LastPlayed,
+		    Duration,
+		    Added
+		};
+
+		enum class Comparison {
+		    Is,
+		    IsNot,
+		    Contains,
+		    Less,
+		    Greater,
+		    Within
+		};
+
+	private:
+		Field field_;
+		Comparison comparison_;
+		std::string value_;
+
+	public:
+		LibraryRule(Field field, Comparison comparison, std::string value);
+		LibraryRule(Field field, Comparison comparison, long long value);
+
+		Field field() const;
+		Comparison comparison() const;
+		std::string value() const;
+		long long number() const;
+	};
+
+	/*
+		Turns text into a key whose bytes sort in the order the text should be listed, ignoring case, accents,
+		punctuation and a leading article. Keys made in different ways must have different names, so the library knows
+		to make its keys again when the way changes.
+	*/
+	class LibraryCollation {
+		std::locale locale_;
+		std::vector< std::string > articles_;
+
+	protected:
+		std::string fold(std::string const & text) const;
+
+	public:
+		LibraryCollation(std::string const & locale = "C");
+		LibraryCollation(std::string const & locale, std::vector< std::string > articles);
+		virtual ~LibraryCollation();
+
+		virtual std::string name() const;
+		virtual std::vector< unsigned char > key(std::string const & text) const;
 	};
 
 	class Library
@@ -51,30 +258,147 @@ namespace toolkit {
 		    Movies
 		};
 
+		enum class Match {
+		    Substring,
+		    Fuzzy
+		};
+
 	private:
+		std::string snapshot_path_;
+		LibrarySnapshot * snapshot_;
+		LibraryTrigramIndex * trigram_index_;
+		std::map< std::string, LibrarySmartPlaylist * > smart_playlists_;
+		std::vector< std::pair< std::string, long long > > roots_;
+		std::vector< LibraryVolume * > volumes_;
+		std::shared_ptr< LibraryCollation const > collation_;
+		long long epoch_;
+
 		core::Statement * add_stmt_;
+		core::Statement * update_stmt_;
+		core::Statement * remove_item_stmt_;
 		core::Statement * count_stmt_;
+		core::Statement * facets_stmt_;
 		core::Statement * list_stmt_;
 		core::Statement * search_stmt_;
 
 		core::Statement * type_stmt_;
 		core::Statement * album_stmt_;
+		core::Statement * add_album_stmt_;
+
+		core::Statement * add_file_stmt_;
+		core::Statement * files_stmt_;
+		core::Statement * remove_file_stmt_;
+		core::Statement * remove_file_item_stmt_;
+		core::Statement * file_item_stmt_;
+		core::Statement * relink_item_stmt_;
+		core::Statement * copies_stmt_;
+		core::Statement * set_uri_stmt_;
+		core::Statement * canonical_stmt_;
+		core::Statement * generation_stmt_;
+
+		core::Statement * playlist_stmt_;
+		core::Statement * add_playlist_stmt_;
+		core::Statement * playlist_entries_stmt_;
+		core::Statement * add_entry_stmt_;
+		core::Statement * move_entry_stmt_;
+		core::Statement * remove_entry_stmt_;
+
+		core::Statement * play_sequence_stmt_;
+		core::Statement * add_play_stmt_;
+		core::Statement * update_play_stmt_;
+		core::Statement * set_play_sequence_stmt_;
+		core::Statement * statistics_stmt_;
+		core::Statement * most_played_stmt_;
+		core::Statement * recently_played_stmt_;
+		core::Statement * play_generation_stmt_;
+		core::Statement * item_stmt_;
+		core::Statement * details_stmt_;
 
 		void initialise_db();
 
 		long long type_id(Type type);
-		long long album_id(std::string album);
+		long long album_id(std::string album, std::vector< unsigned char > const & sort_key);
+		long long root_id(std::string const & uri, std::string & path);
+		LibraryVolume * volume(std::string const & uri, std::string & path) const;
+		LibraryVolume * volume(long long item_id) const;
+		void reset_volume_statements();
+
+		std::vector< unsigned char > sort_key(std::string const & title, std::vector< unsigned char > const & album_key,
+		                                      unsigned int track_number) const;
+		void check_collation(std::string const & schema);
+
+		long long play_generation();
+		unsigned long long identity() const;
+		bool snapshot_current();
 
 	public:
 		Library();
+		Library(std::string location);
 		~Library();
 
-		void add(std::string title, std::string uri, Type type, std::string thumbnail_file = std::string(),
-		         std::string album = std::string());
+		using core::Database::begin;
+		using core::Database::commit;
+
+		long long add(std::string title, std::string uri, Type type, std::string thumbnail_file = std::string(),
+		              std::string album = std::string(), MediaDetails const & details = MediaDetails());
+		bool update(long long item_id, std::string title, std::string uri, Type type,
+		            std::string thumbnail_file = std::string(), std::string album = std::string(),
+		            MediaDetails const & details = MediaDetails());
+		void removeItems(std::vector< long long > const & item_ids);
+
+		bool attachVolume(std::string const & name, std::string const & root, std::string const & location);
+		bool detachVolume(std::string const & name);
+		std::vector< std::string > volumes() const;
+
+		long long addRoot(std::string const & uri);
+		bool relocateRoot(std::string const & from, std::string const & to);
+		std::vector< std::string > roots();
+
+		void setCollation(std::shared_ptr< LibraryCollation const > collation);
+		bool rekey(unsigned int batch = 1000);
+
+		void addFile(LibraryFile const & file, long long item_id = 0);
+		long long canonicalItem(LibraryFile const & file);
+		std::vector< LibraryFile > files(std::string directory);
+		void removeFiles(std::vector< std::string > const & paths, std::map< std::string, long long > * kept = nullptr);
+		unsigned long long prune(std::function< void (unsigned long long checked, unsigned long long total) > progress =
+		                             nullptr, unsigned int threads = 0);
 
 		unsigned long long count(Type type);
-		std::vector< LibraryItem > list(Type type);
-		std::vector< LibraryItem > search(Type type, std::string term);
+		std::vector< LibraryFacet > facets();
+		LibraryItemTable list(Type type);
+		LibraryItemTable search(Type type, std::string term, Match match = Match::Substring, unsigned int limit = 50);
+		std::vector< long long > identifiers(Type type);
+		LibraryItemTable items(std::vector< long long > const & item_ids);
+		MediaDetails details(long long item_id);
+
+		long long playlist(std::string const & name);
+		std::vector< std::string > playlists();
+		void removePlaylist(long long playlist_id);
+
+		std::vector< LibraryPlaylistEntry > playlistEntries(long long playlist_id);
+		long long addPlaylistEntry(long long playlist_id, long long position, std::string const & uri,
+		                           std::string const & title);
+		void movePlaylistEntry(long long entry_id, long long position);
+		void removePlaylistEntry(long long entry_id);
+
+		unsigned long long playSequence();
+		void addPlays(std::vector< LibraryPlay > const & plays);
+		LibraryPlayStatistics statistics(long long item_id);
+		LibraryItemTable mostPlayed(unsigned int limit);
+		LibraryItemTable recentlyPlayed(unsigned int limit);
+
+		bool setSmartPlaylist(std::string const & name, std::vector< LibraryRule > const & rules, bool match_all = true,
+		                      unsigned int limit = 0);
+		std::vector< std::string > smartPlaylists();
+		void removeSmartPlaylist(std::string const & name);
+		LibraryItemTable smartPlaylist(std::string const & name);
+
+		long long generation();
+		long long enumerate(std::function< void (long long id, Type type, std::string const & title,
+		                    std::string const & album, std::string const & uri, std::string const & thumbnail_file) > callback);
+
+		bool writeSnapshot();
 	};
 }
 
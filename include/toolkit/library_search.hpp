@@ -0,0 +1,44 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_LIBRARY_SEARCH_HPP
+#define _TOOLKIT_LIBRARY_SEARCH_HPP
+
+#include <string>
+#include <core/noncopiable.hpp>
+#include <toolkit/library.hpp>
+
+namespace toolkit {
+	class LibrarySearchPrivate;
+
+	/*
+		Searches the library as a term is typed, matching the start of words in titles and albums and narrowing the
+		previous results as the term grows
+	*/
+	class LibrarySearch
+			: core::NonCopiable {
+		LibrarySearchPrivate * p;
+
+	public:
+		LibrarySearch(Library & library);
+		~LibrarySearch();
+
+		LibraryItemTable search(Library::Type type, std::string const & term);
+	};
+}
+
+#endif
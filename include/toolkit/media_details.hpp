@@ -0,0 +1,85 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_MEDIA_DETAILS_HPP
+#define _TOOLKIT_MEDIA_DETAILS_HPP
+
+#include <string>
+
+namespace toolkit {
+	/*
+		What is known about the streams and tags of a media source besides its title and album. Numbers are 0 and text
+		is empty when they aren't known.
+	*/
+	class MediaDetails {
+		long long duration_;
+
+		std::string artist_;
+		unsigned int track_number_;
+		unsigned int track_count_;
+
+		std::string audio_codec_;
+		std::string video_codec_;
+		unsigned int bitrate_;
+
+		unsigned int sample_rate_;
+		unsigned int channels_;
+
+		unsigned int width_;
+		unsigned int height_;
+		double frame_rate_;
+
+	public:
+		MediaDetails();
+
+		long long duration() const;
+		void setDuration(long long duration);
+
+		std::string artist() const;
+		void setArtist(std::string artist);
+
+		unsigned int trackNumber() const;
+		void setTrackNumber(unsigned int track_number);
+
+		unsigned int trackCount() const;
+		void setTrackCount(unsigned int track_count);
+
+		std::string audioCodec() const;
+		void setAudioCodec(std::string codec);
+
+		std::string videoCodec() const;
+		void setVideoCodec(std::string codec);
+
+		unsigned int bitrate() const;
+		void setBitrate(unsigned int bitrate);
+
+		unsigned int sampleRate() const;
+		void setSampleRate(unsigned int sample_rate);
+
+		unsigned int channels() const;
+		void setChannels(unsigned int channels);
+
+		unsigned int width() const;
+		unsigned int height() const;
+		void setResolution(unsigned int width, unsigned int height);
+
+		double frameRate() const;
+		void setFrameRate(double frame_rate);
+	};
+}
+
+#endif
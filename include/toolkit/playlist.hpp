@@ -0,0 +1,57 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_PLAYLIST_HPP
+#define _TOOLKIT_PLAYLIST_HPP
+
+#include <string>
+#include <core/noncopiable.hpp>
+#include <toolkit/library.hpp>
+
+namespace toolkit {
+	class PlaylistPrivate;
+
+	/*
+		A named list of media to play, kept in memory and written through to the library
+	*/
+	class Playlist
+			: core::NonCopiable {
+		PlaylistPrivate * p;
+
+	public:
+		static std::string const queue;
+
+		Playlist(Library & library, std::string name);
+		~Playlist();
+
+		std::string name() const;
+
+		bool empty() const;
+		std::size_t size() const;
+		LibraryPlaylistEntry const & at(std::size_t index) const;
+
+		void append(std::string uri, std::string title);
+		void insert(std::size_t index, std::string uri, std::string title);
+		void move(std::size_t from, std::size_t to);
+		void remove(std::size_t index);
+		void clear();
+
+		unsigned long long import(std::string path);
+	};
+}
+
+#endif
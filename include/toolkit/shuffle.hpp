@@ -0,0 +1,48 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_SHUFFLE_HPP
+#define _TOOLKIT_SHUFFLE_HPP
+
+#include <string>
+#include <core/noncopiable.hpp>
+#include <toolkit/library.hpp>
+
+namespace toolkit {
+	class ShufflePrivate;
+
+	/*
+		Plays the items in the library in a random order without repeating any until all of them have been played,
+		carrying on from where it left off when a state file is given
+	*/
+	class Shuffle
+			: core::NonCopiable {
+		ShufflePrivate * p;
+
+	public:
+		Shuffle(Library & library, Library::Type type = Library::Type::All, std::string state_file = std::string(),
+		        unsigned long long seed = 0);
+		~Shuffle();
+
+		LibraryItemTable next(unsigned int count = 1);
+		void reshuffle(unsigned long long seed = 0);
+
+		unsigned long long seed() const;
+	};
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TOOLKIT_TAG_READER_HPP
+#define _TOOLKIT_TAG_READER_HPP
+
+#include <string>
+#include <core/noncopiable.hpp>
+#include <toolkit/media_details.hpp>
+
+namespace toolkit {
+	class TagReaderPrivate;
+
+	/*
+		Reads the streams and tags of common formats straight from the headers of a local file, without starting a
+		pipeline. Understands Ogg (Vorbis, Opus, Speex, FLAC and Theora), FLAC, MP3 with ID3 tags and MP4/M4A, and
+		gives the same results the inspector would. Anything else is left to the inspector.
+	*/
+	class TagReader
+			: core::NonCopiable {
+		TagReaderPrivate * p;
+
+	public:
+		TagReader();
+		~TagReader();
+
+		static void readAhead(std::string const & uri);
+
+		bool read(std::string const & uri) const;
+
+		bool audio() const;
+		bool video() const;
+
+		std::string album() const;
+		std::string title() const;
+
+		MediaDetails details() const;
+	};
+}
+
+#endif
@@ -58,6 +58,8 @@ namespace core {
 		sqlite3 * db_;
 		bool opened_;
 
+		unsigned int transaction_depth_;
+
 		std::set< StatementPrivate * > statements_;
 
 	public:
@@ -68,6 +70,13 @@ namespace core {
 
 		inline sqlite3 * connection();
 
+		inline long long lastInsertId();
+		inline long long changes();
+
+		inline bool begin();
+		inline bool commit();
+		inline bool rollback();
+
 		inline void addStatement(StatementPrivate * const statement);
 
 		inline void removeStatement(StatementPrivate * const statement);
@@ -109,7 +118,8 @@ namespace core {
 	};
 
 	// Database connection
-	DatabasePrivate::DatabasePrivate(char const * location, int flags) {
+	DatabasePrivate::DatabasePrivate(char const * location, int flags)
+		: transaction_depth_(0) {
 		dprint("Opening %s", location);
 		opened_ = sqlite3_open_v2(location, &db_, flags, NULL) == SQLITE_OK;
 	}
@@ -138,6 +148,64 @@ namespace core {
 		return db_;
 	}
 
+	/*
+		Returns the row ID of the most recent successful insert on this connection
+	*/
+	long long DatabasePrivate::lastInsertId() {
+		return sqlite3_last_insert_rowid(db_);
+	}
+
+	/*
+		Returns the number of rows changed by the most recent insert, update or delete on this connection
+	*/
+	long long DatabasePrivate::changes() {
+		return sqlite3_changes(db_);
+	}
+
+	/*
+		Starts a transaction, nested calls only begin the outermost transaction
+	*/
+	bool DatabasePrivate::begin() {
+		if (transaction_depth_ > 0) {
+			++transaction_depth_;
+			return true;
+		}
+
+		if (sqlite3_exec(db_, "BEGIN", NULL, NULL, NULL) != SQLITE_OK) {
+			return false;
+		}
+
+		transaction_depth_ = 1;
+		return true;
+	}
+
+	/*
+		Commits a transaction once the outermost call to begin is matched
+	*/
+	bool DatabasePrivate::commit() {
+		if (transaction_depth_ == 0) {
+			return false;
+		}
+
+		if (--transaction_depth_ > 0) {
+			return true;
+		}
+
+		return sqlite3_exec(db_, "COMMIT", NULL, NULL, NULL) == SQLITE_OK;
+	}
+
+	/*
+		Abandons the current transaction, including any nested transactions
+	*/
+	bool DatabasePrivate::rollback() {
+		if (transaction_depth_ == 0) {
+			return false;
+		}
+
+		transaction_depth_ = 0;
+		return sqlite3_exec(db_, "ROLLBACK", NULL, NULL, NULL) == SQLITE_OK;
+	}
+
 	/*
 		Called when a new statement has been created on this connection
 	*/
@@ -176,18 +244,59 @@ namespace core {
 		return p->opened();
 	}
 
+	/*
+		Starts a transaction so that many changes are written at once
+	*/
+	bool Database::begin() {
+		return p->begin();
+	}
+
+	/*
+		Writes all changes made since the matching call to begin
+	*/
+	bool Database::commit() {
+		return p->commit();
+	}
+
+	/*
+		Discards all changes made since the outermost call to begin
+	*/
+	bool Database::rollback() {
+		return p->rollback();
+	}
+
 	/*
 		Drops all the tables in the database
 	*/
 	void Database::clear() {
-		Statement tables(*this, "SELECT name FROM sqlite_master WHERE type = 'table'");
+		std::vector< std::string > names = tables();
 
-		Statement drop(*this, "DROP TABLE ?");
-		do {
-			drop.bind(1u, tables.toText(0u));
+		for (std::vector< std::string >::const_iterator i = names.begin(); i != names.end(); ++i) {
+			if (i->compare(0, 7, "sqlite_") == 0) {
+				// Internal tables can't be dropped
+				continue;
+			}
+
+			Statement drop(*this, "DROP TABLE \"" + *i + "\"");
 			drop.execute();
-			drop.reset();
-		} while (tables.nextRow());
+		}
+
+		Statement sequence(*this, "DELETE FROM sqlite_sequence");
+		sequence.execute();
+	}
+
+	/*
+		Returns the row ID of the most recent successful insert
+	*/
+	long long Database::lastInsertId() const {
+		return p->lastInsertId();
+	}
+
+	/*
+		Returns the number of rows changed by the most recent insert, update or delete
+	*/
+	long long Database::changes() const {
+		return p->changes();
 	}
 
 	/*
@@ -339,7 +448,13 @@ namespace core {
 		Return the value in column as a string
 	*/
 	char const * StatementPrivate::toText(unsigned int column) const {
-		return column < columns() ? reinterpret_cast< char const * >(sqlite3_column_text(stmt_, column)) : "";
+		if (column >= columns()) {
+			return "";
+		}
+
+		// Null values have no text
+		char const * text = reinterpret_cast< char const * >(sqlite3_column_text(stmt_, column));
+		return text == nullptr ? "" : text;
 	}
 
 	/*
@@ -15,6 +15,7 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <cctype>
 #include <cstdlib>
 #include <core/filesystem.hpp>
 
@@ -166,6 +167,31 @@ namespace core {
 		return result;
 	}
 
+	/*
+		Convert the path to a file URI, escaping any reserved characters
+	*/
+	std::string Path::toUri() const {
+		static char const hex[] = "0123456789ABCDEF";
+
+		std::string path = toString();
+		std::string uri("file://");
+		uri.reserve(uri.size() + path.size());
+
+		for (std::string::const_iterator i = path.begin(); i != path.end(); ++i) {
+			unsigned char c = *i;
+
+			if (std::isalnum(c) || (c == separator) || (c == '-') || (c == '.') || (c == '_') || (c == '~')) {
+				uri.push_back(c);
+			} else {
+				uri.push_back('%');
+				uri.push_back(hex[c >> 4]);
+				uri.push_back(hex[c & 0xF]);
+			}
+		}
+
+		return uri;
+	}
+
 	/*
 		Returns the path to the current working directory
 	*/
@@ -223,6 +249,30 @@ namespace core {
 		return std::string(home_pwd->pw_dir);
 	}
 
+	/*
+		Converts a file URI back to a path, returning an empty string if it isn't a file URI
+	*/
+	std::string Path::fromUri(std::string const uri) {
+		if (uri.compare(0, 7, "file://") != 0) {
+			return std::string();
+		}
+
+		std::string path;
+		path.reserve(uri.size() - 7);
+
+		for (std::string::size_type i = 7; i < uri.size(); ++i) {
+			if ((uri[i] == '%') && (i + 2 < uri.size()) && std::isxdigit(static_cast< unsigned char >(uri[i + 1])) &&
+			        std::isxdigit(static_cast< unsigned char >(uri[i + 2]))) {
+				path.push_back(static_cast< char >(std::strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16)));
+				i += 2;
+			} else {
+				path.push_back(uri[i]);
+			}
+		}
+
+		return path;
+	}
+
 	/*
 		Check if the given path exists
 	*/
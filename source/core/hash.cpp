@@ -0,0 +1,195 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <vector>
+#include <core/hash.hpp>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+}
+
+namespace {
+	unsigned long long const prime_1(11400714785074694791ULL);
+	unsigned long long const prime_2(14029467366897019727ULL);
+	unsigned long long const prime_3(1609587929392839161ULL);
+	unsigned long long const prime_4(9650029242287828579ULL);
+	unsigned long long const prime_5(2870177450012600261ULL);
+
+	// Size of each of the chunks read when sampling a file
+	unsigned long long const sample_size(64 * 1024);
+
+	// Size of the blocks read when hashing a whole file
+	unsigned long long const block_size(1024 * 1024);
+
+	inline unsigned long long rotate(unsigned long long value, unsigned int bits) {
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	inline unsigned long long read64(unsigned char const * data) {
+		unsigned long long value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline unsigned long long read32(unsigned char const * data) {
+		unsigned int value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline unsigned long long round(unsigned long long accumulator, unsigned long long input) {
+		accumulator += input * prime_2;
+		accumulator = rotate(accumulator, 31);
+		return accumulator * prime_1;
+	}
+
+	inline unsigned long long merge(unsigned long long accumulator, unsigned long long value) {
+		accumulator ^= round(0, value);
+		return accumulator * prime_1 + prime_4;
+	}
+
+	/*
+		Reads as much of a range of a file as possible, returning the number of bytes read
+	*/
+	unsigned long long read_range(int fd, unsigned char * buffer, unsigned long long size, unsigned long long offset) {
+		unsigned long long total = 0;
+
+		while (total < size) {
+			ssize_t result = pread(fd, buffer + total, size - total, offset + total);
+			if (result <= 0) {
+				break;
+			}
+
+			total += result;
+		}
+
+		return total;
+	}
+}
+
+namespace core {
+	/*
+		Hashes a block of memory using the xxHash64 algorithm
+	*/
+	unsigned long long Hash::data(void const * data, unsigned long long size, unsigned long long seed) {
+		unsigned char const * position = static_cast< unsigned char const * >(data);
+		unsigned char const * end = position + size;
+		unsigned long long hash;
+
+		if (size >= 32) {
+			unsigned char const * limit = end - 32;
+			unsigned long long v1 = seed + prime_1 + prime_2;
+			unsigned long long v2 = seed + prime_2;
+			unsigned long long v3 = seed;
+			unsigned long long v4 = seed - prime_1;
+
+			do {
+				v1 = round(v1, read64(position));
+				v2 = round(v2, read64(position + 8));
+				v3 = round(v3, read64(position + 16));
+				v4 = round(v4, read64(position + 24));
+				position += 32;
+			} while (position <= limit);
+
+			hash = rotate(v1, 1) + rotate(v2, 7) + rotate(v3, 12) + rotate(v4, 18);
+			hash = merge(hash, v1);
+			hash = merge(hash, v2);
+			hash = merge(hash, v3);
+			hash = merge(hash, v4);
+		} else {
+			hash = seed + prime_5;
+		}
+
+		hash += size;
+
+		while (position + 8 <= end) {
+			hash ^= round(0, read64(position));
+			hash = rotate(hash, 27) * prime_1 + prime_4;
+			position += 8;
+		}
+
+		if (position + 4 <= end) {
+			hash ^= read32(position) * prime_1;
+			hash = rotate(hash, 23) * prime_2 + prime_3;
+			position += 4;
+		}
+
+		while (position < end) {
+			hash ^= *position * prime_5;
+			hash = rotate(hash, 11) * prime_1;
+			++position;
+		}
+
+		hash ^= hash >> 33;
+		hash *= prime_2;
+		hash ^= hash >> 29;
+		hash *= prime_3;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
+
+	/*
+		Fingerprints a file from its size and chunks at its start, middle and end, or from its whole contents.
+		Returns 0 if the file can't be read.
+	*/
+	unsigned long long Hash::file(std::string const path, bool full) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return 0;
+		}
+
+		struct stat status;
+		if (fstat(fd, &status) != 0) {
+			close(fd);
+			return 0;
+		}
+
+		unsigned long long size = status.st_size;
+		unsigned long long hash = size;
+
+		if (full || (size <= 3 * sample_size)) {
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+			std::vector< unsigned char > buffer(size < block_size ? size : block_size);
+			for (unsigned long long offset = 0; offset < size; offset += buffer.size()) {
+				unsigned long long read = read_range(fd, &buffer[0], buffer.size(), offset);
+				hash = data(&buffer[0], read, hash);
+
+				if (read < buffer.size()) {
+					break;
+				}
+			}
+		} else {
+			unsigned long long const offsets[] = {0, (size - sample_size) / 2, size - sample_size};
+			std::vector< unsigned char > buffer(sample_size);
+
+			for (unsigned int i = 0; i < 3; ++i) {
+				unsigned long long read = read_range(fd, &buffer[0], sample_size, offsets[i]);
+				hash = data(&buffer[0], read, hash);
+			}
+		}
+
+		close(fd);
+
+		// Reserve 0 for unreadable files
+		return hash == 0 ? 1 : hash;
+	}
+}
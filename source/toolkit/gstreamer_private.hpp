@@ -0,0 +1,47 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GSTREAMER_PRIVATE_HPP
+#define _GSTREAMER_PRIVATE_HPP
+
+#include <debug.hpp>
+
+extern "C" {
+#include <gst/gst.h>
+}
+
+namespace gstreamer {
+	/*
+		Inheriting this class will automatically initialiser GStreamer
+	*/
+	class Initialiser {
+	public:
+		Initialiser() {
+			if (!gst_is_initialized()) {
+				dprint("Initialising GStreamer");
+				gst_init(NULL, NULL);
+
+#if defined(DEBUG) && !defined(GST_DISABLE_GST_DEBUG)
+				gst_debug_set_default_threshold(GST_LEVEL_ERROR);
+				gst_debug_set_active(true);
+#endif
+			}
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,222 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <debug.hpp>
+#include <toolkit/history.hpp>
+#include <toolkit/library.hpp>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+namespace toolkit {
+	class HistoryPrivate {
+		Library & library_;
+
+		std::string journal_path_;
+		int journal_;
+
+		unsigned int threshold_;
+		std::chrono::milliseconds interval_;
+
+		unsigned long long sequence_;
+		std::vector< LibraryPlay > pending_;
+		std::chrono::steady_clock::time_point oldest_;
+
+		void replay();
+
+	public:
+		HistoryPrivate(Library & library, std::string journal, unsigned int threshold, unsigned int interval);
+		~HistoryPrivate();
+
+		void record(std::string uri, bool skipped);
+
+		unsigned long long pending() const;
+		bool process();
+		void flush();
+	};
+
+	HistoryPrivate::HistoryPrivate(Library & library, std::string journal, unsigned int threshold,
+	                               unsigned int interval)
+		: library_(library), journal_path_(std::move(journal)), journal_(-1), threshold_(threshold),
+		  interval_(interval), sequence_(library.playSequence()) {
+		if (journal_path_.empty()) {
+			return;
+		}
+
+		replay();
+
+		journal_ = open(journal_path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (journal_ < 0) {
+			dprint("Unable to open play history journal %s", journal_path_.c_str());
+			return;
+		}
+
+		flush();
+	}
+
+	HistoryPrivate::~HistoryPrivate() {
+		flush();
+
+		if (journal_ >= 0) {
+			close(journal_);
+		}
+	}
+
+	/*
+		Reads back the events left in the journal the last time the programme ran, skipping those already written
+	*/
+	void HistoryPrivate::replay() {
+		std::ifstream journal(journal_path_.c_str());
+
+		std::string line;
+		while (std::getline(journal, line)) {
+			// Sequence number, whether it was skipped and the time, followed by the URI
+			std::istringstream fields(line);
+			unsigned long long sequence;
+			int skipped;
+			long long time;
+			std::string uri;
+
+			if (!(fields >> sequence >> skipped >> time >> uri)) {
+				// Likely cut short while it was being written
+				continue;
+			}
+
+			pending_.emplace_back(sequence, uri, skipped != 0, time);
+			if (sequence > sequence_) {
+				sequence_ = sequence;
+			}
+		}
+
+		if (!pending_.empty()) {
+			dprint("Recovered %zu play events from the journal", pending_.size());
+			oldest_ = std::chrono::steady_clock::now();
+		}
+	}
+
+	/*
+		Keeps an event to be written with the next batch
+	*/
+	void HistoryPrivate::record(std::string uri, bool skipped) {
+		if (pending_.empty()) {
+			oldest_ = std::chrono::steady_clock::now();
+		}
+
+		pending_.emplace_back(++sequence_, std::move(uri), skipped, std::time(nullptr));
+
+		if (journal_ >= 0) {
+			// Only handed to the kernel, so it survives the programme crashing without waiting on the disk
+			LibraryPlay const & play = pending_.back();
+			std::ostringstream line;
+			line << play.sequence() << ' ' << (play.skipped() ? 1 : 0) << ' ' << play.time() << ' ' << play.uri() << '\n';
+
+			std::string const text = line.str();
+			if (write(journal_, text.data(), text.size()) != static_cast< ssize_t >(text.size())) {
+				dprint("Unable to write to the play history journal");
+			}
+		}
+
+		if (pending_.size() >= threshold_) {
+			flush();
+		}
+	}
+
+	/*
+		Returns the number of events waiting to be written
+	*/
+	unsigned long long HistoryPrivate::pending() const {
+		return pending_.size();
+	}
+
+	/*
+		Writes the waiting events if the oldest has waited longer than the interval, returning whether any were written
+	*/
+	bool HistoryPrivate::process() {
+		if (pending_.empty() || (std::chrono::steady_clock::now() - oldest_ < interval_)) {
+			return false;
+		}
+
+		flush();
+		return true;
+	}
+
+	/*
+		Writes the waiting events to the library in a single transaction, then empties the journal
+	*/
+	void HistoryPrivate::flush() {
+		if (pending_.empty()) {
+			return;
+		}
+
+		library_.addPlays(pending_);
+		pending_.clear();
+
+		if ((journal_ >= 0) && (ftruncate(journal_, 0) != 0)) {
+			dprint("Unable to empty the play history journal");
+		}
+	}
+
+	History::History(Library & library, std::string journal, unsigned int threshold, unsigned int interval)
+		: p(new HistoryPrivate(library, std::move(journal), threshold, interval)) {}
+
+	History::~History() {
+		delete p;
+	}
+
+	/*
+		Records that the URI was played to the end
+	*/
+	void History::played(std::string uri) {
+		p->record(std::move(uri), false);
+	}
+
+	/*
+		Records that the URI was skipped before it finished
+	*/
+	void History::skipped(std::string uri) {
+		p->record(std::move(uri), true);
+	}
+
+	/*
+		Returns the number of events waiting to be written
+	*/
+	unsigned long long History::pending() const {
+		return p->pending();
+	}
+
+	/*
+		Writes the waiting events once the oldest has waited long enough, returning whether any were written
+	*/
+	bool History::process() {
+		return p->process();
+	}
+
+	/*
+		Writes the waiting events straight away
+	*/
+	void History::flush() {
+		p->flush();
+	}
+}
@@ -0,0 +1,311 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <debug.hpp>
+#include <core/filesystem.hpp>
+#include <core/hash.hpp>
+#include <toolkit/importer.hpp>
+#include <toolkit/inspector_pool.hpp>
+#include <toolkit/library.hpp>
+
+extern "C" {
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+}
+
+namespace {
+	// Number of inspected files written to the library in each transaction
+	unsigned int const batch_size(256);
+
+	/*
+		Finds every regular file in a directory, and optionally its subdirectories, stating each entry relative to its
+		open parent
+	*/
+	void walk(int parent, char const * name, std::string const & path, bool recursive,
+	          std::vector< toolkit::LibraryFile > & found) {
+		int fd = openat(parent, name, O_RDONLY | O_DIRECTORY);
+		if (fd < 0) {
+			dprint("Unable to open %s", path.c_str());
+			return;
+		}
+
+		DIR * dir = fdopendir(fd);
+		if (dir == NULL) {
+			close(fd);
+			return;
+		}
+
+		dirent * entry;
+		struct stat status;
+
+		while ((entry = readdir(dir)) != NULL) {
+			if (entry->d_name[0] == '.') {
+				// Skip hidden files along with the current and parent directories
+				continue;
+			}
+
+			if (fstatat(fd, entry->d_name, &status, AT_SYMLINK_NOFOLLOW) != 0) {
+				continue;
+			}
+
+			std::string child(path);
+			child.push_back('/');
+			child.append(entry->d_name);
+
+			if (S_ISDIR(status.st_mode)) {
+				if (recursive) {
+					walk(fd, entry->d_name, child, true, found);
+				}
+			} else if (S_ISREG(status.st_mode)) {
+				found.emplace_back(std::move(child), status.st_dev, status.st_ino, status.st_size,
+				                   status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec);
+			}
+		}
+
+		closedir(dir);
+	}
+
+	/*
+		Makes a title from a file name for media without a title tag
+	*/
+	std::string file_title(std::string const & path) {
+		std::string::size_type start = path.rfind('/');
+		start = start == std::string::npos ? 0 : start + 1;
+
+		std::string::size_type end = path.rfind('.');
+		if ((end == std::string::npos) || (end <= start)) {
+			end = path.size();
+		}
+
+		return path.substr(start, end - start);
+	}
+}
+
+namespace toolkit {
+	class ImporterPrivate {
+		Library & library_;
+		InspectorPool pool_;
+
+		bool full_hash_;
+
+	public:
+		ImporterPrivate(Library & library, unsigned int threads, bool full_hash, std::shared_ptr< InspectorCache > cache);
+
+		unsigned long long scan(std::string directory, Importer::Mode mode, bool recursive);
+	};
+
+	ImporterPrivate::ImporterPrivate(Library & library, unsigned int threads, bool full_hash,
+	                                 std::shared_ptr< InspectorCache > cache)
+		: library_(library), pool_(threads), full_hash_(full_hash) {
+		pool_.setCache(std::move(cache));
+	}
+
+	/*
+		Inspects the files beneath the directory that are new or have changed and forgets those that have gone
+	*/
+	unsigned long long ImporterPrivate::scan(std::string directory, Importer::Mode mode, bool recursive) {
+		core::Path root(directory);
+		if (!root.makeAbsolute()) {
+			return 0;
+		}
+
+		directory = root.toString();
+
+		if (recursive) {
+			// Lets the directory be moved later without rewriting every item in it
+			std::string uri = root.toUri();
+			library_.addRoot(uri.back() == '/' ? uri : uri + "/");
+		}
+
+		std::vector< LibraryFile > known_files = library_.files(directory);
+		std::unordered_map< std::string, LibraryFile > known;
+		known.reserve(known_files.size());
+		for (std::vector< LibraryFile >::const_iterator i = known_files.begin(); i != known_files.end(); ++i) {
+			if (!recursive && (i->path().find('/', directory.size() + 1) != std::string::npos)) {
+				// Leave files in subdirectories alone
+				continue;
+			}
+
+			known.insert(std::make_pair(i->path(), *i));
+		}
+
+		std::vector< LibraryFile > found;
+		walk(AT_FDCWD, directory.c_str(), directory, recursive, found);
+		dprint("Found %zu files in %s", found.size(), directory.c_str());
+
+		std::vector< LibraryFile > changed;
+		std::vector< std::string > replaced;
+		std::vector< std::string > stale;
+
+		for (std::vector< LibraryFile >::iterator i = found.begin(); i != found.end(); ++i) {
+			std::unordered_map< std::string, LibraryFile >::iterator previous = known.find(i->path());
+
+			if (previous != known.end()) {
+				if ((mode == Importer::Mode::Incremental) && previous->second.unchanged(*i)) {
+					known.erase(previous);
+					continue;
+				}
+
+				replaced.push_back(i->path());
+				known.erase(previous);
+			}
+
+			changed.push_back(std::move(*i));
+		}
+
+		dprint("%zu files changed, %zu removed", changed.size(), known.size());
+
+		// Anything left over has been deleted since the last scan
+		for (std::unordered_map< std::string, LibraryFile >::const_iterator i = known.begin(); i != known.end(); ++i) {
+			stale.push_back(i->first);
+		}
+
+		library_.removeFiles(stale);
+
+		// Items of files that are still there are updated in place rather than removed, so their play statistics stay
+		std::map< std::string, long long > kept;
+		library_.removeFiles(replaced, &kept);
+
+		// Fingerprint the changed files so copies of media already in the library aren't inspected again
+		typedef std::vector< LibraryFile >::size_type Index;
+		typedef std::pair< unsigned long long, unsigned long long > Fingerprint;
+
+		std::vector< long long > item_ids(changed.size(), 0);
+		std::vector< long long > previous_ids(changed.size(), 0);
+		std::vector< bool > inspected(changed.size(), false);
+		std::vector< Index > inspect;
+		std::vector< std::pair< Index, Index > > copies;
+		std::map< Fingerprint, Index > first_copy;
+
+		for (Index i = 0; i < changed.size(); ++i) {
+			changed[i].setHash(core::Hash::file(changed[i].path(), full_hash_));
+
+			std::map< std::string, long long >::const_iterator previous = kept.find(changed[i].path());
+			if (previous != kept.end()) {
+				previous_ids[i] = previous->second;
+			}
+
+			if (changed[i].hash() != 0) {
+				// A file whose contents haven't changed finds its own item, and is inspected again to update it
+				long long canonical = library_.canonicalItem(changed[i]);
+				if ((canonical != 0) && (canonical != previous_ids[i])) {
+					item_ids[i] = canonical;
+					continue;
+				}
+
+				Fingerprint key(changed[i].hash(), changed[i].size());
+				std::map< Fingerprint, Index >::const_iterator original = first_copy.find(key);
+				if (original != first_copy.end()) {
+					if (previous_ids[original->second] == 0) {
+						std::swap(previous_ids[original->second], previous_ids[i]);
+					}
+
+					copies.push_back(std::make_pair(i, original->second));
+					continue;
+				}
+
+				first_copy.insert(std::make_pair(key, i));
+			}
+
+			inspect.push_back(i);
+			inspected[i] = true;
+		}
+
+		dprint("%zu files to inspect, %zu copies", inspect.size(), changed.size() - inspect.size());
+
+		std::vector< std::string > uris;
+		uris.reserve(inspect.size());
+		for (std::vector< Index >::const_iterator i = inspect.begin(); i != inspect.end(); ++i) {
+			uris.push_back(core::Path(changed[*i].path()).toUri());
+		}
+
+		unsigned long long written = 0;
+		library_.begin();
+
+		pool_.inspect(uris, [&](InspectorResult const & result) {
+			Index index = inspect[result.index()];
+			LibraryFile const & file = changed[index];
+
+			if (result.valid() && (result.audio() || result.video())) {
+				std::string title = result.title().empty() ? file_title(file.path()) : result.title();
+				Library::Type type = result.video() ? Library::Type::Movies : Library::Type::Music;
+
+				if ((previous_ids[index] != 0) &&
+				        library_.update(previous_ids[index], title, result.uri(), type, std::string(), result.album(),
+				                        result.details())) {
+					item_ids[index] = previous_ids[index];
+					previous_ids[index] = 0;
+				} else {
+					item_ids[index] = library_.add(title, result.uri(), type, std::string(), result.album(),
+					                               result.details());
+				}
+			}
+
+			// Record files that aren't media as well so they aren't inspected again until they change
+			library_.addFile(file, item_ids[index]);
+
+			if (++written % batch_size == 0) {
+				library_.commit();
+				library_.begin();
+			}
+		});
+
+		// Copies share the item of the first copy found, including its thumbnail
+		for (std::vector< std::pair< Index, Index > >::const_iterator i = copies.begin(); i != copies.end(); ++i) {
+			item_ids[i->first] = item_ids[i->second];
+		}
+
+		for (Index i = 0; i < changed.size(); ++i) {
+			if (!inspected[i]) {
+				library_.addFile(changed[i], item_ids[i]);
+			}
+		}
+
+		// Items of changed files that are no longer media, or now share another item, have nothing left pointing at them
+		std::vector< long long > orphaned;
+		for (Index i = 0; i < changed.size(); ++i) {
+			if ((previous_ids[i] != 0) && (previous_ids[i] != item_ids[i])) {
+				orphaned.push_back(previous_ids[i]);
+			}
+		}
+
+		library_.removeItems(orphaned);
+		library_.commit();
+
+		return changed.size();
+	}
+
+	Importer::Importer(Library & library, unsigned int threads, bool full_hash, std::shared_ptr< InspectorCache > cache)
+		: p(new ImporterPrivate(library, threads, full_hash, std::move(cache))) {}
+
+	Importer::~Importer() {
+		delete p;
+	}
+
+	/*
+		Scans a directory, only inspecting files that have changed since the last scan unless the mode is Full.
+		Returns the number of files that had changed.
+	*/
+	unsigned long long Importer::scan(std::string directory, Mode mode, bool recursive) const {
+		return p->scan(std::move(directory), mode, recursive);
+	}
+}
@@ -15,189 +15,441 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <chrono>
+#include <deque>
 #include <debug.hpp>
 #include <toolkit/inspector.hpp>
+#include <toolkit/inspector_cache.hpp>
+#include <toolkit/tag_reader.hpp>
 
-extern "C" {
-#include <gst/gst.h>
-}
+#include "inspector_pipeline.hpp"
 
 namespace {
-	namespace gstreamer {
-		/*
-			Inheriting this class will automatically initialiser GStreamer
-		*/
-		class Initialiser {
-		public:
-			Initialiser() {
-				if (!gst_is_initialized()) {
-					dprint("Initialising GStreamer");
-					gst_init(NULL, NULL);
-
-#if defined(DEBUG) && !defined(GST_DISABLE_GST_DEBUG)
-					gst_debug_set_default_threshold(GST_LEVEL_ERROR);
-					gst_debug_set_active(true);
-#endif
-				}
-			}
-		};
-	}
+	// Number of files in a batch that are read ahead of the one being inspected
+	std::size_t const read_ahead_files(4);
 }
 
 namespace toolkit {
-	class InspectorPrivate
-			: gstreamer::Initialiser {
-		static void bus_message_cb(GstBus * bus, GstMessage * message, gpointer data);
-		static void pad_added_cb(GstElement * element, GstPad * pad, gpointer data);
+	class InspectorPrivate {
+		TagReader reader_;
+		InspectorPipeline * pipeline_;
+		unsigned int timeout_;
 
-		GstElement * pipeline_;
+		std::shared_ptr< InspectorCache > cache_;
+		InspectorResult cached_;
 
-		bool has_audio_;
-		bool has_video_;
+		bool use_native_;
+		bool native_;
+		bool from_cache_;
+		bool recyclable_;
+		bool timed_out_;
+		bool valid_;
+		unsigned long long setup_time_;
 
-		std::string title_;
-		std::string album_;
+		bool find(char const * uri, LibraryFile const & file);
+		bool read(char const * uri);
+		bool read(char const * uri, LibraryFile const & file);
+		bool wait();
 
-		void bus_message(GstMessage * message);
-		void pad_added(GstElement * element, GstPad * pad);
+		inline InspectorResult result(unsigned long long index, std::string uri) const;
 
 	public:
-		InspectorPrivate(char const * uri);
+		InspectorPrivate(unsigned int timeout, bool native);
 		~InspectorPrivate();
 
+		inline void setCache(std::shared_ptr< InspectorCache > cache);
+
+		bool inspect(char const * uri);
+		void inspectMany(std::vector< std::string > const & uris,
+		                 std::function< void (InspectorResult const &) > & callback);
+		inline unsigned long long setupTime() const;
+
+		inline bool valid() const;
+
 		inline bool audio() const;
 		inline bool video() const;
 
 		inline std::string title() const;
 		inline std::string album() const;
+		inline MediaDetails details() const;
 	};
 
-	void InspectorPrivate::bus_message_cb(GstBus *, GstMessage * message, gpointer data) {
-		reinterpret_cast< InspectorPrivate * >(data)->bus_message(message);
+	InspectorResult::InspectorResult(unsigned long long index, std::string uri, bool valid, bool audio, bool video,
+	                                 std::string title, std::string album, MediaDetails details)
+		: index_(index), uri_(std::move(uri)), valid_(valid), audio_(audio), video_(video), title_(std::move(title)),
+		  album_(std::move(album)), details_(std::move(details)) {}
+
+	/*
+		Returns the position of the URI in the list that was given to a pool, or the ID a queue gave it
+	*/
+	unsigned long long InspectorResult::index() const {
+		return index_;
 	}
 
-	void InspectorPrivate::pad_added_cb(GstElement * element, GstPad * pad, gpointer data) {
-		reinterpret_cast< InspectorPrivate * >(data)->pad_added(element, pad);
+	/*
+		Returns the URI that was inspected
+	*/
+	std::string InspectorResult::uri() const {
+		return uri_;
 	}
 
-	InspectorPrivate::InspectorPrivate(char const * uri)
-		: has_audio_(false), has_video_(false) {
-		pipeline_ = gst_pipeline_new(NULL);
+	/*
+		Indicates whether the URI was inspected successfully before the timeout
+	*/
+	bool InspectorResult::valid() const {
+		return valid_;
+	}
 
-		GstElement * decoder = gst_element_factory_make("uridecodebin", NULL);
-		g_object_set(G_OBJECT(decoder), "uri", uri, NULL);
-		gst_bin_add(GST_BIN(pipeline_), decoder);
-		g_signal_connect(decoder, "pad-added", G_CALLBACK(pad_added_cb), this);
+	/*
+		Indicates whether the source has an audio stream
+	*/
+	bool InspectorResult::audio() const {
+		return audio_;
+	}
 
-		GstBus * bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
-		gst_bus_enable_sync_message_emission(bus);
-		g_signal_connect(bus, "sync-message::tag", G_CALLBACK(bus_message_cb), this);
-		gst_object_unref(GST_OBJECT(bus));
+	/*
+		Indicates whether the source has a video stream
+	*/
+	bool InspectorResult::video() const {
+		return video_;
+	}
 
-		gst_element_set_state(pipeline_, GST_STATE_PAUSED);
-		gst_element_get_state(pipeline_, NULL, NULL, GST_CLOCK_TIME_NONE);
+	/*
+		Returns any detected album name
+	*/
+	std::string InspectorResult::album() const {
+		return album_;
+	}
+
+	/*
+		Returns any detected track title
+	*/
+	std::string InspectorResult::title() const {
+		return title_;
+	}
+
+	/*
+		Returns the rest of what was found, such as the duration, artist and codecs
+	*/
+	MediaDetails InspectorResult::details() const {
+		return details_;
 	}
 
+	InspectorPrivate::InspectorPrivate(unsigned int timeout, bool native)
+		: pipeline_(nullptr), timeout_(timeout), cached_(0, std::string()), use_native_(native), native_(false),
+		  from_cache_(false), recyclable_(false), timed_out_(false), valid_(false), setup_time_(0) {}
+
 	InspectorPrivate::~InspectorPrivate() {
-		gst_element_set_state(pipeline_, GST_STATE_NULL);
-		gst_object_unref(GST_OBJECT(pipeline_));
+		delete pipeline_;
 	}
 
 	/*
-		Called whenever a message is posted on the bus
+		Sets the cache local files are looked up in before they are read, and stored in afterwards
 	*/
-	void InspectorPrivate::bus_message(GstMessage * message) {
-		switch (GST_MESSAGE_TYPE(message)) {
-		case GST_MESSAGE_TAG:
-			GstTagList * tags;
-			gst_message_parse_tag(message, &tags);
+	void InspectorPrivate::setCache(std::shared_ptr< InspectorCache > cache) {
+		cache_ = std::move(cache);
+	}
+
+	/*
+		Inspects a source, using what was found before if it is an unchanged local file in the cache. Returns whether the
+		source could be inspected before the timeout expired.
+	*/
+	bool InspectorPrivate::inspect(char const * uri) {
+		from_cache_ = false;
+
+		if (cache_ == nullptr) {
+			return read(uri);
+		}
+
+		LibraryFile file(InspectorCache::identify(uri));
+		if (file.path().empty()) {
+			return read(uri);
+		}
 
-			char * tag_string;
+		return find(uri, file) ? valid_ : read(uri, file);
+	}
 
-			if (gst_tag_list_get_string(tags, GST_TAG_TITLE, &tag_string)) {
-				dprint("Found title");
-				title_ = tag_string;
-				g_free(tag_string);
+	/*
+		Inspects each source in turn, handing each result to the callback as soon as it is known. Sources in the cache
+		are answered as soon as they are reached, while the next few local files not in it are read ahead so they
+		can be read from memory once their turn comes.
+	*/
+	void InspectorPrivate::inspectMany(std::vector< std::string > const & uris,
+	                                   std::function< void (InspectorResult const &) > & callback) {
+		typedef std::pair< unsigned long long, LibraryFile > Pending;
+
+		std::deque< Pending > pending;
+		std::vector< std::string >::const_iterator next = uris.begin();
+
+		while ((next != uris.end()) || !pending.empty()) {
+			while ((next != uris.end()) && (pending.size() < read_ahead_files)) {
+				unsigned long long index = next - uris.begin();
+				LibraryFile file(cache_ != nullptr ? InspectorCache::identify(*next) : LibraryFile(std::string(), 0, 0, 0, 0));
+
+				if (!file.path().empty() && find(next->c_str(), file)) {
+					callback(result(index, *next));
+				} else {
+					TagReader::readAhead(*next);
+					pending.push_back(Pending(index, std::move(file)));
+				}
+
+				++next;
 			}
 
-			if (gst_tag_list_get_string(tags, GST_TAG_ALBUM, &tag_string)) {
-				dprint("Found album");
-				album_ = tag_string;
-				g_free(tag_string);
+			if (pending.empty()) {
+				continue;
 			}
 
-			gst_tag_list_free(tags);
-			break;
-		default:
-			;
+			Pending current(std::move(pending.front()));
+			pending.pop_front();
+
+			std::string const & uri = uris[current.first];
+			from_cache_ = false;
+
+			if (!current.second.path().empty()) {
+				read(uri.c_str(), current.second);
+			} else {
+				read(uri.c_str());
+			}
+
+			callback(result(current.first, uri));
 		}
 	}
 
 	/*
-		Called whenever a pad is added to a decode bin
+		Looks for a local file in the cache, using what was found the last time it was read if it hasn't changed since.
+		Returns false if it has to be read again.
 	*/
-	void InspectorPrivate::pad_added(GstElement * element, GstPad * pad) {
-		GstCaps * caps = gst_pad_get_caps_reffed(pad);
-		if (caps == NULL) {
-			dprint("Error getting capabilities of pad");
+	bool InspectorPrivate::find(char const * uri, LibraryFile const & file) {
+		cached_ = InspectorResult(0, uri);
+		if (!cache_->find(file, cached_)) {
+			return false;
+		}
+
+		from_cache_ = true;
+		native_ = false;
+		valid_ = cached_.valid();
+		setup_time_ = 0;
+		return true;
+	}
+
+	/*
+		Reads a local file that isn't in the cache, storing what was found in the cache afterwards
+	*/
+	bool InspectorPrivate::read(char const * uri, LibraryFile const & file) {
+		read(uri);
+
+		// A source that ran out of time may be read next time, so only definite answers are kept
+		if (!timed_out_) {
+			cache_->store(file, result(0, uri));
+		}
+
+		return valid_;
+	}
+
+	/*
+		Reads a source, reading the headers of common formats directly and otherwise reusing the pipeline from the last
+		source if it was read successfully. Returns whether the source could be inspected before the timeout expired.
+	*/
+	bool InspectorPrivate::read(char const * uri) {
+		timed_out_ = false;
+		native_ = use_native_ && reader_.read(uri);
+		if (native_) {
+			valid_ = true;
+			setup_time_ = 0;
+			return true;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		if ((pipeline_ != nullptr) && recyclable_) {
+			pipeline_->recycle();
 		} else {
-			GstStructure * str = gst_caps_get_structure(caps, 0);
-			std::string type(gst_structure_get_name(str));
-
-			if (type.find("audio") == 0) {
-				dprint("Found audio stream");
-				has_audio_ = true;
-			} else if (type.find("video") == 0) {
-				dprint("Found video stream");
-				has_video_ = true;
-			} else {
-				dprint("Found other stream");
+			// A source that couldn't be read may have left the pipeline in error, so it isn't trusted again
+			delete pipeline_;
+			pipeline_ = new InspectorPipeline();
+		}
+
+		valid_ = false;
+		pipeline_->prepare(uri);
+		setup_time_ = std::chrono::duration_cast< std::chrono::microseconds >(std::chrono::steady_clock::now() -
+		              start).count();
+
+		if (gst_element_set_state(pipeline_->element(), GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE) {
+			valid_ = wait();
+		}
+
+		recyclable_ = valid_;
+
+		if (!valid_) {
+			dprint("Unable to inspect %s", uri);
+		}
+
+		return valid_;
+	}
+
+	/*
+		Waits until every stream has been found, the source fails to be read or the timeout expires. Returns whether
+		the source was inspected.
+	*/
+	bool InspectorPrivate::wait() {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		GstBus * bus = pipeline_->bus();
+		bool inspected = false;
+
+		for (;;) {
+			GstClockTime wait = GST_CLOCK_TIME_NONE;
+			if (timeout_ > 0) {
+				long long remaining = timeout_ - std::chrono::duration_cast< std::chrono::milliseconds >(
+				                          std::chrono::steady_clock::now() - start).count();
+				wait = remaining > 0 ? static_cast< GstClockTime >(remaining) * GST_MSECOND : 0;
 			}
 
-			gst_caps_unref(caps);
+			GstMessage * message = gst_bus_timed_pop_filtered(bus, wait,
+			                       static_cast< GstMessageType >(GST_MESSAGE_APPLICATION | GST_MESSAGE_ERROR));
+			if (message == NULL) {
+				timed_out_ = true;
+				break;
+			}
+
+			bool error = GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR;
+			inspected = pipeline_->inspected(message);
+			gst_message_unref(message);
+
+			if (error || inspected) {
+				break;
+			}
 		}
 
-		GstElement * fake = gst_element_factory_make("fakesink", NULL);
-		gst_bin_add(GST_BIN(pipeline_), fake);
-		gst_element_link(element, fake);
-		gst_element_sync_state_with_parent(fake);
+		gst_object_unref(GST_OBJECT(bus));
+		return inspected;
+	}
+
+	/*
+		Returns everything that was found about the last source
+	*/
+	InspectorResult InspectorPrivate::result(unsigned long long index, std::string uri) const {
+		return InspectorResult(index, std::move(uri), valid_, audio(), video(), title(), album(), details());
+	}
+
+	/*
+		Returns how many microseconds it took to get the pipeline ready for the last source, not counting reading it
+	*/
+	unsigned long long InspectorPrivate::setupTime() const {
+		return setup_time_;
+	}
+
+	/*
+		Indicates whether the source could be inspected before the timeout expired
+	*/
+	bool InspectorPrivate::valid() const {
+		return valid_;
 	}
 
 	/*
 		Indicates whether this source has an audio stream
 	*/
 	bool InspectorPrivate::audio() const {
-		return has_audio_;
+		if (from_cache_) {
+			return cached_.audio();
+		}
+
+		return native_ ? reader_.audio() : valid_ && pipeline_->audio();
 	}
 
 	/*
 		Indicates whether this source has a video stream
 	*/
 	bool InspectorPrivate::video() const {
-		return has_video_;
+		if (from_cache_) {
+			return cached_.video();
+		}
+
+		return native_ ? reader_.video() : valid_ && pipeline_->video();
 	}
 
 	/*
 		Returns any detected album name
 	*/
 	std::string InspectorPrivate::album() const {
-		return album_;
+		if (from_cache_) {
+			return cached_.album();
+		}
+
+		if (native_) {
+			return reader_.album();
+		}
+
+		return valid_ ? pipeline_->album() : std::string();
 	}
 
 	/*
 		Returns any detected track title
 	*/
 	std::string InspectorPrivate::title() const {
-		return title_;
+		if (from_cache_) {
+			return cached_.title();
+		}
+
+		if (native_) {
+			return reader_.title();
+		}
+
+		return valid_ ? pipeline_->title() : std::string();
+	}
+
+	/*
+		Returns the rest of what was found, such as the duration, artist and codecs
+	*/
+	MediaDetails InspectorPrivate::details() const {
+		if (from_cache_) {
+			return cached_.details();
+		}
+
+		if (native_) {
+			return reader_.details();
+		}
+
+		return valid_ ? pipeline_->details() : MediaDetails();
 	}
 
-	Inspector::Inspector(std::string uri)
-		: p(new InspectorPrivate(uri.c_str())) {}
+	Inspector::Inspector(unsigned int timeout, bool native)
+		: p(new InspectorPrivate(timeout, native)) {}
+
+	Inspector::Inspector(std::string uri, unsigned int timeout, bool native)
+		: p(new InspectorPrivate(timeout, native)) {
+		p->inspect(uri.c_str());
+	}
 
 	Inspector::~Inspector() {
 		delete p;
 	}
 
+	void Inspector::setCache(std::shared_ptr< InspectorCache > cache) {
+		p->setCache(std::move(cache));
+	}
+
+	bool Inspector::inspect(std::string const & uri) const {
+		return p->inspect(uri.c_str());
+	}
+
+	/*
+		Inspects a batch of URIs, calling back with each result and its position in the batch as it completes. Results
+		from the cache can arrive ahead of those before them.
+	*/
+	void Inspector::inspectMany(std::vector< std::string > const & uris,
+	                            std::function< void (InspectorResult const &) > callback) const {
+		p->inspectMany(uris, callback);
+	}
+
+	unsigned long long Inspector::setupTime() const {
+		return p->setupTime();
+	}
+
+	bool Inspector::valid() const {
+		return p->valid();
+	}
+
 	bool Inspector::audio() const {
 		return p->audio();
 	}
@@ -213,4 +465,8 @@ namespace toolkit {
 	std::string Inspector::title() const {
 		return std::move(p->title());
 	}
+
+	MediaDetails Inspector::details() const {
+		return p->details();
+	}
 }
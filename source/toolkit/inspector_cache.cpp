@@ -0,0 +1,197 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <debug.hpp>
+#include <core/filesystem.hpp>
+#include <toolkit/inspector_cache.hpp>
+
+#include "media_details_private.hpp"
+
+#include <sys/stat.h>
+
+namespace {
+	long long const db_version(1);
+
+	// Flags stored for each file
+	long long const flag_valid(1);
+	long long const flag_audio(2);
+	long long const flag_video(4);
+}
+
+namespace toolkit {
+	/*
+		Creates the table of inspected files. Rows are kept in the order of their key rather than by a separate row ID,
+		which keeps the table small and makes each lookup a single search.
+	*/
+	void InspectorCache::initialise_db() {
+		dprint("Creating inspector cache database");
+		clear();
+
+		std::string const statements[] = {
+			"CREATE TABLE version (version INTEGER PRIMARY KEY)",
+			"INSERT INTO version (version) VALUES (" + std::to_string(db_version) + ")",
+			"CREATE TABLE inspected (device INTEGER NOT NULL, inode INTEGER NOT NULL, size INTEGER NOT NULL, "
+			"modified INTEGER NOT NULL, flags INTEGER NOT NULL, title TEXT DEFAULT NULL, album TEXT DEFAULT NULL, "
+			"duration INTEGER DEFAULT NULL, artist TEXT DEFAULT NULL, track_number INTEGER DEFAULT NULL, "
+			"track_count INTEGER DEFAULT NULL, audio_codec TEXT DEFAULT NULL, video_codec TEXT DEFAULT NULL, "
+			"bitrate INTEGER DEFAULT NULL, sample_rate INTEGER DEFAULT NULL, channels INTEGER DEFAULT NULL, "
+			"width INTEGER DEFAULT NULL, height INTEGER DEFAULT NULL, frame_rate REAL DEFAULT NULL, "
+			"PRIMARY KEY (device, inode)) WITHOUT ROWID"
+		};
+
+		for (unsigned int i = 0; i < sizeof(statements) / sizeof(statements[0]); ++i) {
+			core::Statement statement(*this, statements[i]);
+			assert(statement.valid());
+			statement.execute();
+		}
+	}
+
+	InspectorCache::InspectorCache()
+		: InspectorCache(core::Path::data() + "/inspector.db") {}
+
+	InspectorCache::InspectorCache(std::string location)
+		: core::Database(location), hits_(0), misses_(0), find_stmt_(nullptr), store_stmt_(nullptr) {
+		core::Statement check_version(*this, "SELECT version FROM version");
+		if (!check_version.valid()) {
+			// Database is likely empty
+			initialise_db();
+		} else {
+			check_version.execute();
+			if (check_version.toInteger(0u) != db_version) {
+				dprint("Old inspector cache found");
+				check_version.reset();
+				initialise_db();
+			}
+		}
+
+		// Anything lost in a crash is only inspected again, so writes needn't wait for the disk
+		core::Statement synchronous(*this, "PRAGMA synchronous = OFF");
+		synchronous.execute();
+	}
+
+	InspectorCache::~InspectorCache() {
+		delete find_stmt_;
+		delete store_stmt_;
+	}
+
+	/*
+		Returns the state of the local file at the given URI, with an empty path if it isn't a local file or can't be
+		read
+	*/
+	LibraryFile InspectorCache::identify(std::string const & uri) {
+		std::string path(core::Path::fromUri(uri));
+		struct stat status;
+
+		if (path.empty() || (stat(path.c_str(), &status) != 0) || !S_ISREG(status.st_mode)) {
+			return LibraryFile(std::string(), 0, 0, 0, 0);
+		}
+
+		return LibraryFile(path, status.st_dev, status.st_ino, status.st_size,
+		                   status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec);
+	}
+
+	/*
+		Looks for what was found the last time the file was inspected, replacing result with it but keeping its index
+		and URI. Returns false if the file hasn't been inspected since it last changed.
+	*/
+	bool InspectorCache::find(LibraryFile const & file, InspectorResult & result) {
+		std::lock_guard< std::mutex > lock(mutex_);
+
+		if (find_stmt_ == nullptr) {
+			find_stmt_ = new core::Statement(*this, "SELECT flags, title, album, " + std::string(details_columns) +
+			                                 " FROM inspected WHERE device = ? AND inode = ? AND size = ? AND modified = ?");
+		} else {
+			find_stmt_->reset();
+		}
+
+		assert(find_stmt_->valid());
+		find_stmt_->bind(1u, static_cast< long long >(file.device()));
+		find_stmt_->bind(2u, static_cast< long long >(file.inode()));
+		find_stmt_->bind(3u, static_cast< long long >(file.size()));
+		find_stmt_->bind(4u, file.modified());
+		find_stmt_->execute();
+
+		if (!find_stmt_->hasData()) {
+			++misses_;
+			return false;
+		}
+
+		++hits_;
+
+		long long flags = find_stmt_->toInteger(0u);
+		result = InspectorResult(result.index(), result.uri(), flags & flag_valid, flags & flag_audio, flags & flag_video,
+		                         find_stmt_->toText(1u), find_stmt_->toText(2u), read_details(*find_stmt_, 3u));
+
+		find_stmt_->reset();
+		return true;
+	}
+
+	/*
+		Remembers what was found by inspecting a file, replacing anything from before it changed
+	*/
+	void InspectorCache::store(LibraryFile const & file, InspectorResult const & result) {
+		std::lock_guard< std::mutex > lock(mutex_);
+
+		if (store_stmt_ == nullptr) {
+			store_stmt_ = new core::Statement(*this, "INSERT OR REPLACE INTO inspected "
+			                                  "(device, inode, size, modified, flags, title, album, " +
+			                                  std::string(details_columns) +
+			                                  ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+		} else {
+			store_stmt_->reset();
+		}
+
+		assert(store_stmt_->valid());
+		store_stmt_->bind(1u, static_cast< long long >(file.device()));
+		store_stmt_->bind(2u, static_cast< long long >(file.inode()));
+		store_stmt_->bind(3u, static_cast< long long >(file.size()));
+		store_stmt_->bind(4u, file.modified());
+		store_stmt_->bind(5u, (result.valid() ? flag_valid : 0) | (result.audio() ? flag_audio : 0) |
+		                  (result.video() ? flag_video : 0));
+
+		if (result.title().empty()) {
+			store_stmt_->bind(6u);
+		} else {
+			store_stmt_->bind(6u, result.title());
+		}
+
+		if (result.album().empty()) {
+			store_stmt_->bind(7u);
+		} else {
+			store_stmt_->bind(7u, result.album());
+		}
+
+		bind_details(*store_stmt_, 8u, result.details());
+		store_stmt_->execute();
+	}
+
+	/*
+		Returns how many files were found in the cache
+	*/
+	unsigned long long InspectorCache::hits() const {
+		std::lock_guard< std::mutex > lock(mutex_);
+		return hits_;
+	}
+
+	/*
+		Returns how many files had to be inspected because they weren't in the cache or had changed
+	*/
+	unsigned long long InspectorCache::misses() const {
+		std::lock_guard< std::mutex > lock(mutex_);
+		return misses_;
+	}
+}
@@ -0,0 +1,364 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <debug.hpp>
+
+#include "inspector_pipeline.hpp"
+
+namespace toolkit {
+	void InspectorPipeline::bus_message_cb(GstBus *, GstMessage * message, gpointer data) {
+		reinterpret_cast< InspectorPipeline * >(data)->bus_message(message);
+	}
+
+	void InspectorPipeline::pad_added_cb(GstElement *, GstPad * pad, gpointer data) {
+		reinterpret_cast< InspectorPipeline * >(data)->pad_added(pad);
+	}
+
+	void InspectorPipeline::no_more_pads_cb(GstElement *, gpointer data) {
+		reinterpret_cast< InspectorPipeline * >(data)->no_more_pads();
+	}
+
+	gboolean InspectorPipeline::buffer_probe_cb(GstPad * pad, GstBuffer *, gpointer data) {
+		reinterpret_cast< InspectorPipeline * >(data)->stream_started(pad);
+		return TRUE;
+	}
+
+	gboolean InspectorPipeline::event_probe_cb(GstPad * pad, GstEvent * event, gpointer data) {
+		// A stream can end before it has any buffers
+		if (GST_EVENT_TYPE(event) == GST_EVENT_EOS) {
+			reinterpret_cast< InspectorPipeline * >(data)->stream_started(pad);
+		}
+
+		return TRUE;
+	}
+
+	InspectorPipeline::InspectorPipeline()
+		: no_more_pads_(false), inspected_(false), has_audio_(false), has_video_(false) {
+		pipeline_ = gst_pipeline_new(NULL);
+
+		decoder_ = gst_element_factory_make("uridecodebin", NULL);
+		gst_bin_add(GST_BIN(pipeline_), decoder_);
+		g_signal_connect(decoder_, "pad-added", G_CALLBACK(pad_added_cb), this);
+		g_signal_connect(decoder_, "no-more-pads", G_CALLBACK(no_more_pads_cb), this);
+
+		GstBus * bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
+		gst_bus_enable_sync_message_emission(bus);
+		g_signal_connect(bus, "sync-message::tag", G_CALLBACK(bus_message_cb), this);
+		gst_object_unref(GST_OBJECT(bus));
+	}
+
+	/*
+		Stops the pipeline and frees it along with everything in it. This waits for the pipeline's threads to finish,
+		which can take as long as the source takes to respond.
+	*/
+	InspectorPipeline::~InspectorPipeline() {
+		gst_element_set_state(pipeline_, GST_STATE_NULL);
+		gst_object_unref(GST_OBJECT(pipeline_));
+	}
+
+	/*
+		Returns the pipeline element, whose state is changed to read the source
+	*/
+	GstElement * InspectorPipeline::element() const {
+		return pipeline_;
+	}
+
+	/*
+		Returns a new reference to the pipeline's bus
+	*/
+	GstBus * InspectorPipeline::bus() const {
+		return gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
+	}
+
+	/*
+		Forgets anything found in the last source and sets the one to read next
+	*/
+	void InspectorPipeline::prepare(char const * uri) {
+		{
+			std::lock_guard< std::mutex > lock(mutex_);
+			waiting_pads_.clear();
+			no_more_pads_ = false;
+			inspected_ = false;
+
+			has_audio_ = false;
+			has_video_ = false;
+			title_.clear();
+			album_.clear();
+			details_ = MediaDetails();
+		}
+
+		g_object_set(G_OBJECT(decoder_), "uri", uri, NULL);
+	}
+
+	/*
+		Returns the pipeline to how it was when it was built, so another source can be read with it
+	*/
+	void InspectorPipeline::recycle() {
+		// The decode bin drops its source, decoders and pads on the way down to ready
+		gst_element_set_state(pipeline_, GST_STATE_READY);
+		gst_element_get_state(pipeline_, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+		// Messages from the last source would otherwise pile up on the bus if nothing is reading it
+		GstBus * bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
+		gst_bus_set_flushing(bus, TRUE);
+		gst_bus_set_flushing(bus, FALSE);
+		gst_object_unref(GST_OBJECT(bus));
+	}
+
+	/*
+		Indicates whether a message from the bus is the one posted once the source has been inspected
+	*/
+	bool InspectorPipeline::inspected(GstMessage * message) const {
+		return (GST_MESSAGE_TYPE(message) == GST_MESSAGE_APPLICATION) &&
+		       (GST_MESSAGE_SRC(message) == GST_OBJECT(pipeline_)) &&
+		       gst_structure_has_name(gst_message_get_structure(message), "inspected");
+	}
+
+	/*
+		Called whenever a message is posted on the bus
+	*/
+	void InspectorPipeline::bus_message(GstMessage * message) {
+		switch (GST_MESSAGE_TYPE(message)) {
+		case GST_MESSAGE_TAG: {
+			GstTagList * tags;
+			gst_message_parse_tag(message, &tags);
+
+			char * tag_string;
+			std::lock_guard< std::mutex > lock(mutex_);
+
+			if (gst_tag_list_get_string(tags, GST_TAG_TITLE, &tag_string)) {
+				dprint("Found title");
+				title_ = tag_string;
+				g_free(tag_string);
+			}
+
+			if (gst_tag_list_get_string(tags, GST_TAG_ALBUM, &tag_string)) {
+				dprint("Found album");
+				album_ = tag_string;
+				g_free(tag_string);
+			}
+
+			if (gst_tag_list_get_string(tags, GST_TAG_ARTIST, &tag_string)) {
+				details_.setArtist(tag_string);
+				g_free(tag_string);
+			}
+
+			if (gst_tag_list_get_string(tags, GST_TAG_AUDIO_CODEC, &tag_string)) {
+				details_.setAudioCodec(tag_string);
+				g_free(tag_string);
+			}
+
+			if (gst_tag_list_get_string(tags, GST_TAG_VIDEO_CODEC, &tag_string)) {
+				details_.setVideoCodec(tag_string);
+				g_free(tag_string);
+			}
+
+			guint number;
+			if (gst_tag_list_get_uint(tags, GST_TAG_TRACK_NUMBER, &number)) {
+				details_.setTrackNumber(number);
+			}
+
+			if (gst_tag_list_get_uint(tags, GST_TAG_TRACK_COUNT, &number)) {
+				details_.setTrackCount(number);
+			}
+
+			// Decoders that can't know the actual bitrate up front give the one the stream was encoded for
+			if (gst_tag_list_get_uint(tags, GST_TAG_BITRATE, &number) ||
+			        gst_tag_list_get_uint(tags, GST_TAG_NOMINAL_BITRATE, &number)) {
+				details_.setBitrate(number);
+			}
+
+			guint64 duration;
+			if (gst_tag_list_get_uint64(tags, GST_TAG_DURATION, &duration)) {
+				details_.setDuration(std::max< long long >(details_.duration(), duration / GST_MSECOND));
+			}
+
+			gst_tag_list_free(tags);
+			break;
+		}
+		default:
+			;
+		}
+	}
+
+	/*
+		Called whenever a pad is added to the decode bin. Audio and video pads are watched for their first buffer,
+		which a decoder only sends once it has read the stream's headers and posted any tags in them.
+	*/
+	void InspectorPipeline::pad_added(GstPad * pad) {
+		GstCaps * caps = gst_pad_get_caps_reffed(pad);
+		if (caps == NULL) {
+			dprint("Error getting capabilities of pad");
+			return;
+		}
+
+		GstStructure * str = gst_caps_get_structure(caps, 0);
+		std::string type(gst_structure_get_name(str));
+
+		// Fields missing from the caps are left at 0
+		gint rate = 0;
+		gint channels = 0;
+		gint width = 0;
+		gint height = 0;
+		gint numerator = 0;
+		gint denominator = 0;
+		gst_structure_get_int(str, "rate", &rate);
+		gst_structure_get_int(str, "channels", &channels);
+		gst_structure_get_int(str, "width", &width);
+		gst_structure_get_int(str, "height", &height);
+		gst_structure_get_fraction(str, "framerate", &numerator, &denominator);
+		gst_caps_unref(caps);
+
+		std::lock_guard< std::mutex > lock(mutex_);
+
+		if (type.find("audio") == 0) {
+			dprint("Found audio stream");
+			has_audio_ = true;
+
+			details_.setSampleRate(rate);
+			details_.setChannels(channels);
+		} else if (type.find("video") == 0) {
+			dprint("Found video stream");
+			has_video_ = true;
+
+			details_.setResolution(width, height);
+			if (denominator != 0) {
+				details_.setFrameRate(static_cast< double >(numerator) / denominator);
+			}
+		} else {
+			// Other streams such as subtitles may not have a buffer until well into the source
+			dprint("Found other stream");
+			return;
+		}
+
+		WaitingPad waiting;
+		waiting.pad = pad;
+		waiting.buffer_probe = gst_pad_add_buffer_probe(pad, G_CALLBACK(buffer_probe_cb), this);
+		waiting.event_probe = gst_pad_add_event_probe(pad, G_CALLBACK(event_probe_cb), this);
+		waiting_pads_.push_back(waiting);
+	}
+
+	/*
+		Called once the decode bin has added a pad for every stream
+	*/
+	void InspectorPipeline::no_more_pads() {
+		std::unique_lock< std::mutex > lock(mutex_);
+		no_more_pads_ = true;
+		check_inspected(lock);
+	}
+
+	/*
+		Called from a stream's thread when it reaches its first buffer, or its end if it has none. Nothing is linked to
+		the pad, so the stream stops there. The probes are removed so nothing more is done for any later buffer.
+	*/
+	void InspectorPipeline::stream_started(GstPad * pad) {
+		WaitingPad started;
+		{
+			std::lock_guard< std::mutex > lock(mutex_);
+			std::vector< WaitingPad >::const_iterator i = waiting_pads_.begin();
+			while ((i != waiting_pads_.end()) && (i->pad != pad)) {
+				++i;
+			}
+
+			if (i == waiting_pads_.end()) {
+				return;
+			}
+
+			started = *i;
+		}
+
+		// The probes are only called from this stream's thread, so neither can be running while they are removed
+		gst_pad_remove_buffer_probe(pad, started.buffer_probe);
+		gst_pad_remove_event_probe(pad, started.event_probe);
+
+		// Once data is flowing the demuxer can usually say how long the stream is
+		GstFormat format = GST_FORMAT_TIME;
+		gint64 duration = 0;
+		if (!gst_pad_query_duration(pad, &format, &duration) || (format != GST_FORMAT_TIME)) {
+			duration = 0;
+		}
+
+		std::unique_lock< std::mutex > lock(mutex_);
+
+		for (std::vector< WaitingPad >::iterator i = waiting_pads_.begin(); i != waiting_pads_.end(); ++i) {
+			if (i->pad == pad) {
+				details_.setDuration(std::max< long long >(details_.duration(), duration / GST_MSECOND));
+
+				waiting_pads_.erase(i);
+				check_inspected(lock);
+				return;
+			}
+		}
+	}
+
+	/*
+		Posts the message saying the source has been inspected once every stream has been found and started
+	*/
+	void InspectorPipeline::check_inspected(std::unique_lock< std::mutex > & lock) {
+		if (inspected_ || !no_more_pads_ || !waiting_pads_.empty()) {
+			return;
+		}
+
+		inspected_ = true;
+		lock.unlock();
+
+		dprint("Inspected source");
+		gst_element_post_message(pipeline_, gst_message_new_application(GST_OBJECT(pipeline_),
+		                         gst_structure_empty_new("inspected")));
+	}
+
+	/*
+		Indicates whether the source has an audio stream
+	*/
+	bool InspectorPipeline::audio() const {
+		std::lock_guard< std::mutex > lock(mutex_);
+		return has_audio_;
+	}
+
+	/*
+		Indicates whether the source has a video stream
+	*/
+	bool InspectorPipeline::video() const {
+		std::lock_guard< std::mutex > lock(mutex_);
+		return has_video_;
+	}
+
+	/*
+		Returns any detected track title
+	*/
+	std::string InspectorPipeline::title() const {
+		std::lock_guard< std::mutex > lock(mutex_);
+		return title_;
+	}
+
+	/*
+		Returns any detected album name
+	*/
+	std::string InspectorPipeline::album() const {
+		std::lock_guard< std::mutex > lock(mutex_);
+		return album_;
+	}
+
+	/*
+		Returns what else was found about the streams and tags
+	*/
+	MediaDetails InspectorPipeline::details() const {
+		std::lock_guard< std::mutex > lock(mutex_);
+		return details_;
+	}
+}
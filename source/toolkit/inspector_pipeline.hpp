@@ -0,0 +1,101 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _INSPECTOR_PIPELINE_HPP
+#define _INSPECTOR_PIPELINE_HPP
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <core/noncopiable.hpp>
+#include <toolkit/media_details.hpp>
+
+extern "C" {
+#include <gst/gst.h>
+}
+
+#include "gstreamer_private.hpp"
+
+namespace toolkit {
+	/*
+		A pipeline that decodes a source just far enough to find its streams and tags, which can be used for one
+		source after another. Nothing is linked to the decoder, so nothing is prerolled: once every stream has been
+		found and has reached its first buffer, an application message is posted on the bus to say the source has been
+		inspected.
+	*/
+	class InspectorPipeline
+			: gstreamer::Initialiser, core::NonCopiable {
+		static void bus_message_cb(GstBus * bus, GstMessage * message, gpointer data);
+		static void pad_added_cb(GstElement * element, GstPad * pad, gpointer data);
+		static void no_more_pads_cb(GstElement * element, gpointer data);
+		static gboolean buffer_probe_cb(GstPad * pad, GstBuffer * buffer, gpointer data);
+		static gboolean event_probe_cb(GstPad * pad, GstEvent * event, gpointer data);
+
+		GstElement * pipeline_;
+		GstElement * decoder_;
+
+		// Guards everything below, which is written from the streaming threads
+		mutable std::mutex mutex_;
+
+		/*
+			An audio or video stream that hasn't started yet, with the probes waiting for it to
+		*/
+		struct WaitingPad {
+			GstPad * pad;
+			gulong buffer_probe;
+			gulong event_probe;
+		};
+
+		std::vector< WaitingPad > waiting_pads_;
+		bool no_more_pads_;
+		bool inspected_;
+
+		bool has_audio_;
+		bool has_video_;
+
+		std::string title_;
+		std::string album_;
+		MediaDetails details_;
+
+		void bus_message(GstMessage * message);
+		void pad_added(GstPad * pad);
+		void no_more_pads();
+		void stream_started(GstPad * pad);
+		void check_inspected(std::unique_lock< std::mutex > & lock);
+
+	public:
+		InspectorPipeline();
+		~InspectorPipeline();
+
+		GstElement * element() const;
+		GstBus * bus() const;
+
+		void prepare(char const * uri);
+		void recycle();
+
+		bool inspected(GstMessage * message) const;
+
+		bool audio() const;
+		bool video() const;
+
+		std::string title() const;
+		std::string album() const;
+		MediaDetails details() const;
+	};
+}
+
+#endif
@@ -0,0 +1,234 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <debug.hpp>
+#include <toolkit/inspector.hpp>
+#include <toolkit/inspector_pool.hpp>
+
+#include "gstreamer_private.hpp"
+
+namespace {
+	// Most URIs a worker takes from the queue at once
+	std::size_t const max_batch_size(16);
+}
+
+namespace toolkit {
+	class InspectorPoolPrivate
+			: gstreamer::Initialiser {
+		typedef std::pair< unsigned long long, std::string > Job;
+
+		std::vector< std::thread > workers_;
+
+		std::mutex mutex_;
+		std::condition_variable work_available_;
+		std::condition_variable work_changed_;
+
+		std::deque< Job > input_;
+		std::deque< InspectorResult > output_;
+
+		unsigned int queue_size_;
+		unsigned int timeout_;
+		std::shared_ptr< InspectorCache > cache_;
+
+		bool stopping_;
+
+		void work();
+
+	public:
+		InspectorPoolPrivate(unsigned int threads, unsigned int queue_size, unsigned int timeout);
+		~InspectorPoolPrivate();
+
+		inline unsigned int threads() const;
+		void setCache(std::shared_ptr< InspectorCache > cache);
+
+		void inspect(std::vector< std::string > const & uris, std::function< void (InspectorResult const &) > & callback);
+	};
+
+	InspectorPoolPrivate::InspectorPoolPrivate(unsigned int threads, unsigned int queue_size, unsigned int timeout)
+		: queue_size_(queue_size), timeout_(timeout), stopping_(false) {
+		if (threads == 0) {
+			threads = std::thread::hardware_concurrency();
+
+			if (threads == 0) {
+				threads = 1;
+			}
+		}
+
+		if (queue_size_ == 0) {
+			// Keep enough work queued that a worker never waits on the caller
+			queue_size_ = 4 * threads;
+		}
+
+		dprint("Starting %u inspector threads", threads);
+		workers_.reserve(threads);
+		for (unsigned int i = 0; i < threads; ++i) {
+			workers_.emplace_back(&InspectorPoolPrivate::work, this);
+		}
+	}
+
+	InspectorPoolPrivate::~InspectorPoolPrivate() {
+		{
+			std::lock_guard< std::mutex > lock(mutex_);
+			stopping_ = true;
+		}
+
+		work_available_.notify_all();
+
+		for (std::vector< std::thread >::iterator i = workers_.begin(); i != workers_.end(); ++i) {
+			i->join();
+		}
+	}
+
+	/*
+		Runs on each worker thread, inspecting URIs until the pool is destroyed. Each worker takes its share of the
+		queue as a batch, so the files after the one it is inspecting are read ahead.
+	*/
+	void InspectorPoolPrivate::work() {
+		// Each worker reuses one pipeline for everything it inspects
+		Inspector inspector(timeout_);
+
+		std::vector< unsigned long long > indexes;
+		std::vector< std::string > uris;
+
+		std::unique_lock< std::mutex > lock(mutex_);
+
+		for (;;) {
+			while (!stopping_ && input_.empty()) {
+				work_available_.wait(lock);
+			}
+
+			if (stopping_) {
+				return;
+			}
+
+			// Leave enough in the queue for the other workers
+			std::size_t count = std::max< std::size_t >(1, std::min(max_batch_size, input_.size() / workers_.size()));
+
+			indexes.clear();
+			uris.clear();
+
+			for (std::size_t i = 0; i < count; ++i) {
+				indexes.push_back(input_.front().first);
+				uris.push_back(std::move(input_.front().second));
+				input_.pop_front();
+			}
+
+			work_changed_.notify_one();
+
+			inspector.setCache(cache_);
+			lock.unlock();
+
+			inspector.inspectMany(uris, [&](InspectorResult const & result) {
+				InspectorResult found(indexes[result.index()], result.uri(), result.valid(), result.audio(), result.video(),
+				                      result.title(), result.album(), result.details());
+
+				std::lock_guard< std::mutex > output_lock(mutex_);
+				output_.push_back(std::move(found));
+				work_changed_.notify_one();
+			});
+
+			lock.lock();
+		}
+	}
+
+	/*
+		Returns the number of worker threads
+	*/
+	unsigned int InspectorPoolPrivate::threads() const {
+		return workers_.size();
+	}
+
+	/*
+		Sets the cache the workers look up local files in before inspecting them
+	*/
+	void InspectorPoolPrivate::setCache(std::shared_ptr< InspectorCache > cache) {
+		std::lock_guard< std::mutex > lock(mutex_);
+		cache_ = std::move(cache);
+	}
+
+	/*
+		Queues the URIs on the workers and hands each result to the callback on the calling thread
+	*/
+	void InspectorPoolPrivate::inspect(std::vector< std::string > const & uris,
+	                                   std::function< void (InspectorResult const &) > & callback) {
+		unsigned long long outstanding = 0;
+		std::vector< std::string >::const_iterator next = uris.begin();
+
+		std::unique_lock< std::mutex > lock(mutex_);
+
+		while ((next != uris.end()) || (outstanding > 0)) {
+			// Fill the input queue as far as it is allowed to go
+			bool queued = false;
+			while ((next != uris.end()) && (input_.size() < queue_size_)) {
+				input_.push_back(Job(next - uris.begin(), *next));
+				++next;
+				++outstanding;
+				queued = true;
+			}
+
+			if (queued) {
+				work_available_.notify_all();
+			}
+
+			if (output_.empty()) {
+				work_changed_.wait(lock);
+				continue;
+			}
+
+			// Deliver finished results without holding the lock so workers can carry on
+			std::deque< InspectorResult > finished;
+			finished.swap(output_);
+			outstanding -= finished.size();
+
+			lock.unlock();
+
+			for (std::deque< InspectorResult >::const_iterator i = finished.begin(); i != finished.end(); ++i) {
+				callback(*i);
+			}
+
+			lock.lock();
+		}
+	}
+
+	InspectorPool::InspectorPool(unsigned int threads, unsigned int queue_size, unsigned int timeout)
+		: p(new InspectorPoolPrivate(threads, queue_size, timeout)) {}
+
+	InspectorPool::~InspectorPool() {
+		delete p;
+	}
+
+	unsigned int InspectorPool::threads() const {
+		return p->threads();
+	}
+
+	void InspectorPool::setCache(std::shared_ptr< InspectorCache > cache) {
+		p->setCache(std::move(cache));
+	}
+
+	/*
+		Inspects every URI, calling back on this thread as each one completes so a single writer can store them
+	*/
+	void InspectorPool::inspect(std::vector< std::string > const & uris,
+	                            std::function< void (InspectorResult const &) > callback) const {
+		p->inspect(uris, callback);
+	}
+}
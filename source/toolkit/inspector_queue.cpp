@@ -0,0 +1,452 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <debug.hpp>
+#include <toolkit/inspector_queue.hpp>
+
+#include "inspector_pipeline.hpp"
+
+namespace {
+	/*
+		Milliseconds a closing queue waits for its pipelines to stop before leaving them to stop on their own
+	*/
+	unsigned int const reaper_patience(1000);
+}
+
+namespace toolkit {
+	class InspectorQueuePrivate
+			: gstreamer::Initialiser {
+		struct Request {
+			unsigned long long id;
+			std::string uri;
+			std::function< void (InspectorResult const &) > callback;
+			unsigned int timeout;
+		};
+
+		/*
+			A pipeline along with the request it is reading, if it is busy
+		*/
+		struct Slot {
+			InspectorQueuePrivate * queue;
+			InspectorPipeline * pipeline;
+			GSource * watch;
+			GSource * deadline;
+			bool busy;
+			Request request;
+		};
+
+		/*
+			Pipelines waiting to be stopped, shared with the thread stopping them so that it can outlive the queue
+		*/
+		struct Reaper {
+			std::mutex mutex;
+			std::condition_variable wake;
+			std::condition_variable finished;
+			std::deque< InspectorPipeline * > doomed;
+			bool stopping;
+			bool done;
+		};
+
+		static gboolean bus_watch_cb(GstBus * bus, GstMessage * message, gpointer data);
+		static gboolean deadline_cb(gpointer data);
+		static gboolean dispatch_cb(gpointer data);
+
+		GMainContext * context_;
+		GSource * dispatch_source_;
+
+		unsigned int timeout_;
+		unsigned int concurrency_;
+		unsigned long long next_id_;
+
+		std::deque< Request > requests_;
+		std::vector< Slot * > slots_;
+
+		std::shared_ptr< Reaper > reaper_;
+		std::thread reaper_thread_;
+
+		static void reap(std::shared_ptr< Reaper > reaper);
+
+		void schedule();
+		void dispatch();
+		void start(Slot * slot, Request request);
+		void message(Slot * slot, GstMessage * message);
+		void finish(Slot * slot, bool valid);
+		void retire(Slot * slot);
+		unsigned long long busy() const;
+
+	public:
+		InspectorQueuePrivate(unsigned int timeout, unsigned int concurrency);
+		~InspectorQueuePrivate();
+
+		unsigned long long inspect(std::string uri, std::function< void (InspectorResult const &) > callback,
+		                           unsigned int timeout);
+		bool cancel(unsigned long long id);
+		void cancelAll();
+
+		unsigned long long pending() const;
+		void wait();
+	};
+
+	gboolean InspectorQueuePrivate::bus_watch_cb(GstBus *, GstMessage * message, gpointer data) {
+		Slot * slot = reinterpret_cast< Slot * >(data);
+		slot->queue->message(slot, message);
+
+		// The slot may be gone by now, in which case so is this watch
+		return TRUE;
+	}
+
+	gboolean InspectorQueuePrivate::deadline_cb(gpointer data) {
+		Slot * slot = reinterpret_cast< Slot * >(data);
+		dprint("Timed out inspecting %s", slot->request.uri.c_str());
+		slot->queue->finish(slot, false);
+		return FALSE;
+	}
+
+	gboolean InspectorQueuePrivate::dispatch_cb(gpointer data) {
+		InspectorQueuePrivate * queue = reinterpret_cast< InspectorQueuePrivate * >(data);
+		g_source_unref(queue->dispatch_source_);
+		queue->dispatch_source_ = nullptr;
+
+		queue->dispatch();
+		return FALSE;
+	}
+
+	InspectorQueuePrivate::InspectorQueuePrivate(unsigned int timeout, unsigned int concurrency)
+		: context_(g_main_context_get_thread_default()), dispatch_source_(nullptr), timeout_(timeout),
+		  concurrency_(concurrency == 0 ? 1 : concurrency), next_id_(1), reaper_(new Reaper()) {
+		// Threads that haven't made a context of their own use the default one
+		context_ = g_main_context_ref(context_ == NULL ? g_main_context_default() : context_);
+		reaper_->stopping = false;
+		reaper_->done = false;
+		reaper_thread_ = std::thread(&InspectorQueuePrivate::reap, reaper_);
+	}
+
+	InspectorQueuePrivate::~InspectorQueuePrivate() {
+		cancelAll();
+		while (!slots_.empty()) {
+			retire(slots_.back());
+		}
+
+		if (dispatch_source_ != nullptr) {
+			g_source_destroy(dispatch_source_);
+			g_source_unref(dispatch_source_);
+		}
+
+		std::unique_lock< std::mutex > lock(reaper_->mutex);
+		reaper_->stopping = true;
+		reaper_->wake.notify_one();
+
+		// A source that never responds would otherwise hold up whoever is closing the queue for good
+		bool stopped = reaper_->finished.wait_for(lock, std::chrono::milliseconds(reaper_patience), [this]() {
+			return reaper_->done;
+		});
+		lock.unlock();
+
+		if (stopped) {
+			reaper_thread_.join();
+		} else {
+			dprint("Leaving pipelines that haven't stopped to finish after the inspector queue has gone");
+			reaper_thread_.detach();
+		}
+
+		g_main_context_unref(context_);
+	}
+
+	/*
+		Stops pipelines that have been given up on. This can take as long as the source takes to respond, so is done on
+		its own thread rather than holding up the main context.
+	*/
+	void InspectorQueuePrivate::reap(std::shared_ptr< Reaper > reaper) {
+		std::unique_lock< std::mutex > lock(reaper->mutex);
+
+		for (;;) {
+			while (!reaper->stopping && reaper->doomed.empty()) {
+				reaper->wake.wait(lock);
+			}
+
+			if (reaper->doomed.empty()) {
+				reaper->done = true;
+				reaper->finished.notify_one();
+				return;
+			}
+
+			InspectorPipeline * pipeline = reaper->doomed.front();
+			reaper->doomed.pop_front();
+
+			lock.unlock();
+			delete pipeline;
+			lock.lock();
+		}
+	}
+
+	/*
+		Starts waiting requests the next time the main context is idle, so nothing is read while the caller waits
+	*/
+	void InspectorQueuePrivate::schedule() {
+		if ((dispatch_source_ != nullptr) || requests_.empty()) {
+			return;
+		}
+
+		dispatch_source_ = g_idle_source_new();
+		g_source_set_callback(dispatch_source_, dispatch_cb, this, NULL);
+		g_source_attach(dispatch_source_, context_);
+	}
+
+	/*
+		Starts waiting requests until as many are being read as are allowed at once
+	*/
+	void InspectorQueuePrivate::dispatch() {
+		while (!requests_.empty() && (busy() < concurrency_)) {
+			std::vector< Slot * >::const_iterator idle = std::find_if(slots_.begin(), slots_.end(), [](Slot * slot) {
+				return !slot->busy;
+			});
+
+			Slot * slot;
+			if (idle != slots_.end()) {
+				slot = *idle;
+			} else {
+				slot = new Slot();
+				slot->queue = this;
+				slot->pipeline = new InspectorPipeline();
+
+				// Messages are read on the context results are delivered on
+				GstBus * bus = slot->pipeline->bus();
+				slot->watch = gst_bus_create_watch(bus);
+				gst_object_unref(GST_OBJECT(bus));
+
+				g_source_set_callback(slot->watch, reinterpret_cast< GSourceFunc >(G_CALLBACK(bus_watch_cb)), slot, NULL);
+				g_source_attach(slot->watch, context_);
+				slots_.push_back(slot);
+			}
+
+			Request request(std::move(requests_.front()));
+			requests_.pop_front();
+			start(slot, std::move(request));
+		}
+	}
+
+	/*
+		Starts reading a source with the pipeline of an idle slot
+	*/
+	void InspectorQueuePrivate::start(Slot * slot, Request request) {
+		slot->busy = true;
+		slot->request = std::move(request);
+		slot->pipeline->prepare(slot->request.uri.c_str());
+
+		unsigned int timeout = slot->request.timeout == 0 ? timeout_ : slot->request.timeout;
+		if (timeout > 0) {
+			slot->deadline = g_timeout_source_new(timeout);
+			g_source_set_callback(slot->deadline, deadline_cb, slot, NULL);
+			g_source_attach(slot->deadline, context_);
+		}
+
+		// Otherwise this finishes once every stream has been found, the source fails or it runs out of time
+		if (gst_element_set_state(slot->pipeline->element(), GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE) {
+			finish(slot, false);
+		}
+	}
+
+	/*
+		Called on the main context for each message posted on a slot's bus
+	*/
+	void InspectorQueuePrivate::message(Slot * slot, GstMessage * message) {
+		if (!slot->busy) {
+			return;
+		}
+
+		if (slot->pipeline->inspected(message)) {
+			finish(slot, true);
+		} else if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR) {
+			finish(slot, false);
+		}
+	}
+
+	/*
+		Hands the result of a slot's request to its callback, freeing the slot for the next request
+	*/
+	void InspectorQueuePrivate::finish(Slot * slot, bool valid) {
+		if (slot->deadline != nullptr) {
+			g_source_destroy(slot->deadline);
+			g_source_unref(slot->deadline);
+			slot->deadline = nullptr;
+		}
+
+		// A pipeline that hasn't finished may still be changing what it found from its streaming threads
+		InspectorResult result(slot->request.id, std::move(slot->request.uri), valid, valid && slot->pipeline->audio(),
+		                       valid && slot->pipeline->video(), valid ? slot->pipeline->title() : std::string(),
+		                       valid ? slot->pipeline->album() : std::string(),
+		                       valid ? slot->pipeline->details() : MediaDetails());
+
+		std::function< void (InspectorResult const &) > callback;
+		callback.swap(slot->request.callback);
+		slot->busy = false;
+
+		if (valid) {
+			slot->pipeline->recycle();
+		} else {
+			// A source that couldn't be read may have left the pipeline in error, or still waiting on the source
+			dprint("Unable to inspect %s", result.uri().c_str());
+			retire(slot);
+		}
+
+		callback(result);
+		schedule();
+	}
+
+	/*
+		Removes a slot, leaving its pipeline to be stopped on the reaper thread
+	*/
+	void InspectorQueuePrivate::retire(Slot * slot) {
+		if (slot->deadline != nullptr) {
+			g_source_destroy(slot->deadline);
+			g_source_unref(slot->deadline);
+		}
+
+		g_source_destroy(slot->watch);
+		g_source_unref(slot->watch);
+
+		{
+			std::lock_guard< std::mutex > lock(reaper_->mutex);
+			reaper_->doomed.push_back(slot->pipeline);
+		}
+
+		reaper_->wake.notify_one();
+
+		slots_.erase(std::find(slots_.begin(), slots_.end(), slot));
+		delete slot;
+	}
+
+	/*
+		Returns the number of sources being read
+	*/
+	unsigned long long InspectorQueuePrivate::busy() const {
+		return std::count_if(slots_.begin(), slots_.end(), [](Slot * slot) {
+			return slot->busy;
+		});
+	}
+
+	/*
+		Queues a source to be inspected, returning the ID its result will have
+	*/
+	unsigned long long InspectorQueuePrivate::inspect(std::string uri,
+	        std::function< void (InspectorResult const &) > callback, unsigned int timeout) {
+		Request request = {next_id_++, std::move(uri), std::move(callback), timeout};
+		requests_.push_back(std::move(request));
+		schedule();
+
+		return requests_.back().id;
+	}
+
+	/*
+		Stops inspecting a source without calling back, returning false if it had already finished
+	*/
+	bool InspectorQueuePrivate::cancel(unsigned long long id) {
+		for (std::deque< Request >::iterator i = requests_.begin(); i != requests_.end(); ++i) {
+			if (i->id == id) {
+				requests_.erase(i);
+				return true;
+			}
+		}
+
+		for (std::vector< Slot * >::const_iterator i = slots_.begin(); i != slots_.end(); ++i) {
+			if ((*i)->busy && ((*i)->request.id == id)) {
+				retire(*i);
+				schedule();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/*
+		Stops inspecting every source without calling back
+	*/
+	void InspectorQueuePrivate::cancelAll() {
+		requests_.clear();
+
+		std::vector< Slot * > slots(slots_);
+		for (std::vector< Slot * >::const_iterator i = slots.begin(); i != slots.end(); ++i) {
+			if ((*i)->busy) {
+				retire(*i);
+			}
+		}
+	}
+
+	/*
+		Returns the number of sources that are waiting or being read
+	*/
+	unsigned long long InspectorQueuePrivate::pending() const {
+		return requests_.size() + busy();
+	}
+
+	/*
+		Runs the main context until every source has been inspected
+	*/
+	void InspectorQueuePrivate::wait() {
+		while (pending() > 0) {
+			g_main_context_iteration(context_, TRUE);
+		}
+	}
+
+	InspectorQueue::InspectorQueue(unsigned int timeout, unsigned int concurrency)
+		: p(new InspectorQueuePrivate(timeout, concurrency)) {}
+
+	InspectorQueue::~InspectorQueue() {
+		delete p;
+	}
+
+	/*
+		Queues a source to be inspected, returning straight away with the ID the result passed to the callback will
+		have. A timeout of 0 uses the queue's timeout.
+	*/
+	unsigned long long InspectorQueue::inspect(std::string uri, std::function< void (InspectorResult const &) > callback,
+	        unsigned int timeout) const {
+		return p->inspect(std::move(uri), std::move(callback), timeout);
+	}
+
+	/*
+		Stops inspecting a source without calling back, returning false if it had already finished
+	*/
+	bool InspectorQueue::cancel(unsigned long long id) const {
+		return p->cancel(id);
+	}
+
+	void InspectorQueue::cancelAll() const {
+		p->cancelAll();
+	}
+
+	unsigned long long InspectorQueue::pending() const {
+		return p->pending();
+	}
+
+	/*
+		Runs the main context until every source has been inspected. This must be called on the thread the queue calls
+		back on.
+	*/
+	void InspectorQueue::wait() const {
+		p->wait();
+	}
+}
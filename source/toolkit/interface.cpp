@@ -42,8 +42,24 @@ namespace clutter {
 }
 
 namespace toolkit {
+	gboolean InterfacePrivate::rekey_library_cb(gpointer data) {
+		InterfacePrivate * self = reinterpret_cast< InterfacePrivate * >(data);
+		if (self->library_.rekey()) {
+			return TRUE;
+		}
+
+		// Show the items in their new order
+		self->libraryUpdated();
+		return FALSE;
+	}
+
 	InterfacePrivate::InterfacePrivate()
 		: browser_(this), player_(this) {
+		// Items are listed in the order of the user's language, their keys being made again a batch at a time while
+		// idle if the language has changed
+		library_.setCollation(std::make_shared< LibraryCollation >(""));
+		g_idle_add(rekey_library_cb, this);
+
 		clutter_stage_set_title(CLUTTER_STAGE(clutter_stage_get_default()), DISPLAY_NAME);
 		clutter_stage_set_throttle_motion_events(CLUTTER_STAGE(clutter_stage_get_default()), TRUE);
 		clutter_stage_set_user_resizable(CLUTTER_STAGE(clutter_stage_get_default()), TRUE);
@@ -78,6 +94,20 @@ namespace toolkit {
 		panel_.setAutoHide(false);
 	}
 
+	/*
+		Adds the URI to the end of the play queue
+	*/
+	void InterfacePrivate::enqueue(std::string uri, std::string title) {
+		player_.enqueue(std::move(uri), std::move(title));
+	}
+
+	/*
+		Returns the library shared by the widgets
+	*/
+	toolkit::Library & InterfacePrivate::library() {
+		return library_;
+	}
+
 	/*
 		Informs the other widgets that the library has been updated
 	*/
@@ -39,8 +39,8 @@ namespace {
 }
 
 namespace interface {
-	gboolean BrowserItem::item_clicked_cb(ClutterActor *, ClutterEvent *, gpointer data) {
-		reinterpret_cast< BrowserItem * >(data)->item_clicked();
+	gboolean BrowserItem::item_clicked_cb(ClutterActor *, ClutterEvent * event, gpointer data) {
+		reinterpret_cast< BrowserItem * >(data)->item_clicked(clutter_event_get_button(event));
 		return TRUE;
 	}
 
@@ -87,6 +87,14 @@ namespace interface {
 		g_object_unref(actor_);
 	}
 
+	/*
+		Whether the item already displays the given library item
+	*/
+	bool BrowserItem::shows(toolkit::LibraryItem const & library_item) const {
+		return item_.uri() == library_item.uri() && item_.title() == library_item.title() &&
+		       item_.thumbnailFile() == library_item.thumbnailFile();
+	}
+
 	/*
 		Renders the thumnail for the item
 	*/
@@ -120,8 +128,13 @@ namespace interface {
 	/*
 		Called whenever the item is clicked
 	*/
-	void BrowserItem::item_clicked() {
-		p->play(item_.uri(), item_.title());
+	void BrowserItem::item_clicked(guint button) {
+		if (button == 3) {
+			// Play after whatever is playing now
+			p->enqueue(item_.uri(), item_.title());
+		} else {
+			p->play(item_.uri(), item_.title());
+		}
 	}
 
 	gboolean Browser::all_clicked_cb(ClutterActor *, ClutterEvent * event, gpointer data) {
@@ -176,7 +189,7 @@ namespace interface {
 		return TRUE;
 	}
 
-	void Browser::search_activated_cb(ClutterText *, gpointer data) {
+	void Browser::search_changed_cb(ClutterText *, gpointer data) {
 		reinterpret_cast< Browser * >(data)->update_media_list();
 	}
 
@@ -207,7 +220,8 @@ namespace interface {
 	}
 
 	Browser::Browser(toolkit::InterfacePrivate * interface_private)
-		: p(interface_private), type_(toolkit::Library::Type::All) {
+		: p(interface_private), library_(interface_private->library()), search_(library_),
+		  type_(toolkit::Library::Type::All) {
 		ClutterLayoutManager * main_layout = clutter_box_layout_new();
 		clutter_box_layout_set_spacing(CLUTTER_BOX_LAYOUT(main_layout), 30u);
 		clutter_box_layout_set_vertical(CLUTTER_BOX_LAYOUT(main_layout), TRUE);
@@ -275,7 +289,7 @@ namespace interface {
 		clutter_actor_set_x(search_text_, 19.0f);
 		clutter_actor_set_width(search_text_, 280.0f);
 		clutter_actor_set_reactive(search_text_, TRUE);
-		g_signal_connect(search_text_, "activate", G_CALLBACK(search_activated_cb), this);
+		g_signal_connect(search_text_, "text-changed", G_CALLBACK(search_changed_cb), this);
 		g_signal_connect(search_text_, "enter-event", G_CALLBACK(actor_highlight_on_cb), search_icon);
 		g_signal_connect(search_text_, "leave-event", G_CALLBACK(actor_highlight_off_cb), search_icon);
 		clutter_box_pack(CLUTTER_BOX(search), search_text_, NULL, NULL);
@@ -663,21 +677,58 @@ namespace interface {
 		Update the displayed list of media items
 	*/
 	void Browser::update_media_list() {
-		clear_media_list();
-
-		std::vector< toolkit::LibraryItem > list;
+		toolkit::LibraryItemTable list;
 		if (*(clutter_text_get_text(CLUTTER_TEXT(search_text_))) == '\0') {
 			// Search box is empty
 			list = library_.list(type_);
 		} else {
-			// Search text exists
-			list = library_.search(type_, clutter_text_get_text(CLUTTER_TEXT(search_text_)));
+			// Search text exists, narrowing down the previous results as it's typed
+			list = search_.search(type_, clutter_text_get_text(CLUTTER_TEXT(search_text_)));
 		}
-		item_list_.reserve(list.size());
 
-		for (std::vector< toolkit::LibraryItem >::const_iterator i = list.begin(); i != list.end(); ++i) {
-			item_list_.emplace_back(*i, p);
-			clutter_box_pack(CLUTTER_BOX(media_list_), item_list_.back().actor(), NULL, NULL);
+		// Reuse the items already displayed so their thumbnails are not drawn again
+		std::unordered_map< std::string, std::size_t > displayed;
+		displayed.reserve(item_list_.size());
+		for (std::size_t i = 0; i < item_list_.size(); ++i) {
+			displayed.emplace(item_list_[i].uri(), i);
+		}
+
+		std::vector< BrowserItem > item_list;
+		std::vector< bool > kept(item_list_.size(), false);
+		item_list.reserve(list.size());
+		bool in_order = true;
+		std::size_t last = 0;
+
+		for (std::size_t i = 0; i < list.size(); ++i) {
+			toolkit::LibraryItem library_item = list[i];
+			auto found = displayed.find(library_item.uri());
+			if (found != displayed.end() && !kept[found->second] && item_list_[found->second].shows(library_item)) {
+				if (found->second < last) {
+					in_order = false;
+				}
+				last = found->second;
+				kept[found->second] = true;
+				item_list.push_back(std::move(item_list_[found->second]));
+			} else {
+				in_order = false;
+				item_list.emplace_back(std::move(library_item), p);
+			}
+		}
+
+		if (in_order) {
+			// Narrowed down, only the items that dropped out need removing
+			for (std::size_t i = 0; i < item_list_.size(); ++i) {
+				if (!kept[i]) {
+					clutter_container_remove_actor(CLUTTER_CONTAINER(media_list_), item_list_[i].actor());
+				}
+			}
+			item_list_ = std::move(item_list);
+		} else {
+			clear_media_list();
+			item_list_ = std::move(item_list);
+			for (auto & item : item_list_) {
+				clutter_box_pack(CLUTTER_BOX(media_list_), item.actor(), NULL, NULL);
+			}
 		}
 
 		// Scroll to top of list
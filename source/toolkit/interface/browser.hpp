@@ -19,7 +19,9 @@
 #define _INTERFACE_BROWSER_HPP
 
 #include <list>
+#include <unordered_map>
 #include <toolkit/library.hpp>
+#include <toolkit/library_search.hpp>
 
 extern "C" {
 #include <clutter/clutter.h>
@@ -46,13 +48,19 @@ namespace interface {
 
 		void draw_thumbnail();
 
-		void item_clicked();
+		void item_clicked(guint button);
 
 	public:
 		BrowserItem(toolkit::LibraryItem library_item, toolkit::InterfacePrivate * interface_private);
 		BrowserItem(BrowserItem const & browser_item);
 		BrowserItem(BrowserItem && browser_item);
 		~BrowserItem();
+
+		bool shows(toolkit::LibraryItem const & library_item) const;
+
+		std::string uri() const {
+			return item_.uri();
+		}
 	};
 
 	class Browser
@@ -63,12 +71,13 @@ namespace interface {
 		static void height_changed_cb(GObject * object, GParamSpec * param, gpointer data);
 		static gboolean key_pressed_cb(ClutterActor * actor, ClutterEvent * event, gpointer data);
 		static gboolean scroll_dragged_cb(ClutterActor * actor, ClutterEvent * event, gpointer data);
-		static void search_activated_cb(ClutterText * text, gpointer data);
+		static void search_changed_cb(ClutterText * text, gpointer data);
 		static gboolean wheel_scrolled_cb(ClutterActor * actor, ClutterEvent * event, gpointer data);
 
 		toolkit::InterfacePrivate * p;
 
-		toolkit::Library library_;
+		toolkit::Library & library_;
+		toolkit::LibrarySearch search_;
 
 		std::vector< BrowserItem > item_list_;
 
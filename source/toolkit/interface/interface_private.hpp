@@ -43,10 +43,14 @@ namespace clutter {
 namespace toolkit {
 	class InterfacePrivate
 		: clutter::Initialiser {
+		toolkit::Library library_;
+
 		interface::Browser browser_;
 		interface::Player player_;
 		interface::WindowPanel panel_;
 
+		static gboolean rekey_library_cb(gpointer data);
+
 	public:
 		InterfacePrivate();
 
@@ -54,6 +58,9 @@ namespace toolkit {
 		void play(std::string uri, std::string title);
 
 		void add();
+		void enqueue(std::string uri, std::string title);
+
+		toolkit::Library & library();
 
 		void libraryUpdated();
 	};
@@ -20,6 +20,8 @@ extern "C" {
 #include <clutter-gst/clutter-gst.h>
 }
 
+#include <core/filesystem.hpp>
+
 #include "interface_private.hpp"
 #include "player.hpp"
 
@@ -27,6 +29,11 @@ namespace interface {
 	unsigned int const Player::title_width(300);
 	unsigned int const Player::title_height(30);
 
+	gboolean Player::flush_history_cb(gpointer data) {
+		reinterpret_cast< Player * >(data)->history_.process();
+		return TRUE;
+	}
+
 	gboolean Player::hide_controls_cb(gpointer data) {
 		reinterpret_cast< Player * >(data)->hide_controls();
 		return FALSE;
@@ -156,7 +163,11 @@ namespace interface {
 	}
 
 	Player::Player(toolkit::InterfacePrivate * interface_private)
-		: p(interface_private), update_seek_timeout_id_(0) {
+		: p(interface_private), queue_(interface_private->library(), toolkit::Playlist::queue),
+		  history_(interface_private->library(), core::Path::data() + "/history.journal"), update_seek_timeout_id_(0) {
+		// Play history is written in batches rather than as each play happens
+		g_timeout_add_seconds(5, flush_history_cb, this);
+
 		ClutterLayoutManager * main_layout = clutter_bin_layout_new(CLUTTER_BIN_ALIGNMENT_FIXED,
 		                                     CLUTTER_BIN_ALIGNMENT_FIXED);
 		actor_ = clutter_box_new(main_layout);
@@ -507,6 +518,17 @@ namespace interface {
 	*/
 	void Player::media_eos() {
 		if (current_track_ == total_tracks_) {
+			history_.played(playing_uri_);
+			playing_uri_.clear();
+
+			if (!queue_.empty()) {
+				// Move on to the next queued media
+				toolkit::LibraryPlaylistEntry next = queue_.at(0);
+				queue_.remove(0);
+				play(next.uri(), next.title());
+				return;
+			}
+
 			draw_play_button();
 			p->browse();
 		} else {
@@ -675,6 +697,11 @@ namespace interface {
 		Called whenever the stop button is clicked
 	*/
 	void Player::stop_clicked() {
+		if (!playing_uri_.empty()) {
+			history_.skipped(playing_uri_);
+			playing_uri_.clear();
+		}
+
 		clutter_media_set_playing(media_, FALSE);
 		p->browse();
 	}
@@ -707,10 +734,23 @@ namespace interface {
 		clutter_actor_set_width(seek_hidden_, clutter_actor_get_width(clutter_stage_get_default()) * 0.7f);
 	}
 
+	/*
+		Adds the given URI to the end of the play queue
+	*/
+	void Player::enqueue(std::string uri, std::string title) {
+		queue_.append(std::move(uri), std::move(title));
+	}
+
 	/*
 		Plays the given URI in the media widget
 	*/
 	void Player::play(std::string uri, std::string title) {
+		if (!playing_uri_.empty()) {
+			// Whatever was playing didn't reach the end
+			history_.skipped(playing_uri_);
+		}
+
+		playing_uri_ = uri;
 		set_title(std::move(title));
 
 		// Clear the image in the video texture
@@ -23,6 +23,9 @@ extern "C" {
 #include <gst/gst.h>
 }
 
+#include <toolkit/history.hpp>
+#include <toolkit/playlist.hpp>
+
 #include "actor.hpp"
 
 namespace toolkit {
@@ -35,6 +38,7 @@ namespace interface {
 		static unsigned int const title_width;
 		static unsigned int const title_height;
 
+		static gboolean flush_history_cb(gpointer data);
 		static gboolean hide_controls_cb(gpointer data);
 		static gboolean key_pressed_cb(ClutterActor * actor, ClutterEvent * event, gpointer data);
 		static void media_eos_cb(ClutterMedia * media, gpointer data);
@@ -52,6 +56,11 @@ namespace interface {
 
 		toolkit::InterfacePrivate * p;
 
+		toolkit::Playlist queue_;
+		toolkit::History history_;
+
+		std::string playing_uri_;
+
 		ClutterMedia * media_;
 
 		ClutterActor * volume_;
@@ -97,6 +106,7 @@ namespace interface {
 	public:
 		Player(toolkit::InterfacePrivate * interface_private);
 
+		void enqueue(std::string uri, std::string title);
 		void play(std::string uri, std::string title = std::string());
 	};
 }
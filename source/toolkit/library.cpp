@@ -15,29 +15,75 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <debug.hpp>
 #include <core/filesystem.hpp>
+#include <core/hash.hpp>
 #include <toolkit/library.hpp>
 
+#include "library_rules.hpp"
+#include "library_snapshot.hpp"
+#include "library_trigrams.hpp"
+#include "library_volume.hpp"
+#include "media_details_private.hpp"
+
 namespace {
-	long long const db_version(1);
+	long long const db_version(14);
 
 	/*
-		Fetches the next specified number of items
+		Quotes text to be included in an SQL statement
 	*/
-	inline std::vector< toolkit::LibraryItem > fetch(core::Statement * stmt) {
-		if ((stmt == nullptr) || (!stmt->hasData())) {
-			return std::vector< toolkit::LibraryItem >();
+	std::string quote(std::string const & text) {
+		std::string quoted("'");
+		for (std::string::const_iterator i = text.begin(); i != text.end(); ++i) {
+			quoted.push_back(*i);
+			if (*i == '\'') {
+				quoted.push_back('\'');
+			}
 		}
 
-		std::vector< toolkit::LibraryItem > items;
+		return quoted + "'";
+	}
+
+	/*
+		Returns a URI ending in a slash, so that comparing the start of another URI against it only matches what is
+		beneath it
+	*/
+	std::string directory(std::string const & uri) {
+		return (uri.empty() || (uri[uri.size() - 1] == '/')) ? uri : uri + "/";
+	}
+
+	/*
+		Indicates whether a URI is a root or beneath it, rather than merely starting with the same characters
+	*/
+	bool beneath(std::string const & uri, std::string const & root) {
+		return (uri.compare(0, root.size(), root) == 0) && ((uri.size() == root.size()) || root.empty() ||
+		        (root[root.size() - 1] == '/') || (uri[root.size()] == '/'));
+	}
+
+	/*
+		Returns the start of a query for the items on a volume, with the same columns as those from the library
+	*/
+	std::string volume_items(toolkit::LibraryVolume const & volume, std::string const & columns) {
+		return "SELECT (" + std::to_string(volume.id()) + " << " + std::to_string(toolkit::LibraryVolume::id_shift) +
+		       ") | item_id, name, " + quote(volume.root()) + " || path, items.thumbnail" + columns + " FROM " +
+		       volume.schema() + ".items LEFT JOIN " + volume.schema() + ".albums USING (album_id) NATURAL JOIN main.types";
+	}
+
+	/*
+		Fetches the remaining rows of a statement as items
+	*/
+	inline toolkit::LibraryItemTable fetch(core::Statement * stmt) {
+		toolkit::LibraryItemTable items;
+
+		if ((stmt == nullptr) || (!stmt->hasData())) {
+			return items;
+		}
 
 		do {
-			if (stmt->dataType(3u) == core::Statement::Type::Null) {
-				items.emplace_back(stmt->toInteger(0u), stmt->toText(1u), stmt->toText(2u));
-			} else {
-				items.emplace_back(stmt->toInteger(0u), stmt->toText(1u), stmt->toText(2u), stmt->toText(3u));
-			}
+			items.add(stmt->toInteger(0u), stmt->toText(1u), stmt->toText(2u), stmt->toText(3u));
 		} while (stmt->nextRow());
 
 		return items;
@@ -45,45 +91,218 @@ namespace {
 }
 
 namespace toolkit {
-	LibraryItem::LibraryItem(long long id, std::string title, std::string uri, std::string thumbnail_file)
-		: id_(id), title_(title), uri_(uri), thumbnail_(thumbnail_file) {}
+	LibraryFile::LibraryFile(std::string path, unsigned long long device, unsigned long long inode,
+	                         unsigned long long size, long long modified, unsigned long long hash)
+		: path_(std::move(path)), device_(device), inode_(inode), size_(size), modified_(modified), hash_(hash) {}
+
+	/*
+		Returns the absolute path of the file
+	*/
+	std::string LibraryFile::path() const {
+		return path_;
+	}
+
+	/*
+		Returns the device the file is stored on
+	*/
+	unsigned long long LibraryFile::device() const {
+		return device_;
+	}
 
-	LibraryItem::LibraryItem(LibraryItem const & library_item)
-		: id_(library_item.id_), title_(library_item.title_), uri_(library_item.uri_), thumbnail_(library_item.thumbnail_) {}
+	/*
+		Returns the inode of the file on its device
+	*/
+	unsigned long long LibraryFile::inode() const {
+		return inode_;
+	}
+
+	/*
+		Returns the size of the file in bytes
+	*/
+	unsigned long long LibraryFile::size() const {
+		return size_;
+	}
+
+	/*
+		Returns the modification time of the file in nanoseconds
+	*/
+	long long LibraryFile::modified() const {
+		return modified_;
+	}
+
+	/*
+		Returns the fingerprint of the file's contents, or 0 if it hasn't been calculated
+	*/
+	unsigned long long LibraryFile::hash() const {
+		return hash_;
+	}
+
+	/*
+		Sets the fingerprint of the file's contents
+	*/
+	void LibraryFile::setHash(unsigned long long hash) {
+		hash_ = hash;
+	}
+
+	/*
+		Indicates whether the file appears to be the same one, unmodified
+	*/
+	bool LibraryFile::unchanged(LibraryFile const & file) const {
+		return (device_ == file.device_) && (inode_ == file.inode_) && (size_ == file.size_) &&
+		       (modified_ == file.modified_);
+	}
+
+	LibraryFacet::LibraryFacet(Kind kind, std::string name, unsigned long long count)
+		: kind_(kind), name_(std::move(name)), count_(count) {}
+
+	/*
+		Returns whether the facet counts a type, an album or a directory
+	*/
+	LibraryFacet::Kind LibraryFacet::kind() const {
+		return kind_;
+	}
+
+	/*
+		Returns the name of the type or album, or the URI of the directory
+	*/
+	std::string LibraryFacet::name() const {
+		return name_;
+	}
 
-	LibraryItem::LibraryItem(LibraryItem && library_item)
-		: id_(library_item.id_) {
-		swap(title_, library_item.title_);
-		swap(uri_, library_item.uri_);
-		swap(thumbnail_, library_item.thumbnail_);
+	/*
+		Returns the number of items in the facet
+	*/
+	unsigned long long LibraryFacet::count() const {
+		return count_;
 	}
 
+	LibraryPlaylistEntry::LibraryPlaylistEntry(long long id, long long position, std::string uri, std::string title)
+		: id_(id), position_(position), uri_(std::move(uri)), title_(std::move(title)) {}
+
 	/*
-		Returns the database ID of the library item
+		Returns the database ID of the entry
 	*/
-	long long LibraryItem::id() const {
+	long long LibraryPlaylistEntry::id() const {
 		return id_;
 	}
 
 	/*
-		Returns the title of the library item
+		Returns the key the playlist is ordered by
+	*/
+	long long LibraryPlaylistEntry::position() const {
+		return position_;
+	}
+
+	/*
+		Sets the key the playlist is ordered by
+	*/
+	void LibraryPlaylistEntry::setPosition(long long position) {
+		position_ = position;
+	}
+
+	/*
+		Returns the URI to play
+	*/
+	std::string LibraryPlaylistEntry::uri() const {
+		return uri_;
+	}
+
+	/*
+		Returns the title to display while playing
 	*/
-	std::string LibraryItem::title() const {
+	std::string LibraryPlaylistEntry::title() const {
 		return title_;
 	}
 
+	LibraryPlay::LibraryPlay(unsigned long long sequence, std::string uri, bool skipped, long long time)
+		: sequence_(sequence), uri_(std::move(uri)), skipped_(skipped), time_(time) {}
+
+	/*
+		Returns the number of the event, which increases with each play or skip
+	*/
+	unsigned long long LibraryPlay::sequence() const {
+		return sequence_;
+	}
+
 	/*
-		Returns the URI pointing to the location of the library item
+		Returns the URI of the item played
 	*/
-	std::string LibraryItem::uri() const {
+	std::string LibraryPlay::uri() const {
 		return uri_;
 	}
 
 	/*
-		Returns the file with a thumbnail of the library item
+		Indicates whether the item was skipped rather than played to the end
+	*/
+	bool LibraryPlay::skipped() const {
+		return skipped_;
+	}
+
+	/*
+		Returns the time of the event in seconds since the epoch
+	*/
+	long long LibraryPlay::time() const {
+		return time_;
+	}
+
+	LibraryPlayStatistics::LibraryPlayStatistics(unsigned long long plays, unsigned long long skips,
+	        long long last_played)
+		: plays_(plays), skips_(skips), last_played_(last_played) {}
+
+	/*
+		Returns the number of times the item has been played to the end
+	*/
+	unsigned long long LibraryPlayStatistics::plays() const {
+		return plays_;
+	}
+
+	/*
+		Returns the number of times the item has been skipped
+	*/
+	unsigned long long LibraryPlayStatistics::skips() const {
+		return skips_;
+	}
+
+	/*
+		Returns when the item was last played in seconds since the epoch, or 0 if it never has been
+	*/
+	long long LibraryPlayStatistics::lastPlayed() const {
+		return last_played_;
+	}
+
+	LibraryRule::LibraryRule(Field field, Comparison comparison, std::string value)
+		: field_(field), comparison_(comparison), value_(std::move(value)) {}
+
+	LibraryRule::LibraryRule(Field field, Comparison comparison, long long value)
+		: field_(field), comparison_(comparison), value_(std::to_string(value)) {}
+
+	/*
+		Returns the property of items the rule tests
+	*/
+	LibraryRule::Field LibraryRule::field() const {
+		return field_;
+	}
+
+	/*
+		Returns how the property is compared with the value
 	*/
-	std::string LibraryItem::thumbnailFile() const {
-		return thumbnail_;
+	LibraryRule::Comparison LibraryRule::comparison() const {
+		return comparison_;
+	}
+
+	/*
+		Returns the value the property is compared with as text
+	*/
+	std::string LibraryRule::value() const {
+		return value_;
+	}
+
+	/*
+		Returns the value the property is compared with as a number, or 0 if it isn't one. Times are in seconds and
+		durations in milliseconds.
+	*/
+	long long LibraryRule::number() const {
+		return std::strtoll(value_.c_str(), nullptr, 10);
 	}
 
 	/*
@@ -94,14 +313,16 @@ namespace toolkit {
 		clear();
 
 		{
-			core::Statement version_table(*this, "CREATE TABLE version (version INTEGER PRIMARY KEY)");
+			// The epoch tells this database apart from any it replaces, whose generations started from the same place
+			core::Statement version_table(*this, "CREATE TABLE version (version INTEGER PRIMARY KEY, epoch INTEGER NOT NULL)");
 			assert(version_table.valid());
 			version_table.execute();
 		}
 
 		{
-			core::Statement set_version(*this, "INSERT INTO version (version) VALUES (?)");
+			core::Statement set_version(*this, "INSERT INTO version (version, epoch) VALUES (?, ?)");
 			set_version.bind(1u, db_version);
+			set_version.bind(2u, static_cast< long long >(snapshot::epoch()));
 			assert(set_version.valid());
 			set_version.execute();
 		}
@@ -116,17 +337,32 @@ namespace toolkit {
 		{
 			core::Statement set_types(*this, "INSERT INTO types (type) VALUES (?)");
 			assert(set_types.valid());
-			set_types.bind(1u, "movie");
+			set_types.bind(1u, "movies");
 			set_types.execute();
 			set_types.reset();
 			set_types.bind(1u, "music");
 			set_types.execute();
 		}
 
+		{
+			// Prefixes shared by the URIs of items, so a whole directory can be moved by changing one row
+			core::Statement roots_table(*this, "CREATE TABLE roots "
+			                            "(root_id INTEGER PRIMARY KEY AUTOINCREMENT, uri TEXT NOT NULL UNIQUE)");
+			assert(roots_table.valid());
+			roots_table.execute();
+		}
+
+		{
+			// Holds items that aren't beneath any other root
+			core::Statement set_roots(*this, "INSERT INTO roots (uri) VALUES ('')");
+			assert(set_roots.valid());
+			set_roots.execute();
+		}
+
 		{
 			core::Statement albums_table(*this, "CREATE TABLE albums "
 			                             "(album_id INTEGER PRIMARY KEY AUTOINCREMENT, album TEXT NOT NULL, "
-			                             "thumbnail TEXT DEFAULT NULL)");
+			                             "thumbnail TEXT DEFAULT NULL, sort_key BLOB)");
 			assert(albums_table.valid());
 			albums_table.execute();
 		}
@@ -134,12 +370,334 @@ namespace toolkit {
 		{
 			core::Statement items_table(*this, "CREATE TABLE items "
 			                            "(item_id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL, "
-			                            "uri TEXT NOT NULL, thumbnail TEXT DEFAULT NULL, "
-			                            "album_id REFERENCES albums (album_id) ON DELETE SET NULL, "
-			                            "type_id REFERENCES types (type_id))");
+			                            "root_id INTEGER NOT NULL REFERENCES roots (root_id), path TEXT NOT NULL, "
+			                            "thumbnail TEXT DEFAULT NULL, "
+			                            "album_id INTEGER REFERENCES albums (album_id) ON DELETE SET NULL, "
+			                            "type_id INTEGER REFERENCES types (type_id), duration INTEGER DEFAULT NULL, "
+			                            "artist TEXT DEFAULT NULL, track_number INTEGER DEFAULT NULL, "
+			                            "track_count INTEGER DEFAULT NULL, audio_codec TEXT DEFAULT NULL, "
+			                            "video_codec TEXT DEFAULT NULL, bitrate INTEGER DEFAULT NULL, "
+			                            "sample_rate INTEGER DEFAULT NULL, channels INTEGER DEFAULT NULL, "
+			                            "width INTEGER DEFAULT NULL, height INTEGER DEFAULT NULL, frame_rate REAL DEFAULT NULL, "
+			                            "added INTEGER NOT NULL DEFAULT (strftime('%s', 'now')), sort_key BLOB)");
 			assert(items_table.valid());
 			items_table.execute();
 		}
+
+		{
+			core::Statement files_table(*this, "CREATE TABLE files "
+			                            "(path TEXT PRIMARY KEY, device INTEGER NOT NULL, inode INTEGER NOT NULL, "
+			                            "size INTEGER NOT NULL, modified INTEGER NOT NULL, inspected INTEGER NOT NULL, "
+			                            "hash INTEGER DEFAULT NULL, item_id REFERENCES items (item_id) ON DELETE SET NULL)");
+			assert(files_table.valid());
+			files_table.execute();
+		}
+
+		{
+			core::Statement generation_table(*this, "CREATE TABLE generation (generation INTEGER NOT NULL)");
+			assert(generation_table.valid());
+			generation_table.execute();
+		}
+
+		{
+			core::Statement set_generation(*this, "INSERT INTO generation (generation) VALUES (0)");
+			assert(set_generation.valid());
+			set_generation.execute();
+		}
+
+		{
+			// Any change to what would be listed moves the database on to a new generation
+			char const * const triggers[] = {
+				"CREATE TRIGGER items_insert_generation AFTER INSERT ON items "
+				"BEGIN UPDATE generation SET generation = generation + 1; END",
+				"CREATE TRIGGER items_update_generation AFTER UPDATE ON items "
+				"BEGIN UPDATE generation SET generation = generation + 1; END",
+				"CREATE TRIGGER items_delete_generation AFTER DELETE ON items "
+				"BEGIN UPDATE generation SET generation = generation + 1; END",
+				"CREATE TRIGGER albums_update_generation AFTER UPDATE ON albums "
+				"BEGIN UPDATE generation SET generation = generation + 1; END",
+				"CREATE TRIGGER roots_update_generation AFTER UPDATE ON roots "
+				"BEGIN UPDATE generation SET generation = generation + 1; END"
+			};
+
+			for (unsigned int i = 0; i < sizeof(triggers) / sizeof(triggers[0]); ++i) {
+				core::Statement trigger(*this, triggers[i]);
+				assert(trigger.valid());
+				trigger.execute();
+			}
+		}
+
+		{
+			core::Statement type_counts_table(*this, "CREATE TABLE type_counts "
+			                                  "(type_id INTEGER PRIMARY KEY REFERENCES types (type_id), count INTEGER NOT NULL)");
+			assert(type_counts_table.valid());
+			type_counts_table.execute();
+		}
+
+		{
+			core::Statement set_type_counts(*this, "INSERT INTO type_counts (type_id, count) SELECT type_id, 0 FROM types");
+			assert(set_type_counts.valid());
+			set_type_counts.execute();
+		}
+
+		{
+			core::Statement album_counts_table(*this, "CREATE TABLE album_counts "
+			                                   "(album_id INTEGER PRIMARY KEY REFERENCES albums (album_id), count INTEGER NOT NULL)");
+			assert(album_counts_table.valid());
+			album_counts_table.execute();
+		}
+
+		{
+			core::Statement directory_counts_table(*this, "CREATE TABLE directory_counts "
+			                                       "(root_id INTEGER NOT NULL REFERENCES roots (root_id), directory TEXT NOT NULL, "
+			                                       "count INTEGER NOT NULL, PRIMARY KEY (root_id, directory))");
+			assert(directory_counts_table.valid());
+			directory_counts_table.execute();
+		}
+
+		{
+			/*
+				Keep the counts up to date as items come and go, so counting never has to scan the items. Albums and
+				directories are only listed while they have items, the directory of an item being its path beneath its
+				root with the final component trimmed off.
+			*/
+			char const * const triggers[] = {
+				"CREATE TRIGGER items_insert_counts AFTER INSERT ON items BEGIN "
+				"UPDATE type_counts SET count = count + 1 WHERE type_id = NEW.type_id; "
+				"INSERT OR IGNORE INTO album_counts (album_id, count) SELECT NEW.album_id, 0 WHERE NEW.album_id IS NOT NULL; "
+				"UPDATE album_counts SET count = count + 1 WHERE album_id = NEW.album_id; "
+				"INSERT OR IGNORE INTO directory_counts (root_id, directory, count) "
+				"VALUES (NEW.root_id, rtrim(NEW.path, replace(NEW.path, '/', '')), 0); "
+				"UPDATE directory_counts SET count = count + 1 "
+				"WHERE root_id = NEW.root_id AND directory = rtrim(NEW.path, replace(NEW.path, '/', '')); "
+				"END",
+				"CREATE TRIGGER items_delete_counts AFTER DELETE ON items BEGIN "
+				"UPDATE type_counts SET count = count - 1 WHERE type_id = OLD.type_id; "
+				"UPDATE album_counts SET count = count - 1 WHERE album_id = OLD.album_id; "
+				"DELETE FROM album_counts WHERE album_id = OLD.album_id AND count = 0; "
+				"UPDATE directory_counts SET count = count - 1 "
+				"WHERE root_id = OLD.root_id AND directory = rtrim(OLD.path, replace(OLD.path, '/', '')); "
+				"DELETE FROM directory_counts "
+				"WHERE root_id = OLD.root_id AND directory = rtrim(OLD.path, replace(OLD.path, '/', '')) AND count = 0; "
+				"END",
+				"CREATE TRIGGER items_update_counts AFTER UPDATE OF root_id, path, type_id, album_id ON items BEGIN "
+				"UPDATE type_counts SET count = count - 1 WHERE type_id = OLD.type_id; "
+				"UPDATE type_counts SET count = count + 1 WHERE type_id = NEW.type_id; "
+				"UPDATE album_counts SET count = count - 1 WHERE album_id = OLD.album_id; "
+				"DELETE FROM album_counts WHERE album_id = OLD.album_id AND count = 0; "
+				"INSERT OR IGNORE INTO album_counts (album_id, count) SELECT NEW.album_id, 0 WHERE NEW.album_id IS NOT NULL; "
+				"UPDATE album_counts SET count = count + 1 WHERE album_id = NEW.album_id; "
+				"UPDATE directory_counts SET count = count - 1 "
+				"WHERE root_id = OLD.root_id AND directory = rtrim(OLD.path, replace(OLD.path, '/', '')); "
+				"DELETE FROM directory_counts "
+				"WHERE root_id = OLD.root_id AND directory = rtrim(OLD.path, replace(OLD.path, '/', '')) AND count = 0; "
+				"INSERT OR IGNORE INTO directory_counts (root_id, directory, count) "
+				"VALUES (NEW.root_id, rtrim(NEW.path, replace(NEW.path, '/', '')), 0); "
+				"UPDATE directory_counts SET count = count + 1 "
+				"WHERE root_id = NEW.root_id AND directory = rtrim(NEW.path, replace(NEW.path, '/', '')); "
+				"END"
+			};
+
+			for (unsigned int i = 0; i < sizeof(triggers) / sizeof(triggers[0]); ++i) {
+				core::Statement trigger(*this, triggers[i]);
+				assert(trigger.valid());
+				trigger.execute();
+			}
+		}
+
+		{
+			core::Statement playlists_table(*this, "CREATE TABLE playlists "
+			                                "(playlist_id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL UNIQUE)");
+			assert(playlists_table.valid());
+			playlists_table.execute();
+		}
+
+		{
+			core::Statement playlist_entries_table(*this, "CREATE TABLE playlist_entries "
+			                                       "(entry_id INTEGER PRIMARY KEY AUTOINCREMENT, "
+			                                       "playlist_id REFERENCES playlists (playlist_id) ON DELETE CASCADE, "
+			                                       "position INTEGER NOT NULL, uri TEXT NOT NULL, title TEXT NOT NULL)");
+			assert(playlist_entries_table.valid());
+			playlist_entries_table.execute();
+		}
+
+		{
+			core::Statement playlist_entries_index(*this, "CREATE INDEX playlist_entries_position "
+			                                       "ON playlist_entries (playlist_id, position)");
+			assert(playlist_entries_index.valid());
+			playlist_entries_index.execute();
+		}
+
+		{
+			core::Statement play_stats_table(*this, "CREATE TABLE play_stats "
+			                                 "(item_id INTEGER PRIMARY KEY REFERENCES items (item_id) ON DELETE CASCADE, "
+			                                 "plays INTEGER NOT NULL DEFAULT 0, skips INTEGER NOT NULL DEFAULT 0, "
+			                                 "last_played INTEGER DEFAULT NULL)");
+			assert(play_stats_table.valid());
+			play_stats_table.execute();
+		}
+
+		{
+			// Sequence number of the last play event written, so events replayed from a journal aren't counted twice
+			core::Statement play_sequence_table(*this, "CREATE TABLE play_sequence (sequence INTEGER NOT NULL)");
+			assert(play_sequence_table.valid());
+			play_sequence_table.execute();
+		}
+
+		{
+			core::Statement set_play_sequence(*this, "INSERT INTO play_sequence (sequence) VALUES (0)");
+			assert(set_play_sequence.valid());
+			set_play_sequence.execute();
+		}
+
+		{
+			core::Statement play_stats_trigger(*this, "CREATE TRIGGER items_delete_play_stats AFTER DELETE ON items "
+			                                   "BEGIN DELETE FROM play_stats WHERE item_id = OLD.item_id; END");
+			assert(play_stats_trigger.valid());
+			play_stats_trigger.execute();
+		}
+
+		{
+			core::Statement play_stats_plays_index(*this, "CREATE INDEX play_stats_plays ON play_stats (plays)");
+			assert(play_stats_plays_index.valid());
+			play_stats_plays_index.execute();
+		}
+
+		{
+			core::Statement play_stats_last_played_index(*this,
+			        "CREATE INDEX play_stats_last_played ON play_stats (last_played)");
+			assert(play_stats_last_played_index.valid());
+			play_stats_last_played_index.execute();
+		}
+
+		{
+			core::Statement play_stats_skips_index(*this, "CREATE INDEX play_stats_skips ON play_stats (skips)");
+			assert(play_stats_skips_index.valid());
+			play_stats_skips_index.execute();
+		}
+
+		{
+			core::Statement play_generation_table(*this, "CREATE TABLE play_generation (generation INTEGER NOT NULL)");
+			assert(play_generation_table.valid());
+			play_generation_table.execute();
+		}
+
+		{
+			core::Statement set_play_generation(*this, "INSERT INTO play_generation (generation) VALUES (0)");
+			assert(set_play_generation.valid());
+			set_play_generation.execute();
+		}
+
+		{
+			// Smart playlists depending on play statistics are rebuilt when this changes
+			char const * const triggers[] = {
+				"CREATE TRIGGER play_stats_insert_generation AFTER INSERT ON play_stats "
+				"BEGIN UPDATE play_generation SET generation = generation + 1; END",
+				"CREATE TRIGGER play_stats_update_generation AFTER UPDATE ON play_stats "
+				"BEGIN UPDATE play_generation SET generation = generation + 1; END",
+				"CREATE TRIGGER play_stats_delete_generation AFTER DELETE ON play_stats "
+				"BEGIN UPDATE play_generation SET generation = generation + 1; END"
+			};
+
+			for (unsigned int i = 0; i < sizeof(triggers) / sizeof(triggers[0]); ++i) {
+				core::Statement trigger(*this, triggers[i]);
+				assert(trigger.valid());
+				trigger.execute();
+			}
+		}
+
+		{
+			core::Statement smart_playlists_table(*this, "CREATE TABLE smart_playlists "
+			                                      "(smart_id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL UNIQUE, "
+			                                      "match_all INTEGER NOT NULL, max_items INTEGER NOT NULL)");
+			assert(smart_playlists_table.valid());
+			smart_playlists_table.execute();
+		}
+
+		{
+			core::Statement smart_rules_table(*this, "CREATE TABLE smart_rules "
+			                                  "(smart_id INTEGER NOT NULL REFERENCES smart_playlists (smart_id) ON DELETE CASCADE, "
+			                                  "position INTEGER NOT NULL, field INTEGER NOT NULL, comparison INTEGER NOT NULL, "
+			                                  "value TEXT NOT NULL, PRIMARY KEY (smart_id, position))");
+			assert(smart_rules_table.valid());
+			smart_rules_table.execute();
+		}
+
+		{
+			core::Statement smart_rules_trigger(*this, "CREATE TRIGGER smart_playlists_delete_rules "
+			                                    "AFTER DELETE ON smart_playlists "
+			                                    "BEGIN DELETE FROM smart_rules WHERE smart_id = OLD.smart_id; END");
+			assert(smart_rules_trigger.valid());
+			smart_rules_trigger.execute();
+		}
+
+		{
+			// Gives each drive that has been attached an ID that stays the same each time it is attached
+			core::Statement volumes_table(*this, "CREATE TABLE volumes "
+			                              "(volume_id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL UNIQUE)");
+			assert(volumes_table.valid());
+			volumes_table.execute();
+		}
+
+		{
+			// Which collation the sort keys were made by, and how far through making them again it is
+			core::Statement collation_table(*this, "CREATE TABLE collation (name TEXT NOT NULL, position INTEGER)");
+			assert(collation_table.valid());
+			collation_table.execute();
+		}
+
+		{
+			core::Statement set_collation(*this, "INSERT INTO collation (name, position) VALUES ('', NULL)");
+			assert(set_collation.valid());
+			set_collation.execute();
+		}
+
+		{
+			core::Statement items_path_index(*this, "CREATE INDEX items_path ON items (root_id, path)");
+			assert(items_path_index.valid());
+			items_path_index.execute();
+		}
+
+		{
+			core::Statement albums_album_index(*this, "CREATE INDEX albums_album ON albums (album)");
+			assert(albums_album_index.valid());
+			albums_album_index.execute();
+		}
+
+		{
+			// Items are listed by walking this index rather than sorting them
+			core::Statement items_sort_index(*this, "CREATE INDEX items_sort ON items (sort_key)");
+			assert(items_sort_index.valid());
+			items_sort_index.execute();
+		}
+
+		{
+			// Lets the conditions of smart playlists be answered from indexes
+			char const * const indexes[] = {
+				"CREATE INDEX items_type ON items (type_id)",
+				"CREATE INDEX items_album ON items (album_id)",
+				"CREATE INDEX items_duration ON items (duration)",
+				"CREATE INDEX items_added ON items (added)"
+			};
+
+			for (unsigned int i = 0; i < sizeof(indexes) / sizeof(indexes[0]); ++i) {
+				core::Statement index(*this, indexes[i]);
+				assert(index.valid());
+				index.execute();
+			}
+		}
+
+		{
+			core::Statement files_hash_index(*this, "CREATE INDEX files_hash ON files (hash)");
+			assert(files_hash_index.valid());
+			files_hash_index.execute();
+		}
+
+		{
+			core::Statement files_item_index(*this, "CREATE INDEX files_item ON files (item_id)");
+			assert(files_item_index.valid());
+			files_item_index.execute();
+		}
 	}
 
 	/*
@@ -171,9 +729,9 @@ namespace toolkit {
 	}
 
 	/*
-		Find the foreign key relating to the given album
+		Find the foreign key relating to the given album, adding it with the given sort key if it is new
 	*/
-	long long Library::album_id(std::string album) {
+	long long Library::album_id(std::string album, std::vector< unsigned char > const & sort_key) {
 		if (album_stmt_ == nullptr) {
 			album_stmt_ = new core::Statement(*this, "SELECT album_id FROM albums WHERE album = ?");
 		} else {
@@ -184,150 +742,1691 @@ namespace toolkit {
 
 		assert(album_stmt_->valid());
 		album_stmt_->execute();
-		return album_stmt_->toInteger(0u);
-	}
+		if (album_stmt_->hasData()) {
+			return album_stmt_->toInteger(0u);
+		}
 
-	Library::Library()
-		: core::Database(core::Path::data() + "/library.db"), add_stmt_(nullptr), count_stmt_(nullptr),
-		  list_stmt_(nullptr), search_stmt_(nullptr), type_stmt_(nullptr), album_stmt_(nullptr) {
-		core::Statement check_version(*this, "SELECT version FROM version");
-		if (!check_version.valid()) {
-			// Database is likely empty
-			initialise_db();
-		} else {
-			check_version.execute();
-			if (check_version.toInteger(0u) != db_version) {
-				// Database is out of date
-				dprint("Old database found");
-				initialise_db();
-			}
+		// First item in this album
+		if (add_album_stmt_ == nullptr) {
+			add_album_stmt_ = new core::Statement(*this, "INSERT INTO albums (album, sort_key) VALUES (?, ?)");
+		} else {
+			add_album_stmt_->reset();
 		}
-	}
 
-	Library::~Library() {
-		delete add_stmt_;
-		delete count_stmt_;
-		delete list_stmt_;
+		add_album_stmt_->bind(1u, album);
+		add_album_stmt_->bind(2u, sort_key);
 
-		delete type_stmt_;
-		delete album_stmt_;
+		assert(add_album_stmt_->valid());
+		add_album_stmt_->execute();
+		return lastInsertId();
 	}
 
 	/*
-		Adds a new entry to the library
+		Finds the root with the longest URI that the given URI starts with, setting path to the rest of it
 	*/
-	void Library::add(std::string title, std::string uri, Library::Type type, std::string thumbnail_file, std::string album) {
-		if (type == Type::All) {
-			dprint("Trying to add media item with media type of 'All'");
-			return;
+	long long Library::root_id(std::string const & uri, std::string & path) {
+		if (roots_.empty()) {
+			core::Statement roots(*this, "SELECT uri, root_id FROM roots ORDER BY length(uri) DESC");
+			assert(roots.valid());
+			roots.execute();
+
+			if (roots.hasData()) {
+				do {
+					roots_.push_back(std::make_pair(roots.toText(0u), roots.toInteger(1u)));
+				} while (roots.nextRow());
+			}
 		}
 
-		if (add_stmt_ == nullptr) {
-			add_stmt_ = new core::Statement(*this,
-			                                "INSERT INTO items (name, uri, type_id, thumbnail, album_id) VALUES (?, ?, ?, ?, ?)");
-		} else {
+		for (std::vector< std::pair< std::string, long long > >::const_iterator i = roots_.begin(); i != roots_.end(); ++i) {
+			if (beneath(uri, i->first)) {
+				path = uri.substr(i->first.size());
+				return i->second;
+			}
+		}
+
+		// The empty root matches everything, so this is only reached if it has gone missing
+		assert(false);
+		path = uri;
+		return 0;
+	}
+
+	/*
+		Returns a counter that changes whenever the listed items change
+	*/
+	long long Library::generation() {
+		if (generation_stmt_ == nullptr) {
+			// Attaching and detaching volumes moves the library on, though a snapshot also has to match its identity
+			std::string sql("SELECT (SELECT generation FROM main.generation)");
+			for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+				sql.append(" + (SELECT generation FROM " + (*i)->schema() + ".generation)");
+			}
+
+			generation_stmt_ = new core::Statement(*this, sql);
+		} else {
+			generation_stmt_->reset();
+		}
+
+		assert(generation_stmt_->valid());
+		generation_stmt_->execute();
+		long long current = generation_stmt_->toInteger(0u);
+		generation_stmt_->reset();
+
+		return current;
+	}
+
+	/*
+		Returns a fingerprint of the databases the items are listed from: the library's own and each attached volume. A
+		generation only says whether the items have changed between two snapshots with the same identity.
+	*/
+	unsigned long long Library::identity() const {
+		std::vector< std::pair< long long, long long > > volumes;
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			volumes.push_back(std::make_pair((*i)->id(), (*i)->epoch()));
+		}
+
+		std::sort(volumes.begin(), volumes.end());
+
+		std::vector< long long > values;
+		values.push_back(epoch_);
+		values.push_back(db_version);
+		for (std::vector< std::pair< long long, long long > >::const_iterator i = volumes.begin(); i != volumes.end(); ++i) {
+			values.push_back(i->first);
+			values.push_back(i->second);
+		}
+
+		return core::Hash::data(values.data(), values.size() * sizeof(long long));
+	}
+
+	/*
+		Indicates whether the snapshot was taken from the same databases as are attached now, and nothing has changed
+		since
+	*/
+	bool Library::snapshot_current() {
+		return (snapshot_ != nullptr) && snapshot_->valid() && (snapshot_->identity() == identity()) &&
+		       (snapshot_->generation() == generation());
+	}
+
+	/*
+		Finds the attached volume with the longest root that the given URI starts with, setting path to the rest of it
+	*/
+	LibraryVolume * Library::volume(std::string const & uri, std::string & path) const {
+		LibraryVolume * found = nullptr;
+
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			std::string const root = (*i)->root();
+			if (beneath(uri, root) && ((found == nullptr) || (root.size() > found->root().size()))) {
+				found = *i;
+			}
+		}
+
+		if (found != nullptr) {
+			path = uri.substr(found->root().size());
+		}
+
+		return found;
+	}
+
+	/*
+		Finds the attached volume an item ID belongs to, or null if it belongs to the library itself or a volume that
+		isn't attached
+	*/
+	LibraryVolume * Library::volume(long long item_id) const {
+		long long volume_id = item_id >> LibraryVolume::id_shift;
+
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); (volume_id != 0) && (i != volumes_.end());
+		        ++i) {
+			if ((*i)->id() == volume_id) {
+				return *i;
+			}
+		}
+
+		return nullptr;
+	}
+
+	/*
+		Drops the statements that read from every volume, so they are prepared again for the volumes now attached
+	*/
+	void Library::reset_volume_statements() {
+		delete count_stmt_;
+		delete facets_stmt_;
+		delete list_stmt_;
+		delete search_stmt_;
+		delete generation_stmt_;
+		delete item_stmt_;
+		delete details_stmt_;
+		delete most_played_stmt_;
+		delete recently_played_stmt_;
+
+		count_stmt_ = nullptr;
+		facets_stmt_ = nullptr;
+		list_stmt_ = nullptr;
+		search_stmt_ = nullptr;
+		generation_stmt_ = nullptr;
+		item_stmt_ = nullptr;
+		details_stmt_ = nullptr;
+		most_played_stmt_ = nullptr;
+		recently_played_stmt_ = nullptr;
+	}
+
+	/*
+		Attaches the database of a drive mounted at the given root URI, creating it if the drive hasn't been seen before.
+		Items added beneath the root are stored on the volume, and the volume's items are listed along with the rest
+		until it is detached. Returns false if the database couldn't be attached.
+	*/
+	bool Library::attachVolume(std::string const & name, std::string const & root, std::string const & location) {
+		if (name.empty() || root.empty()) {
+			return false;
+		}
+
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			if ((*i)->name() == name) {
+				return false;
+			}
+		}
+
+		long long volume_id;
+		{
+			core::Statement add_volume(*this, "INSERT OR IGNORE INTO volumes (name) VALUES (?)");
+			assert(add_volume.valid());
+			add_volume.bind(1u, name);
+			add_volume.execute();
+
+			core::Statement find_volume(*this, "SELECT volume_id FROM volumes WHERE name = ?");
+			assert(find_volume.valid());
+			find_volume.bind(1u, name);
+			find_volume.execute();
+			volume_id = find_volume.toInteger(0u);
+		}
+
+		core::Statement attach(*this, "ATTACH DATABASE ? AS volume_" + std::to_string(volume_id));
+		assert(attach.valid());
+		attach.bind(1u, location);
+		if (!attach.execute()) {
+			dprint("Unable to attach volume database %s", location.c_str());
+			return false;
+		}
+
+		volumes_.push_back(new LibraryVolume(*this, name, volume_id, root));
+		reset_volume_statements();
+		check_collation(volumes_.back()->schema());
+
+		core::Statement next_generation(*this, "UPDATE main.generation SET generation = generation + 1");
+		assert(next_generation.valid());
+		next_generation.execute();
+
+		return true;
+	}
+
+	/*
+		Detaches the database of a drive, so its items are no longer listed. Returns false if it wasn't attached.
+	*/
+	bool Library::detachVolume(std::string const & name) {
+		for (std::vector< LibraryVolume * >::iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			if ((*i)->name() != name) {
+				continue;
+			}
+
+			LibraryVolume * volume = *i;
+			long long volume_generation = volume->generation();
+			std::string const schema = volume->schema();
+
+			volumes_.erase(i);
+			delete volume;
+			reset_volume_statements();
+
+			core::Statement detach(*this, "DETACH DATABASE " + schema);
+			assert(detach.valid());
+			detach.execute();
+
+			// Still moves forward even without the volume's generation counted
+			core::Statement next_generation(*this, "UPDATE main.generation SET generation = generation + ?");
+			assert(next_generation.valid());
+			next_generation.bind(1u, volume_generation + 1);
+			next_generation.execute();
+
+			return true;
+		}
+
+		return false;
+	}
+
+	/*
+		Returns the names of the attached volumes
+	*/
+	std::vector< std::string > Library::volumes() const {
+		std::vector< std::string > names;
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			names.push_back((*i)->name());
+		}
+
+		return names;
+	}
+
+	/*
+		Returns a counter that changes whenever play statistics change
+	*/
+	long long Library::play_generation() {
+		if (play_generation_stmt_ == nullptr) {
+			play_generation_stmt_ = new core::Statement(*this, "SELECT generation FROM play_generation");
+		} else {
+			play_generation_stmt_->reset();
+		}
+
+		assert(play_generation_stmt_->valid());
+		play_generation_stmt_->execute();
+		long long current = play_generation_stmt_->toInteger(0u);
+		play_generation_stmt_->reset();
+
+		return current;
+	}
+
+	Library::Library()
+		: Library(core::Path::data() + "/library.db") {}
+
+	Library::Library(std::string location)
+		: core::Database(location), snapshot_(nullptr), trigram_index_(nullptr),
+		  collation_(std::make_shared< LibraryCollation >()), epoch_(0), add_stmt_(nullptr), update_stmt_(nullptr),
+		  remove_item_stmt_(nullptr), count_stmt_(nullptr), facets_stmt_(nullptr), list_stmt_(nullptr),
+		  search_stmt_(nullptr), type_stmt_(nullptr), album_stmt_(nullptr), add_album_stmt_(nullptr),
+		  add_file_stmt_(nullptr), files_stmt_(nullptr), remove_file_stmt_(nullptr), remove_file_item_stmt_(nullptr),
+		  file_item_stmt_(nullptr), relink_item_stmt_(nullptr), copies_stmt_(nullptr), set_uri_stmt_(nullptr),
+		  canonical_stmt_(nullptr),
+		  generation_stmt_(nullptr), playlist_stmt_(nullptr), add_playlist_stmt_(nullptr), playlist_entries_stmt_(nullptr),
+		  add_entry_stmt_(nullptr), move_entry_stmt_(nullptr), remove_entry_stmt_(nullptr), play_sequence_stmt_(nullptr),
+		  add_play_stmt_(nullptr), update_play_stmt_(nullptr), set_play_sequence_stmt_(nullptr), statistics_stmt_(nullptr),
+		  most_played_stmt_(nullptr), recently_played_stmt_(nullptr), play_generation_stmt_(nullptr),
+		  item_stmt_(nullptr), details_stmt_(nullptr) {
+		bool created = false;
+		{
+			core::Statement check_version(*this, "SELECT version FROM version");
+			if (!check_version.valid()) {
+				// Database is likely empty
+				initialise_db();
+				created = true;
+			} else {
+				check_version.execute();
+				if (check_version.toInteger(0u) != db_version) {
+					// Database is out of date, and its tables can't be dropped while they are being read
+					dprint("Old database found");
+					check_version.reset();
+					initialise_db();
+					created = true;
+				}
+			}
+		}
+
+		{
+			core::Statement epoch(*this, "SELECT epoch FROM version");
+			assert(epoch.valid());
+			epoch.execute();
+			epoch_ = epoch.toInteger(0u);
+		}
+
+		check_collation("main");
+
+		if (!location.empty()) {
+			snapshot_path_ = location + ".snapshot";
+			if (created) {
+				// Left from a database that has gone
+				std::remove(snapshot_path_.c_str());
+			}
+
+			snapshot_ = new LibrarySnapshot(snapshot_path_);
+		}
+	}
+
+	Library::~Library() {
+		if (!snapshot_path_.empty() && !snapshot_current()) {
+			// Leave an up to date snapshot for the next start up
+			writeSnapshot();
+		}
+
+		delete snapshot_;
+		delete trigram_index_;
+
+		delete add_stmt_;
+		delete update_stmt_;
+		delete remove_item_stmt_;
+		delete count_stmt_;
+		delete facets_stmt_;
+		delete list_stmt_;
+		delete search_stmt_;
+
+		delete type_stmt_;
+		delete album_stmt_;
+		delete add_album_stmt_;
+
+		delete add_file_stmt_;
+		delete files_stmt_;
+		delete remove_file_stmt_;
+		delete remove_file_item_stmt_;
+		delete file_item_stmt_;
+		delete relink_item_stmt_;
+		delete copies_stmt_;
+		delete set_uri_stmt_;
+		delete canonical_stmt_;
+		delete generation_stmt_;
+
+		delete playlist_stmt_;
+		delete add_playlist_stmt_;
+		delete playlist_entries_stmt_;
+		delete add_entry_stmt_;
+		delete move_entry_stmt_;
+		delete remove_entry_stmt_;
+
+		delete play_sequence_stmt_;
+		delete add_play_stmt_;
+		delete update_play_stmt_;
+		delete set_play_sequence_stmt_;
+		delete statistics_stmt_;
+		delete most_played_stmt_;
+		delete recently_played_stmt_;
+		delete play_generation_stmt_;
+		delete item_stmt_;
+		delete details_stmt_;
+
+		for (std::vector< LibraryVolume * >::iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			delete *i;
+		}
+
+		for (std::map< std::string, LibrarySmartPlaylist * >::iterator i = smart_playlists_.begin();
+		        i != smart_playlists_.end(); ++i) {
+			delete i->second;
+		}
+	}
+
+	/*
+		Adds a new entry to the library, along with whatever else is known about it
+	*/
+	long long Library::add(std::string title, std::string uri, Library::Type type, std::string thumbnail_file,
+	                       std::string album, MediaDetails const & details) {
+		if (type == Type::All) {
+			dprint("Trying to add media item with media type of 'All'");
+			return 0;
+		}
+
+		std::vector< unsigned char > album_key;
+		if (!album.empty()) {
+			album_key = collation_->key(album);
+		}
+
+		std::vector< unsigned char > key = sort_key(title, album_key, details.trackNumber());
+
+		std::string volume_path;
+		LibraryVolume * target = volume(uri, volume_path);
+		if (target != nullptr) {
+			return target->add(title, volume_path, type_id(type), thumbnail_file, album, key, album_key, details);
+		}
+
+		if (add_stmt_ == nullptr) {
+			add_stmt_ = new core::Statement(*this, "INSERT INTO items "
+			                                "(name, root_id, path, type_id, thumbnail, album_id, sort_key, " +
+			                                std::string(details_columns) +
+			                                ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+		} else {
 			add_stmt_->reset();
 		}
 
+		std::string path;
 		add_stmt_->bind(1u, title);
-		add_stmt_->bind(2u, uri);
-		add_stmt_->bind(3u, type_id(type));
+		add_stmt_->bind(2u, root_id(uri, path));
+		add_stmt_->bind(3u, path);
+		add_stmt_->bind(4u, type_id(type));
 
 		if (thumbnail_file.empty()) {
-			add_stmt_->bind(4u);
+			add_stmt_->bind(5u);
 		} else {
-			add_stmt_->bind(4u, thumbnail_file);
+			add_stmt_->bind(5u, thumbnail_file);
 		}
 
 		if (album.empty()) {
-			add_stmt_->bind(5u);
+			add_stmt_->bind(6u);
 		} else {
-			add_stmt_->bind(5u, album_id(album));
+			add_stmt_->bind(6u, album_id(album, album_key));
 		}
 
+		add_stmt_->bind(7u, key);
+		bind_details(*add_stmt_, 8u, details);
+
 		assert(add_stmt_->valid());
-		add_stmt_->execute();
+		if (!add_stmt_->execute()) {
+			return 0;
+		}
+
+		return lastInsertId();
 	}
 
 	/*
-		Count the number of items in the media library of a given type
+		Replaces what is known about an existing entry, as when its file has changed, keeping its ID and play statistics.
+		Returns false if there is no such entry or the URI would move it to or from a volume.
 	*/
-	unsigned long long Library::count(Library::Type type) {
-		if (count_stmt_ == nullptr) {
-			count_stmt_ = new core::Statement(*this, "SELECT COUNT(item_id) FROM items WHERE type LIKE ?");
+	bool Library::update(long long item_id, std::string title, std::string uri, Library::Type type,
+	                     std::string thumbnail_file, std::string album, MediaDetails const & details) {
+		if (type == Type::All) {
+			dprint("Trying to update media item with media type of 'All'");
+			return false;
+		}
+
+		std::vector< unsigned char > album_key;
+		if (!album.empty()) {
+			album_key = collation_->key(album);
+		}
+
+		std::vector< unsigned char > key = sort_key(title, album_key, details.trackNumber());
+
+		std::string volume_path;
+		LibraryVolume * target = volume(uri, volume_path);
+		if (target != volume(item_id)) {
+			return false;
+		}
+
+		if (target != nullptr) {
+			return target->update(item_id, title, volume_path, type_id(type), thumbnail_file, album, key, album_key,
+			                      details);
+		}
+
+		if (update_stmt_ == nullptr) {
+			update_stmt_ = new core::Statement(*this, "UPDATE items SET name = ?, root_id = ?, path = ?, type_id = ?, "
+			                                   "thumbnail = ?, album_id = ?, sort_key = ?, " +
+			                                   std::string(details_assignments) + " WHERE item_id = ?");
 		} else {
-			count_stmt_->reset();
+			update_stmt_->reset();
 		}
 
-		count_stmt_->bind(1u, type_id(type));
+		std::string path;
+		update_stmt_->bind(1u, title);
+		update_stmt_->bind(2u, root_id(uri, path));
+		update_stmt_->bind(3u, path);
+		update_stmt_->bind(4u, type_id(type));
 
-		assert(count_stmt_->valid());
-		count_stmt_->execute();
-		assert(count_stmt_->hasData());
+		if (thumbnail_file.empty()) {
+			update_stmt_->bind(5u);
+		} else {
+			update_stmt_->bind(5u, thumbnail_file);
+		}
+
+		if (album.empty()) {
+			update_stmt_->bind(6u);
+		} else {
+			update_stmt_->bind(6u, album_id(album, album_key));
+		}
 
-		return count_stmt_->toInteger(0u);
+		update_stmt_->bind(7u, key);
+		bind_details(*update_stmt_, 8u, details);
+		update_stmt_->bind(20u, item_id);
+
+		assert(update_stmt_->valid());
+		return update_stmt_->execute() && (changes() > 0);
 	}
 
 	/*
-		Return the items of the given type from the media library
+		Removes the given entries in a single transaction, leaving alone those that a file is still recorded for
 	*/
-	std::vector< LibraryItem > Library::list(Library::Type type) {
-		if (list_stmt_ == nullptr) {
-			list_stmt_ = new core::Statement(*this,
-			                                 "SELECT item_id, name, uri, thumbnail FROM items NATURAL JOIN albums NATURAL JOIN types "
-			                                 "WHERE type LIKE ? ORDER BY album, name");
-		} else {
-			list_stmt_->reset();
+	void Library::removeItems(std::vector< long long > const & item_ids) {
+		if (item_ids.empty()) {
+			return;
 		}
 
-		switch (type) {
-		case Type::All:
-			list_stmt_->bind(1u, "%");
-			break;
-		case Type::Movies:
-			list_stmt_->bind(1u, "movies");
-			break;
-		case Type::Music:
-			list_stmt_->bind(1u, "music");
-			break;
+		if (remove_item_stmt_ == nullptr) {
+			remove_item_stmt_ = new core::Statement(*this, "DELETE FROM items WHERE item_id = ?1 "
+			                                        "AND NOT EXISTS (SELECT 1 FROM files WHERE item_id = ?1)");
 		}
 
-		assert(list_stmt_->valid());
-		list_stmt_->execute();
+		assert(remove_item_stmt_->valid());
 
-		return fetch(list_stmt_);
+		begin();
+
+		for (std::vector< long long >::const_iterator i = item_ids.begin(); i != item_ids.end(); ++i) {
+			LibraryVolume * target = volume(*i);
+			if (target != nullptr) {
+				target->removeItem(*i);
+				continue;
+			}
+
+			remove_item_stmt_->reset();
+			remove_item_stmt_->bind(1u, *i);
+			remove_item_stmt_->execute();
+		}
+
+		commit();
 	}
 
 	/*
-		Return the items of the given type from the media library that contain the search term
+		Stores the URIs of items beneath the given URI relative to it, so they can be moved together, returning the ID of
+		the root. Items already in the library are moved beneath the new root. If the URI is already beneath a root, that
+		root is returned instead.
 	*/
-	std::vector< LibraryItem > Library::search(Library::Type type, std::string term) {
-		if (search_stmt_ == nullptr) {
-			search_stmt_ = new core::Statement(*this,
-			                                   "SELECT item_id, name, uri, thumbnail FROM items NATURAL JOIN albums NATURAL JOIN types "
-			                                   "WHERE type LIKE ? AND (name LIKE ?2 OR album LIKE ?2) ORDER BY album, name");
-		} else {
-			search_stmt_->reset();
+	long long Library::addRoot(std::string const & uri) {
+		std::string path;
+		long long parent = root_id(uri, path);
+		if (path.size() != uri.size()) {
+			return parent;
 		}
 
+		begin();
 
-		switch (type) {
-		case Type::All:
-			list_stmt_->bind(1u, "%");
-			break;
-		case Type::Movies:
-			list_stmt_->bind(1u, "movies");
-			break;
-		case Type::Music:
-			list_stmt_->bind(1u, "music");
-			break;
+		{
+			core::Statement add_root(*this, "INSERT INTO roots (uri) VALUES (?)");
+			assert(add_root.valid());
+			add_root.bind(1u, uri);
+			add_root.execute();
 		}
 
-		search_stmt_->bind(2u, "%" + term + "%");
+		long long root = lastInsertId();
 
-		assert(search_stmt_->valid());
-		search_stmt_->execute();
+		{
+			// Items beneath the new root were stored relative to the root it is beneath
+			core::Statement move_items(*this, "UPDATE items SET root_id = ?1, path = substr(path, length(?2) + 1) "
+			                           "WHERE root_id = ?3 AND (path = ?2 OR substr(path, 1, length(?4)) = ?4)");
+			assert(move_items.valid());
+			move_items.bind(1u, root);
+			move_items.bind(2u, path);
+			move_items.bind(3u, parent);
+			move_items.bind(4u, directory(path));
+			move_items.execute();
+		}
 
-		return fetch(search_stmt_);
+		commit();
+
+		roots_.clear();
+		return root;
+	}
+
+	/*
+		Changes the URI of a root, moving every item beneath it by updating a single row, along with any roots added
+		beneath it later and the recorded state of the files beneath it. Returns false if no root has exactly the old
+		URI or there already is one with the new URI.
+	*/
+	bool Library::relocateRoot(std::string const & from, std::string const & to) {
+		if (from.empty() || to.empty()) {
+			return false;
+		}
+
+		{
+			core::Statement exists(*this, "SELECT 1 FROM roots WHERE uri = ?");
+			assert(exists.valid());
+			exists.bind(1u, from);
+			if (!exists.execute() || !exists.hasData()) {
+				return false;
+			}
+		}
+
+		// Roots beneath this one keep their place relative to it, so both URIs end in a slash if the old one did
+		std::string const target = (directory(from) == from) ? directory(to) : to;
+
+		begin();
+
+		{
+			core::Statement relocate(*this, "UPDATE roots SET uri = ?1 || substr(uri, length(?2) + 1) "
+			                         "WHERE uri = ?2 OR substr(uri, 1, length(?3)) = ?3");
+			assert(relocate.valid());
+			relocate.bind(1u, target);
+			relocate.bind(2u, from);
+			relocate.bind(3u, directory(from));
+
+			// A single statement, so a clash with an existing root leaves every root as it was
+			if (!relocate.execute() || (changes() == 0)) {
+				commit();
+				return false;
+			}
+		}
+
+		// The recorded file states are keyed by path, so they move too or the next scan would inspect everything again
+		std::string from_path = core::Path::fromUri(directory(from));
+		std::string to_path = core::Path::fromUri(directory(to));
+		if (!from_path.empty() && !to_path.empty()) {
+			from_path.erase(from_path.size() - 1);
+			to_path.erase(to_path.size() - 1);
+
+			// Files already recorded at the new location by a scan before the move give way to those moved there
+			core::Statement move_files(*this, "UPDATE OR REPLACE files SET path = ?1 || substr(path, length(?2) + 1) "
+			                           "WHERE path > ?2 || '/' AND path < ?2 || '0'");
+			assert(move_files.valid());
+			move_files.bind(1u, to_path);
+			move_files.bind(2u, from_path);
+			move_files.execute();
+		}
+
+		commit();
+
+		roots_.clear();
+		return true;
+	}
+
+	/*
+		Returns the URIs of the roots that items are stored beneath
+	*/
+	std::vector< std::string > Library::roots() {
+		core::Statement roots(*this, "SELECT uri FROM roots WHERE uri != '' ORDER BY uri");
+		assert(roots.valid());
+		roots.execute();
+
+		std::vector< std::string > result;
+		if (roots.hasData()) {
+			do {
+				result.push_back(roots.toText(0u));
+			} while (roots.nextRow());
+		}
+
+		return result;
+	}
+
+	/*
+		Records the state of a file that has just been inspected, along with the item created from it, in the database of
+		the volume it is on if there is one
+	*/
+	void Library::addFile(LibraryFile const & file, long long item_id) {
+		std::string volume_path;
+		LibraryVolume * target = volume(core::Path(file.path()).toUri(), volume_path);
+		if (target != nullptr) {
+			target->addFile(file, volume_path, item_id);
+			return;
+		}
+
+		if (add_file_stmt_ == nullptr) {
+			add_file_stmt_ = new core::Statement(*this,
+			                                     "INSERT OR REPLACE INTO files (path, device, inode, size, modified, inspected, hash, item_id) "
+			                                     "VALUES (?, ?, ?, ?, ?, strftime('%s', 'now'), ?, ?)");
+		} else {
+			add_file_stmt_->reset();
+		}
+
+		add_file_stmt_->bind(1u, file.path());
+		add_file_stmt_->bind(2u, static_cast< long long >(file.device()));
+		add_file_stmt_->bind(3u, static_cast< long long >(file.inode()));
+		add_file_stmt_->bind(4u, static_cast< long long >(file.size()));
+		add_file_stmt_->bind(5u, file.modified());
+
+		if (file.hash() == 0) {
+			add_file_stmt_->bind(6u);
+		} else {
+			add_file_stmt_->bind(6u, static_cast< long long >(file.hash()));
+		}
+
+		if (item_id == 0) {
+			add_file_stmt_->bind(7u);
+		} else {
+			add_file_stmt_->bind(7u, item_id);
+		}
+
+		assert(add_file_stmt_->valid());
+		add_file_stmt_->execute();
+	}
+
+	/*
+		Finds the item already created from another copy of the file's contents, or 0 if there isn't one
+	*/
+	long long Library::canonicalItem(LibraryFile const & file) {
+		if (file.hash() == 0) {
+			return 0;
+		}
+
+		// Copies are only shared within the library or within a volume, as a volume's items go when it is detached
+		std::string volume_path;
+		LibraryVolume * target = volume(core::Path(file.path()).toUri(), volume_path);
+		if (target != nullptr) {
+			return target->canonicalItem(file);
+		}
+
+		if (canonical_stmt_ == nullptr) {
+			canonical_stmt_ = new core::Statement(*this,
+			                                      "SELECT item_id FROM files WHERE hash = ? AND size = ? AND item_id IS NOT NULL LIMIT 1");
+		} else {
+			canonical_stmt_->reset();
+		}
+
+		canonical_stmt_->bind(1u, static_cast< long long >(file.hash()));
+		canonical_stmt_->bind(2u, static_cast< long long >(file.size()));
+
+		assert(canonical_stmt_->valid());
+		canonical_stmt_->execute();
+		return canonical_stmt_->hasData() ? canonical_stmt_->toInteger(0u) : 0;
+	}
+
+	/*
+		Returns the recorded state of every file beneath a directory, whether in the library or on a volume
+	*/
+	std::vector< LibraryFile > Library::files(std::string directory) {
+		if (files_stmt_ == nullptr) {
+			// Range over the primary key rather than using LIKE so the index is used
+			files_stmt_ = new core::Statement(*this,
+			                                  "SELECT path, device, inode, size, modified FROM files WHERE path > ?1 || '/' AND path < ?1 || '0'");
+		} else {
+			files_stmt_->reset();
+		}
+
+		while (!directory.empty() && (directory[directory.size() - 1] == '/')) {
+			directory.erase(directory.size() - 1);
+		}
+
+		files_stmt_->bind(1u, directory);
+
+		assert(files_stmt_->valid());
+		files_stmt_->execute();
+
+		std::vector< LibraryFile > files;
+		if (files_stmt_->hasData()) {
+			do {
+				files.emplace_back(files_stmt_->toText(0u), files_stmt_->toInteger(1u), files_stmt_->toInteger(2u),
+				                   files_stmt_->toInteger(3u), files_stmt_->toInteger(4u));
+			} while (files_stmt_->nextRow());
+		}
+
+		// Along with those on the volumes mounted beneath it or that it is on
+		std::string const uri = directory.empty() ? std::string("file:///") : core::Path(directory).toUri();
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			std::vector< LibraryFile > on_volume;
+			if (beneath(uri, (*i)->root())) {
+				std::string path = uri.substr((*i)->root().size());
+				while (!path.empty() && (path[path.size() - 1] == '/')) {
+					path.erase(path.size() - 1);
+				}
+
+				on_volume = (*i)->files(path);
+			} else if (beneath((*i)->root(), uri)) {
+				on_volume = (*i)->files(std::string());
+			}
+
+			files.insert(files.end(), on_volume.begin(), on_volume.end());
+		}
+
+		return files;
+	}
+
+	/*
+		Forgets the given files in a single transaction, removing items that no longer have any copies. Files on a volume
+		are forgotten from its database. When kept is given, a file that is the last copy of its item is left alone
+		along with the item, and its path is mapped to the item's ID so the item can be updated in place.
+	*/
+	void Library::removeFiles(std::vector< std::string > const & paths, std::map< std::string, long long > * kept) {
+		if (paths.empty()) {
+			return;
+		}
+
+		if (remove_file_stmt_ == nullptr) {
+			file_item_stmt_ = new core::Statement(*this, "SELECT item_id FROM files WHERE path = ?");
+			remove_file_stmt_ = new core::Statement(*this, "DELETE FROM files WHERE path = ?");
+			relink_item_stmt_ = new core::Statement(*this, "SELECT path FROM files WHERE item_id = ? LIMIT 1");
+			set_uri_stmt_ = new core::Statement(*this, "UPDATE items SET root_id = ?, path = ? WHERE item_id = ?");
+			remove_file_item_stmt_ = new core::Statement(*this, "DELETE FROM items WHERE item_id = ?");
+			copies_stmt_ = new core::Statement(*this, "SELECT 1 FROM files WHERE item_id = ? AND path != ? LIMIT 1");
+		}
+
+		assert(file_item_stmt_->valid());
+		assert(remove_file_stmt_->valid());
+		assert(relink_item_stmt_->valid());
+		assert(set_uri_stmt_->valid());
+		assert(remove_file_item_stmt_->valid());
+		assert(copies_stmt_->valid());
+
+		begin();
+
+		for (std::vector< std::string >::const_iterator i = paths.begin(); i != paths.end(); ++i) {
+			std::string volume_path;
+			LibraryVolume * target = volume(core::Path(*i).toUri(), volume_path);
+			if (target != nullptr) {
+				long long item_id = target->removeFile(volume_path, kept != nullptr);
+				if (item_id != 0) {
+					(*kept)[*i] = item_id;
+				}
+
+				continue;
+			}
+
+			file_item_stmt_->bind(1u, *i);
+			file_item_stmt_->execute();
+			long long item_id = file_item_stmt_->hasData() ? file_item_stmt_->toInteger(0u) : 0;
+			file_item_stmt_->reset();
+
+			if ((kept != nullptr) && (item_id != 0)) {
+				copies_stmt_->bind(1u, item_id);
+				copies_stmt_->bind(2u, *i);
+				copies_stmt_->execute();
+				bool copied = copies_stmt_->hasData();
+				copies_stmt_->reset();
+
+				if (!copied) {
+					(*kept)[*i] = item_id;
+					continue;
+				}
+			}
+
+			remove_file_stmt_->bind(1u, *i);
+			remove_file_stmt_->execute();
+
+			if (item_id == 0) {
+				continue;
+			}
+
+			relink_item_stmt_->bind(1u, item_id);
+			relink_item_stmt_->execute();
+
+			if (relink_item_stmt_->hasData()) {
+				// Another copy of the file remains, point the item at it instead
+				std::string path;
+				set_uri_stmt_->bind(1u, root_id(core::Path(relink_item_stmt_->toText(0u)).toUri(), path));
+				set_uri_stmt_->bind(2u, path);
+				set_uri_stmt_->bind(3u, item_id);
+				set_uri_stmt_->execute();
+			} else {
+				remove_file_item_stmt_->bind(1u, item_id);
+				remove_file_item_stmt_->execute();
+			}
+
+			relink_item_stmt_->reset();
+		}
+
+		commit();
+	}
+
+	/*
+		Count the number of items in the media library of a given type
+	*/
+	unsigned long long Library::count(Library::Type type) {
+		if (count_stmt_ == nullptr) {
+			// Read from the counts kept by triggers rather than counting the items
+			std::string counts("SELECT type_id, count FROM main.type_counts");
+			for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+				counts.append(" UNION ALL SELECT type_id, count FROM " + (*i)->schema() + ".type_counts");
+			}
+
+			count_stmt_ = new core::Statement(*this, "SELECT IFNULL(SUM(count), 0) FROM (" + counts + ") "
+			                                  "NATURAL JOIN types WHERE type LIKE ?");
+		} else {
+			count_stmt_->reset();
+		}
+
+		switch (type) {
+		case Type::All:
+			count_stmt_->bind(1u, "%");
+			break;
+		case Type::Movies:
+			count_stmt_->bind(1u, "movies");
+			break;
+		case Type::Music:
+			count_stmt_->bind(1u, "music");
+			break;
+		}
+
+		assert(count_stmt_->valid());
+		count_stmt_->execute();
+		assert(count_stmt_->hasData());
+
+		unsigned long long count = count_stmt_->toInteger(0u);
+		count_stmt_->reset();
+
+		return count;
+	}
+
+	/*
+		Returns the number of items of each type, in each album and in each directory, including those on the volumes
+	*/
+	std::vector< LibraryFacet > Library::facets() {
+		if (facets_stmt_ == nullptr) {
+			std::string counts("SELECT 0 AS kind, type AS name, count FROM main.type_counts NATURAL JOIN main.types "
+			                   "UNION ALL SELECT 1, album, count FROM main.album_counts NATURAL JOIN main.albums "
+			                   "UNION ALL SELECT 2, roots.uri || directory, count FROM main.directory_counts "
+			                   "NATURAL JOIN main.roots");
+
+			// The directories on a volume are relative to where it is mounted, which is bound in the same order
+			for (std::vector< LibraryVolume * >::size_type i = 0; i < volumes_.size(); ++i) {
+				std::string const schema = volumes_[i]->schema();
+				counts.append(" UNION ALL SELECT 0, type, count FROM " + schema + ".type_counts NATURAL JOIN main.types"
+				              " UNION ALL SELECT 1, album, count FROM " + schema + ".album_counts NATURAL JOIN " + schema +
+				              ".albums UNION ALL SELECT 2, ?" + std::to_string(i + 1) + " || directory, count FROM " + schema +
+				              ".directory_counts");
+			}
+
+			// Albums and directories found both in the library and on a volume are listed once
+			facets_stmt_ = new core::Statement(*this, "SELECT kind, name, SUM(count) FROM (" + counts + ") "
+			                                   "GROUP BY kind, name");
+		} else {
+			facets_stmt_->reset();
+		}
+
+		for (std::vector< LibraryVolume * >::size_type i = 0; i < volumes_.size(); ++i) {
+			facets_stmt_->bind(static_cast< unsigned int >(i + 1), volumes_[i]->root());
+		}
+
+		assert(facets_stmt_->valid());
+		facets_stmt_->execute();
+
+		std::vector< LibraryFacet > facets;
+		if (!facets_stmt_->hasData()) {
+			return facets;
+		}
+
+		do {
+			LibraryFacet::Kind kind;
+			switch (facets_stmt_->toInteger(0u)) {
+			case 0:
+				kind = LibraryFacet::Kind::Type;
+				break;
+			case 1:
+				kind = LibraryFacet::Kind::Album;
+				break;
+			default:
+				kind = LibraryFacet::Kind::Directory;
+				break;
+			}
+
+			facets.emplace_back(kind, facets_stmt_->toText(1u), facets_stmt_->toInteger(2u));
+		} while (facets_stmt_->nextRow());
+
+		return facets;
+	}
+
+	/*
+		Return the items of the given type from the media library
+	*/
+	LibraryItemTable Library::list(Library::Type type) {
+		if (snapshot_current()) {
+			// Nothing has changed since the snapshot was taken
+			return snapshot_->list(type);
+		}
+
+		if (list_stmt_ == nullptr) {
+			// Each volume is sorted separately and the results merged
+			std::string sql("SELECT item_id, name, roots.uri || path, items.thumbnail, items.sort_key AS item_key FROM items "
+			                "JOIN roots USING (root_id) NATURAL JOIN types WHERE type LIKE ?1");
+			for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+				sql.append(" UNION ALL " + volume_items(**i, ", items.sort_key") + " WHERE type LIKE ?1");
+			}
+
+			list_stmt_ = new core::Statement(*this, sql + " ORDER BY item_key");
+		} else {
+			list_stmt_->reset();
+		}
+
+		switch (type) {
+		case Type::All:
+			list_stmt_->bind(1u, "%");
+			break;
+		case Type::Movies:
+			list_stmt_->bind(1u, "movies");
+			break;
+		case Type::Music:
+			list_stmt_->bind(1u, "music");
+			break;
+		}
+
+		assert(list_stmt_->valid());
+		list_stmt_->execute();
+
+		return fetch(list_stmt_);
+	}
+
+	/*
+		Return the items of the given type from the media library that contain the search term, or with fuzzy matching
+		up to limit items that nearly contain it, closest first
+	*/
+	LibraryItemTable Library::search(Library::Type type, std::string term, Match match, unsigned int limit) {
+		if (match == Match::Fuzzy) {
+			if ((trigram_index_ == nullptr) || (trigram_index_->generation() != generation())) {
+				// Items have changed since the index was built
+				delete trigram_index_;
+				trigram_index_ = new LibraryTrigramIndex();
+				trigram_index_->reserve(count(Type::All));
+
+				LibraryTrigramIndex * index = trigram_index_;
+				index->setGeneration(enumerate([index](long long id, Type type, std::string const & title,
+				                                       std::string const & album, std::string const & uri, std::string const & thumbnail_file) {
+					index->add(id, type, title, album, uri, thumbnail_file);
+				}));
+			}
+
+			return trigram_index_->search(type, term, limit);
+		}
+
+		if (search_stmt_ == nullptr) {
+			// Few items match, so scanning the table and sorting them is quicker than walking the sort key index
+			std::string sql("SELECT item_id, name, roots.uri || path, items.thumbnail, +items.sort_key AS item_key FROM items "
+			                "JOIN roots USING (root_id) LEFT JOIN albums USING (album_id) NATURAL JOIN types "
+			                "WHERE type LIKE ?1 AND (name LIKE ?2 OR album LIKE ?2)");
+			for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+				sql.append(" UNION ALL " + volume_items(**i, ", +items.sort_key") +
+				           " WHERE type LIKE ?1 AND (name LIKE ?2 OR album LIKE ?2)");
+			}
+
+			search_stmt_ = new core::Statement(*this, sql + " ORDER BY item_key");
+		} else {
+			search_stmt_->reset();
+		}
+
+		switch (type) {
+		case Type::All:
+			search_stmt_->bind(1u, "%");
+			break;
+		case Type::Movies:
+			search_stmt_->bind(1u, "movies");
+			break;
+		case Type::Music:
+			search_stmt_->bind(1u, "music");
+			break;
+		}
+
+		search_stmt_->bind(2u, "%" + term + "%");
+
+		assert(search_stmt_->valid());
+		search_stmt_->execute();
+
+		return fetch(search_stmt_);
+	}
+
+	/*
+		Returns the IDs of the items of the given type in ascending order
+	*/
+	std::vector< long long > Library::identifiers(Library::Type type) {
+		std::string sql("SELECT item_id FROM items NATURAL JOIN types WHERE type LIKE ?1");
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			sql.append(" UNION ALL SELECT (" + std::to_string((*i)->id()) + " << " + std::to_string(LibraryVolume::id_shift) +
+			           ") | item_id FROM " + (*i)->schema() + ".items NATURAL JOIN main.types WHERE type LIKE ?1");
+		}
+
+		core::Statement ids(*this, sql + " ORDER BY item_id");
+		assert(ids.valid());
+
+		switch (type) {
+		case Type::All:
+			ids.bind(1u, "%");
+			break;
+		case Type::Movies:
+			ids.bind(1u, "movies");
+			break;
+		case Type::Music:
+			ids.bind(1u, "music");
+			break;
+		}
+
+		ids.execute();
+
+		std::vector< long long > result;
+		result.reserve(count(type));
+		if (ids.hasData()) {
+			do {
+				result.push_back(ids.toInteger(0u));
+			} while (ids.nextRow());
+		}
+
+		return result;
+	}
+
+	/*
+		Returns the items with the given IDs in the same order, leaving out any that no longer exist
+	*/
+	LibraryItemTable Library::items(std::vector< long long > const & item_ids) {
+		if (item_stmt_ == nullptr) {
+			std::string sql("SELECT item_id, name, roots.uri || path, thumbnail FROM items JOIN roots USING (root_id) "
+			                "WHERE item_id = ?1");
+			for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+				sql.append(" UNION ALL " + volume_items(**i, "") + " WHERE item_id = ?1 - (" + std::to_string((*i)->id()) +
+				           " << " + std::to_string(LibraryVolume::id_shift) + ")");
+			}
+
+			item_stmt_ = new core::Statement(*this, sql);
+		}
+
+		assert(item_stmt_->valid());
+
+		LibraryItemTable items;
+		items.reserve(item_ids.size());
+
+		for (std::vector< long long >::const_iterator i = item_ids.begin(); i != item_ids.end(); ++i) {
+			item_stmt_->reset();
+			item_stmt_->bind(1u, *i);
+			item_stmt_->execute();
+
+			if (item_stmt_->hasData()) {
+				items.add(item_stmt_->toInteger(0u), item_stmt_->toText(1u), item_stmt_->toText(2u), item_stmt_->toText(3u));
+			}
+		}
+
+		item_stmt_->reset();
+		return items;
+	}
+
+	/*
+		Returns what is known about an item besides its title and album, which is left empty if it doesn't exist
+	*/
+	MediaDetails Library::details(long long item_id) {
+		if (details_stmt_ == nullptr) {
+			std::string sql("SELECT " + std::string(details_columns) + " FROM items WHERE item_id = ?1");
+			for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+				sql.append(" UNION ALL SELECT " + std::string(details_columns) + " FROM " + (*i)->schema() +
+				           ".items WHERE item_id = ?1 - (" + std::to_string((*i)->id()) + " << " +
+				           std::to_string(LibraryVolume::id_shift) + ")");
+			}
+
+			details_stmt_ = new core::Statement(*this, sql);
+		} else {
+			details_stmt_->reset();
+		}
+
+		assert(details_stmt_->valid());
+		details_stmt_->bind(1u, item_id);
+		details_stmt_->execute();
+
+		MediaDetails details;
+		if (details_stmt_->hasData()) {
+			details = read_details(*details_stmt_, 0u);
+		}
+
+		details_stmt_->reset();
+		return details;
+	}
+
+	/*
+		Finds the playlist with the given name, creating it if there isn't one
+	*/
+	long long Library::playlist(std::string const & name) {
+		if (playlist_stmt_ == nullptr) {
+			playlist_stmt_ = new core::Statement(*this, "SELECT playlist_id FROM playlists WHERE name = ?");
+		} else {
+			playlist_stmt_->reset();
+		}
+
+		playlist_stmt_->bind(1u, name);
+
+		assert(playlist_stmt_->valid());
+		playlist_stmt_->execute();
+		if (playlist_stmt_->hasData()) {
+			return playlist_stmt_->toInteger(0u);
+		}
+
+		if (add_playlist_stmt_ == nullptr) {
+			add_playlist_stmt_ = new core::Statement(*this, "INSERT INTO playlists (name) VALUES (?)");
+		} else {
+			add_playlist_stmt_->reset();
+		}
+
+		add_playlist_stmt_->bind(1u, name);
+
+		assert(add_playlist_stmt_->valid());
+		add_playlist_stmt_->execute();
+		return lastInsertId();
+	}
+
+	/*
+		Returns the names of every playlist
+	*/
+	std::vector< std::string > Library::playlists() {
+		core::Statement names(*this, "SELECT name FROM playlists ORDER BY name");
+		assert(names.valid());
+		names.execute();
+
+		std::vector< std::string > playlists;
+		if (names.hasData()) {
+			do {
+				playlists.push_back(names.toText(0u));
+			} while (names.nextRow());
+		}
+
+		return playlists;
+	}
+
+	/*
+		Deletes a playlist along with its entries
+	*/
+	void Library::removePlaylist(long long playlist_id) {
+		core::Statement remove_entries(*this, "DELETE FROM playlist_entries WHERE playlist_id = ?");
+		core::Statement remove_playlist(*this, "DELETE FROM playlists WHERE playlist_id = ?");
+		assert(remove_entries.valid());
+		assert(remove_playlist.valid());
+
+		begin();
+		remove_entries.bind(1u, playlist_id);
+		remove_entries.execute();
+		remove_playlist.bind(1u, playlist_id);
+		remove_playlist.execute();
+		commit();
+	}
+
+	/*
+		Returns the entries of a playlist in order
+	*/
+	std::vector< LibraryPlaylistEntry > Library::playlistEntries(long long playlist_id) {
+		if (playlist_entries_stmt_ == nullptr) {
+			playlist_entries_stmt_ = new core::Statement(*this, "SELECT entry_id, position, uri, title FROM playlist_entries "
+			        "WHERE playlist_id = ? ORDER BY position");
+		} else {
+			playlist_entries_stmt_->reset();
+		}
+
+		playlist_entries_stmt_->bind(1u, playlist_id);
+
+		assert(playlist_entries_stmt_->valid());
+		playlist_entries_stmt_->execute();
+
+		std::vector< LibraryPlaylistEntry > entries;
+		if (!playlist_entries_stmt_->hasData()) {
+			return entries;
+		}
+
+		do {
+			entries.emplace_back(playlist_entries_stmt_->toInteger(0u), playlist_entries_stmt_->toInteger(1u),
+			                     playlist_entries_stmt_->toText(2u), playlist_entries_stmt_->toText(3u));
+		} while (playlist_entries_stmt_->nextRow());
+
+		return entries;
+	}
+
+	/*
+		Adds an entry to a playlist at the given position key, returning its ID
+	*/
+	long long Library::addPlaylistEntry(long long playlist_id, long long position, std::string const & uri,
+	                                    std::string const & title) {
+		if (add_entry_stmt_ == nullptr) {
+			add_entry_stmt_ = new core::Statement(*this,
+			                                      "INSERT INTO playlist_entries (playlist_id, position, uri, title) VALUES (?, ?, ?, ?)");
+		} else {
+			add_entry_stmt_->reset();
+		}
+
+		add_entry_stmt_->bind(1u, playlist_id);
+		add_entry_stmt_->bind(2u, position);
+		add_entry_stmt_->bind(3u, uri);
+		add_entry_stmt_->bind(4u, title);
+
+		assert(add_entry_stmt_->valid());
+		if (!add_entry_stmt_->execute()) {
+			return 0;
+		}
+
+		return lastInsertId();
+	}
+
+	/*
+		Changes the position key of a playlist entry
+	*/
+	void Library::movePlaylistEntry(long long entry_id, long long position) {
+		if (move_entry_stmt_ == nullptr) {
+			move_entry_stmt_ = new core::Statement(*this, "UPDATE playlist_entries SET position = ? WHERE entry_id = ?");
+		} else {
+			move_entry_stmt_->reset();
+		}
+
+		move_entry_stmt_->bind(1u, position);
+		move_entry_stmt_->bind(2u, entry_id);
+
+		assert(move_entry_stmt_->valid());
+		move_entry_stmt_->execute();
+	}
+
+	/*
+		Removes an entry from its playlist
+	*/
+	void Library::removePlaylistEntry(long long entry_id) {
+		if (remove_entry_stmt_ == nullptr) {
+			remove_entry_stmt_ = new core::Statement(*this, "DELETE FROM playlist_entries WHERE entry_id = ?");
+		} else {
+			remove_entry_stmt_->reset();
+		}
+
+		remove_entry_stmt_->bind(1u, entry_id);
+
+		assert(remove_entry_stmt_->valid());
+		remove_entry_stmt_->execute();
+	}
+
+	/*
+		Returns the sequence number of the last play event written to the library
+	*/
+	unsigned long long Library::playSequence() {
+		if (play_sequence_stmt_ == nullptr) {
+			play_sequence_stmt_ = new core::Statement(*this, "SELECT sequence FROM play_sequence");
+		} else {
+			play_sequence_stmt_->reset();
+		}
+
+		assert(play_sequence_stmt_->valid());
+		play_sequence_stmt_->execute();
+		unsigned long long sequence = play_sequence_stmt_->toInteger(0u);
+		play_sequence_stmt_->reset();
+
+		return sequence;
+	}
+
+	/*
+		Adds play and skip events to the statistics of their items in a single transaction, ignoring events already
+		written and those for items that aren't in the library. Plays of items on a volume are kept on the volume.
+	*/
+	void Library::addPlays(std::vector< LibraryPlay > const & plays) {
+		if (plays.empty()) {
+			return;
+		}
+
+		if (add_play_stmt_ == nullptr) {
+			add_play_stmt_ = new core::Statement(*this,
+			                                     "INSERT OR IGNORE INTO play_stats (item_id) "
+			                                     "SELECT item_id FROM items WHERE root_id = ? AND path = ?");
+			update_play_stmt_ = new core::Statement(*this,
+			                                        "UPDATE play_stats SET plays = plays + ?2, skips = skips + ?3, "
+			                                        "last_played = CASE WHEN ?2 > 0 THEN max(IFNULL(last_played, 0), ?4) ELSE last_played END "
+			                                        "WHERE item_id IN (SELECT item_id FROM items WHERE root_id = ?1 AND path = ?5)");
+			set_play_sequence_stmt_ = new core::Statement(*this, "UPDATE play_sequence SET sequence = ?");
+		}
+
+		assert(add_play_stmt_->valid());
+		assert(update_play_stmt_->valid());
+		assert(set_play_sequence_stmt_->valid());
+
+		begin();
+
+		unsigned long long written = playSequence();
+		unsigned long long last = written;
+		bool volume_played = false;
+
+		for (std::vector< LibraryPlay >::const_iterator i = plays.begin(); i != plays.end(); ++i) {
+			if (i->sequence() <= written) {
+				continue;
+			}
+
+			last = std::max(last, i->sequence());
+
+			std::string path;
+			LibraryVolume * target = volume(i->uri(), path);
+			if (target != nullptr) {
+				volume_played = target->addPlay(path, *i) || volume_played;
+				continue;
+			}
+
+			long long root = root_id(i->uri(), path);
+
+			add_play_stmt_->bind(1u, root);
+			add_play_stmt_->bind(2u, path);
+			add_play_stmt_->execute();
+
+			update_play_stmt_->bind(1u, root);
+			update_play_stmt_->bind(5u, path);
+			update_play_stmt_->bind(2u, i->skipped() ? 0LL : 1LL);
+			update_play_stmt_->bind(3u, i->skipped() ? 1LL : 0LL);
+			update_play_stmt_->bind(4u, i->time());
+			update_play_stmt_->execute();
+		}
+
+		if (volume_played) {
+			// Triggers on a volume can't reach the library's tables
+			core::Statement next_generation(*this, "UPDATE main.play_generation SET generation = generation + 1");
+			assert(next_generation.valid());
+			next_generation.execute();
+		}
+
+		set_play_sequence_stmt_->bind(1u, static_cast< long long >(last));
+		set_play_sequence_stmt_->execute();
+
+		commit();
+	}
+
+	/*
+		Returns the play statistics of an item
+	*/
+	LibraryPlayStatistics Library::statistics(long long item_id) {
+		if ((item_id >> LibraryVolume::id_shift) != 0) {
+			LibraryVolume * target = volume(item_id);
+			return target != nullptr ? target->statistics(item_id) : LibraryPlayStatistics();
+		}
+
+		if (statistics_stmt_ == nullptr) {
+			statistics_stmt_ = new core::Statement(*this,
+			                                       "SELECT plays, skips, IFNULL(last_played, 0) FROM play_stats WHERE item_id = ?");
+		} else {
+			statistics_stmt_->reset();
+		}
+
+		statistics_stmt_->bind(1u, item_id);
+
+		assert(statistics_stmt_->valid());
+		statistics_stmt_->execute();
+		if (!statistics_stmt_->hasData()) {
+			return LibraryPlayStatistics();
+		}
+
+		LibraryPlayStatistics statistics(statistics_stmt_->toInteger(0u), statistics_stmt_->toInteger(1u),
+		                                 statistics_stmt_->toInteger(2u));
+		statistics_stmt_->reset();
+
+		return statistics;
+	}
+
+	/*
+		Returns up to limit items that have been played the most times, most played first
+	*/
+	LibraryItemTable Library::mostPlayed(unsigned int limit) {
+		if (most_played_stmt_ == nullptr) {
+			std::string sql("SELECT item_id, name, roots.uri || path, items.thumbnail, plays FROM play_stats "
+			                "NATURAL JOIN items JOIN roots USING (root_id) WHERE plays > 0");
+			for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+				sql.append(" UNION ALL " + volume_items(**i, ", plays") + " NATURAL JOIN " + (*i)->schema() +
+				           ".play_stats WHERE plays > 0");
+			}
+
+			most_played_stmt_ = new core::Statement(*this, sql + " ORDER BY plays DESC LIMIT ?1");
+		} else {
+			most_played_stmt_->reset();
+		}
+
+		most_played_stmt_->bind(1u, static_cast< long long >(limit));
+
+		assert(most_played_stmt_->valid());
+		most_played_stmt_->execute();
+
+		return fetch(most_played_stmt_);
+	}
+
+	/*
+		Returns up to limit items that have been played most recently, latest first
+	*/
+	LibraryItemTable Library::recentlyPlayed(unsigned int limit) {
+		if (recently_played_stmt_ == nullptr) {
+			std::string sql("SELECT item_id, name, roots.uri || path, items.thumbnail, last_played FROM play_stats "
+			                "NATURAL JOIN items JOIN roots USING (root_id) WHERE last_played IS NOT NULL");
+			for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+				sql.append(" UNION ALL " + volume_items(**i, ", last_played") + " NATURAL JOIN " + (*i)->schema() +
+				           ".play_stats WHERE last_played IS NOT NULL");
+			}
+
+			recently_played_stmt_ = new core::Statement(*this, sql + " ORDER BY last_played DESC LIMIT ?1");
+		} else {
+			recently_played_stmt_->reset();
+		}
+
+		recently_played_stmt_->bind(1u, static_cast< long long >(limit));
+
+		assert(recently_played_stmt_->valid());
+		recently_played_stmt_->execute();
+
+		return fetch(recently_played_stmt_);
+	}
+
+	/*
+		Creates or replaces the smart playlist with the given name, returning false if the rules can't be used
+	*/
+	bool Library::setSmartPlaylist(std::string const & name, std::vector< LibraryRule > const & rules, bool match_all,
+	                               unsigned int limit) {
+		LibrarySmartPlaylist * playlist = new LibrarySmartPlaylist(*this, rules, match_all, limit);
+		if (!playlist->valid()) {
+			delete playlist;
+			return false;
+		}
+
+		begin();
+
+		{
+			core::Statement remove_playlist(*this, "DELETE FROM smart_playlists WHERE name = ?");
+			assert(remove_playlist.valid());
+			remove_playlist.bind(1u, name);
+			remove_playlist.execute();
+		}
+
+		{
+			core::Statement add_playlist(*this, "INSERT INTO smart_playlists (name, match_all, max_items) VALUES (?, ?, ?)");
+			assert(add_playlist.valid());
+			add_playlist.bind(1u, name);
+			add_playlist.bind(2u, match_all ? 1LL : 0LL);
+			add_playlist.bind(3u, static_cast< long long >(limit));
+			add_playlist.execute();
+		}
+
+		long long smart_id = lastInsertId();
+
+		core::Statement add_rule(*this, "INSERT INTO smart_rules (smart_id, position, field, comparison, value) "
+		                         "VALUES (?, ?, ?, ?, ?)");
+		assert(add_rule.valid());
+
+		for (std::size_t i = 0; i < rules.size(); ++i) {
+			add_rule.reset();
+			add_rule.bind(1u, smart_id);
+			add_rule.bind(2u, static_cast< long long >(i));
+			add_rule.bind(3u, static_cast< long long >(rules[i].field()));
+			add_rule.bind(4u, static_cast< long long >(rules[i].comparison()));
+			add_rule.bind(5u, rules[i].value());
+			add_rule.execute();
+		}
+
+		commit();
+
+		std::map< std::string, LibrarySmartPlaylist * >::iterator existing = smart_playlists_.find(name);
+		if (existing != smart_playlists_.end()) {
+			delete existing->second;
+			existing->second = playlist;
+		} else {
+			smart_playlists_.insert(std::make_pair(name, playlist));
+		}
+
+		return true;
+	}
+
+	/*
+		Returns the names of all the smart playlists
+	*/
+	std::vector< std::string > Library::smartPlaylists() {
+		core::Statement names(*this, "SELECT name FROM smart_playlists ORDER BY name");
+		assert(names.valid());
+		names.execute();
+
+		std::vector< std::string > result;
+		if (names.hasData()) {
+			do {
+				result.push_back(names.toText(0u));
+			} while (names.nextRow());
+		}
+
+		return result;
+	}
+
+	/*
+		Removes the smart playlist with the given name
+	*/
+	void Library::removeSmartPlaylist(std::string const & name) {
+		core::Statement remove_playlist(*this, "DELETE FROM smart_playlists WHERE name = ?");
+		assert(remove_playlist.valid());
+		remove_playlist.bind(1u, name);
+		remove_playlist.execute();
+
+		std::map< std::string, LibrarySmartPlaylist * >::iterator existing = smart_playlists_.find(name);
+		if (existing != smart_playlists_.end()) {
+			delete existing->second;
+			smart_playlists_.erase(existing);
+		}
+	}
+
+	/*
+		Returns the items matching the rules of a smart playlist. The results are kept until the items, or the play
+		statistics the rules depend on, change.
+	*/
+	LibraryItemTable Library::smartPlaylist(std::string const & name) {
+		std::map< std::string, LibrarySmartPlaylist * >::iterator existing = smart_playlists_.find(name);
+
+		if (existing == smart_playlists_.end()) {
+			// Compile the rules stored by an earlier session
+			core::Statement playlist(*this, "SELECT smart_id, match_all, max_items FROM smart_playlists WHERE name = ?");
+			assert(playlist.valid());
+			playlist.bind(1u, name);
+			playlist.execute();
+
+			if (!playlist.hasData()) {
+				return LibraryItemTable();
+			}
+
+			core::Statement stored_rules(*this, "SELECT field, comparison, value FROM smart_rules "
+			                             "WHERE smart_id = ? ORDER BY position");
+			assert(stored_rules.valid());
+			stored_rules.bind(1u, playlist.toInteger(0u));
+			stored_rules.execute();
+
+			std::vector< LibraryRule > rules;
+			if (stored_rules.hasData()) {
+				do {
+					rules.push_back(LibraryRule(static_cast< LibraryRule::Field >(stored_rules.toInteger(0u)),
+					                            static_cast< LibraryRule::Comparison >(stored_rules.toInteger(1u)),
+					                            stored_rules.toText(2u)));
+				} while (stored_rules.nextRow());
+			}
+
+			existing = smart_playlists_.insert(std::make_pair(name, new LibrarySmartPlaylist(*this, rules,
+			                                   playlist.toInteger(1u) != 0, static_cast< unsigned int >(playlist.toInteger(2u))))).first;
+		}
+
+		begin();
+		LibraryItemTable items = existing->second->items(generation(), play_generation());
+		commit();
+
+		return items;
+	}
+
+	/*
+		Calls back with every item along with its album, in the order they are listed, returning the generation of the
+		library they were read from
+	*/
+	long long Library::enumerate(std::function< void (long long id, Type type, std::string const & title,
+	                             std::string const & album, std::string const & uri, std::string const & thumbnail_file) > callback) {
+		std::string sql("SELECT item_id, name, roots.uri || path, items.thumbnail, type, album, items.sort_key AS item_key "
+		                "FROM items JOIN roots USING (root_id) LEFT JOIN albums USING (album_id) NATURAL JOIN types");
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			sql.append(" UNION ALL " + volume_items(**i, ", type, album, items.sort_key"));
+		}
+
+		core::Statement items(*this, sql + " ORDER BY item_key");
+		assert(items.valid());
+
+		// Read the generation within the same transaction as the items
+		begin();
+		long long current = generation();
+		items.execute();
+
+		if (items.hasData()) {
+			do {
+				callback(items.toInteger(0u), items.toText(4u) == "movies" ? Type::Movies : Type::Music, items.toText(1u),
+				         items.toText(5u), items.toText(2u), items.toText(3u));
+			} while (items.nextRow());
+		}
+
+		commit();
+
+		return current;
+	}
+
+	/*
+		Writes a snapshot of the library's items that can be listed without querying the database
+	*/
+	bool Library::writeSnapshot() {
+		if (snapshot_path_.empty()) {
+			return false;
+		}
+
+		LibrarySnapshotWriter writer;
+		long long current = enumerate([&writer](long long id, Type type, std::string const & title, std::string const &,
+		                               std::string const & uri, std::string const & thumbnail_file) {
+			writer.add(id, type, title, uri, thumbnail_file);
+		});
+
+		if (!writer.write(snapshot_path_, current, identity())) {
+			dprint("Unable to write library snapshot");
+			return false;
+		}
+
+		delete snapshot_;
+		snapshot_ = new LibrarySnapshot(snapshot_path_);
+		return snapshot_->valid();
 	}
 }
@@ -0,0 +1,291 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <stdexcept>
+#include <debug.hpp>
+#include <toolkit/library.hpp>
+
+#include "library_volume.hpp"
+
+namespace {
+	/*
+		The letters of the Latin-1 supplement from U+00C0 onwards written without their accents, indexed by the second
+		byte of their UTF-8 encoding, or null for the signs among them
+	*/
+	char const * const latin_letters[] = {
+		"a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+		"d", "n", "o", "o", "o", "o", "o", nullptr, "o", "u", "u", "u", "u", "y", "th", "ss",
+		"a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+		"d", "n", "o", "o", "o", "o", "o", nullptr, "o", "u", "u", "u", "u", "y", "th", "y"
+	};
+
+	/*
+		Appends to text, putting a single space in place of any word separators skipped since the last letter
+	*/
+	inline void append(std::string & text, char const * letters, std::size_t length, bool & separated) {
+		if (separated && !text.empty()) {
+			text.push_back(' ');
+		}
+
+		separated = false;
+		text.append(letters, length);
+	}
+}
+
+namespace toolkit {
+	LibraryCollation::LibraryCollation(std::string const & locale)
+		: LibraryCollation(locale, std::vector< std::string > {"the", "a", "an"}) {}
+
+	/*
+		Sorts by the rules of the given locale once text has been folded, or by character codes for the C locale.
+		Articles are stripped from the start of text before it is sorted.
+	*/
+	LibraryCollation::LibraryCollation(std::string const & locale, std::vector< std::string > articles)
+		: locale_(std::locale::classic()), articles_(std::move(articles)) {
+		try {
+			locale_ = std::locale(locale.c_str());
+		} catch (std::runtime_error const &) {
+			dprint("Locale %s isn't available, sorting by character codes", locale.c_str());
+		}
+	}
+
+	LibraryCollation::~LibraryCollation() {}
+
+	/*
+		Lower cases text and removes accents from Latin letters, turning each run of spaces and punctuation into a
+		single space and dropping a leading article
+	*/
+	std::string LibraryCollation::fold(std::string const & text) const {
+		std::string folded;
+		folded.reserve(text.size());
+		bool separated = false;
+
+		for (std::size_t i = 0; i < text.size(); ++i) {
+			unsigned char c = text[i];
+
+			if ((c == 0xC3) && (i + 1 < text.size()) && ((text[i + 1] & 0xC0) == 0x80)) {
+				char const * letters = latin_letters[static_cast< unsigned char >(text[i + 1]) - 0x80];
+				if (letters != nullptr) {
+					append(folded, letters, std::char_traits< char >::length(letters), separated);
+					++i;
+					continue;
+				}
+			}
+
+			if (c >= 0x80) {
+				// Other characters are left for the locale to order
+				append(folded, &text[i], 1, separated);
+			} else if (std::isalnum(c)) {
+				char lower = static_cast< char >(std::tolower(c));
+				append(folded, &lower, 1, separated);
+			} else {
+				separated = true;
+			}
+		}
+
+		for (std::vector< std::string >::const_iterator i = articles_.begin(); i != articles_.end(); ++i) {
+			if ((folded.size() > i->size() + 1) && (folded.compare(0, i->size(), *i) == 0) && (folded[i->size()] == ' ')) {
+				folded.erase(0, i->size() + 1);
+				break;
+			}
+		}
+
+		return folded;
+	}
+
+	/*
+		Returns a name identifying the locale and articles keys are made with
+	*/
+	std::string LibraryCollation::name() const {
+		std::string result(locale_.name());
+		for (std::vector< std::string >::const_iterator i = articles_.begin(); i != articles_.end(); ++i) {
+			result += (i == articles_.begin() ? ":" : ",") + *i;
+		}
+
+		return result;
+	}
+
+	/*
+		Returns the key of the text, which never contains a zero byte so keys can be joined with one between them
+	*/
+	std::vector< unsigned char > LibraryCollation::key(std::string const & text) const {
+		std::string folded = fold(text);
+
+		if (locale_ == std::locale::classic()) {
+			return std::vector< unsigned char >(folded.begin(), folded.end());
+		}
+
+		std::string transformed = std::use_facet< std::collate< char > >(locale_).transform(folded.data(),
+		                          folded.data() + folded.size());
+		return std::vector< unsigned char >(transformed.begin(), transformed.end());
+	}
+
+	/*
+		Returns the key an item is listed by, ordering it by its album, then its track number within the album, then its
+		title. Items without an album come first, as the zero byte after the album's key is smaller than any byte of a
+		key.
+	*/
+	std::vector< unsigned char > Library::sort_key(std::string const & title,
+	        std::vector< unsigned char > const & album_key, unsigned int track_number) const {
+		std::vector< unsigned char > key(album_key);
+		key.push_back(0);
+
+		if (!album_key.empty()) {
+			track_number = std::min(track_number, 0xffffu);
+			key.push_back(track_number >> 8);
+			key.push_back(track_number & 0xff);
+		}
+
+		std::vector< unsigned char > title_key = collation_->key(title);
+		key.insert(key.end(), title_key.begin(), title_key.end());
+		return key;
+	}
+
+	/*
+		Starts making the keys in the given schema again if they were made by a different collation
+	*/
+	void Library::check_collation(std::string const & schema) {
+		core::Statement check(*this, "UPDATE " + schema + ".collation SET name = ?1, position = "
+		                      "CASE WHEN EXISTS (SELECT 1 FROM " + schema + ".items) THEN 0 END WHERE name != ?1");
+		assert(check.valid());
+		check.bind(1u, collation_->name());
+		check.execute();
+
+		if (changes() > 0) {
+			dprint("Sort keys in %s will be made again for %s", schema.c_str(), collation_->name().c_str());
+		}
+	}
+
+	/*
+		Changes how items are ordered. Items added from now on are ordered by the new collation, while those already in
+		the library keep their old keys until they are made again by rekey.
+	*/
+	void Library::setCollation(std::shared_ptr< LibraryCollation const > collation) {
+		if (collation == nullptr) {
+			return;
+		}
+
+		collation_ = std::move(collation);
+		check_collation("main");
+
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			check_collation((*i)->schema());
+		}
+	}
+
+	/*
+		Makes the sort keys of up to batch items again after the collation has changed, in one transaction, so it can
+		be called while the application is idle. Returns false once there is nothing left to do.
+	*/
+	bool Library::rekey(unsigned int batch) {
+		std::vector< std::string > schemas(1, "main");
+		for (std::vector< LibraryVolume * >::const_iterator i = volumes_.begin(); i != volumes_.end(); ++i) {
+			schemas.push_back((*i)->schema());
+		}
+
+		for (std::vector< std::string >::const_iterator schema = schemas.begin(); schema != schemas.end(); ++schema) {
+			long long position;
+			{
+				core::Statement progress(*this, "SELECT position FROM " + *schema + ".collation WHERE position IS NOT NULL");
+				assert(progress.valid());
+				progress.execute();
+
+				if (!progress.hasData()) {
+					continue;
+				}
+
+				position = progress.toInteger(0u);
+			}
+
+			struct Row {
+				long long item_id;
+				std::string title;
+				long long album_id;
+				std::string album;
+				unsigned int track_number;
+			};
+
+			std::vector< Row > rows;
+			{
+				// Items are worked through in order of ID, so those added meanwhile are keyed already or come last
+				core::Statement items(*this, "SELECT item_id, name, album_id, album, track_number FROM " + *schema +
+				                      ".items LEFT JOIN " + *schema + ".albums USING (album_id) WHERE item_id > ? "
+				                      "ORDER BY item_id LIMIT ?");
+				assert(items.valid());
+				items.bind(1u, position);
+				items.bind(2u, static_cast< long long >(batch));
+				items.execute();
+
+				if (items.hasData()) {
+					do {
+						Row row = {items.toInteger(0u), items.toText(1u), items.toInteger(2u), items.toText(3u),
+						           static_cast< unsigned int >(items.toInteger(4u))};
+						rows.push_back(row);
+					} while (items.nextRow());
+				}
+			}
+
+			core::Statement set_item(*this, "UPDATE " + *schema + ".items SET sort_key = ? WHERE item_id = ?");
+			core::Statement set_album(*this, "UPDATE " + *schema + ".albums SET sort_key = ? WHERE album_id = ?");
+			core::Statement set_position(*this, "UPDATE " + *schema + ".collation SET position = ?");
+			assert(set_item.valid());
+			assert(set_album.valid());
+			assert(set_position.valid());
+
+			begin();
+
+			std::map< long long, std::vector< unsigned char > > album_keys;
+			for (std::vector< Row >::const_iterator i = rows.begin(); i != rows.end(); ++i) {
+				std::map< long long, std::vector< unsigned char > >::iterator album_key = album_keys.find(i->album_id);
+
+				if (album_key == album_keys.end()) {
+					album_key = album_keys.insert(std::make_pair(i->album_id, i->album_id == 0 ?
+					                              std::vector< unsigned char >() : collation_->key(i->album))).first;
+
+					if (i->album_id != 0) {
+						set_album.reset();
+						set_album.bind(1u, album_key->second);
+						set_album.bind(2u, i->album_id);
+						set_album.execute();
+					}
+				}
+
+				set_item.reset();
+				set_item.bind(1u, sort_key(i->title, album_key->second, i->track_number));
+				set_item.bind(2u, i->item_id);
+				set_item.execute();
+			}
+
+			if (rows.size() < batch) {
+				// Every item has been keyed
+				set_position.bind(1u);
+			} else {
+				set_position.bind(1u, rows.back().item_id);
+			}
+
+			set_position.execute();
+			commit();
+
+			return true;
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,316 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <debug.hpp>
+#include <toolkit/library.hpp>
+
+namespace toolkit {
+	/*
+		Column storage for a library item table. Titles and file names are stored once each in the arena, while
+		directories and thumbnails are interned as they are usually shared by many items.
+	*/
+	class LibraryItemTablePrivate {
+		std::vector< long long > ids_;
+		std::vector< std::uint32_t > titles_;
+		std::vector< std::uint32_t > directories_;
+		std::vector< std::uint32_t > names_;
+		std::vector< std::uint32_t > thumbnails_;
+
+		// Null terminated strings, stored in fixed size chunks so the arena never needs to be copied as it grows
+		static std::size_t const chunk_bits = 20;
+		static std::size_t const chunk_size = 1 << chunk_bits;
+		std::vector< std::unique_ptr< char[] > > storage_;
+		std::vector< char * > chunks_;
+		std::size_t chunk_used_;
+
+		// Offsets of interned strings, the first being the empty string
+		std::vector< std::uint32_t > interned_;
+
+		// Interned string indexes by hash, so the strings aren't stored a second time as keys
+		std::unordered_multimap< std::size_t, std::uint32_t > interned_index_;
+
+		std::uint32_t store(char const * text, std::size_t length);
+		inline char const * text(std::uint32_t offset) const;
+		std::uint32_t intern(std::string const & value);
+
+	public:
+		LibraryItemTablePrivate();
+
+		void reserve(std::size_t size);
+		void add(long long id, std::string const & title, std::string const & uri, std::string const & thumbnail_file);
+
+		inline std::size_t size() const;
+
+		inline long long id(std::size_t index) const;
+		inline std::string title(std::size_t index) const;
+		inline std::string uri(std::size_t index) const;
+		inline std::string thumbnailFile(std::size_t index) const;
+
+		unsigned long long memory() const;
+	};
+
+	LibraryItemTablePrivate::LibraryItemTablePrivate()
+		: chunk_used_(0), interned_(1, store("", 0)) {}
+
+	/*
+		Copies a string into the arena, returning its offset
+	*/
+	std::uint32_t LibraryItemTablePrivate::store(char const * text, std::size_t length) {
+		std::size_t needed = length + 1;
+		std::size_t offset;
+
+		if (chunks_.empty() || chunk_used_ + needed > chunk_size) {
+			// Strings never cross chunks, a string larger than a chunk spans several consecutive ones
+			std::size_t spanned = (needed + chunk_size - 1) / chunk_size;
+			assert((chunks_.size() + spanned) * chunk_size <= UINT32_MAX);
+
+			storage_.emplace_back(new char[spanned * chunk_size]);
+			for (std::size_t i = 0; i < spanned; ++i) {
+				chunks_.push_back(storage_.back().get() + i * chunk_size);
+			}
+
+			offset = (chunks_.size() - spanned) * chunk_size;
+			chunk_used_ = needed - (spanned - 1) * chunk_size;
+		} else {
+			offset = (chunks_.size() - 1) * chunk_size + chunk_used_;
+			chunk_used_ += needed;
+		}
+
+		char * destination = chunks_[offset >> chunk_bits] + (offset & (chunk_size - 1));
+		std::copy(text, text + length, destination);
+		destination[length] = '\0';
+
+		return offset;
+	}
+
+	/*
+		Returns the string stored at an offset in the arena
+	*/
+	char const * LibraryItemTablePrivate::text(std::uint32_t offset) const {
+		return chunks_[offset >> chunk_bits] + (offset & (chunk_size - 1));
+	}
+
+	/*
+		Stores a string only once however many items use it, returning its index
+	*/
+	std::uint32_t LibraryItemTablePrivate::intern(std::string const & value) {
+		if (value.empty()) {
+			return 0;
+		}
+
+		std::size_t hash = std::hash< std::string >()(value);
+		typedef std::unordered_multimap< std::size_t, std::uint32_t >::const_iterator iterator;
+		std::pair< iterator, iterator > candidates = interned_index_.equal_range(hash);
+		for (iterator i = candidates.first; i != candidates.second; ++i) {
+			if (value.compare(text(interned_[i->second])) == 0) {
+				return i->second;
+			}
+		}
+
+		std::uint32_t index = interned_.size();
+		interned_.push_back(store(value.data(), value.size()));
+		interned_index_.insert(std::make_pair(hash, index));
+
+		return index;
+	}
+
+	/*
+		Reserves space for the given number of items
+	*/
+	void LibraryItemTablePrivate::reserve(std::size_t size) {
+		ids_.reserve(size);
+		titles_.reserve(size);
+		directories_.reserve(size);
+		names_.reserve(size);
+		thumbnails_.reserve(size);
+	}
+
+	/*
+		Appends an item to the table
+	*/
+	void LibraryItemTablePrivate::add(long long id, std::string const & title, std::string const & uri,
+	                                  std::string const & thumbnail_file) {
+		std::string::size_type separator = uri.rfind('/');
+		std::string::size_type name = separator == std::string::npos ? 0 : separator + 1;
+
+		ids_.push_back(id);
+		titles_.push_back(store(title.data(), title.size()));
+		directories_.push_back(intern(uri.substr(0, name)));
+		names_.push_back(store(uri.data() + name, uri.size() - name));
+		thumbnails_.push_back(intern(thumbnail_file));
+	}
+
+	/*
+		Returns the number of items in the table
+	*/
+	std::size_t LibraryItemTablePrivate::size() const {
+		return ids_.size();
+	}
+
+	/*
+		Returns the database ID of an item
+	*/
+	long long LibraryItemTablePrivate::id(std::size_t index) const {
+		return ids_[index];
+	}
+
+	/*
+		Returns the title of an item
+	*/
+	std::string LibraryItemTablePrivate::title(std::size_t index) const {
+		return std::string(text(titles_[index]));
+	}
+
+	/*
+		Returns the URI of an item, joining its directory and file name
+	*/
+	std::string LibraryItemTablePrivate::uri(std::size_t index) const {
+		std::string uri(text(interned_[directories_[index]]));
+		uri.append(text(names_[index]));
+		return uri;
+	}
+
+	/*
+		Returns the thumbnail file of an item
+	*/
+	std::string LibraryItemTablePrivate::thumbnailFile(std::size_t index) const {
+		return std::string(text(interned_[thumbnails_[index]]));
+	}
+
+	/*
+		Returns an estimate of the memory used by the table in bytes
+	*/
+	unsigned long long LibraryItemTablePrivate::memory() const {
+		unsigned long long total = sizeof(*this);
+
+		total += ids_.capacity() * sizeof(long long);
+		total += (titles_.capacity() + directories_.capacity() + names_.capacity() + thumbnails_.capacity() +
+		          interned_.capacity()) * sizeof(std::uint32_t);
+		total += storage_.capacity() * sizeof(std::unique_ptr< char[] >) + chunks_.capacity() * sizeof(char *);
+		total += chunks_.size() * chunk_size;
+
+		// Each node of the index holds a hash, an index and a link
+		total += interned_index_.bucket_count() * sizeof(void *);
+		total += interned_index_.size() * (sizeof(std::pair< std::size_t const, std::uint32_t >) + sizeof(void *));
+
+		return total;
+	}
+
+	LibraryItem::LibraryItem(std::shared_ptr< LibraryItemTablePrivate const > table, std::size_t index)
+		: table_(std::move(table)), index_(index) {}
+
+	/*
+		Returns the database ID of the library item
+	*/
+	long long LibraryItem::id() const {
+		return table_->id(index_);
+	}
+
+	/*
+		Returns the title of the library item
+	*/
+	std::string LibraryItem::title() const {
+		return table_->title(index_);
+	}
+
+	/*
+		Returns the URI pointing to the location of the library item
+	*/
+	std::string LibraryItem::uri() const {
+		return table_->uri(index_);
+	}
+
+	/*
+		Returns the file with a thumbnail of the library item
+	*/
+	std::string LibraryItem::thumbnailFile() const {
+		return table_->thumbnailFile(index_);
+	}
+
+	LibraryItemTable::LibraryItemTable()
+		: p(std::make_shared< LibraryItemTablePrivate >()) {}
+
+	/*
+		Gives the table its own copy of the items before it is changed, if they are shared with another table or with
+		items taken from it
+	*/
+	void LibraryItemTable::detach() {
+		if (p.use_count() == 1) {
+			return;
+		}
+
+		std::shared_ptr< LibraryItemTablePrivate > copy(std::make_shared< LibraryItemTablePrivate >());
+		copy->reserve(p->size());
+		for (std::size_t i = 0; i < p->size(); ++i) {
+			copy->add(p->id(i), p->title(i), p->uri(i), p->thumbnailFile(i));
+		}
+
+		p = copy;
+	}
+
+	void LibraryItemTable::reserve(std::size_t size) {
+		detach();
+		p->reserve(size);
+	}
+
+	/*
+		Appends an item to the table. Copies of a table share its items until one of them is changed.
+	*/
+	void LibraryItemTable::add(long long id, std::string const & title, std::string const & uri,
+	                           std::string const & thumbnail_file) {
+		detach();
+		p->add(id, title, uri, thumbnail_file);
+	}
+
+	bool LibraryItemTable::empty() const {
+		return p->size() == 0;
+	}
+
+	std::size_t LibraryItemTable::size() const {
+		return p->size();
+	}
+
+	/*
+		Returns a view of an item, throwing std::out_of_range if there is no such item
+	*/
+	LibraryItem LibraryItemTable::at(std::size_t index) const {
+		if (index >= p->size()) {
+			throw std::out_of_range("LibraryItemTable::at");
+		}
+
+		return LibraryItem(p, index);
+	}
+
+	/*
+		Returns a view of an item, which remains valid after the table is destroyed
+	*/
+	LibraryItem LibraryItemTable::operator[](std::size_t index) const {
+		assert(index < p->size());
+		return LibraryItem(p, index);
+	}
+
+	/*
+		Returns an estimate of the memory used by the table's items in bytes
+	*/
+	unsigned long long LibraryItemTable::memory() const {
+		return p->memory();
+	}
+}
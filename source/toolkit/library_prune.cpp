@@ -0,0 +1,334 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <debug.hpp>
+#include <core/filesystem.hpp>
+#include <toolkit/library.hpp>
+#include "library_volume.hpp"
+
+extern "C" {
+#include <dirent.h>
+#include <sys/stat.h>
+}
+
+namespace {
+	/*
+		Number of vanished items removed in each transaction
+	*/
+	std::size_t const prune_batch_size(1000);
+
+	/*
+		The items whose files are in a single directory
+	*/
+	struct PruneDirectory {
+		std::string path;
+		std::vector< std::pair< std::string, long long > > files;
+		std::vector< std::size_t > missing;
+
+		// The device the files were on when they were inspected, if any of them were
+		bool has_device;
+		unsigned long long device;
+	};
+
+	/*
+		Checks that a root directory is there and has something in it, so a drive that isn't mounted isn't mistaken
+		for one whose files have all been deleted
+	*/
+	bool root_available(std::string const & path) {
+		DIR * handle = opendir(path.c_str());
+		if (handle == nullptr) {
+			return false;
+		}
+
+		bool empty = true;
+		while (dirent * entry = readdir(handle)) {
+			std::string name(entry->d_name);
+			if ((name != ".") && (name != "..")) {
+				empty = false;
+				break;
+			}
+		}
+
+		closedir(handle);
+		return !empty;
+	}
+
+	/*
+		Shortens a path to the nearest part of it that exists, returning false if none of it can be found
+	*/
+	bool nearest_existing(std::string & path, struct stat & info) {
+		while (stat(path.c_str(), &info) != 0) {
+			std::string::size_type slash = path.rfind('/');
+			if (((errno != ENOENT) && (errno != ENOTDIR)) || (slash == std::string::npos) || (path == "/")) {
+				return false;
+			}
+
+			path.erase(slash == 0 ? 1 : slash);
+		}
+
+		return true;
+	}
+
+	/*
+		Decides whether the drive a directory's files were on is mounted. Where the device they were inspected on is
+		known, the nearest part of the path still there must be on it. Otherwise that part must have something in it,
+		since a drive that isn't mounted usually leaves an empty directory or none at all.
+	*/
+	bool directory_available(PruneDirectory const & directory) {
+		std::string path = directory.path;
+		struct stat info;
+		if (!nearest_existing(path, info)) {
+			return false;
+		}
+
+		if (directory.has_device) {
+			return static_cast< unsigned long long >(info.st_dev) == directory.device;
+		}
+
+		return root_available(path);
+	}
+
+	/*
+		Finds the files in a directory that are no longer there, with one read of the directory rather than a check
+		for each file. Nothing is reported missing if the directory can't be read for any reason other than it having
+		gone.
+	*/
+	void check_directory(PruneDirectory & directory) {
+		if (!directory_available(directory)) {
+			dprint("Not pruning items in %s as its drive isn't available", directory.path.c_str());
+			return;
+		}
+
+		DIR * handle = opendir(directory.path.c_str());
+		if (handle == nullptr) {
+			if ((errno == ENOENT) || (errno == ENOTDIR)) {
+				for (std::size_t i = 0; i < directory.files.size(); ++i) {
+					directory.missing.push_back(i);
+				}
+			} else {
+				dprint("Unable to read %s", directory.path.c_str());
+			}
+
+			return;
+		}
+
+		std::unordered_set< std::string > names;
+		while (dirent * entry = readdir(handle)) {
+			names.insert(entry->d_name);
+		}
+
+		closedir(handle);
+
+		for (std::size_t i = 0; i < directory.files.size(); ++i) {
+			if (names.count(directory.files[i].first) == 0) {
+				directory.missing.push_back(i);
+			}
+		}
+	}
+}
+
+namespace toolkit {
+	/*
+		Removes the items whose files no longer exist, returning how many were removed. Directories are read on a pool of
+		threads while the items found to be missing are removed in batches, with progress reported from the calling
+		thread. Items beneath a root that isn't currently available are left alone, as are those in a directory whose
+		drive isn't mounted and those that aren't files.
+	*/
+	unsigned long long Library::prune(std::function< void (unsigned long long checked, unsigned long long total) >
+	                                  progress, unsigned int threads) {
+		std::vector< PruneDirectory > directories;
+		unsigned long long total = 0;
+
+		{
+			std::unordered_map< std::string, std::size_t > directory_index;
+			std::unordered_map< std::string, bool > roots;
+
+			// The library's own items, then those on each volume with their library-wide IDs
+			for (std::size_t source = 0; source <= volumes_.size(); ++source) {
+				LibraryVolume const * volume = source == 0 ? nullptr : volumes_[source - 1];
+				std::string sql;
+				if (volume == nullptr) {
+					sql = "SELECT item_id, roots.uri, path, "
+					      "(SELECT device FROM files WHERE files.item_id = items.item_id LIMIT 1) "
+					      "FROM items JOIN roots USING (root_id)";
+				} else {
+					sql = "SELECT (" + std::to_string(volume->id()) + " << " + std::to_string(LibraryVolume::id_shift) +
+					      ") | item_id, ?1, path, (SELECT device FROM " + volume->schema() + ".files "
+					      "WHERE files.item_id = items.item_id LIMIT 1) FROM " + volume->schema() + ".items";
+				}
+
+				core::Statement items(*this, sql);
+				assert(items.valid());
+				if (volume != nullptr) {
+					items.bind(1u, volume->root());
+				}
+
+				items.execute();
+				if (!items.hasData()) {
+					continue;
+				}
+
+				do {
+					std::string root_uri = items.toText(1u);
+
+					std::unordered_map< std::string, bool >::iterator available = roots.find(root_uri);
+					if (available == roots.end()) {
+						std::string root_path = core::Path::fromUri(root_uri);
+						// Items that aren't beneath a root are checked by the directory they are in instead
+						bool mounted = root_path.empty() || root_available(root_path);
+						if (!mounted) {
+							dprint("Not pruning items beneath %s as it isn't available", root_uri.c_str());
+						}
+
+						available = roots.insert(std::make_pair(root_uri, mounted)).first;
+					}
+
+					if (!available->second) {
+						continue;
+					}
+
+					std::string path = core::Path::fromUri(root_uri + items.toText(2u));
+					std::string::size_type slash = path.rfind('/');
+					if (path.empty() || (slash == std::string::npos)) {
+						continue;
+					}
+
+					std::string directory = path.substr(0, slash == 0 ? 1 : slash);
+					std::unordered_map< std::string, std::size_t >::iterator index = directory_index.find(directory);
+					if (index == directory_index.end()) {
+						index = directory_index.insert(std::make_pair(directory, directories.size())).first;
+						directories.push_back(PruneDirectory());
+						directories.back().path = directory;
+						directories.back().has_device = false;
+						directories.back().device = 0;
+					}
+
+					PruneDirectory & entry = directories[index->second];
+					if (!entry.has_device && (items.dataType(3u) == core::Statement::Type::Integer)) {
+						entry.has_device = true;
+						entry.device = static_cast< unsigned long long >(items.toInteger(3u));
+					}
+
+					entry.files.push_back(std::make_pair(path.substr(slash + 1), items.toInteger(0u)));
+					++total;
+				} while (items.nextRow());
+			}
+		}
+
+		dprint("Checking %llu files in %zu directories", total, directories.size());
+
+		if (threads == 0) {
+			// Mostly waiting on the disk or the network, so more threads than cores helps
+			threads = std::max(4u, std::thread::hardware_concurrency());
+		}
+
+		threads = std::min< std::size_t >(threads, directories.size());
+
+		std::atomic< std::size_t > next(0);
+		std::mutex mutex;
+		std::condition_variable checked_directory;
+		std::vector< std::size_t > checked;
+
+		std::vector< std::thread > workers;
+		for (unsigned int i = 0; i < threads; ++i) {
+			workers.push_back(std::thread([&]() {
+				for (std::size_t index = next++; index < directories.size(); index = next++) {
+					check_directory(directories[index]);
+
+					std::lock_guard< std::mutex > lock(mutex);
+					checked.push_back(index);
+					checked_directory.notify_one();
+				}
+			}));
+		}
+
+		std::vector< std::string > batch_paths;
+		std::vector< long long > batch_items;
+
+		// Files are forgotten first, so an item with another copy is pointed at it rather than removed
+		auto remove_batch = [&]() {
+			begin();
+			removeFiles(batch_paths);
+			removeItems(batch_items);
+			commit();
+
+			batch_paths.clear();
+			batch_items.clear();
+		};
+
+		unsigned long long before = count(Type::All);
+		unsigned long long files_checked = 0;
+		std::size_t directories_checked = 0;
+
+		while (directories_checked < directories.size()) {
+			std::vector< std::size_t > ready;
+			{
+				std::unique_lock< std::mutex > lock(mutex);
+				while (checked.empty()) {
+					checked_directory.wait(lock);
+				}
+
+				ready.swap(checked);
+			}
+
+			for (std::vector< std::size_t >::const_iterator i = ready.begin(); i != ready.end(); ++i) {
+				PruneDirectory & directory = directories[*i];
+				for (std::vector< std::size_t >::const_iterator j = directory.missing.begin(); j != directory.missing.end();
+				        ++j) {
+					batch_paths.push_back((directory.path == "/" ? directory.path : directory.path + "/") +
+					                      directory.files[*j].first);
+					batch_items.push_back(directory.files[*j].second);
+				}
+
+				files_checked += directory.files.size();
+				directory.files.clear();
+				directory.files.shrink_to_fit();
+			}
+
+			directories_checked += ready.size();
+
+			if (batch_items.size() >= prune_batch_size) {
+				remove_batch();
+			}
+
+			if (progress) {
+				progress(files_checked, total);
+			}
+		}
+
+		for (std::vector< std::thread >::iterator i = workers.begin(); i != workers.end(); ++i) {
+			i->join();
+		}
+
+		if (!batch_items.empty()) {
+			remove_batch();
+		}
+
+		unsigned long long removed = before - count(Type::All);
+		dprint("Pruned %llu items", removed);
+
+		return removed;
+	}
+}
@@ -0,0 +1,277 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <debug.hpp>
+
+#include "library_rules.hpp"
+
+namespace {
+	/*
+		How long results that depend on the current time are kept
+	*/
+	std::chrono::seconds const time_rule_lifetime(60);
+
+	/*
+		Returns the SQL operator for a comparison of numbers
+	*/
+	char const * numeric_operator(toolkit::LibraryRule::Comparison comparison) {
+		switch (comparison) {
+		case toolkit::LibraryRule::Comparison::Is:
+			return "=";
+		case toolkit::LibraryRule::Comparison::IsNot:
+			return "!=";
+		case toolkit::LibraryRule::Comparison::Less:
+			return "<";
+		case toolkit::LibraryRule::Comparison::Greater:
+			return ">";
+		default:
+			return nullptr;
+		}
+	}
+}
+
+namespace toolkit {
+	LibrarySmartPlaylist::LibrarySmartPlaylist(core::Database & database, std::vector< LibraryRule > const & rules,
+	        bool match_all, unsigned int limit)
+		: statement_(nullptr), uses_plays_(false), uses_time_(false), cached_(false), generation_(0), play_generation_(0) {
+		std::string sql("SELECT item_id, name, roots.uri || path, items.thumbnail FROM items JOIN roots USING (root_id) "
+		                "LEFT JOIN albums USING (album_id) WHERE ");
+
+		if (rules.empty()) {
+			sql.append("1");
+		}
+
+		for (std::vector< LibraryRule >::const_iterator i = rules.begin(); i != rules.end(); ++i) {
+			std::string condition;
+			if (!compile(*i, condition)) {
+				dprint("Unable to compile smart playlist rule %d %d", static_cast< int >(i->field()),
+				       static_cast< int >(i->comparison()));
+				return;
+			}
+
+			if (i != rules.begin()) {
+				sql.append(match_all ? " AND " : " OR ");
+			}
+
+			sql.append("(" + condition + ")");
+		}
+
+		sql.append(" ORDER BY items.sort_key");
+		if (limit > 0) {
+			sql.append(" LIMIT " + std::to_string(limit));
+		}
+
+#ifdef DEBUG
+		{
+			// Shows whether the rules are able to use the indexes
+			core::Statement plan(database, "EXPLAIN QUERY PLAN " + sql);
+			for (std::size_t i = 0; i < bindings_.size(); ++i) {
+				bindings_[i].integer ? plan.bind(i + 1, bindings_[i].number) : plan.bind(i + 1, bindings_[i].text);
+			}
+
+			if (plan.valid() && plan.execute() && plan.hasData()) {
+				do {
+					dprint("Smart playlist plan: %s", plan.toText(3u).c_str());
+				} while (plan.nextRow());
+			}
+		}
+#endif
+
+		statement_ = new core::Statement(database, sql);
+		if (!statement_->valid()) {
+			dprint("Unable to prepare smart playlist statement");
+			delete statement_;
+			statement_ = nullptr;
+		}
+	}
+
+	LibrarySmartPlaylist::~LibrarySmartPlaylist() {
+		delete statement_;
+	}
+
+	/*
+		Turns a rule into an SQL condition, adding the values it needs to the bindings. Conditions on play statistics
+		are written as lookups by item ID so they can use the play_stats indexes.
+	*/
+	bool LibrarySmartPlaylist::compile(LibraryRule const & rule, std::string & condition) {
+		std::string parameter = "?" + std::to_string(bindings_.size() + 1);
+		Binding binding = {false, 0, rule.value()};
+
+		switch (rule.field()) {
+		case LibraryRule::Field::Type:
+			if (rule.comparison() == LibraryRule::Comparison::Is) {
+				condition = "type_id = (SELECT type_id FROM types WHERE type = " + parameter + ")";
+			} else if (rule.comparison() == LibraryRule::Comparison::IsNot) {
+				condition = "type_id != (SELECT type_id FROM types WHERE type = " + parameter + ")";
+			} else {
+				return false;
+			}
+			break;
+		case LibraryRule::Field::Album:
+			if (rule.comparison() == LibraryRule::Comparison::Is) {
+				condition = "album_id IN (SELECT album_id FROM albums WHERE album = " + parameter + ")";
+			} else if (rule.comparison() == LibraryRule::Comparison::IsNot) {
+				condition = "album_id IS NULL OR album_id NOT IN (SELECT album_id FROM albums WHERE album = " + parameter + ")";
+			} else if (rule.comparison() == LibraryRule::Comparison::Contains) {
+				condition = "album_id IN (SELECT album_id FROM albums WHERE album LIKE " + parameter + ")";
+				binding.text = "%" + rule.value() + "%";
+			} else {
+				return false;
+			}
+			break;
+		case LibraryRule::Field::Title:
+			if (rule.comparison() == LibraryRule::Comparison::Is) {
+				condition = "name = " + parameter;
+			} else if (rule.comparison() == LibraryRule::Comparison::IsNot) {
+				condition = "name != " + parameter;
+			} else if (rule.comparison() == LibraryRule::Comparison::Contains) {
+				condition = "name LIKE " + parameter;
+				binding.text = "%" + rule.value() + "%";
+			} else {
+				return false;
+			}
+			break;
+		case LibraryRule::Field::Plays:
+		case LibraryRule::Field::Skips: {
+			char const * comparison = numeric_operator(rule.comparison());
+			if (comparison == nullptr) {
+				return false;
+			}
+
+			char const * column = rule.field() == LibraryRule::Field::Plays ? "plays" : "skips";
+			binding.integer = true;
+			binding.number = rule.number();
+
+			// Items that have never been played have no statistics, but count as zero
+			bool zero_matches;
+			switch (rule.comparison()) {
+			case LibraryRule::Comparison::Is:
+				zero_matches = binding.number == 0;
+				break;
+			case LibraryRule::Comparison::IsNot:
+				zero_matches = binding.number != 0;
+				break;
+			case LibraryRule::Comparison::Less:
+				zero_matches = binding.number > 0;
+				break;
+			default:
+				zero_matches = binding.number < 0;
+				break;
+			}
+
+			if (zero_matches) {
+				condition = std::string("item_id NOT IN (SELECT item_id FROM play_stats WHERE NOT (") + column + " " +
+				            comparison + " " + parameter + "))";
+			} else {
+				condition = std::string("item_id IN (SELECT item_id FROM play_stats WHERE ") + column + " " + comparison +
+				            " " + parameter + ")";
+			}
+
+			uses_plays_ = true;
+			break;
+		}
+		case LibraryRule::Field::LastPlayed:
+			binding.integer = true;
+			binding.number = rule.number();
+
+			if (rule.comparison() == LibraryRule::Comparison::Less) {
+				condition = "item_id IN (SELECT item_id FROM play_stats WHERE last_played < " + parameter + ")";
+			} else if (rule.comparison() == LibraryRule::Comparison::Greater) {
+				condition = "item_id IN (SELECT item_id FROM play_stats WHERE last_played > " + parameter + ")";
+			} else if (rule.comparison() == LibraryRule::Comparison::Within) {
+				condition = "item_id IN (SELECT item_id FROM play_stats WHERE last_played > strftime('%s', 'now') - " +
+				            parameter + ")";
+				uses_time_ = true;
+			} else {
+				return false;
+			}
+
+			uses_plays_ = true;
+			break;
+		case LibraryRule::Field::Duration:
+		case LibraryRule::Field::Added: {
+			char const * column = rule.field() == LibraryRule::Field::Duration ? "duration" : "added";
+			binding.integer = true;
+			binding.number = rule.number();
+
+			if ((rule.field() == LibraryRule::Field::Added) && (rule.comparison() == LibraryRule::Comparison::Within)) {
+				condition = "added > strftime('%s', 'now') - " + parameter;
+				uses_time_ = true;
+			} else if (rule.comparison() == LibraryRule::Comparison::IsNot) {
+				// Includes items where the value isn't known
+				condition = std::string(column) + " IS NOT " + parameter;
+			} else if (numeric_operator(rule.comparison()) != nullptr) {
+				condition = std::string(column) + " " + numeric_operator(rule.comparison()) + " " + parameter;
+			} else {
+				return false;
+			}
+			break;
+		}
+		}
+
+		bindings_.push_back(binding);
+		return true;
+	}
+
+	/*
+		Indicates whether the rules compiled into a statement
+	*/
+	bool LibrarySmartPlaylist::valid() const {
+		return statement_ != nullptr;
+	}
+
+	/*
+		Returns the items matching the rules, reusing the last results unless the tables they depend on have changed
+	*/
+	LibraryItemTable LibrarySmartPlaylist::items(long long generation, long long play_generation) {
+		if (statement_ == nullptr) {
+			return LibraryItemTable();
+		}
+
+		if (cached_ && (generation == generation_) && (!uses_plays_ || (play_generation == play_generation_)) &&
+		        (!uses_time_ || (std::chrono::steady_clock::now() - cached_at_ < time_rule_lifetime))) {
+			return items_;
+		}
+
+		statement_->reset();
+		for (std::size_t i = 0; i < bindings_.size(); ++i) {
+			if (bindings_[i].integer) {
+				statement_->bind(i + 1, bindings_[i].number);
+			} else {
+				statement_->bind(i + 1, bindings_[i].text);
+			}
+		}
+
+		statement_->execute();
+
+		items_ = LibraryItemTable();
+		if (statement_->hasData()) {
+			do {
+				items_.add(statement_->toInteger(0u), statement_->toText(1u), statement_->toText(2u), statement_->toText(3u));
+			} while (statement_->nextRow());
+		}
+
+		statement_->reset();
+
+		cached_ = true;
+		generation_ = generation;
+		play_generation_ = play_generation;
+		cached_at_ = std::chrono::steady_clock::now();
+
+		return items_;
+	}
+}
@@ -0,0 +1,67 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _LIBRARY_RULES_HPP
+#define _LIBRARY_RULES_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <core/database.hpp>
+#include <core/noncopiable.hpp>
+#include <toolkit/library.hpp>
+
+namespace toolkit {
+	/*
+		The rules of a smart playlist compiled into a single prepared statement, along with its last results
+	*/
+	class LibrarySmartPlaylist
+			: core::NonCopiable {
+		/*
+			A value bound to the statement, as an integer or as text
+		*/
+		struct Binding {
+			bool integer;
+			long long number;
+			std::string text;
+		};
+
+		core::Statement * statement_;
+		std::vector< Binding > bindings_;
+		bool uses_plays_;
+		bool uses_time_;
+
+		bool cached_;
+		long long generation_;
+		long long play_generation_;
+		std::chrono::steady_clock::time_point cached_at_;
+		LibraryItemTable items_;
+
+		bool compile(LibraryRule const & rule, std::string & condition);
+
+	public:
+		LibrarySmartPlaylist(core::Database & database, std::vector< LibraryRule > const & rules, bool match_all,
+		                     unsigned int limit);
+		~LibrarySmartPlaylist();
+
+		bool valid() const;
+
+		LibraryItemTable items(long long generation, long long play_generation);
+	};
+}
+
+#endif
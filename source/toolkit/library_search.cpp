@@ -0,0 +1,326 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <debug.hpp>
+#include <toolkit/library_search.hpp>
+
+#include "library_trigrams.hpp"
+
+namespace {
+	// Number of earlier searches remembered for narrowing down
+	std::size_t const history_size(64);
+
+	/*
+		Splits a normalised string into its words
+	*/
+	std::vector< std::string > split(std::string const & normalised) {
+		std::vector< std::string > words;
+
+		std::string::size_type start = 0;
+		while (start < normalised.size()) {
+			std::string::size_type end = normalised.find(' ', start);
+			if (end == std::string::npos) {
+				end = normalised.size();
+			}
+
+			if (end > start) {
+				words.push_back(normalised.substr(start, end - start));
+			}
+
+			start = end + 1;
+		}
+
+		return words;
+	}
+}
+
+namespace toolkit {
+	/*
+		Every distinct word in the library is kept once in sorted order, so the words starting with a prefix are a
+		contiguous range of word IDs. Each item lists the IDs of its words and each word lists the items it appears in.
+	*/
+	class LibrarySearchPrivate {
+		/*
+			An earlier search and the items it matched
+		*/
+		struct Step {
+			std::string query;
+			std::vector< std::uint32_t > matches;
+		};
+
+		typedef std::pair< std::uint32_t, std::uint32_t > Range;
+
+		Library & library_;
+		long long generation_;
+
+		LibraryItemTable items_;
+		std::vector< std::uint8_t > types_;
+
+		// Sorted, null terminated words
+		std::string words_;
+		std::vector< std::uint32_t > word_offsets_;
+
+		// Words of each item
+		std::vector< std::uint32_t > item_word_offsets_;
+		std::vector< std::uint32_t > item_words_;
+
+		// Items containing each word
+		std::vector< std::uint32_t > posting_offsets_;
+		std::vector< std::uint32_t > postings_;
+
+		std::vector< Step > history_;
+
+		void build();
+
+		Range range(std::string const & prefix) const;
+		bool matches(std::uint32_t item, std::vector< Range > const & ranges) const;
+
+	public:
+		LibrarySearchPrivate(Library & library);
+
+		LibraryItemTable search(Library::Type type, std::string const & term);
+	};
+
+	LibrarySearchPrivate::LibrarySearchPrivate(Library & library)
+		: library_(library), generation_(-1) {}
+
+	/*
+		Indexes the words of every item's title and album
+	*/
+	void LibrarySearchPrivate::build() {
+		items_ = LibraryItemTable();
+		types_.clear();
+		words_.clear();
+		word_offsets_.clear();
+		item_word_offsets_.assign(1, 0);
+		item_words_.clear();
+		history_.clear();
+
+		// Number the words in the order they're found to begin with
+		std::unordered_map< std::string, std::uint32_t > found;
+		std::vector< std::string const * > found_words;
+
+		generation_ = library_.enumerate([&](long long id, Library::Type type, std::string const & title,
+		                                     std::string const & album, std::string const & uri, std::string const & thumbnail_file) {
+			items_.add(id, title, uri, thumbnail_file);
+			types_.push_back(static_cast< std::uint8_t >(type));
+
+			std::vector< std::string > words = split(trigrams::normalise(album.empty() ? title : title + " " + album));
+			std::size_t first = item_words_.size();
+
+			for (std::vector< std::string >::const_iterator i = words.begin(); i != words.end(); ++i) {
+				std::pair< std::unordered_map< std::string, std::uint32_t >::iterator, bool > inserted =
+				    found.insert(std::make_pair(*i, static_cast< std::uint32_t >(found_words.size())));
+				if (inserted.second) {
+					found_words.push_back(&inserted.first->first);
+				}
+
+				item_words_.push_back(inserted.first->second);
+			}
+
+			// Each word only needs to be listed once per item
+			std::sort(item_words_.begin() + first, item_words_.end());
+			item_words_.erase(std::unique(item_words_.begin() + first, item_words_.end()), item_words_.end());
+			item_word_offsets_.push_back(item_words_.size());
+		});
+
+		// Renumber the words in sorted order
+		std::vector< std::uint32_t > order(found_words.size());
+		for (std::size_t i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+
+		std::sort(order.begin(), order.end(), [&found_words](std::uint32_t x, std::uint32_t y) {
+			return *found_words[x] < *found_words[y];
+		});
+
+		std::vector< std::uint32_t > renumbered(order.size());
+		word_offsets_.reserve(order.size());
+		for (std::size_t i = 0; i < order.size(); ++i) {
+			renumbered[order[i]] = i;
+			word_offsets_.push_back(words_.size());
+			words_.append(*found_words[order[i]]);
+			words_.push_back('\0');
+		}
+
+		for (std::size_t item = 0; item + 1 < item_word_offsets_.size(); ++item) {
+			std::vector< std::uint32_t >::iterator begin = item_words_.begin() + item_word_offsets_[item];
+			std::vector< std::uint32_t >::iterator end = item_words_.begin() + item_word_offsets_[item + 1];
+			for (std::vector< std::uint32_t >::iterator i = begin; i != end; ++i) {
+				*i = renumbered[*i];
+			}
+
+			std::sort(begin, end);
+		}
+
+		// Invert the item words into the items of each word, which come out in listing order
+		posting_offsets_.assign(order.size() + 1, 0);
+		for (std::vector< std::uint32_t >::const_iterator i = item_words_.begin(); i != item_words_.end(); ++i) {
+			++posting_offsets_[*i + 1];
+		}
+
+		for (std::size_t i = 1; i < posting_offsets_.size(); ++i) {
+			posting_offsets_[i] += posting_offsets_[i - 1];
+		}
+
+		postings_.resize(item_words_.size());
+		std::vector< std::uint32_t > next(posting_offsets_.begin(), posting_offsets_.end() - 1);
+		for (std::size_t item = 0; item + 1 < item_word_offsets_.size(); ++item) {
+			for (std::uint32_t i = item_word_offsets_[item]; i < item_word_offsets_[item + 1]; ++i) {
+				postings_[next[item_words_[i]]++] = item;
+			}
+		}
+
+		dprint("Indexed %zu words in %zu items for searching", word_offsets_.size(), types_.size());
+	}
+
+	/*
+		Finds the IDs of the words starting with a prefix
+	*/
+	LibrarySearchPrivate::Range LibrarySearchPrivate::range(std::string const & prefix) const {
+		char const * words = words_.c_str();
+
+		std::vector< std::uint32_t >::const_iterator first = std::lower_bound(word_offsets_.begin(), word_offsets_.end(),
+		        prefix, [words](std::uint32_t offset, std::string const & value) {
+			return std::strcmp(words + offset, value.c_str()) < 0;
+		});
+
+		std::vector< std::uint32_t >::const_iterator last = std::upper_bound(first, word_offsets_.end(), prefix,
+		[words](std::string const & value, std::uint32_t offset) {
+			return std::strncmp(value.c_str(), words + offset, value.size()) < 0;
+		});
+
+		return Range(first - word_offsets_.begin(), last - word_offsets_.begin());
+	}
+
+	/*
+		Checks that an item has a word in each range
+	*/
+	bool LibrarySearchPrivate::matches(std::uint32_t item, std::vector< Range > const & ranges) const {
+		std::vector< std::uint32_t >::const_iterator begin = item_words_.begin() + item_word_offsets_[item];
+		std::vector< std::uint32_t >::const_iterator end = item_words_.begin() + item_word_offsets_[item + 1];
+
+		for (std::vector< Range >::const_iterator range = ranges.begin(); range != ranges.end(); ++range) {
+			std::vector< std::uint32_t >::const_iterator word = std::lower_bound(begin, end, range->first);
+			if ((word == end) || (*word >= range->second)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/*
+		Returns the items whose titles and albums have words starting with each word of the term
+	*/
+	LibraryItemTable LibrarySearchPrivate::search(Library::Type type, std::string const & term) {
+		if (library_.generation() != generation_) {
+			build();
+		}
+
+		std::string query = trigrams::normalise(term);
+		query.erase(query.size() - 1);
+
+		std::vector< Range > ranges;
+		std::vector< std::string > words = split(query);
+		for (std::vector< std::string >::const_iterator i = words.begin(); i != words.end(); ++i) {
+			ranges.push_back(range(*i));
+		}
+
+		// Go back to the last search this one narrows down
+		while (!history_.empty() && (query.compare(0, history_.back().query.size(), history_.back().query) != 0)) {
+			history_.pop_back();
+		}
+
+		std::vector< std::uint32_t > matched;
+		if (!history_.empty()) {
+			std::vector< std::uint32_t > const & previous = history_.back().matches;
+			for (std::vector< std::uint32_t >::const_iterator i = previous.begin(); i != previous.end(); ++i) {
+				if (matches(*i, ranges)) {
+					matched.push_back(*i);
+				}
+			}
+		} else if (ranges.empty()) {
+			matched.resize(types_.size());
+			for (std::size_t i = 0; i < matched.size(); ++i) {
+				matched[i] = i;
+			}
+		} else {
+			// Start from whichever word has the fewest items
+			std::vector< Range >::const_iterator rarest = ranges.begin();
+			for (std::vector< Range >::const_iterator i = ranges.begin(); i != ranges.end(); ++i) {
+				if (posting_offsets_[i->second] - posting_offsets_[i->first] <
+				        posting_offsets_[rarest->second] - posting_offsets_[rarest->first]) {
+					rarest = i;
+				}
+			}
+
+			matched.assign(postings_.begin() + posting_offsets_[rarest->first],
+			               postings_.begin() + posting_offsets_[rarest->second]);
+			if (rarest->second - rarest->first > 1) {
+				// Several words share the prefix
+				std::sort(matched.begin(), matched.end());
+				matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+			}
+
+			if (ranges.size() > 1) {
+				matched.erase(std::remove_if(matched.begin(), matched.end(), [this, &ranges](std::uint32_t item) {
+					return !matches(item, ranges);
+				}), matched.end());
+			}
+		}
+
+		LibraryItemTable results;
+		results.reserve(matched.size());
+		for (std::vector< std::uint32_t >::const_iterator i = matched.begin(); i != matched.end(); ++i) {
+			if ((type == Library::Type::All) || (types_[*i] == static_cast< std::uint8_t >(type))) {
+				LibraryItem item = items_[*i];
+				results.add(item.id(), item.title(), item.uri(), item.thumbnailFile());
+			}
+		}
+
+		if (!query.empty()) {
+			if (history_.size() == history_size) {
+				history_.erase(history_.begin());
+			}
+
+			Step step = {query, std::move(matched)};
+			history_.push_back(std::move(step));
+		}
+
+		return results;
+	}
+
+	LibrarySearch::LibrarySearch(Library & library)
+		: p(new LibrarySearchPrivate(library)) {}
+
+	LibrarySearch::~LibrarySearch() {
+		delete p;
+	}
+
+	/*
+		Returns the items of the given type with words in their title or album starting with each word of the term, in
+		the order they are listed
+	*/
+	LibraryItemTable LibrarySearch::search(Library::Type type, std::string const & term) {
+		return p->search(type, term);
+	}
+}
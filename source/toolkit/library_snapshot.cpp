@@ -0,0 +1,234 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <debug.hpp>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+}
+
+#include "library_snapshot.hpp"
+
+namespace {
+	char const magic[8] = {'M', 'P', 'L', 'I', 'B', 'S', 'N', 'P'};
+	std::uint32_t const format(2);
+
+	std::uint32_t const type_movies(1);
+	std::uint32_t const type_music(2);
+}
+
+namespace toolkit {
+	/*
+		Returns a random number to tell a newly created database apart from any it replaced, whose generations start
+		from the same place
+	*/
+	std::int64_t snapshot::epoch() {
+		std::random_device device;
+		return static_cast< std::int64_t >(((static_cast< std::uint64_t >(device()) << 32) | device()) >> 1);
+	}
+
+	LibrarySnapshot::LibrarySnapshot(std::string const & path)
+		: data_(nullptr), size_(0), header_(nullptr), records_(nullptr), strings_(nullptr) {
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return;
+		}
+
+		struct stat status;
+		if ((fstat(fd, &status) != 0) || (static_cast< std::size_t >(status.st_size) < sizeof(snapshot::Header))) {
+			close(fd);
+			return;
+		}
+
+		void * data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+
+		if (data == MAP_FAILED) {
+			return;
+		}
+
+		data_ = data;
+		size_ = status.st_size;
+
+		snapshot::Header const * header = static_cast< snapshot::Header const * >(data_);
+		if ((std::memcmp(header->magic, magic, sizeof(magic)) != 0) || (header->format != format) ||
+		        (header->record_size != sizeof(snapshot::Record))) {
+			dprint("Ignoring snapshot %s in an unknown format", path.c_str());
+			return;
+		}
+
+		unsigned long long records_size = header->count * sizeof(snapshot::Record);
+		if ((header->count > size_ / sizeof(snapshot::Record)) ||
+		        (sizeof(snapshot::Header) + records_size + header->strings_size != size_)) {
+			dprint("Ignoring truncated snapshot %s", path.c_str());
+			return;
+		}
+
+		header_ = header;
+		records_ = reinterpret_cast< snapshot::Record const * >(static_cast< char const * >(data_) + sizeof(snapshot::Header));
+		strings_ = reinterpret_cast< char const * >(records_ + header_->count);
+	}
+
+	LibrarySnapshot::~LibrarySnapshot() {
+		if (data_ != nullptr) {
+			munmap(data_, size_);
+		}
+	}
+
+	/*
+		Indicates whether the snapshot was mapped and has a recognised format
+	*/
+	bool LibrarySnapshot::valid() const {
+		return header_ != nullptr;
+	}
+
+	/*
+		Returns the generation of the library database the snapshot was taken from
+	*/
+	long long LibrarySnapshot::generation() const {
+		return header_ == nullptr ? -1 : header_->generation;
+	}
+
+	/*
+		Returns the identity of the databases the snapshot was taken from, as generations are only comparable between
+		snapshots of the same ones
+	*/
+	unsigned long long LibrarySnapshot::identity() const {
+		return header_ == nullptr ? 0 : header_->identity;
+	}
+
+	/*
+		Returns the number of items in the snapshot
+	*/
+	unsigned long long LibrarySnapshot::size() const {
+		return header_ == nullptr ? 0 : header_->count;
+	}
+
+	/*
+		Returns the items of the given type, in the same order as Library::list
+	*/
+	LibraryItemTable LibrarySnapshot::list(Library::Type type) const {
+		LibraryItemTable items;
+		if (header_ == nullptr) {
+			return items;
+		}
+
+		std::uint32_t wanted = 0;
+		switch (type) {
+		case Library::Type::All:
+			items.reserve(header_->count);
+			break;
+		case Library::Type::Movies:
+			wanted = type_movies;
+			break;
+		case Library::Type::Music:
+			wanted = type_music;
+			break;
+		}
+
+		for (snapshot::Record const * record = records_; record != records_ + header_->count; ++record) {
+			if ((wanted != 0) && (record->type != wanted)) {
+				continue;
+			}
+
+			if ((record->title + static_cast< unsigned long long >(record->title_length) > header_->strings_size) ||
+			        (record->uri + static_cast< unsigned long long >(record->uri_length) > header_->strings_size) ||
+			        (record->thumbnail + static_cast< unsigned long long >(record->thumbnail_length) > header_->strings_size)) {
+				continue;
+			}
+
+			items.add(record->id, std::string(strings_ + record->title, record->title_length),
+			          std::string(strings_ + record->uri, record->uri_length),
+			          std::string(strings_ + record->thumbnail, record->thumbnail_length));
+		}
+
+		return items;
+	}
+
+	/*
+		Appends a string to the string table
+	*/
+	void LibrarySnapshotWriter::add_string(std::string const & text, std::uint32_t & offset, std::uint32_t & length) {
+		offset = strings_.size();
+		length = text.size();
+		strings_.append(text);
+	}
+
+	/*
+		Adds an item to the snapshot, items must be added in the order they should be listed
+	*/
+	void LibrarySnapshotWriter::add(long long id, Library::Type type, std::string const & title, std::string const & uri,
+	                                std::string const & thumbnail_file) {
+		snapshot::Record record;
+		std::memset(&record, 0, sizeof(record));
+
+		record.id = id;
+		record.type = type == Library::Type::Movies ? type_movies : type_music;
+		add_string(title, record.title, record.title_length);
+		add_string(uri, record.uri, record.uri_length);
+		add_string(thumbnail_file, record.thumbnail, record.thumbnail_length);
+
+		records_.push_back(record);
+	}
+
+	/*
+		Writes the snapshot, replacing any existing file atomically
+	*/
+	bool LibrarySnapshotWriter::write(std::string const & path, long long generation, unsigned long long identity) const {
+		if (strings_.size() > UINT32_MAX) {
+			// Offsets into the string table wouldn't fit in the records
+			return false;
+		}
+
+		snapshot::Header header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, magic, sizeof(magic));
+		header.format = format;
+		header.record_size = sizeof(snapshot::Record);
+		header.generation = generation;
+		header.identity = identity;
+		header.count = records_.size();
+		header.strings_size = strings_.size();
+
+		std::string temporary = path + ".tmp";
+		std::FILE * file = std::fopen(temporary.c_str(), "wb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+		if (!records_.empty()) {
+			written = written && (std::fwrite(&records_[0], sizeof(snapshot::Record), records_.size(), file) == records_.size());
+		}
+		written = written && (std::fwrite(strings_.data(), 1, strings_.size(), file) == strings_.size());
+		written = (std::fclose(file) == 0) && written;
+
+		if (!written || (std::rename(temporary.c_str(), path.c_str()) != 0)) {
+			std::remove(temporary.c_str());
+			return false;
+		}
+
+		dprint("Wrote snapshot of %zu items", records_.size());
+		return true;
+	}
+}
@@ -0,0 +1,103 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _LIBRARY_SNAPSHOT_HPP
+#define _LIBRARY_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <core/noncopiable.hpp>
+#include <toolkit/library.hpp>
+
+namespace toolkit {
+	namespace snapshot {
+		/*
+			Start of a snapshot file, followed by the records and then the string table
+		*/
+		struct Header {
+			char magic[8];
+			std::uint32_t format;
+			std::uint32_t record_size;
+			std::int64_t generation;
+			std::uint64_t identity;
+			std::uint64_t count;
+			std::uint64_t strings_size;
+		};
+
+		std::int64_t epoch();
+
+		/*
+			A single item, with its strings stored as offsets into the string table
+		*/
+		struct Record {
+			std::int64_t id;
+			std::uint32_t type;
+			std::uint32_t title;
+			std::uint32_t title_length;
+			std::uint32_t uri;
+			std::uint32_t uri_length;
+			std::uint32_t thumbnail;
+			std::uint32_t thumbnail_length;
+			std::uint32_t padding;
+		};
+	}
+
+	/*
+		A read-only, memory mapped copy of the library's items used to show the library without querying it
+	*/
+	class LibrarySnapshot
+			: core::NonCopiable {
+		void * data_;
+		std::size_t size_;
+
+		snapshot::Header const * header_;
+		snapshot::Record const * records_;
+		char const * strings_;
+
+	public:
+		LibrarySnapshot(std::string const & path);
+		~LibrarySnapshot();
+
+		bool valid() const;
+
+		long long generation() const;
+		unsigned long long identity() const;
+		unsigned long long size() const;
+
+		LibraryItemTable list(Library::Type type) const;
+	};
+
+	/*
+		Builds a snapshot file from the library's items
+	*/
+	class LibrarySnapshotWriter
+			: core::NonCopiable {
+		std::vector< snapshot::Record > records_;
+		std::string strings_;
+
+		void add_string(std::string const & text, std::uint32_t & offset, std::uint32_t & length);
+
+	public:
+		void add(long long id, Library::Type type, std::string const & title, std::string const & uri,
+		         std::string const & thumbnail_file);
+
+		bool write(std::string const & path, long long generation, unsigned long long identity) const;
+	};
+}
+
+#endif
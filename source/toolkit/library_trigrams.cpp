@@ -0,0 +1,271 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <limits>
+#include <debug.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "library_trigrams.hpp"
+
+namespace {
+	/*
+		Candidates kept for scoring per result asked for, chosen by trigram overlap
+	*/
+	std::size_t const candidates_per_result(32);
+
+	/*
+		Returns the number of trigram bits shared by two bitsets
+	*/
+	inline unsigned int overlap(toolkit::trigrams::Bitset const & x, toolkit::trigrams::Bitset const & y) {
+#ifdef __SSE2__
+		// Count the bits of both halves at once, a byte at a time
+		__m128i const m1 = _mm_set1_epi8(0x55);
+		__m128i const m2 = _mm_set1_epi8(0x33);
+		__m128i const m4 = _mm_set1_epi8(0x0F);
+
+		__m128i total = _mm_setzero_si128();
+		for (unsigned int i = 0; i < 4; i += 2) {
+			__m128i v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast< __m128i const * >(&x.words[i])),
+			                          _mm_loadu_si128(reinterpret_cast< __m128i const * >(&y.words[i])));
+			v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+			v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+			v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), m4);
+			total = _mm_add_epi64(total, _mm_sad_epu8(v, _mm_setzero_si128()));
+		}
+
+		return _mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(total, total));
+#else
+		unsigned int count = 0;
+		for (unsigned int i = 0; i < 4; ++i) {
+			count += __builtin_popcountll(x.words[i] & y.words[i]);
+		}
+
+		return count;
+#endif
+	}
+
+	/*
+		Returns the fewest edits needed to turn the pattern into any part of the text
+	*/
+	unsigned int substring_distance(std::string const & pattern, char const * text) {
+		std::vector< unsigned int > column(pattern.size() + 1);
+		for (std::size_t i = 0; i < column.size(); ++i) {
+			column[i] = i;
+		}
+
+		unsigned int best = column.back();
+		for (char const * c = text; *c != '\0'; ++c) {
+			// A match may start anywhere in the text
+			unsigned int diagonal = 0;
+			column[0] = 0;
+
+			for (std::size_t i = 1; i < column.size(); ++i) {
+				unsigned int above = column[i];
+				column[i] = std::min(std::min(column[i] + 1, column[i - 1] + 1),
+				                     diagonal + (pattern[i - 1] == *c ? 0 : 1));
+				diagonal = above;
+			}
+
+			best = std::min(best, column.back());
+			if (best == 0) {
+				break;
+			}
+		}
+
+		return best;
+	}
+
+	/*
+		A candidate item and how closely it matched
+	*/
+	struct Match {
+		std::size_t index;
+		unsigned int overlap;
+		unsigned int distance;
+	};
+}
+
+namespace toolkit {
+	namespace trigrams {
+		/*
+			Lower cases ASCII letters and separates words with single spaces, including one at either end
+		*/
+		std::string normalise(std::string const & text) {
+			std::string normalised(1, ' ');
+			normalised.reserve(text.size() + 2);
+
+			for (std::string::const_iterator i = text.begin(); i != text.end(); ++i) {
+				unsigned char c = *i;
+				if ((c >= 'A') && (c <= 'Z')) {
+					normalised.push_back(c - 'A' + 'a');
+				} else if (((c >= 'a') && (c <= 'z')) || ((c >= '0') && (c <= '9')) || (c >= 0x80)) {
+					normalised.push_back(c);
+				} else if (normalised[normalised.size() - 1] != ' ') {
+					normalised.push_back(' ');
+				}
+			}
+
+			if (normalised[normalised.size() - 1] != ' ') {
+				normalised.push_back(' ');
+			}
+
+			return normalised;
+		}
+
+		/*
+			Sets the bit for each trigram of a normalised string
+		*/
+		Bitset bitset(std::string const & normalised) {
+			Bitset bits = {{0, 0, 0, 0}};
+
+			for (std::size_t i = 0; i + 3 <= normalised.size(); ++i) {
+				std::uint32_t trigram = (static_cast< unsigned char >(normalised[i]) << 16) |
+				                        (static_cast< unsigned char >(normalised[i + 1]) << 8) |
+				                        static_cast< unsigned char >(normalised[i + 2]);
+				std::uint32_t bit = (trigram * 0x9E3779B1u) >> 24;
+				bits.words[bit >> 6] |= std::uint64_t(1) << (bit & 63);
+			}
+
+			return bits;
+		}
+	}
+
+	LibraryTrigramIndex::LibraryTrigramIndex()
+		: generation_(-1) {}
+
+	/*
+		Returns the generation of the library the index was built from
+	*/
+	long long LibraryTrigramIndex::generation() const {
+		return generation_;
+	}
+
+	/*
+		Records the generation of the library the index was built from
+	*/
+	void LibraryTrigramIndex::setGeneration(long long generation) {
+		generation_ = generation;
+	}
+
+	/*
+		Reserves space for the given number of items
+	*/
+	void LibraryTrigramIndex::reserve(std::size_t size) {
+		items_.reserve(size);
+		types_.reserve(size);
+		bitsets_.reserve(size);
+		texts_.reserve(size);
+	}
+
+	/*
+		Adds an item to the index, its title and album being the text searched
+	*/
+	void LibraryTrigramIndex::add(long long id, Library::Type type, std::string const & title, std::string const & album,
+	                              std::string const & uri, std::string const & thumbnail_file) {
+		std::string normalised = trigrams::normalise(album.empty() ? title : title + " " + album);
+
+		items_.add(id, title, uri, thumbnail_file);
+		types_.push_back(static_cast< std::uint8_t >(type));
+		bitsets_.push_back(trigrams::bitset(normalised));
+
+		assert(strings_.size() + normalised.size() < std::numeric_limits< std::uint32_t >::max());
+		texts_.push_back(strings_.size());
+		strings_.append(normalised);
+		strings_.push_back('\0');
+	}
+
+	/*
+		Returns up to limit items whose title or album is within a few edits of the term, closest first
+	*/
+	LibraryItemTable LibraryTrigramIndex::search(Library::Type type, std::string const & term, unsigned int limit) const {
+		LibraryItemTable results;
+
+		// Match against the words alone, without the padding at either end
+		std::string normalised = trigrams::normalise(term);
+		std::string pattern = normalised.substr(1, normalised.size() > 2 ? normalised.size() - 2 : 0);
+		if (pattern.empty() || (limit == 0)) {
+			return results;
+		}
+
+		unsigned int allowed = pattern.size() / 4;
+
+		/*
+			Each edit can break at most three trigrams of the term and a match inside a word loses the two padded at
+			its ends, any item sharing fewer trigram bits than that cannot be close enough
+		*/
+		trigrams::Bitset query = trigrams::bitset(normalised);
+		unsigned int query_bits = overlap(query, query);
+		unsigned int required = query_bits > 3 * allowed + 2 ? query_bits - 3 * allowed - 2 : 1;
+
+		std::vector< Match > candidates;
+		for (std::size_t i = 0; i < bitsets_.size(); ++i) {
+			if ((type != Library::Type::All) && (types_[i] != static_cast< std::uint8_t >(type))) {
+				continue;
+			}
+
+			unsigned int shared = overlap(query, bitsets_[i]);
+			if (shared >= required) {
+				Match candidate = {i, shared, 0};
+				candidates.push_back(candidate);
+			}
+		}
+
+		// Only the closest candidates by trigrams are worth the edit distance
+		std::size_t kept = std::min< std::size_t >(candidates.size(), candidates_per_result * limit);
+		std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(),
+		[](Match const & x, Match const & y) {
+			return (x.overlap > y.overlap) || ((x.overlap == y.overlap) && (x.index < y.index));
+		});
+		candidates.resize(kept);
+
+		std::vector< Match > matches;
+		for (std::vector< Match >::iterator i = candidates.begin(); i != candidates.end(); ++i) {
+			i->distance = substring_distance(pattern, &strings_[texts_[i->index]]);
+			if (i->distance <= allowed) {
+				matches.push_back(*i);
+			}
+		}
+
+		std::sort(matches.begin(), matches.end(), [](Match const & x, Match const & y) {
+			if (x.distance != y.distance) {
+				return x.distance < y.distance;
+			}
+
+			if (x.overlap != y.overlap) {
+				return x.overlap > y.overlap;
+			}
+
+			return x.index < y.index;
+		});
+
+		if (matches.size() > limit) {
+			matches.resize(limit);
+		}
+
+		results.reserve(matches.size());
+		for (std::vector< Match >::const_iterator i = matches.begin(); i != matches.end(); ++i) {
+			LibraryItem item = items_[i->index];
+			results.add(item.id(), item.title(), item.uri(), item.thumbnailFile());
+		}
+
+		return results;
+	}
+}
@@ -0,0 +1,69 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _LIBRARY_TRIGRAMS_HPP
+#define _LIBRARY_TRIGRAMS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <core/noncopiable.hpp>
+#include <toolkit/library.hpp>
+
+namespace toolkit {
+	namespace trigrams {
+		/*
+			The trigrams of a string, each hashed to one of 256 bits
+		*/
+		struct Bitset {
+			std::uint64_t words[4];
+		};
+
+		std::string normalise(std::string const & text);
+		Bitset bitset(std::string const & normalised);
+	}
+
+	/*
+		An in-memory index of the library's titles and albums for finding items despite spelling mistakes
+	*/
+	class LibraryTrigramIndex
+			: core::NonCopiable {
+		long long generation_;
+
+		LibraryItemTable items_;
+		std::vector< std::uint8_t > types_;
+		std::vector< trigrams::Bitset > bitsets_;
+
+		// Normalised title and album of each item
+		std::vector< std::uint32_t > texts_;
+		std::string strings_;
+
+	public:
+		LibraryTrigramIndex();
+
+		long long generation() const;
+		void setGeneration(long long generation);
+
+		void reserve(std::size_t size);
+		void add(long long id, Library::Type type, std::string const & title, std::string const & album,
+		         std::string const & uri, std::string const & thumbnail_file);
+
+		LibraryItemTable search(Library::Type type, std::string const & term, unsigned int limit) const;
+	};
+}
+
+#endif
@@ -0,0 +1,589 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+#include <debug.hpp>
+#include <core/filesystem.hpp>
+
+#include "library_snapshot.hpp"
+#include "library_volume.hpp"
+#include "media_details_private.hpp"
+
+namespace {
+	long long const volume_version(6);
+}
+
+namespace toolkit {
+	/*
+		Sets up a volume's database after it has been attached under the given ID, creating its tables if it hasn't been
+		used before
+	*/
+	LibraryVolume::LibraryVolume(core::Database & database, std::string name, long long id, std::string root)
+		: database_(database), name_(std::move(name)), schema_("volume_" + std::to_string(id)), root_(std::move(root)),
+		  id_(id), epoch_(0), add_stmt_(nullptr), update_stmt_(nullptr), album_stmt_(nullptr), add_album_stmt_(nullptr),
+		  add_file_stmt_(nullptr), canonical_stmt_(nullptr), files_stmt_(nullptr), file_item_stmt_(nullptr),
+		  remove_file_stmt_(nullptr), relink_item_stmt_(nullptr), copies_stmt_(nullptr), set_path_stmt_(nullptr),
+		  remove_item_stmt_(nullptr), add_play_stmt_(nullptr), update_play_stmt_(nullptr), statistics_stmt_(nullptr) {
+		core::Statement check_version(database_, "SELECT version FROM " + schema_ + ".version");
+		if (!check_version.valid()) {
+			// A drive that hasn't been indexed yet
+			initialise_db();
+		} else {
+			check_version.execute();
+			if (check_version.toInteger(0u) != volume_version) {
+				dprint("Old volume database found for %s", name_.c_str());
+				check_version.reset();
+				initialise_db();
+			}
+		}
+
+		core::Statement epoch(database_, "SELECT epoch FROM " + schema_ + ".version");
+		assert(epoch.valid());
+		epoch.execute();
+		epoch_ = epoch.toInteger(0u);
+	}
+
+	LibraryVolume::~LibraryVolume() {
+		delete add_stmt_;
+		delete update_stmt_;
+		delete album_stmt_;
+		delete add_album_stmt_;
+		delete add_file_stmt_;
+		delete canonical_stmt_;
+		delete files_stmt_;
+		delete file_item_stmt_;
+		delete remove_file_stmt_;
+		delete relink_item_stmt_;
+		delete copies_stmt_;
+		delete set_path_stmt_;
+		delete remove_item_stmt_;
+		delete add_play_stmt_;
+		delete update_play_stmt_;
+		delete statistics_stmt_;
+	}
+
+	/*
+		Creates the tables of a volume database, along with the triggers keeping its counts and generation up to date. The
+		state of the drive's files and the play statistics of its items are kept on the drive with them.
+	*/
+	void LibraryVolume::initialise_db() {
+		dprint("Creating volume database for %s", name_.c_str());
+
+		std::vector< std::string > names;
+		{
+			core::Statement tables(database_, "SELECT type, name FROM " + schema_ + ".sqlite_master "
+			                       "WHERE type IN ('table', 'trigger') AND name NOT LIKE 'sqlite_%'");
+			assert(tables.valid());
+			tables.execute();
+
+			if (tables.hasData()) {
+				do {
+					names.push_back("DROP " + tables.toText(0u) + " IF EXISTS " + schema_ + "." + tables.toText(1u));
+				} while (tables.nextRow());
+			}
+		}
+
+		for (std::vector< std::string >::const_iterator i = names.begin(); i != names.end(); ++i) {
+			core::Statement drop(database_, *i);
+			drop.execute();
+		}
+
+		std::string const statements[] = {
+			"CREATE TABLE " + schema_ + ".version (version INTEGER PRIMARY KEY, epoch INTEGER NOT NULL)",
+			"INSERT INTO " + schema_ + ".version (version, epoch) VALUES (" + std::to_string(volume_version) + ", " +
+			std::to_string(snapshot::epoch()) + ")",
+			"CREATE TABLE " + schema_ + ".albums "
+			"(album_id INTEGER PRIMARY KEY AUTOINCREMENT, album TEXT NOT NULL, thumbnail TEXT DEFAULT NULL, "
+			"sort_key BLOB)",
+			"CREATE TABLE " + schema_ + ".items "
+			"(item_id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL, path TEXT NOT NULL, "
+			"thumbnail TEXT DEFAULT NULL, album_id INTEGER REFERENCES albums (album_id) ON DELETE SET NULL, "
+			"type_id INTEGER NOT NULL, duration INTEGER DEFAULT NULL, artist TEXT DEFAULT NULL, "
+			"track_number INTEGER DEFAULT NULL, track_count INTEGER DEFAULT NULL, audio_codec TEXT DEFAULT NULL, "
+			"video_codec TEXT DEFAULT NULL, bitrate INTEGER DEFAULT NULL, sample_rate INTEGER DEFAULT NULL, "
+			"channels INTEGER DEFAULT NULL, width INTEGER DEFAULT NULL, height INTEGER DEFAULT NULL, "
+			"frame_rate REAL DEFAULT NULL, added INTEGER NOT NULL DEFAULT (strftime('%s', 'now')), sort_key BLOB)",
+			"CREATE TABLE " + schema_ + ".generation (generation INTEGER NOT NULL)",
+			"INSERT INTO " + schema_ + ".generation (generation) VALUES (0)",
+			"CREATE TABLE " + schema_ + ".type_counts (type_id INTEGER PRIMARY KEY, count INTEGER NOT NULL)",
+			"INSERT INTO " + schema_ + ".type_counts (type_id, count) SELECT type_id, 0 FROM main.types",
+			"CREATE TABLE " + schema_ + ".album_counts "
+			"(album_id INTEGER PRIMARY KEY REFERENCES albums (album_id), count INTEGER NOT NULL)",
+			"CREATE TABLE " + schema_ + ".directory_counts (directory TEXT PRIMARY KEY, count INTEGER NOT NULL)",
+			"CREATE TABLE " + schema_ + ".files "
+			"(path TEXT PRIMARY KEY, device INTEGER NOT NULL, inode INTEGER NOT NULL, size INTEGER NOT NULL, "
+			"modified INTEGER NOT NULL, inspected INTEGER NOT NULL, hash INTEGER DEFAULT NULL, "
+			"item_id REFERENCES items (item_id) ON DELETE SET NULL)",
+			"CREATE TABLE " + schema_ + ".play_stats "
+			"(item_id INTEGER PRIMARY KEY REFERENCES items (item_id) ON DELETE CASCADE, "
+			"plays INTEGER NOT NULL DEFAULT 0, skips INTEGER NOT NULL DEFAULT 0, last_played INTEGER DEFAULT NULL)",
+			"CREATE TABLE " + schema_ + ".collation (name TEXT NOT NULL, position INTEGER)",
+			"INSERT INTO " + schema_ + ".collation (name, position) VALUES ('', NULL)",
+			"CREATE TRIGGER " + schema_ + ".items_insert AFTER INSERT ON items BEGIN "
+			"UPDATE generation SET generation = generation + 1; "
+			"UPDATE type_counts SET count = count + 1 WHERE type_id = NEW.type_id; "
+			"INSERT OR IGNORE INTO album_counts (album_id, count) SELECT NEW.album_id, 0 WHERE NEW.album_id IS NOT NULL; "
+			"UPDATE album_counts SET count = count + 1 WHERE album_id = NEW.album_id; "
+			"INSERT OR IGNORE INTO directory_counts (directory, count) "
+			"VALUES (rtrim(NEW.path, replace(NEW.path, '/', '')), 0); "
+			"UPDATE directory_counts SET count = count + 1 "
+			"WHERE directory = rtrim(NEW.path, replace(NEW.path, '/', '')); END",
+			"CREATE TRIGGER " + schema_ + ".items_update AFTER UPDATE ON items BEGIN "
+			"UPDATE generation SET generation = generation + 1; "
+			"UPDATE type_counts SET count = count - 1 WHERE type_id = OLD.type_id; "
+			"UPDATE type_counts SET count = count + 1 WHERE type_id = NEW.type_id; "
+			"UPDATE album_counts SET count = count - 1 WHERE album_id = OLD.album_id; "
+			"DELETE FROM album_counts WHERE album_id = OLD.album_id AND count = 0; "
+			"INSERT OR IGNORE INTO album_counts (album_id, count) SELECT NEW.album_id, 0 WHERE NEW.album_id IS NOT NULL; "
+			"UPDATE album_counts SET count = count + 1 WHERE album_id = NEW.album_id; "
+			"UPDATE directory_counts SET count = count - 1 "
+			"WHERE directory = rtrim(OLD.path, replace(OLD.path, '/', '')); "
+			"DELETE FROM directory_counts WHERE directory = rtrim(OLD.path, replace(OLD.path, '/', '')) AND count = 0; "
+			"INSERT OR IGNORE INTO directory_counts (directory, count) "
+			"VALUES (rtrim(NEW.path, replace(NEW.path, '/', '')), 0); "
+			"UPDATE directory_counts SET count = count + 1 "
+			"WHERE directory = rtrim(NEW.path, replace(NEW.path, '/', '')); END",
+			"CREATE TRIGGER " + schema_ + ".items_delete AFTER DELETE ON items BEGIN "
+			"UPDATE generation SET generation = generation + 1; "
+			"UPDATE type_counts SET count = count - 1 WHERE type_id = OLD.type_id; "
+			"UPDATE album_counts SET count = count - 1 WHERE album_id = OLD.album_id; "
+			"DELETE FROM album_counts WHERE album_id = OLD.album_id AND count = 0; "
+			"UPDATE directory_counts SET count = count - 1 "
+			"WHERE directory = rtrim(OLD.path, replace(OLD.path, '/', '')); "
+			"DELETE FROM directory_counts WHERE directory = rtrim(OLD.path, replace(OLD.path, '/', '')) AND count = 0; "
+			"END",
+			"CREATE TRIGGER " + schema_ + ".items_delete_play_stats AFTER DELETE ON items BEGIN "
+			"DELETE FROM play_stats WHERE item_id = OLD.item_id; END",
+			"CREATE TRIGGER " + schema_ + ".albums_update AFTER UPDATE ON albums BEGIN "
+			"UPDATE generation SET generation = generation + 1; END",
+			"CREATE INDEX " + schema_ + ".items_path ON items (path)",
+			"CREATE INDEX " + schema_ + ".items_type ON items (type_id)",
+			"CREATE INDEX " + schema_ + ".items_album ON items (album_id)",
+			"CREATE INDEX " + schema_ + ".albums_album ON albums (album)",
+			"CREATE INDEX " + schema_ + ".items_sort ON items (sort_key)",
+			"CREATE INDEX " + schema_ + ".files_hash ON files (hash)",
+			"CREATE INDEX " + schema_ + ".files_item ON files (item_id)",
+			"CREATE INDEX " + schema_ + ".play_stats_plays ON play_stats (plays)",
+			"CREATE INDEX " + schema_ + ".play_stats_last_played ON play_stats (last_played)"
+		};
+
+		for (unsigned int i = 0; i < sizeof(statements) / sizeof(statements[0]); ++i) {
+			core::Statement statement(database_, statements[i]);
+			assert(statement.valid());
+			statement.execute();
+		}
+	}
+
+	/*
+		Finds the album on the volume with the given name, adding it with the given sort key if there isn't one
+	*/
+	long long LibraryVolume::album_id(std::string const & album, std::vector< unsigned char > const & sort_key) {
+		if (album_stmt_ == nullptr) {
+			album_stmt_ = new core::Statement(database_, "SELECT album_id FROM " + schema_ + ".albums WHERE album = ?");
+			add_album_stmt_ = new core::Statement(database_, "INSERT INTO " + schema_ + ".albums (album, sort_key) VALUES (?, ?)");
+		}
+
+		assert(album_stmt_->valid());
+		assert(add_album_stmt_->valid());
+
+		album_stmt_->reset();
+		album_stmt_->bind(1u, album);
+		album_stmt_->execute();
+		if (album_stmt_->hasData()) {
+			long long id = album_stmt_->toInteger(0u);
+			album_stmt_->reset();
+			return id;
+		}
+
+		add_album_stmt_->reset();
+		add_album_stmt_->bind(1u, album);
+		add_album_stmt_->bind(2u, sort_key);
+		add_album_stmt_->execute();
+		return database_.lastInsertId();
+	}
+
+	/*
+		Returns the name the volume was attached with
+	*/
+	std::string LibraryVolume::name() const {
+		return name_;
+	}
+
+	/*
+		Returns the name the volume's database is attached under
+	*/
+	std::string LibraryVolume::schema() const {
+		return schema_;
+	}
+
+	/*
+		Returns the URI the drive is mounted at, which item paths are relative to
+	*/
+	std::string LibraryVolume::root() const {
+		return root_;
+	}
+
+	/*
+		Returns the ID of the volume, kept in the upper bits of the IDs of its items
+	*/
+	long long LibraryVolume::id() const {
+		return id_;
+	}
+
+	/*
+		Returns the random number chosen when the volume's database was created
+	*/
+	long long LibraryVolume::epoch() const {
+		return epoch_;
+	}
+
+	/*
+		Adds an item to the volume, returning its ID within the library or 0 if it couldn't be added
+	*/
+	long long LibraryVolume::add(std::string const & title, std::string const & path, long long type_id,
+	                             std::string const & thumbnail_file, std::string const & album,
+	                             std::vector< unsigned char > const & sort_key, std::vector< unsigned char > const & album_key,
+	                             MediaDetails const & details) {
+		long long album_row = album.empty() ? 0 : album_id(album, album_key);
+
+		if (add_stmt_ == nullptr) {
+			add_stmt_ = new core::Statement(database_, "INSERT INTO " + schema_ + ".items "
+			                                "(name, path, type_id, thumbnail, album_id, sort_key, " +
+			                                std::string(details_columns) +
+			                                ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+		} else {
+			add_stmt_->reset();
+		}
+
+		add_stmt_->bind(1u, title);
+		add_stmt_->bind(2u, path);
+		add_stmt_->bind(3u, type_id);
+
+		if (thumbnail_file.empty()) {
+			add_stmt_->bind(4u);
+		} else {
+			add_stmt_->bind(4u, thumbnail_file);
+		}
+
+		if (album_row == 0) {
+			add_stmt_->bind(5u);
+		} else {
+			add_stmt_->bind(5u, album_row);
+		}
+
+		add_stmt_->bind(6u, sort_key);
+		bind_details(*add_stmt_, 7u, details);
+
+		assert(add_stmt_->valid());
+		if (!add_stmt_->execute()) {
+			return 0;
+		}
+
+		return (id_ << id_shift) | database_.lastInsertId();
+	}
+
+	/*
+		Replaces what is known about an item on the volume, keeping its ID and play statistics. Returns false if the
+		item isn't on the volume.
+	*/
+	bool LibraryVolume::update(long long item_id, std::string const & title, std::string const & path,
+	                           long long type_id, std::string const & thumbnail_file, std::string const & album,
+	                           std::vector< unsigned char > const & sort_key, std::vector< unsigned char > const & album_key,
+	                           MediaDetails const & details) {
+		if ((item_id >> id_shift) != id_) {
+			return false;
+		}
+
+		long long album_row = album.empty() ? 0 : album_id(album, album_key);
+
+		if (update_stmt_ == nullptr) {
+			update_stmt_ = new core::Statement(database_, "UPDATE " + schema_ + ".items "
+			                                   "SET name = ?, path = ?, type_id = ?, thumbnail = ?, album_id = ?, sort_key = ?, " +
+			                                   std::string(details_assignments) + " WHERE item_id = ?");
+		} else {
+			update_stmt_->reset();
+		}
+
+		update_stmt_->bind(1u, title);
+		update_stmt_->bind(2u, path);
+		update_stmt_->bind(3u, type_id);
+
+		if (thumbnail_file.empty()) {
+			update_stmt_->bind(4u);
+		} else {
+			update_stmt_->bind(4u, thumbnail_file);
+		}
+
+		if (album_row == 0) {
+			update_stmt_->bind(5u);
+		} else {
+			update_stmt_->bind(5u, album_row);
+		}
+
+		update_stmt_->bind(6u, sort_key);
+		bind_details(*update_stmt_, 7u, details);
+		update_stmt_->bind(19u, item_id & id_mask);
+
+		assert(update_stmt_->valid());
+		return update_stmt_->execute() && (database_.changes() > 0);
+	}
+
+	/*
+		Returns a counter that changes whenever the items on the volume change
+	*/
+	long long LibraryVolume::generation() {
+		core::Statement generation(database_, "SELECT generation FROM " + schema_ + ".generation");
+		assert(generation.valid());
+		generation.execute();
+		return generation.toInteger(0u);
+	}
+
+	/*
+		Records the state of a file on the drive, given by its path relative to the root, along with the item created
+		from it
+	*/
+	void LibraryVolume::addFile(LibraryFile const & file, std::string const & path, long long item_id) {
+		if (add_file_stmt_ == nullptr) {
+			add_file_stmt_ = new core::Statement(database_, "INSERT OR REPLACE INTO " + schema_ + ".files "
+			                                     "(path, device, inode, size, modified, inspected, hash, item_id) "
+			                                     "VALUES (?, ?, ?, ?, ?, strftime('%s', 'now'), ?, ?)");
+		} else {
+			add_file_stmt_->reset();
+		}
+
+		add_file_stmt_->bind(1u, path);
+		add_file_stmt_->bind(2u, static_cast< long long >(file.device()));
+		add_file_stmt_->bind(3u, static_cast< long long >(file.inode()));
+		add_file_stmt_->bind(4u, static_cast< long long >(file.size()));
+		add_file_stmt_->bind(5u, file.modified());
+
+		if (file.hash() == 0) {
+			add_file_stmt_->bind(6u);
+		} else {
+			add_file_stmt_->bind(6u, static_cast< long long >(file.hash()));
+		}
+
+		// Only the volume's own items can be referred to from its database
+		if ((item_id >> id_shift) != id_) {
+			add_file_stmt_->bind(7u);
+		} else {
+			add_file_stmt_->bind(7u, item_id & id_mask);
+		}
+
+		assert(add_file_stmt_->valid());
+		add_file_stmt_->execute();
+	}
+
+	/*
+		Finds the item on the drive already created from another copy of the file's contents, or 0 if there isn't one
+	*/
+	long long LibraryVolume::canonicalItem(LibraryFile const & file) {
+		if (canonical_stmt_ == nullptr) {
+			canonical_stmt_ = new core::Statement(database_, "SELECT item_id FROM " + schema_ + ".files "
+			                                      "WHERE hash = ? AND size = ? AND item_id IS NOT NULL LIMIT 1");
+		} else {
+			canonical_stmt_->reset();
+		}
+
+		canonical_stmt_->bind(1u, static_cast< long long >(file.hash()));
+		canonical_stmt_->bind(2u, static_cast< long long >(file.size()));
+
+		assert(canonical_stmt_->valid());
+		canonical_stmt_->execute();
+		return canonical_stmt_->hasData() ? (id_ << id_shift) | canonical_stmt_->toInteger(0u) : 0;
+	}
+
+	/*
+		Returns the recorded state of every file beneath a directory relative to the root, or of every file on the drive
+		if it is empty
+	*/
+	std::vector< LibraryFile > LibraryVolume::files(std::string const & directory) {
+		core::Statement * statement;
+		core::Statement every_file(database_, "SELECT path, device, inode, size, modified FROM " + schema_ + ".files");
+
+		if (directory.empty()) {
+			statement = &every_file;
+		} else {
+			if (files_stmt_ == nullptr) {
+				// Range over the primary key rather than using LIKE so the index is used
+				files_stmt_ = new core::Statement(database_, "SELECT path, device, inode, size, modified FROM " + schema_ +
+				                                  ".files WHERE path > ?1 || '/' AND path < ?1 || '0'");
+			} else {
+				files_stmt_->reset();
+			}
+
+			files_stmt_->bind(1u, directory);
+			statement = files_stmt_;
+		}
+
+		assert(statement->valid());
+		statement->execute();
+
+		std::vector< LibraryFile > files;
+		if (!statement->hasData()) {
+			return files;
+		}
+
+		do {
+			files.emplace_back(core::Path::fromUri(root_ + statement->toText(0u)), statement->toInteger(1u),
+			                   statement->toInteger(2u), statement->toInteger(3u), statement->toInteger(4u));
+		} while (statement->nextRow());
+
+		return files;
+	}
+
+	/*
+		Forgets a file on the drive, pointing its item at another copy or removing it if there are none left. When
+		keep_last is set, the last copy of an item is left alone instead so the item can be updated in place, and the
+		item's ID within the library is returned.
+	*/
+	long long LibraryVolume::removeFile(std::string const & path, bool keep_last) {
+		if (remove_file_stmt_ == nullptr) {
+			file_item_stmt_ = new core::Statement(database_, "SELECT item_id FROM " + schema_ + ".files WHERE path = ?");
+			remove_file_stmt_ = new core::Statement(database_, "DELETE FROM " + schema_ + ".files WHERE path = ?");
+			relink_item_stmt_ = new core::Statement(database_, "SELECT path FROM " + schema_ + ".files "
+			                                        "WHERE item_id = ? LIMIT 1");
+			set_path_stmt_ = new core::Statement(database_, "UPDATE " + schema_ + ".items SET path = ? WHERE item_id = ?");
+			copies_stmt_ = new core::Statement(database_, "SELECT 1 FROM " + schema_ + ".files "
+			                                   "WHERE item_id = ? AND path != ? LIMIT 1");
+		}
+
+		assert(file_item_stmt_->valid());
+		assert(remove_file_stmt_->valid());
+		assert(relink_item_stmt_->valid());
+		assert(set_path_stmt_->valid());
+		assert(copies_stmt_->valid());
+
+		file_item_stmt_->reset();
+		file_item_stmt_->bind(1u, path);
+		file_item_stmt_->execute();
+		long long item_id = file_item_stmt_->hasData() ? file_item_stmt_->toInteger(0u) : 0;
+		file_item_stmt_->reset();
+
+		if (keep_last && (item_id != 0)) {
+			copies_stmt_->reset();
+			copies_stmt_->bind(1u, item_id);
+			copies_stmt_->bind(2u, path);
+			copies_stmt_->execute();
+			bool copied = copies_stmt_->hasData();
+			copies_stmt_->reset();
+
+			if (!copied) {
+				return (id_ << id_shift) | item_id;
+			}
+		}
+
+		remove_file_stmt_->reset();
+		remove_file_stmt_->bind(1u, path);
+		remove_file_stmt_->execute();
+
+		if (item_id == 0) {
+			return 0;
+		}
+
+		relink_item_stmt_->reset();
+		relink_item_stmt_->bind(1u, item_id);
+		relink_item_stmt_->execute();
+
+		if (relink_item_stmt_->hasData()) {
+			// Another copy of the file remains, point the item at it instead
+			set_path_stmt_->reset();
+			set_path_stmt_->bind(1u, relink_item_stmt_->toText(0u));
+			set_path_stmt_->bind(2u, item_id);
+			set_path_stmt_->execute();
+		} else {
+			removeItem((id_ << id_shift) | item_id);
+		}
+
+		relink_item_stmt_->reset();
+		return 0;
+	}
+
+	/*
+		Removes an item from the drive unless a file is still recorded for it
+	*/
+	void LibraryVolume::removeItem(long long item_id) {
+		if (remove_item_stmt_ == nullptr) {
+			remove_item_stmt_ = new core::Statement(database_, "DELETE FROM " + schema_ + ".items WHERE item_id = ?1 "
+			                                        "AND NOT EXISTS (SELECT 1 FROM " + schema_ + ".files WHERE item_id = ?1)");
+		} else {
+			remove_item_stmt_->reset();
+		}
+
+		assert(remove_item_stmt_->valid());
+		remove_item_stmt_->bind(1u, item_id & id_mask);
+		remove_item_stmt_->execute();
+	}
+
+	/*
+		Adds a play or skip to the statistics of the item at a path relative to the root, returning false if there is
+		no item there
+	*/
+	bool LibraryVolume::addPlay(std::string const & path, LibraryPlay const & play) {
+		if (add_play_stmt_ == nullptr) {
+			add_play_stmt_ = new core::Statement(database_, "INSERT OR IGNORE INTO " + schema_ + ".play_stats (item_id) "
+			                                     "SELECT item_id FROM " + schema_ + ".items WHERE path = ?");
+			update_play_stmt_ = new core::Statement(database_, "UPDATE " + schema_ + ".play_stats "
+			                                        "SET plays = plays + ?1, skips = skips + ?2, "
+			                                        "last_played = CASE WHEN ?1 > 0 THEN max(IFNULL(last_played, 0), ?3) ELSE last_played END "
+			                                        "WHERE item_id IN (SELECT item_id FROM " + schema_ + ".items WHERE path = ?4)");
+		} else {
+			add_play_stmt_->reset();
+			update_play_stmt_->reset();
+		}
+
+		assert(add_play_stmt_->valid());
+		assert(update_play_stmt_->valid());
+
+		add_play_stmt_->bind(1u, path);
+		add_play_stmt_->execute();
+
+		update_play_stmt_->bind(1u, play.skipped() ? 0LL : 1LL);
+		update_play_stmt_->bind(2u, play.skipped() ? 1LL : 0LL);
+		update_play_stmt_->bind(3u, play.time());
+		update_play_stmt_->bind(4u, path);
+		update_play_stmt_->execute();
+
+		return database_.changes() > 0;
+	}
+
+	/*
+		Returns the play statistics of an item on the drive
+	*/
+	LibraryPlayStatistics LibraryVolume::statistics(long long item_id) {
+		if (statistics_stmt_ == nullptr) {
+			statistics_stmt_ = new core::Statement(database_, "SELECT plays, skips, IFNULL(last_played, 0) FROM " + schema_ +
+			                                       ".play_stats WHERE item_id = ?");
+		} else {
+			statistics_stmt_->reset();
+		}
+
+		statistics_stmt_->bind(1u, item_id & id_mask);
+
+		assert(statistics_stmt_->valid());
+		statistics_stmt_->execute();
+		if (!statistics_stmt_->hasData()) {
+			return LibraryPlayStatistics();
+		}
+
+		LibraryPlayStatistics statistics(statistics_stmt_->toInteger(0u), statistics_stmt_->toInteger(1u),
+		                                 statistics_stmt_->toInteger(2u));
+		statistics_stmt_->reset();
+
+		return statistics;
+	}
+}
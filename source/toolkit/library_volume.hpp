@@ -0,0 +1,99 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _LIBRARY_VOLUME_HPP
+#define _LIBRARY_VOLUME_HPP
+
+#include <string>
+#include <vector>
+#include <core/database.hpp>
+#include <core/noncopiable.hpp>
+#include <toolkit/library.hpp>
+#include <toolkit/media_details.hpp>
+
+namespace toolkit {
+	/*
+		A database holding the items on one removable drive, attached to the library while the drive is mounted. Item
+		URIs are stored relative to where the drive is mounted, and item IDs are given the volume's ID in their upper
+		bits so they don't clash with those in the library or on other drives.
+	*/
+	class LibraryVolume
+			: core::NonCopiable {
+		core::Database & database_;
+
+		std::string name_;
+		std::string schema_;
+		std::string root_;
+		long long id_;
+		long long epoch_;
+
+		core::Statement * add_stmt_;
+		core::Statement * update_stmt_;
+		core::Statement * album_stmt_;
+		core::Statement * add_album_stmt_;
+		core::Statement * add_file_stmt_;
+		core::Statement * canonical_stmt_;
+		core::Statement * files_stmt_;
+		core::Statement * file_item_stmt_;
+		core::Statement * remove_file_stmt_;
+		core::Statement * relink_item_stmt_;
+		core::Statement * copies_stmt_;
+		core::Statement * set_path_stmt_;
+		core::Statement * remove_item_stmt_;
+		core::Statement * add_play_stmt_;
+		core::Statement * update_play_stmt_;
+		core::Statement * statistics_stmt_;
+
+		void initialise_db();
+
+		long long album_id(std::string const & album, std::vector< unsigned char > const & sort_key);
+
+	public:
+		static unsigned int const id_shift = 40;
+		static long long const id_mask = (1LL << id_shift) - 1;
+
+		LibraryVolume(core::Database & database, std::string name, long long id, std::string root);
+		~LibraryVolume();
+
+		std::string name() const;
+		std::string schema() const;
+		std::string root() const;
+		long long id() const;
+		long long epoch() const;
+
+		long long add(std::string const & title, std::string const & path, long long type_id,
+		              std::string const & thumbnail_file, std::string const & album,
+		              std::vector< unsigned char > const & sort_key, std::vector< unsigned char > const & album_key,
+		              MediaDetails const & details);
+		bool update(long long item_id, std::string const & title, std::string const & path, long long type_id,
+		            std::string const & thumbnail_file, std::string const & album,
+		            std::vector< unsigned char > const & sort_key, std::vector< unsigned char > const & album_key,
+		            MediaDetails const & details);
+		long long generation();
+
+		void addFile(LibraryFile const & file, std::string const & path, long long item_id);
+		long long canonicalItem(LibraryFile const & file);
+		std::vector< LibraryFile > files(std::string const & directory);
+		long long removeFile(std::string const & path, bool keep_last = false);
+		void removeItem(long long item_id);
+
+		bool addPlay(std::string const & path, LibraryPlay const & play);
+		LibraryPlayStatistics statistics(long long item_id);
+	};
+}
+
+#endif
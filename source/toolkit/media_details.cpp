@@ -0,0 +1,232 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <utility>
+#include <toolkit/media_details.hpp>
+
+#include "media_details_private.hpp"
+
+namespace {
+	/*
+		Binds a number to a parameter, or NULL if it isn't known
+	*/
+	void bind_known(core::Statement const & statement, unsigned int index, long long value) {
+		if (value == 0) {
+			statement.bind(index);
+		} else {
+			statement.bind(index, value);
+		}
+	}
+
+	/*
+		Binds text to a parameter, or NULL if it isn't known
+	*/
+	void bind_known(core::Statement const & statement, unsigned int index, std::string const & value) {
+		if (value.empty()) {
+			statement.bind(index);
+		} else {
+			statement.bind(index, value);
+		}
+	}
+}
+
+namespace toolkit {
+	MediaDetails::MediaDetails()
+		: duration_(0), track_number_(0), track_count_(0), bitrate_(0), sample_rate_(0), channels_(0), width_(0),
+		  height_(0), frame_rate_(0) {}
+
+	/*
+		Returns the length of the source in milliseconds
+	*/
+	long long MediaDetails::duration() const {
+		return duration_;
+	}
+
+	void MediaDetails::setDuration(long long duration) {
+		duration_ = duration;
+	}
+
+	/*
+		Returns the performer of the track
+	*/
+	std::string MediaDetails::artist() const {
+		return artist_;
+	}
+
+	void MediaDetails::setArtist(std::string artist) {
+		artist_ = std::move(artist);
+	}
+
+	/*
+		Returns the position of the track on its album, counting from 1
+	*/
+	unsigned int MediaDetails::trackNumber() const {
+		return track_number_;
+	}
+
+	void MediaDetails::setTrackNumber(unsigned int track_number) {
+		track_number_ = track_number;
+	}
+
+	/*
+		Returns the number of tracks on the album
+	*/
+	unsigned int MediaDetails::trackCount() const {
+		return track_count_;
+	}
+
+	void MediaDetails::setTrackCount(unsigned int track_count) {
+		track_count_ = track_count;
+	}
+
+	/*
+		Returns a description of the codec of the audio stream
+	*/
+	std::string MediaDetails::audioCodec() const {
+		return audio_codec_;
+	}
+
+	void MediaDetails::setAudioCodec(std::string codec) {
+		audio_codec_ = std::move(codec);
+	}
+
+	/*
+		Returns a description of the codec of the video stream
+	*/
+	std::string MediaDetails::videoCodec() const {
+		return video_codec_;
+	}
+
+	void MediaDetails::setVideoCodec(std::string codec) {
+		video_codec_ = std::move(codec);
+	}
+
+	/*
+		Returns the bitrate of the source in bits per second, or the nominal bitrate if it varies
+	*/
+	unsigned int MediaDetails::bitrate() const {
+		return bitrate_;
+	}
+
+	void MediaDetails::setBitrate(unsigned int bitrate) {
+		bitrate_ = bitrate;
+	}
+
+	/*
+		Returns the number of audio samples per second in each channel
+	*/
+	unsigned int MediaDetails::sampleRate() const {
+		return sample_rate_;
+	}
+
+	void MediaDetails::setSampleRate(unsigned int sample_rate) {
+		sample_rate_ = sample_rate;
+	}
+
+	/*
+		Returns the number of audio channels
+	*/
+	unsigned int MediaDetails::channels() const {
+		return channels_;
+	}
+
+	void MediaDetails::setChannels(unsigned int channels) {
+		channels_ = channels;
+	}
+
+	/*
+		Returns the width of the video in pixels
+	*/
+	unsigned int MediaDetails::width() const {
+		return width_;
+	}
+
+	/*
+		Returns the height of the video in pixels
+	*/
+	unsigned int MediaDetails::height() const {
+		return height_;
+	}
+
+	void MediaDetails::setResolution(unsigned int width, unsigned int height) {
+		width_ = width;
+		height_ = height;
+	}
+
+	/*
+		Returns the number of video frames per second
+	*/
+	double MediaDetails::frameRate() const {
+		return frame_rate_;
+	}
+
+	void MediaDetails::setFrameRate(double frame_rate) {
+		frame_rate_ = frame_rate;
+	}
+
+	// The columns media details are stored in, in the order they are bound and read
+	char const * const details_columns = "duration, artist, track_number, track_count, audio_codec, video_codec, "
+	                                     "bitrate, sample_rate, channels, width, height, frame_rate";
+
+	// The same columns set to parameters, for updating details already stored
+	char const * const details_assignments = "duration = ?, artist = ?, track_number = ?, track_count = ?, "
+	        "audio_codec = ?, video_codec = ?, bitrate = ?, sample_rate = ?, channels = ?, width = ?, height = ?, "
+	        "frame_rate = ?";
+
+	/*
+		Binds media details to the parameters of a statement starting at first, in the order of details_columns
+	*/
+	void bind_details(core::Statement const & statement, unsigned int first, MediaDetails const & details) {
+		bind_known(statement, first, details.duration());
+		bind_known(statement, first + 1, details.artist());
+		bind_known(statement, first + 2, details.trackNumber());
+		bind_known(statement, first + 3, details.trackCount());
+		bind_known(statement, first + 4, details.audioCodec());
+		bind_known(statement, first + 5, details.videoCodec());
+		bind_known(statement, first + 6, details.bitrate());
+		bind_known(statement, first + 7, details.sampleRate());
+		bind_known(statement, first + 8, details.channels());
+		bind_known(statement, first + 9, details.width());
+		bind_known(statement, first + 10, details.height());
+
+		if (details.frameRate() > 0) {
+			statement.bind(first + 11, details.frameRate());
+		} else {
+			statement.bind(first + 11);
+		}
+	}
+
+	/*
+		Reads media details from the columns of a row starting at first, in the order of details_columns
+	*/
+	MediaDetails read_details(core::Statement const & statement, unsigned int first) {
+		MediaDetails details;
+		details.setDuration(statement.toInteger(first));
+		details.setArtist(statement.toText(first + 1));
+		details.setTrackNumber(statement.toInteger(first + 2));
+		details.setTrackCount(statement.toInteger(first + 3));
+		details.setAudioCodec(statement.toText(first + 4));
+		details.setVideoCodec(statement.toText(first + 5));
+		details.setBitrate(statement.toInteger(first + 6));
+		details.setSampleRate(statement.toInteger(first + 7));
+		details.setChannels(statement.toInteger(first + 8));
+		details.setResolution(statement.toInteger(first + 9), statement.toInteger(first + 10));
+		details.setFrameRate(statement.toReal(first + 11));
+
+		return details;
+	}
+}
@@ -0,0 +1,32 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _MEDIA_DETAILS_PRIVATE_HPP
+#define _MEDIA_DETAILS_PRIVATE_HPP
+
+#include <core/database.hpp>
+#include <toolkit/media_details.hpp>
+
+namespace toolkit {
+	extern char const * const details_columns;
+	extern char const * const details_assignments;
+
+	void bind_details(core::Statement const & statement, unsigned int first, MediaDetails const & details);
+	MediaDetails read_details(core::Statement const & statement, unsigned int first);
+}
+
+#endif
@@ -0,0 +1,430 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <debug.hpp>
+#include <core/filesystem.hpp>
+#include <toolkit/playlist.hpp>
+
+namespace {
+	// Space left between the position keys of neighbouring entries
+	long long const position_gap(1LL << 20);
+
+	/*
+		Removes white space from either end of a line
+	*/
+	std::string trim(std::string const & line) {
+		std::string::size_type start = 0;
+		while ((start < line.size()) && std::isspace(static_cast< unsigned char >(line[start]))) {
+			++start;
+		}
+
+		std::string::size_type end = line.size();
+		while ((end > start) && std::isspace(static_cast< unsigned char >(line[end - 1]))) {
+			--end;
+		}
+
+		return line.substr(start, end - start);
+	}
+
+	/*
+		Case insensitive check that a string starts with a prefix
+	*/
+	bool starts_with(std::string const & text, char const * prefix) {
+		for (std::string::size_type i = 0; prefix[i] != '\0'; ++i) {
+			if ((i == text.size()) ||
+			        (std::tolower(static_cast< unsigned char >(text[i])) != std::tolower(static_cast< unsigned char >(prefix[i])))) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/*
+		A single location read from a playlist file
+	*/
+	struct ImportedEntry {
+		std::string location;
+		std::string title;
+	};
+
+	/*
+		Reads the entries of an M3U or extended M3U playlist
+	*/
+	std::vector< ImportedEntry > read_m3u(std::vector< std::string > const & lines) {
+		std::vector< ImportedEntry > entries;
+		std::string title;
+
+		for (std::vector< std::string >::const_iterator i = lines.begin(); i != lines.end(); ++i) {
+			if (i->empty()) {
+				continue;
+			}
+
+			if ((*i)[0] == '#') {
+				if (starts_with(*i, "#EXTINF:")) {
+					// Duration followed by the title
+					std::string::size_type comma = i->find(',');
+					title = comma == std::string::npos ? std::string() : trim(i->substr(comma + 1));
+				}
+
+				continue;
+			}
+
+			ImportedEntry entry = {*i, title};
+			entries.push_back(entry);
+			title.clear();
+		}
+
+		return entries;
+	}
+
+	/*
+		Reads the entries of a PLS playlist, ordered by their numbers
+	*/
+	std::vector< ImportedEntry > read_pls(std::vector< std::string > const & lines) {
+		std::map< unsigned long, ImportedEntry > numbered;
+
+		for (std::vector< std::string >::const_iterator i = lines.begin(); i != lines.end(); ++i) {
+			std::string::size_type equals = i->find('=');
+			if (equals == std::string::npos) {
+				continue;
+			}
+
+			std::string key = trim(i->substr(0, equals));
+			std::string value = trim(i->substr(equals + 1));
+
+			bool file = starts_with(key, "File");
+			bool title = starts_with(key, "Title");
+			if (!file && !title) {
+				continue;
+			}
+
+			std::string number = key.substr(file ? 4 : 5);
+			if (number.empty() || (number.find_first_not_of("0123456789") != std::string::npos)) {
+				continue;
+			}
+
+			ImportedEntry & entry = numbered[std::stoul(number)];
+			(file ? entry.location : entry.title) = value;
+		}
+
+		std::vector< ImportedEntry > entries;
+		for (std::map< unsigned long, ImportedEntry >::const_iterator i = numbered.begin(); i != numbered.end(); ++i) {
+			if (!i->second.location.empty()) {
+				entries.push_back(i->second);
+			}
+		}
+
+		return entries;
+	}
+
+	/*
+		Turns a location in a playlist into a URI, relative paths being relative to the playlist
+	*/
+	std::string to_uri(std::string location, std::string const & directory) {
+		if (location.find("://") != std::string::npos) {
+			return location;
+		}
+
+		for (std::string::iterator i = location.begin(); i != location.end(); ++i) {
+			if (*i == '\\') {
+				*i = '/';
+			}
+		}
+
+		core::Path path(location[0] == '/' ? location : directory + "/" + location);
+		path.makeAbsolute();
+		return path.toUri();
+	}
+
+	/*
+		Uses the file name without its extension when a playlist doesn't give a title
+	*/
+	std::string default_title(std::string const & location) {
+		std::string::size_type slash = location.find_last_of("/\\");
+		std::string name = slash == std::string::npos ? location : location.substr(slash + 1);
+
+		std::string::size_type dot = name.rfind('.');
+		if ((dot != std::string::npos) && (dot > 0)) {
+			name.erase(dot);
+		}
+
+		return name;
+	}
+}
+
+namespace toolkit {
+	class PlaylistPrivate {
+		Library & library_;
+
+		std::string name_;
+		long long id_;
+
+		std::vector< LibraryPlaylistEntry > entries_;
+
+		void respace();
+
+	public:
+		PlaylistPrivate(Library & library, std::string name);
+
+		std::string name() const;
+		std::vector< LibraryPlaylistEntry > const & entries() const;
+
+		long long position(std::size_t index);
+		void insert(std::size_t index, std::string uri, std::string title);
+		void move(std::size_t from, std::size_t to);
+		void remove(std::size_t index);
+		void clear();
+
+		unsigned long long import(std::string const & path);
+	};
+
+	PlaylistPrivate::PlaylistPrivate(Library & library, std::string name)
+		: library_(library), name_(std::move(name)), id_(library.playlist(name_)),
+		  entries_(library.playlistEntries(id_)) {}
+
+	/*
+		Returns the name of the playlist
+	*/
+	std::string PlaylistPrivate::name() const {
+		return name_;
+	}
+
+	/*
+		Returns the entries in order
+	*/
+	std::vector< LibraryPlaylistEntry > const & PlaylistPrivate::entries() const {
+		return entries_;
+	}
+
+	/*
+		Spreads the position keys back out evenly once two neighbours have no room left between them
+	*/
+	void PlaylistPrivate::respace() {
+		dprint("Respacing %zu entries of playlist %s", entries_.size(), name_.c_str());
+
+		library_.begin();
+		for (std::size_t i = 0; i < entries_.size(); ++i) {
+			entries_[i].setPosition((i + 1) * position_gap);
+			library_.movePlaylistEntry(entries_[i].id(), entries_[i].position());
+		}
+		library_.commit();
+	}
+
+	/*
+		Finds a position key for an entry placed before the given index
+	*/
+	long long PlaylistPrivate::position(std::size_t index) {
+		if (entries_.empty()) {
+			return position_gap;
+		} else if (index == 0) {
+			return entries_.front().position() - position_gap;
+		} else if (index == entries_.size()) {
+			return entries_.back().position() + position_gap;
+		}
+
+		if (entries_[index].position() - entries_[index - 1].position() < 2) {
+			respace();
+		}
+
+		long long before = entries_[index - 1].position();
+		return before + (entries_[index].position() - before) / 2;
+	}
+
+	/*
+		Adds an entry before the given index, writing only the new entry
+	*/
+	void PlaylistPrivate::insert(std::size_t index, std::string uri, std::string title) {
+		if (index > entries_.size()) {
+			index = entries_.size();
+		}
+
+		long long key = position(index);
+		long long id = library_.addPlaylistEntry(id_, key, uri, title);
+		entries_.insert(entries_.begin() + index, LibraryPlaylistEntry(id, key, std::move(uri), std::move(title)));
+	}
+
+	/*
+		Moves an entry so it ends up at the given index, writing only the moved entry
+	*/
+	void PlaylistPrivate::move(std::size_t from, std::size_t to) {
+		if ((from >= entries_.size()) || (from == to)) {
+			return;
+		}
+
+		LibraryPlaylistEntry entry = entries_[from];
+		entries_.erase(entries_.begin() + from);
+
+		if (to > entries_.size()) {
+			to = entries_.size();
+		}
+
+		entry.setPosition(position(to));
+		library_.movePlaylistEntry(entry.id(), entry.position());
+		entries_.insert(entries_.begin() + to, entry);
+	}
+
+	/*
+		Removes the entry at the given index
+	*/
+	void PlaylistPrivate::remove(std::size_t index) {
+		if (index >= entries_.size()) {
+			return;
+		}
+
+		library_.removePlaylistEntry(entries_[index].id());
+		entries_.erase(entries_.begin() + index);
+	}
+
+	/*
+		Removes every entry
+	*/
+	void PlaylistPrivate::clear() {
+		library_.begin();
+		for (std::vector< LibraryPlaylistEntry >::const_iterator i = entries_.begin(); i != entries_.end(); ++i) {
+			library_.removePlaylistEntry(i->id());
+		}
+		library_.commit();
+
+		entries_.clear();
+	}
+
+	/*
+		Appends the entries of an M3U or PLS playlist file in a single transaction, returning how many were added
+	*/
+	unsigned long long PlaylistPrivate::import(std::string const & path) {
+		std::ifstream file(path.c_str());
+		if (!file) {
+			dprint("Unable to open playlist %s", path.c_str());
+			return 0;
+		}
+
+		std::vector< std::string > lines;
+		std::string line;
+		while (std::getline(file, line)) {
+			if (lines.empty() && (line.compare(0, 3, "\xEF\xBB\xBF") == 0)) {
+				// Byte order mark
+				line.erase(0, 3);
+			}
+
+			lines.push_back(trim(line));
+		}
+
+		bool pls = false;
+		for (std::vector< std::string >::const_iterator i = lines.begin(); i != lines.end(); ++i) {
+			if (!i->empty()) {
+				pls = starts_with(*i, "[playlist]");
+				break;
+			}
+		}
+
+		std::vector< ImportedEntry > imported = pls ? read_pls(lines) : read_m3u(lines);
+
+		core::Path absolute(path);
+		absolute.makeAbsolute();
+		std::string directory = absolute.toString();
+		directory.erase(directory.rfind('/') == std::string::npos ? 0 : directory.rfind('/'));
+
+		entries_.reserve(entries_.size() + imported.size());
+
+		library_.begin();
+		for (std::vector< ImportedEntry >::const_iterator i = imported.begin(); i != imported.end(); ++i) {
+			insert(entries_.size(), to_uri(i->location, directory),
+			       i->title.empty() ? default_title(i->location) : i->title);
+		}
+		library_.commit();
+
+		return imported.size();
+	}
+
+	// Name of the playlist the player moves on to once the current media has finished
+	std::string const Playlist::queue("Play queue");
+
+	Playlist::Playlist(Library & library, std::string name)
+		: p(new PlaylistPrivate(library, std::move(name))) {}
+
+	Playlist::~Playlist() {
+		delete p;
+	}
+
+	/*
+		Returns the name of the playlist
+	*/
+	std::string Playlist::name() const {
+		return p->name();
+	}
+
+	bool Playlist::empty() const {
+		return p->entries().empty();
+	}
+
+	std::size_t Playlist::size() const {
+		return p->entries().size();
+	}
+
+	/*
+		Returns the entry at the given index, throwing std::out_of_range if there is no such entry
+	*/
+	LibraryPlaylistEntry const & Playlist::at(std::size_t index) const {
+		return p->entries().at(index);
+	}
+
+	/*
+		Adds an entry to the end of the playlist
+	*/
+	void Playlist::append(std::string uri, std::string title) {
+		p->insert(size(), std::move(uri), std::move(title));
+	}
+
+	/*
+		Adds an entry before the given index
+	*/
+	void Playlist::insert(std::size_t index, std::string uri, std::string title) {
+		p->insert(index, std::move(uri), std::move(title));
+	}
+
+	/*
+		Moves an entry so it ends up at the given index
+	*/
+	void Playlist::move(std::size_t from, std::size_t to) {
+		p->move(from, to);
+	}
+
+	/*
+		Removes the entry at the given index
+	*/
+	void Playlist::remove(std::size_t index) {
+		p->remove(index);
+	}
+
+	/*
+		Removes every entry
+	*/
+	void Playlist::clear() {
+		p->clear();
+	}
+
+	/*
+		Appends the entries of an M3U or PLS playlist file, returning how many were added
+	*/
+	unsigned long long Playlist::import(std::string path) {
+		return p->import(path);
+	}
+}
@@ -0,0 +1,339 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <debug.hpp>
+#include <toolkit/shuffle.hpp>
+
+namespace {
+	/*
+		Scrambles the bits of a number
+	*/
+	inline unsigned long long mix(unsigned long long x) {
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+
+	/*
+		Picks a seed when none is given
+	*/
+	unsigned long long random_seed() {
+		std::random_device device;
+		unsigned long long seed = (static_cast< unsigned long long >(device()) << 32) | device();
+		return seed != 0 ? seed : 1;
+	}
+}
+
+namespace toolkit {
+	class ShufflePrivate {
+		Library & library_;
+		Library::Type type_;
+		std::string state_path_;
+
+		// Position within a permutation of the indexes of ids_
+		unsigned long long seed_;
+		unsigned long long position_;
+		unsigned int half_bits_;
+		unsigned long long half_mask_;
+
+		// The IDs being permuted in ascending order, with those of items that have gone since set to 0
+		std::vector< long long > ids_;
+		long long generation_;
+
+		void remove_missing(std::vector< long long > const & ids);
+		void set_domain();
+		void start(unsigned long long seed);
+		bool read_state();
+		void write_state() const;
+		void write_index() const;
+
+		unsigned long long permute(unsigned long long x) const;
+		long long next_id();
+
+	public:
+		ShufflePrivate(Library & library, Library::Type type, std::string state_file, unsigned long long seed);
+
+		LibraryItemTable next(unsigned int count);
+		void reshuffle(unsigned long long seed);
+
+		unsigned long long seed() const;
+	};
+
+	ShufflePrivate::ShufflePrivate(Library & library, Library::Type type, std::string state_file,
+	                               unsigned long long seed)
+		: library_(library), type_(type), state_path_(std::move(state_file)), seed_(0), position_(0), half_bits_(1),
+		  half_mask_(1), generation_(0) {
+		if (read_state()) {
+			remove_missing(library_.identifiers(type_));
+		} else {
+			start(seed != 0 ? seed : random_seed());
+			write_state();
+		}
+	}
+
+	/*
+		Clears the IDs of items no longer in the library, given the IDs that are in ascending order
+	*/
+	void ShufflePrivate::remove_missing(std::vector< long long > const & ids) {
+		generation_ = library_.generation();
+		std::vector< long long >::const_iterator current = ids.begin();
+
+		for (std::vector< long long >::iterator i = ids_.begin(); i != ids_.end(); ++i) {
+			if (*i == 0) {
+				continue;
+			}
+
+			while ((current != ids.end()) && (*current < *i)) {
+				++current;
+			}
+
+			if ((current == ids.end()) || (*current != *i)) {
+				*i = 0;
+			}
+		}
+	}
+
+	/*
+		Uses the fewest bits that will cover the indexes of ids_
+	*/
+	void ShufflePrivate::set_domain() {
+		// The Feistel network needs an even number of bits
+		unsigned int bits = 2;
+		while ((bits < 64) && ((1ULL << bits) < ids_.size())) {
+			bits += 2;
+		}
+
+		half_bits_ = bits / 2;
+		half_mask_ = (1ULL << half_bits_) - 1;
+	}
+
+	/*
+		Begins a new permutation covering every item currently in the library. The permutation is of indexes into the
+		list of IDs rather than of the IDs themselves, so gaps left by removed items and by other types, and the distance
+		between the IDs of attached volumes, cost nothing.
+	*/
+	void ShufflePrivate::start(unsigned long long seed) {
+		seed_ = seed;
+		position_ = 0;
+		generation_ = library_.generation();
+
+		std::vector< long long > ids = library_.identifiers(type_);
+		ids_.swap(ids);
+		set_domain();
+		write_index();
+	}
+
+	/*
+		Restores the permutation and position saved by an earlier session, if it was of the same type of item
+	*/
+	bool ShufflePrivate::read_state() {
+		if (state_path_.empty()) {
+			return false;
+		}
+
+		std::ifstream state(state_path_.c_str());
+		int type;
+		unsigned long long seed;
+		unsigned long long position;
+		std::size_t count;
+
+		if (!(state >> type >> seed >> position >> count) || (type != static_cast< int >(type_)) || (position > count)) {
+			return false;
+		}
+
+		// Items added since are left for the next permutation
+		std::ifstream index((state_path_ + ".index").c_str(), std::ios::binary);
+		unsigned long long index_seed;
+		std::vector< long long > ids(count);
+
+		if (!index.read(reinterpret_cast< char * >(&index_seed), sizeof(index_seed)) || (index_seed != seed) ||
+		    !index.read(reinterpret_cast< char * >(ids.data()), count * sizeof(long long))) {
+			return false;
+		}
+
+		seed_ = seed;
+		position_ = position;
+		ids_.swap(ids);
+		set_domain();
+
+		return true;
+	}
+
+	/*
+		Saves the type, permutation and position, replacing the file in one step so it is never left half written
+	*/
+	void ShufflePrivate::write_state() const {
+		if (state_path_.empty()) {
+			return;
+		}
+
+		std::string const temporary = state_path_ + ".tmp";
+		bool written;
+		{
+			std::ofstream state(temporary.c_str(), std::ios::trunc);
+			state << static_cast< int >(type_) << ' ' << seed_ << ' ' << position_ << ' ' << ids_.size() << '\n';
+			written = static_cast< bool >(state.flush());
+		}
+
+		if (!written || (std::rename(temporary.c_str(), state_path_.c_str()) != 0)) {
+			dprint("Unable to write shuffle state to %s", state_path_.c_str());
+			std::remove(temporary.c_str());
+		}
+	}
+
+	/*
+		Saves the IDs being permuted alongside the state file. They only change when a permutation begins, so they are
+		kept apart from the position that is saved after every pick, and tagged with the seed to tie them to it.
+	*/
+	void ShufflePrivate::write_index() const {
+		if (state_path_.empty()) {
+			return;
+		}
+
+		std::string const path = state_path_ + ".index";
+		std::string const temporary = path + ".tmp";
+		bool written;
+		{
+			std::ofstream index(temporary.c_str(), std::ios::trunc | std::ios::binary);
+			index.write(reinterpret_cast< char const * >(&seed_), sizeof(seed_));
+			index.write(reinterpret_cast< char const * >(ids_.data()), ids_.size() * sizeof(long long));
+			written = static_cast< bool >(index.flush());
+		}
+
+		if (!written || (std::rename(temporary.c_str(), path.c_str()) != 0)) {
+			dprint("Unable to write shuffle index to %s", path.c_str());
+			std::remove(temporary.c_str());
+		}
+	}
+
+	/*
+		A Feistel network over twice half_bits_ bits, a permutation determined by the seed
+	*/
+	unsigned long long ShufflePrivate::permute(unsigned long long x) const {
+		unsigned long long left = x >> half_bits_;
+		unsigned long long right = x & half_mask_;
+
+		for (unsigned long long round = 0; round < 4; ++round) {
+			unsigned long long next = left ^ (mix(right ^ (seed_ + round * 0x9e3779b97f4a7c15ULL)) & half_mask_);
+			left = right;
+			right = next;
+		}
+
+		return (left << half_bits_) | right;
+	}
+
+	/*
+		Returns the ID of the next item to play, or 0 if there are none. Positions are mapped through the permutation
+		until they land inside the list of IDs, which takes less than four steps on average since it is at least a
+		quarter of the permuted range.
+	*/
+	long long ShufflePrivate::next_id() {
+		if (library_.generation() != generation_) {
+			// Leave out items that have gone
+			remove_missing(library_.identifiers(type_));
+		}
+
+		for (unsigned int cycles = 0; cycles < 2; ++cycles) {
+			while (position_ < ids_.size()) {
+				unsigned long long k = permute(position_++);
+				while (k >= ids_.size()) {
+					k = permute(k);
+				}
+
+				if (ids_[k] != 0) {
+					return ids_[k];
+				}
+			}
+
+			// Every item has been played, so begin again in a different order
+			start(mix(seed_));
+		}
+
+		return 0;
+	}
+
+	/*
+		Returns the next count items to play
+	*/
+	LibraryItemTable ShufflePrivate::next(unsigned int count) {
+		std::vector< long long > ids;
+		ids.reserve(count);
+
+		for (unsigned int i = 0; i < count; ++i) {
+			long long id = next_id();
+			if (id == 0) {
+				break;
+			}
+
+			ids.push_back(id);
+		}
+
+		write_state();
+		return library_.items(ids);
+	}
+
+	/*
+		Begins a new order, leaving the previous one unfinished
+	*/
+	void ShufflePrivate::reshuffle(unsigned long long seed) {
+		start(seed != 0 ? seed : random_seed());
+		write_state();
+	}
+
+	/*
+		Returns the seed that determines the current order
+	*/
+	unsigned long long ShufflePrivate::seed() const {
+		return seed_;
+	}
+
+	/*
+		Creates a shuffled order of the items of the given type. An order saved in the state file is carried on with,
+		otherwise the seed picks the order, with 0 meaning a random one.
+	*/
+	Shuffle::Shuffle(Library & library, Library::Type type, std::string state_file, unsigned long long seed)
+		: p(new ShufflePrivate(library, type, std::move(state_file), seed)) {}
+
+	Shuffle::~Shuffle() {
+		delete p;
+	}
+
+	/*
+		Returns the next count items to play, with every item returned once before any is repeated
+	*/
+	LibraryItemTable Shuffle::next(unsigned int count) {
+		return p->next(count);
+	}
+
+	/*
+		Starts again with a new order picked by the seed, or a random one if it is 0
+	*/
+	void Shuffle::reshuffle(unsigned long long seed) {
+		p->reshuffle(seed);
+	}
+
+	/*
+		Returns the seed that picked the current order
+	*/
+	unsigned long long Shuffle::seed() const {
+		return p->seed();
+	}
+}
@@ -0,0 +1,1541 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <core/filesystem.hpp>
+#include <debug.hpp>
+#include <toolkit/tag_reader.hpp>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+}
+
+namespace {
+	// Largest block of headers that is read, so a broken file can't make the reader load the whole of it
+	unsigned long long const max_header_size(16 * 1024 * 1024);
+
+	// Number of consecutive MPEG audio frames that must be found before a file is taken to be MPEG audio
+	unsigned int const min_mpeg_frames(3);
+
+	// How much of the end of an Ogg file is searched for the last page of each stream
+	unsigned long long const ogg_tail_size(64 * 1024);
+
+	// How much of the start of a file is read ahead, enough for the headers of most files
+	unsigned long long const read_ahead_size(256 * 1024);
+
+	typedef std::vector< unsigned char > Bytes;
+
+	/*
+		The streams and tags found in a file
+	*/
+	struct Tags {
+		bool audio;
+		bool video;
+
+		std::string title;
+		std::string album;
+
+		toolkit::MediaDetails details;
+	};
+
+	/*
+		A file that is read a range at a time
+	*/
+	class File {
+		int fd_;
+		unsigned long long size_;
+
+	public:
+		File(std::string const & path)
+			: fd_(open(path.c_str(), O_RDONLY | O_CLOEXEC)), size_(0) {
+			struct stat info;
+			if ((fd_ >= 0) && (fstat(fd_, &info) == 0)) {
+				size_ = info.st_size;
+			}
+		}
+
+		~File() {
+			if (fd_ >= 0) {
+				close(fd_);
+			}
+		}
+
+		bool valid() const {
+			return fd_ >= 0;
+		}
+
+		unsigned long long size() const {
+			return size_;
+		}
+
+		/*
+			Reads exactly size bytes from offset, returning false if the file is too short
+		*/
+		bool read(unsigned long long offset, unsigned long long size, Bytes & buffer) const {
+			if ((offset > size_) || (size > size_ - offset) || (size > max_header_size)) {
+				return false;
+			}
+
+			buffer.resize(size);
+			unsigned long long total = 0;
+
+			while (total < size) {
+				ssize_t result = pread(fd_, &buffer[0] + total, size - total, offset + total);
+				if (result <= 0) {
+					return false;
+				}
+
+				total += result;
+			}
+
+			return true;
+		}
+	};
+
+	inline unsigned int be16(unsigned char const * data) {
+		return (data[0] << 8) | data[1];
+	}
+
+	inline unsigned int be24(unsigned char const * data) {
+		return (data[0] << 16) | (data[1] << 8) | data[2];
+	}
+
+	inline unsigned long long be32(unsigned char const * data) {
+		return (static_cast< unsigned long long >(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+	}
+
+	inline unsigned long long be64(unsigned char const * data) {
+		return (be32(data) << 32) | be32(data + 4);
+	}
+
+	inline unsigned int le16(unsigned char const * data) {
+		return (data[1] << 8) | data[0];
+	}
+
+	inline unsigned long long le32(unsigned char const * data) {
+		return (static_cast< unsigned long long >(data[3]) << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
+	}
+
+	inline unsigned long long le64(unsigned char const * data) {
+		return (le32(data + 4) << 32) | le32(data);
+	}
+
+	/*
+		Reads the 28 bit sizes used by ID3, which leave the top bit of each byte clear
+	*/
+	inline unsigned long long synchsafe(unsigned char const * data) {
+		return ((data[0] & 0x7f) << 21) | ((data[1] & 0x7f) << 14) | ((data[2] & 0x7f) << 7) | (data[3] & 0x7f);
+	}
+
+	inline bool starts_with(Bytes const & data, unsigned long long offset, char const * prefix,
+	                        unsigned long long length) {
+		return (offset <= data.size()) && (data.size() - offset >= length) &&
+		       (std::memcmp(&data[0] + offset, prefix, length) == 0);
+	}
+
+	void append_utf8(std::string & text, unsigned long code) {
+		if (code < 0x80) {
+			text.push_back(static_cast< char >(code));
+		} else if (code < 0x800) {
+			text.push_back(static_cast< char >(0xc0 | (code >> 6)));
+			text.push_back(static_cast< char >(0x80 | (code & 0x3f)));
+		} else if (code < 0x10000) {
+			text.push_back(static_cast< char >(0xe0 | (code >> 12)));
+			text.push_back(static_cast< char >(0x80 | ((code >> 6) & 0x3f)));
+			text.push_back(static_cast< char >(0x80 | (code & 0x3f)));
+		} else {
+			text.push_back(static_cast< char >(0xf0 | (code >> 18)));
+			text.push_back(static_cast< char >(0x80 | ((code >> 12) & 0x3f)));
+			text.push_back(static_cast< char >(0x80 | ((code >> 6) & 0x3f)));
+			text.push_back(static_cast< char >(0x80 | (code & 0x3f)));
+		}
+	}
+
+	std::string from_latin1(unsigned char const * data, unsigned long long size) {
+		std::string text;
+		text.reserve(size);
+
+		for (unsigned long long i = 0; i < size; ++i) {
+			append_utf8(text, data[i]);
+		}
+
+		return text;
+	}
+
+	std::string from_utf16(unsigned char const * data, unsigned long long size, bool big_endian) {
+		std::string text;
+		text.reserve(size / 2);
+
+		for (unsigned long long i = 0; i + 1 < size; i += 2) {
+			unsigned long code = big_endian ? (data[i] << 8) | data[i + 1] : (data[i + 1] << 8) | data[i];
+
+			if ((code >= 0xd800) && (code < 0xdc00) && (i + 3 < size)) {
+				unsigned long low = big_endian ? (data[i + 2] << 8) | data[i + 3] : (data[i + 3] << 8) | data[i + 2];
+				if ((low >= 0xdc00) && (low < 0xe000)) {
+					code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					i += 2;
+				}
+			}
+
+			append_utf8(text, code);
+		}
+
+		return text;
+	}
+
+	/*
+		Adds another value for a tag, joining several the way GStreamer does
+	*/
+	void add_value(std::string & tag, std::string const & value) {
+		if (value.empty()) {
+			return;
+		}
+
+		if (!tag.empty()) {
+			tag.append(", ");
+		}
+
+		tag.append(value);
+	}
+
+	/*
+		Reads a track number written as a number or as a number and count separated by a slash
+	*/
+	void read_track(std::string const & text, unsigned int & number, unsigned int & count) {
+		char * end;
+		number = std::strtoul(text.c_str(), &end, 10);
+
+		if (*end == '/') {
+			count = std::strtoul(end + 1, nullptr, 10);
+		}
+	}
+
+	/*
+		Reads the tags from a Vorbis comment block, used by Vorbis, Opus, Speex, FLAC and Theora
+	*/
+	void read_vorbis_comment(unsigned char const * data, unsigned long long size, Tags & tags) {
+		if (size < 8) {
+			return;
+		}
+
+		unsigned long long offset = 4 + le32(data);
+		if (offset + 4 > size) {
+			return;
+		}
+
+		unsigned long long count = le32(data + offset);
+		offset += 4;
+
+		// Each stream's comments replace those of any stream before it, as they do when posted on the bus
+		std::string title;
+		std::string album;
+		std::string artist;
+		unsigned int track_number = 0;
+		unsigned int track_count = 0;
+
+		for (unsigned long long i = 0; (i < count) && (offset + 4 <= size); ++i) {
+			unsigned long long length = le32(data + offset);
+			offset += 4;
+
+			if (length > size - offset) {
+				break;
+			}
+
+			std::string comment(reinterpret_cast< char const * >(data + offset), length);
+			offset += length;
+
+			std::string::size_type equals = comment.find('=');
+			if (equals == std::string::npos) {
+				continue;
+			}
+
+			std::string key(comment, 0, equals);
+			for (std::string::iterator c = key.begin(); c != key.end(); ++c) {
+				if ((*c >= 'a') && (*c <= 'z')) {
+					*c -= 'a' - 'A';
+				}
+			}
+
+			std::string value(comment, equals + 1);
+			if (key == "TITLE") {
+				add_value(title, value);
+			} else if (key == "ALBUM") {
+				add_value(album, value);
+			} else if (key == "ARTIST") {
+				add_value(artist, value);
+			} else if (key == "TRACKNUMBER") {
+				read_track(value, track_number, track_count);
+			} else if ((key == "TRACKTOTAL") || (key == "TOTALTRACKS")) {
+				track_count = std::strtoul(value.c_str(), nullptr, 10);
+			}
+		}
+
+		if (!title.empty()) {
+			tags.title = title;
+		}
+
+		if (!album.empty()) {
+			tags.album = album;
+		}
+
+		if (!artist.empty()) {
+			tags.details.setArtist(artist);
+		}
+
+		if (track_number != 0) {
+			tags.details.setTrackNumber(track_number);
+		}
+
+		if (track_count != 0) {
+			tags.details.setTrackCount(track_count);
+		}
+	}
+
+	/*
+		Reads the sample rate and channels from a FLAC stream info block, returning the number of samples in the stream
+	*/
+	unsigned long long read_flac_streaminfo(unsigned char const * info, Tags & tags) {
+		tags.details.setAudioCodec("Free Lossless Audio Codec (FLAC)");
+		tags.details.setSampleRate((info[10] << 12) | (info[11] << 4) | (info[12] >> 4));
+		tags.details.setChannels(((info[12] >> 1) & 0x07) + 1);
+
+		return (static_cast< unsigned long long >(info[13] & 0x0f) << 32) | be32(info + 14);
+	}
+
+	/*
+		A logical stream within an Ogg file, collected until its comment header has been read
+	*/
+	struct OggStream {
+		enum Kind {
+			Unknown, Vorbis, Opus, Speex, Flac, Theora, Other
+		};
+
+		unsigned long long serial;
+		Kind kind;
+		unsigned int packets;
+		bool done;
+		Bytes packet;
+
+		// Granule positions count samples after a number to skip for audio, and key frames and frames for Theora
+		long long last_granule;
+		unsigned long long rate;
+		unsigned long long skip;
+		unsigned long long frame_duration;
+		unsigned int granule_shift;
+
+		/*
+			Returns how far into the stream its last page ends, in milliseconds
+		*/
+		long long duration() const {
+			if ((last_granule < 0) || (rate == 0)) {
+				return 0;
+			}
+
+			unsigned long long granule = last_granule;
+			if (kind != Theora) {
+				return granule > skip ? (granule - skip) * 1000 / rate : 0;
+			}
+
+			unsigned long long frames = (granule >> granule_shift) + (granule & ((1ULL << granule_shift) - 1)) + skip;
+			return frames * frame_duration * 1000 / rate;
+		}
+	};
+
+	/*
+		Reads the details of a stream from its identification header
+	*/
+	void read_ogg_identification(OggStream & stream, Tags & tags) {
+		Bytes const & packet = stream.packet;
+		toolkit::MediaDetails & details = tags.details;
+
+		if (stream.kind == OggStream::Theora) {
+			tags.video = true;
+			details.setVideoCodec("Theora");
+
+			if (packet.size() >= 42) {
+				details.setResolution(be24(&packet[14]), be24(&packet[17]));
+
+				stream.rate = be32(&packet[22]);
+				stream.frame_duration = be32(&packet[26]);
+				if (stream.frame_duration != 0) {
+					details.setFrameRate(static_cast< double >(stream.rate) / stream.frame_duration);
+				}
+
+				if (be24(&packet[37]) != 0) {
+					details.setBitrate(be24(&packet[37]));
+				}
+
+				stream.granule_shift = ((packet[40] & 0x03) << 3) | (packet[41] >> 5);
+
+				// Before 3.2.1, granule positions counted from the first frame rather than after it
+				stream.skip = be24(&packet[7]) < 0x030201 ? 1 : 0;
+			}
+
+			return;
+		}
+
+		tags.audio = true;
+
+		switch (stream.kind) {
+		case OggStream::Vorbis:
+			details.setAudioCodec("Vorbis");
+			if (packet.size() >= 28) {
+				details.setChannels(packet[11]);
+				stream.rate = le32(&packet[12]);
+
+				long long nominal = static_cast< int >(le32(&packet[20]));
+				if (nominal > 0) {
+					details.setBitrate(nominal);
+				}
+			}
+			break;
+		case OggStream::Opus:
+			// Opus is always decoded at 48 kHz, whatever the rate of the original
+			details.setAudioCodec("Opus");
+			if (packet.size() >= 19) {
+				details.setChannels(packet[9]);
+				stream.skip = le16(&packet[10]);
+				stream.rate = 48000;
+			}
+			break;
+		case OggStream::Speex:
+			details.setAudioCodec("Speex");
+			if (packet.size() >= 56) {
+				stream.rate = le32(&packet[36]);
+				details.setChannels(le32(&packet[48]));
+
+				long long bitrate = static_cast< int >(le32(&packet[52]));
+				if (bitrate > 0) {
+					details.setBitrate(bitrate);
+				}
+			}
+			break;
+		case OggStream::Flac:
+			if (packet.size() >= 51) {
+				read_flac_streaminfo(&packet[17], tags);
+				stream.rate = details.sampleRate();
+			}
+			break;
+		default:
+			;
+		}
+
+		if (stream.rate != 0) {
+			details.setSampleRate(stream.rate);
+		}
+	}
+
+	/*
+		Handles a complete header packet from an Ogg stream, returning false if the stream can't be recognised
+	*/
+	bool read_ogg_packet(OggStream & stream, Tags & tags) {
+		Bytes const & packet = stream.packet;
+
+		if (stream.packets++ == 0) {
+			if (starts_with(packet, 0, "\x01vorbis", 7)) {
+				stream.kind = OggStream::Vorbis;
+			} else if (starts_with(packet, 0, "OpusHead", 8)) {
+				stream.kind = OggStream::Opus;
+			} else if (starts_with(packet, 0, "Speex   ", 8)) {
+				stream.kind = OggStream::Speex;
+			} else if (starts_with(packet, 0, "\x7f" "FLAC", 5)) {
+				stream.kind = OggStream::Flac;
+			} else if (starts_with(packet, 0, "\x80theora", 7)) {
+				stream.kind = OggStream::Theora;
+			} else if (starts_with(packet, 0, "fishead", 8) || starts_with(packet, 0, "\x80kate", 5)) {
+				// Skeleton metadata and Kate subtitles have neither audio nor tags to read
+				stream.kind = OggStream::Other;
+				stream.done = true;
+				return true;
+			} else {
+				dprint("Unknown Ogg stream");
+				return false;
+			}
+
+			read_ogg_identification(stream, tags);
+			return true;
+		}
+
+		switch (stream.kind) {
+		case OggStream::Vorbis:
+			if (starts_with(packet, 0, "\x03vorbis", 7)) {
+				read_vorbis_comment(&packet[0] + 7, packet.size() - 7, tags);
+			}
+			break;
+		case OggStream::Opus:
+			if (starts_with(packet, 0, "OpusTags", 8)) {
+				read_vorbis_comment(&packet[0] + 8, packet.size() - 8, tags);
+			}
+			break;
+		case OggStream::Speex:
+			read_vorbis_comment(&packet[0], packet.size(), tags);
+			break;
+		case OggStream::Flac:
+			// The first metadata block after the stream info should hold the comments
+			if ((packet.size() >= 4) && ((packet[0] & 0x7f) == 4)) {
+				read_vorbis_comment(&packet[0] + 4, packet.size() - 4, tags);
+			}
+			break;
+		case OggStream::Theora:
+			if (starts_with(packet, 0, "\x81theora", 7)) {
+				read_vorbis_comment(&packet[0] + 7, packet.size() - 7, tags);
+			}
+			break;
+		default:
+			;
+		}
+
+		stream.done = true;
+		return true;
+	}
+
+	/*
+		Finds the length of an Ogg file from the granule positions of the last page of each stream. Pages are searched
+		for backwards from the end, reading further back only while some stream hasn't been found.
+	*/
+	void read_ogg_duration(File const & file, std::vector< OggStream > & streams, Tags & tags) {
+		unsigned long long remaining = streams.size();
+		Bytes tail;
+
+		for (unsigned long long size = 4096; remaining > 0; size *= 4) {
+			size = std::min(std::min(size, ogg_tail_size), file.size());
+			if (!file.read(file.size() - size, size, tail) || (tail.size() < 27)) {
+				break;
+			}
+
+			for (unsigned long long i = tail.size() - 27 + 1; (i-- > 0) && (remaining > 0);) {
+				if ((tail[i] != 'O') || !starts_with(tail, i, "OggS\0", 5)) {
+					continue;
+				}
+
+				long long granule = le64(&tail[i + 6]);
+				unsigned long long serial = le32(&tail[i + 14]);
+
+				for (std::vector< OggStream >::iterator stream = streams.begin(); stream != streams.end(); ++stream) {
+					if ((stream->serial == serial) && (stream->last_granule < 0) && (granule >= 0)) {
+						stream->last_granule = granule;
+						--remaining;
+					}
+				}
+			}
+
+			// Streams already found keep the granule from their last page when the search goes further back
+			if ((size == ogg_tail_size) || (size == file.size())) {
+				break;
+			}
+		}
+
+		long long duration = 0;
+		for (std::vector< OggStream >::const_iterator stream = streams.begin(); stream != streams.end(); ++stream) {
+			duration = std::max(duration, stream->duration());
+		}
+
+		tags.details.setDuration(duration);
+	}
+
+	/*
+		Reads the identification and comment headers of every stream in an Ogg file. These all come before any audio
+		or video, so only the first few pages are read.
+	*/
+	bool read_ogg(File const & file, Tags & tags) {
+		std::vector< OggStream > streams;
+		bool headers = true;
+		unsigned long long offset = 0;
+		Bytes header;
+		Bytes body;
+
+		for (;;) {
+			if (offset == file.size()) {
+				break;
+			}
+
+			if (!file.read(offset, 27, header) || !starts_with(header, 0, "OggS\0", 5)) {
+				return false;
+			}
+
+			unsigned int flags = header[5];
+			unsigned long long serial = le32(&header[14]);
+			unsigned int segments = header[26];
+
+			Bytes lacing;
+			if (!file.read(offset + 27, segments, lacing)) {
+				return false;
+			}
+
+			unsigned long long body_size = 0;
+			for (unsigned int i = 0; i < segments; ++i) {
+				body_size += lacing[i];
+			}
+
+			// Streams all begin before any of them carry on
+			if (flags & 0x02) {
+				if (!headers) {
+					break;
+				}
+
+				OggStream stream = {serial, OggStream::Unknown, 0, false, Bytes(), -1, 0, 0, 0, 0};
+				streams.push_back(stream);
+			} else {
+				headers = false;
+			}
+
+			std::vector< OggStream >::iterator stream = streams.begin();
+			while ((stream != streams.end()) && (stream->serial != serial)) {
+				++stream;
+			}
+
+			if ((stream != streams.end()) && !stream->done) {
+				if (!file.read(offset + 27 + segments, body_size, body)) {
+					return false;
+				}
+
+				unsigned long long position = 0;
+				for (unsigned int i = 0; (i < segments) && !stream->done; ++i) {
+					stream->packet.insert(stream->packet.end(), body.begin() + position, body.begin() + position + lacing[i]);
+					position += lacing[i];
+
+					if (stream->packet.size() > max_header_size) {
+						return false;
+					}
+
+					// A lacing value under 255 ends a packet
+					if (lacing[i] < 255) {
+						if (!read_ogg_packet(*stream, tags)) {
+							return false;
+						}
+
+						stream->packet.clear();
+					}
+				}
+			}
+
+			offset += 27 + segments + body_size;
+
+			if (!headers) {
+				bool done = true;
+				for (std::vector< OggStream >::const_iterator i = streams.begin(); i != streams.end(); ++i) {
+					done = done && i->done;
+				}
+
+				if (done) {
+					break;
+				}
+			}
+		}
+
+		if (streams.empty()) {
+			return false;
+		}
+
+		read_ogg_duration(file, streams, tags);
+		return true;
+	}
+
+	/*
+		Reads the stream information and comments from the metadata blocks of a native FLAC stream starting at offset
+	*/
+	bool read_flac(File const & file, unsigned long long offset, Tags & tags) {
+		Bytes header;
+		if (!file.read(offset, 4, header) || !starts_with(header, 0, "fLaC", 4)) {
+			return false;
+		}
+
+		unsigned long long start = offset;
+		offset += 4;
+		tags.audio = true;
+
+		for (bool last = false; !last;) {
+			if (!file.read(offset, 4, header)) {
+				return false;
+			}
+
+			last = header[0] & 0x80;
+			unsigned int type = header[0] & 0x7f;
+			unsigned long long length = be24(&header[1]);
+
+			if ((type == 0) && (length >= 34)) {
+				Bytes block;
+				if (!file.read(offset + 4, length, block)) {
+					return false;
+				}
+
+				unsigned long long samples = read_flac_streaminfo(&block[0], tags);
+				if (tags.details.sampleRate() != 0) {
+					tags.details.setDuration(samples * 1000 / tags.details.sampleRate());
+				}
+
+				if (tags.details.duration() > 0) {
+					tags.details.setBitrate((file.size() - start) * 8000 / tags.details.duration());
+				}
+			} else if (type == 4) {
+				Bytes block;
+				if (!file.read(offset + 4, length, block)) {
+					return false;
+				}
+
+				read_vorbis_comment(&block[0], block.size(), tags);
+				break;
+			}
+
+			offset += 4 + length;
+		}
+
+		return true;
+	}
+
+	/*
+		Reads the text in an ID3v2 text frame, joining several strings the way GStreamer does
+	*/
+	std::string read_id3v2_text(unsigned char const * data, unsigned long long size) {
+		if (size == 0) {
+			return std::string();
+		}
+
+		unsigned int encoding = data[0];
+		++data;
+		--size;
+
+		std::string text;
+		unsigned int width = (encoding == 1) || (encoding == 2) ? 2 : 1;
+		unsigned long long start = 0;
+
+		for (unsigned long long i = 0; i <= size; i += width) {
+			bool end = (i + width > size);
+			if (!end && (data[i] != 0 || (width == 2 && data[i + 1] != 0))) {
+				continue;
+			}
+
+			unsigned char const * string = data + start;
+			unsigned long long length = (end ? size : i) - start;
+			start = i + width;
+
+			std::string value;
+			switch (encoding) {
+			case 0:
+				value = from_latin1(string, length);
+				break;
+			case 1:
+				if ((length >= 2) && (string[0] == 0xfe) && (string[1] == 0xff)) {
+					value = from_utf16(string + 2, length - 2, true);
+				} else if ((length >= 2) && (string[0] == 0xff) && (string[1] == 0xfe)) {
+					value = from_utf16(string + 2, length - 2, false);
+				} else {
+					value = from_utf16(string, length, false);
+				}
+				break;
+			case 2:
+				value = from_utf16(string, length, true);
+				break;
+			default:
+				value.assign(reinterpret_cast< char const * >(string), length);
+			}
+
+			add_value(text, value);
+
+			if (end) {
+				break;
+			}
+		}
+
+		return text;
+	}
+
+	/*
+		Undoes the unsynchronisation ID3 uses to keep false MPEG frame syncs out of tags
+	*/
+	void resynchronise(Bytes & data) {
+		Bytes::iterator out = data.begin();
+		for (Bytes::const_iterator in = data.begin(); in != data.end(); ++in) {
+			*out++ = *in;
+
+			if ((*in == 0xff) && (in + 1 != data.end()) && (*(in + 1) == 0x00)) {
+				++in;
+			}
+		}
+
+		data.erase(out, data.end());
+	}
+
+	/*
+		Reads an ID3v2 tag at the start of a file, returning the offset of whatever follows it or 0 if there isn't one
+	*/
+	unsigned long long read_id3v2(File const & file, Tags & tags) {
+		Bytes header;
+		if (!file.read(0, 10, header) || !starts_with(header, 0, "ID3", 3)) {
+			return 0;
+		}
+
+		unsigned int version = header[3];
+		unsigned int flags = header[5];
+		unsigned long long size = synchsafe(&header[6]);
+		unsigned long long end = 10 + size + ((version >= 4) && (flags & 0x10) ? 10 : 0);
+
+		Bytes data;
+		if ((version < 2) || (version > 4) || !file.read(10, size, data)) {
+			return 0;
+		}
+
+		if ((version < 4) && (flags & 0x80)) {
+			resynchronise(data);
+		}
+
+		unsigned long long offset = 0;
+		if ((version >= 3) && (flags & 0x40) && (data.size() >= 4)) {
+			offset = version == 3 ? 4 + be32(&data[0]) : synchsafe(&data[0]);
+		}
+
+		unsigned int const header_size = version == 2 ? 6 : 10;
+		while (offset + header_size <= data.size()) {
+			unsigned char const * frame = &data[0] + offset;
+
+			// Padding fills the rest of the tag
+			if (frame[0] == 0) {
+				break;
+			}
+
+			std::string id;
+			unsigned long long length;
+			unsigned int frame_flags = 0;
+
+			if (version == 2) {
+				id.assign(reinterpret_cast< char const * >(frame), 3);
+				length = be24(frame + 3);
+			} else {
+				id.assign(reinterpret_cast< char const * >(frame), 4);
+				length = version == 3 ? be32(frame + 4) : synchsafe(frame + 4);
+				frame_flags = frame[9];
+			}
+
+			offset += header_size;
+			if (length > data.size() - offset) {
+				break;
+			}
+
+			Bytes content(data.begin() + offset, data.begin() + offset + length);
+			offset += length;
+
+			bool title = (id == "TIT2") || (id == "TT2");
+			bool album = (id == "TALB") || (id == "TAL");
+			bool artist = (id == "TPE1") || (id == "TP1");
+			bool track = (id == "TRCK") || (id == "TRK");
+			if (!title && !album && !artist && !track) {
+				continue;
+			}
+
+			// Compressed and encrypted frames are left for GStreamer
+			if ((version == 3) && (frame_flags & 0xc0)) {
+				continue;
+			}
+
+			if (version == 4) {
+				if (frame_flags & 0x0c) {
+					continue;
+				}
+
+				unsigned int skip = (frame_flags & 0x40 ? 1 : 0) + (frame_flags & 0x01 ? 4 : 0);
+				if (skip > content.size()) {
+					continue;
+				}
+
+				content.erase(content.begin(), content.begin() + skip);
+
+				if (frame_flags & 0x02) {
+					resynchronise(content);
+				}
+			}
+
+			std::string text = content.empty() ? std::string() : read_id3v2_text(&content[0], content.size());
+			if (title) {
+				tags.title = text;
+			} else if (album) {
+				tags.album = text;
+			} else if (artist) {
+				tags.details.setArtist(text);
+			} else {
+				unsigned int number = 0;
+				unsigned int count = 0;
+				read_track(text, number, count);
+
+				tags.details.setTrackNumber(number);
+				tags.details.setTrackCount(count);
+			}
+		}
+
+		return end;
+	}
+
+	/*
+		Reads the fixed width fields of an ID3v1 tag at the end of a file, for tags an ID3v2 tag doesn't have. Returns
+		whether there is one.
+	*/
+	bool read_id3v1(File const & file, Tags & tags) {
+		Bytes tag;
+		if ((file.size() < 128) || !file.read(file.size() - 128, 128, tag) || !starts_with(tag, 0, "TAG", 3)) {
+			return false;
+		}
+
+		std::string artist = tags.details.artist();
+
+		struct {
+			std::string & tag;
+			unsigned int offset;
+		} fields[] = {{tags.title, 3}, {artist, 33}, {tags.album, 63}};
+
+		for (unsigned int i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+			unsigned int length = 30;
+			unsigned char const * value = &tag[0] + fields[i].offset;
+
+			while ((length > 0) && ((value[length - 1] == 0) || (value[length - 1] == ' '))) {
+				--length;
+			}
+
+			// Anything after a terminator is left over from an earlier value
+			unsigned int end = 0;
+			while ((end < length) && (value[end] != 0)) {
+				++end;
+			}
+
+			if (fields[i].tag.empty()) {
+				fields[i].tag = from_latin1(value, end);
+			}
+		}
+
+		tags.details.setArtist(artist);
+
+		// ID3v1.1 keeps a track number in the last byte of a shortened comment
+		if ((tag[125] == 0) && (tag[126] != 0) && (tags.details.trackNumber() == 0)) {
+			tags.details.setTrackNumber(tag[126]);
+		}
+
+		return true;
+	}
+
+	/*
+		The fields of an MPEG audio frame header
+	*/
+	struct MpegHeader {
+		unsigned int version;
+		unsigned int layer;
+		unsigned long long bitrate;
+		unsigned long long sample_rate;
+		unsigned int channels;
+		unsigned long long length;
+		unsigned long long samples;
+	};
+
+	/*
+		Reads an MPEG audio frame header, returning false if it isn't a valid one
+	*/
+	bool read_mpeg_header(unsigned char const * header, MpegHeader & frame) {
+		static unsigned int const bitrates[5][15] = {
+			{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+			{0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+			{0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+			{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+			{0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}
+		};
+		static unsigned int const sample_rates[4][3] = {
+			{11025, 12000, 8000}, {0, 0, 0}, {22050, 24000, 16000}, {44100, 48000, 32000}
+		};
+
+		if ((header[0] != 0xff) || ((header[1] & 0xe0) != 0xe0)) {
+			return false;
+		}
+
+		unsigned int version = (header[1] >> 3) & 0x03;
+		unsigned int layer = (header[1] >> 1) & 0x03;
+		unsigned int bitrate_index = header[2] >> 4;
+		unsigned int sample_rate_index = (header[2] >> 2) & 0x03;
+		unsigned int padding = (header[2] >> 1) & 0x01;
+
+		if ((version == 1) || (layer == 0) || (bitrate_index == 0) || (bitrate_index == 15) ||
+		        (sample_rate_index == 3)) {
+			return false;
+		}
+
+		// Layer is stored as 3 for layer I down to 1 for layer III
+		unsigned int table = version == 3 ? 3 - layer : (layer == 3 ? 3 : 4);
+		frame.version = version;
+		frame.layer = 4 - layer;
+		frame.bitrate = bitrates[table][bitrate_index] * 1000ULL;
+		frame.sample_rate = sample_rates[version][sample_rate_index];
+		frame.channels = (header[3] >> 6) == 3 ? 1 : 2;
+
+		if (layer == 3) {
+			frame.length = (12 * frame.bitrate / frame.sample_rate + padding) * 4;
+			frame.samples = 384;
+		} else {
+			bool long_frame = (version == 3) || (layer == 2);
+			frame.length = (long_frame ? 144 : 72) * frame.bitrate / frame.sample_rate + padding;
+			frame.samples = long_frame ? 1152 : 576;
+		}
+
+		return true;
+	}
+
+	/*
+		Returns the length of the MPEG audio frame with the given header, or 0 if it isn't a valid header
+	*/
+	unsigned long long mpeg_frame_length(unsigned char const * header) {
+		MpegHeader frame;
+		return read_mpeg_header(header, frame) ? frame.length : 0;
+	}
+
+	/*
+		Checks for a run of MPEG audio frames starting exactly at offset, all of the same version, layer and sample rate.
+		Frames found inside other containers, such as the audio packets of an MPEG program stream, don't start there and
+		are left to the inspector.
+	*/
+	bool mpeg_audio_at(File const & file, unsigned long long offset) {
+		Bytes first;
+		unsigned long long next = offset;
+		for (unsigned int count = 0; count < min_mpeg_frames; ++count) {
+			// A stream too short for the whole run is accepted if its frames run exactly to the end of the file
+			if (next + 4 > file.size()) {
+				return (count > 0) && (next == file.size());
+			}
+
+			Bytes header;
+			if (!file.read(next, 4, header)) {
+				return false;
+			}
+
+			unsigned long long length = mpeg_frame_length(&header[0]);
+			if (length == 0) {
+				// Or to an ID3v1 tag
+				return (count > 0) && starts_with(header, 0, "TAG", 3);
+			}
+
+			if (count == 0) {
+				first = header;
+			} else if (((header[1] & 0xfe) != (first[1] & 0xfe)) || ((header[2] & 0x0c) != (first[2] & 0x0c))) {
+				return false;
+			}
+
+			next += length;
+		}
+
+		return true;
+	}
+
+	/*
+		Reads the details of an MPEG audio stream running from its first frame to end. Variable bitrate files count their
+		frames in a Xing or VBRI header in the first frame, otherwise the length comes from the bitrate.
+	*/
+	void read_mpeg_details(File const & file, unsigned long long offset, unsigned long long end, Tags & tags) {
+		Bytes data;
+		MpegHeader frame;
+		if (!file.read(offset, std::min< unsigned long long >(end - offset, 4 + 32 + 18), data) ||
+		        !read_mpeg_header(&data[0], frame)) {
+			return;
+		}
+
+		char const * const versions[] = {"2.5", "", "2", "1"};
+		char const * const layers[] = {"", "MP1", "MP2", "MP3"};
+		tags.details.setAudioCodec(std::string("MPEG-") + versions[frame.version] + " Layer " +
+		                           std::to_string(frame.layer) + " (" + layers[frame.layer] + ")");
+		tags.details.setSampleRate(frame.sample_rate);
+		tags.details.setChannels(frame.channels);
+
+		// The Xing header follows the side information, which is shorter for mono and for MPEG-2
+		unsigned int xing = 4 + (frame.version == 3 ? (frame.channels == 1 ? 17 : 32) : (frame.channels == 1 ? 9 : 17));
+		unsigned long long frames = 0;
+
+		if ((data.size() >= xing + 12) && (starts_with(data, xing, "Xing", 4) || starts_with(data, xing, "Info", 4)) &&
+		        (data[xing + 7] & 0x01)) {
+			frames = be32(&data[xing + 8]);
+		} else if ((data.size() >= 4 + 32 + 18) && starts_with(data, 4 + 32, "VBRI", 4)) {
+			frames = be32(&data[4 + 32 + 14]);
+		}
+
+		unsigned long long size = end - offset;
+		if (frames != 0) {
+			tags.details.setDuration(frames * frame.samples * 1000 / frame.sample_rate);
+			if (tags.details.duration() > 0) {
+				tags.details.setBitrate(size * 8000 / tags.details.duration());
+			}
+		} else {
+			tags.details.setBitrate(frame.bitrate);
+			tags.details.setDuration(size * 8000 / frame.bitrate);
+		}
+	}
+
+	/*
+		Reads MP3 files and FLAC files with ID3 tags
+	*/
+	bool read_id3(File const & file, Tags & tags) {
+		unsigned long long offset = read_id3v2(file, tags);
+
+		if (read_flac(file, offset, tags)) {
+			return true;
+		}
+
+		// The first frame follows the ID3v2 tag directly, or starts the file if there isn't one
+		if (!mpeg_audio_at(file, offset)) {
+			return false;
+		}
+
+		unsigned long long end = read_id3v1(file, tags) ? file.size() - 128 : file.size();
+		read_mpeg_details(file, offset, std::max(end, offset + 4), tags);
+
+		tags.audio = true;
+		return true;
+	}
+
+	/*
+		Calls back for each atom between begin and end of an MP4 atom tree held in memory
+	*/
+	template< typename Callback >
+	void mp4_atoms(unsigned char const * begin, unsigned char const * end, Callback callback) {
+		while (end - begin >= 8) {
+			unsigned long long size = be32(begin);
+			unsigned long long header = 8;
+
+			if (size == 1) {
+				if (end - begin < 16) {
+					return;
+				}
+
+				size = be64(begin + 8);
+				header = 16;
+			} else if (size == 0) {
+				size = end - begin;
+			}
+
+			if ((size < header) || (size > static_cast< unsigned long long >(end - begin))) {
+				return;
+			}
+
+			callback(std::string(reinterpret_cast< char const * >(begin) + 4, 4), begin + header, begin + size);
+			begin += size;
+		}
+	}
+
+	/*
+		Reads the tags from an iTunes style metadata list
+	*/
+	void read_mp4_ilst(unsigned char const * begin, unsigned char const * end, Tags & tags) {
+		mp4_atoms(begin, end, [&](std::string const & type, unsigned char const * item, unsigned char const * item_end) {
+			std::string artist;
+			std::string * tag = nullptr;
+			if (type == "\xa9nam") {
+				tag = &tags.title;
+			} else if (type == "\xa9" "alb") {
+				tag = &tags.album;
+			} else if (type == "\xa9" "ART") {
+				tag = &artist;
+			} else if (type != "trkn") {
+				return;
+			}
+
+			mp4_atoms(item, item_end, [&](std::string const & data_type, unsigned char const * data,
+			unsigned char const * data_end) {
+				// Text is flagged as UTF-8, or as UTF-16 in older files
+				if ((data_type != "data") || (data_end - data < 8)) {
+					return;
+				}
+
+				unsigned long long flags = be32(data) & 0xffffff;
+				if (type == "trkn") {
+					// The track number and count are held as binary numbers after two bytes of padding
+					if ((flags == 0) && (data_end - data >= 14)) {
+						tags.details.setTrackNumber(be16(data + 10));
+						tags.details.setTrackCount(be16(data + 12));
+					}
+				} else if (flags == 1) {
+					*tag = std::string(reinterpret_cast< char const * >(data) + 8, data_end - data - 8);
+				} else if (flags == 2) {
+					*tag = from_utf16(data + 8, data_end - data - 8, true);
+				}
+			});
+
+			if (!artist.empty()) {
+				tags.details.setArtist(artist);
+			}
+		});
+	}
+
+	/*
+		Reads a metadata atom, which is a full atom with a version and flags before its children. Some QuickTime files
+		leave these out.
+	*/
+	void read_mp4_meta(unsigned char const * begin, unsigned char const * end, Tags & tags) {
+		if ((end - begin >= 12) && (std::memcmp(begin + 4, "hdlr", 4) != 0)) {
+			begin += 4;
+		}
+
+		mp4_atoms(begin, end, [&](std::string const & type, unsigned char const * child, unsigned char const * child_end) {
+			if (type == "ilst") {
+				read_mp4_ilst(child, child_end, tags);
+			}
+		});
+	}
+
+	/*
+		What the media atom of a track says about its stream
+	*/
+	struct Mp4Track {
+		std::string handler;
+		unsigned long long timescale;
+
+		// The format and fields of the first sample description
+		std::string format;
+		unsigned char const * entry;
+		unsigned long long entry_size;
+
+		unsigned long long samples;
+		unsigned long long sample_time;
+	};
+
+	/*
+		Returns the name GStreamer gives the codec of an MP4 sample description format
+	*/
+	std::string mp4_codec(std::string const & format) {
+		struct {
+			char const * format;
+			char const * codec;
+		} const codecs[] = {
+			{"mp4a", "MPEG-4 AAC audio"}, {"alac", "Apple Lossless Audio (ALAC)"}, {"ac-3", "AC-3 audio"},
+			{"avc1", "H.264 / AVC"}, {"avc3", "H.264 / AVC"}, {"hvc1", "H.265 / HEVC"}, {"hev1", "H.265 / HEVC"},
+			{"mp4v", "MPEG-4 video"}
+		};
+
+		for (unsigned int i = 0; i < sizeof(codecs) / sizeof(codecs[0]); ++i) {
+			if (format == codecs[i].format) {
+				return codecs[i].codec;
+			}
+		}
+
+		return format;
+	}
+
+	/*
+		Reads the first sample description and the sample durations from a sample table atom
+	*/
+	void read_mp4_stbl(unsigned char const * begin, unsigned char const * end, Mp4Track & track) {
+		mp4_atoms(begin, end, [&](std::string const & type, unsigned char const * child, unsigned char const * child_end) {
+			if ((type == "stsd") && (child_end - child >= 16)) {
+				unsigned char const * entry = child + 8;
+				unsigned long long size = std::min< unsigned long long >(be32(entry), child_end - entry);
+
+				track.format.assign(reinterpret_cast< char const * >(entry) + 4, 4);
+				track.entry = entry;
+				track.entry_size = size;
+			} else if ((type == "stts") && (child_end - child >= 8)) {
+				unsigned long long count = be32(child + 4);
+				unsigned char const * sample = child + 8;
+
+				for (unsigned long long i = 0; (i < count) && (child_end - sample >= 8); ++i, sample += 8) {
+					track.samples += be32(sample);
+					track.sample_time += be32(sample) * be32(sample + 4);
+				}
+			}
+		});
+	}
+
+	/*
+		Reads the stream of a track from its media atom
+	*/
+	void read_mp4_mdia(unsigned char const * begin, unsigned char const * end, Tags & tags) {
+		Mp4Track track = {std::string(), 0, std::string(), nullptr, 0, 0, 0};
+
+		mp4_atoms(begin, end, [&](std::string const & type, unsigned char const * child, unsigned char const * child_end) {
+			if ((type == "hdlr") && (child_end - child >= 12)) {
+				track.handler.assign(reinterpret_cast< char const * >(child) + 8, 4);
+			} else if ((type == "mdhd") && (child_end - child >= 24)) {
+				track.timescale = be32(child + (child[0] == 1 ? 20 : 12));
+			} else if (type == "minf") {
+				mp4_atoms(child, child_end, [&](std::string const & minf_type, unsigned char const * stbl,
+				unsigned char const * stbl_end) {
+					if (minf_type == "stbl") {
+						read_mp4_stbl(stbl, stbl_end, track);
+					}
+				});
+			}
+		});
+
+		toolkit::MediaDetails & details = tags.details;
+
+		if (track.handler == "soun") {
+			tags.audio = true;
+
+			if (!track.format.empty()) {
+				details.setAudioCodec(mp4_codec(track.format));
+			}
+
+			// Sound descriptions hold the channels and a 16.16 fixed point sample rate
+			if (track.entry_size >= 36) {
+				details.setChannels(be16(track.entry + 24));
+				details.setSampleRate(be32(track.entry + 32) >> 16);
+			}
+		} else if (track.handler == "vide") {
+			tags.video = true;
+
+			if (!track.format.empty()) {
+				details.setVideoCodec(mp4_codec(track.format));
+			}
+
+			if (track.entry_size >= 36) {
+				details.setResolution(be16(track.entry + 32), be16(track.entry + 34));
+			}
+
+			if ((track.sample_time != 0) && (track.timescale != 0)) {
+				details.setFrameRate(static_cast< double >(track.samples) * track.timescale / track.sample_time);
+			}
+		}
+	}
+
+	/*
+		Reads the streams from the tracks of a movie atom, and the tags from its metadata
+	*/
+	void read_mp4_moov(unsigned char const * begin, unsigned char const * end, Tags & tags) {
+		mp4_atoms(begin, end, [&](std::string const & type, unsigned char const * child, unsigned char const * child_end) {
+			if ((type == "mvhd") && (child_end - child >= 32)) {
+				bool wide = child[0] == 1;
+				unsigned long long timescale = be32(child + (wide ? 20 : 12));
+				unsigned long long duration = wide ? be64(child + 24) : be32(child + 16);
+
+				if (timescale != 0) {
+					tags.details.setDuration(duration * 1000 / timescale);
+				}
+			} else if (type == "trak") {
+				mp4_atoms(child, child_end, [&](std::string const & trak_type, unsigned char const * mdia,
+				unsigned char const * mdia_end) {
+					if (trak_type == "mdia") {
+						read_mp4_mdia(mdia, mdia_end, tags);
+					}
+				});
+			} else if (type == "udta") {
+				mp4_atoms(child, child_end, [&](std::string const & udta_type, unsigned char const * meta,
+				unsigned char const * meta_end) {
+					if (udta_type == "meta") {
+						read_mp4_meta(meta, meta_end, tags);
+					}
+				});
+			} else if (type == "meta") {
+				read_mp4_meta(child, child_end, tags);
+			}
+		});
+	}
+
+	/*
+		Finds the movie atom of an MP4 file by skipping from one top level atom to the next, then reads it
+	*/
+	bool read_mp4(File const & file, Tags & tags) {
+		Bytes header;
+		if (!file.read(0, 8, header) || !starts_with(header, 4, "ftyp", 4)) {
+			return false;
+		}
+
+		unsigned long long offset = 0;
+		while (file.read(offset, 8, header)) {
+			unsigned long long size = be32(&header[0]);
+			unsigned long long header_size = 8;
+
+			if (size == 1) {
+				if (!file.read(offset, 16, header)) {
+					return false;
+				}
+
+				size = be64(&header[8]);
+				header_size = 16;
+			} else if (size == 0) {
+				size = file.size() - offset;
+			}
+
+			if (size < header_size) {
+				return false;
+			}
+
+			if (starts_with(header, 4, "moov", 4)) {
+				Bytes moov;
+				if (!file.read(offset + header_size, size - header_size, moov) || moov.empty()) {
+					return false;
+				}
+
+				read_mp4_moov(&moov[0], &moov[0] + moov.size(), tags);
+				if (tags.details.duration() > 0) {
+					tags.details.setBitrate(file.size() * 8000 / tags.details.duration());
+				}
+
+				return tags.audio || tags.video;
+			}
+
+			offset += size;
+		}
+
+		return false;
+	}
+}
+
+namespace toolkit {
+	class TagReaderPrivate {
+		Tags tags_;
+
+	public:
+		bool read(std::string const & uri);
+
+		inline bool audio() const;
+		inline bool video() const;
+
+		inline std::string title() const;
+		inline std::string album() const;
+
+		inline toolkit::MediaDetails details() const;
+	};
+
+	/*
+		Reads the streams and tags from a local file, returning false if it isn't in a format that can be read here
+	*/
+	bool TagReaderPrivate::read(std::string const & uri) {
+		tags_ = Tags();
+
+		std::string path(core::Path::fromUri(uri));
+		if (path.empty()) {
+			return false;
+		}
+
+		File file(path);
+		if (!file.valid()) {
+			return false;
+		}
+
+		bool found = read_ogg(file, tags_);
+
+		if (!found) {
+			tags_ = Tags();
+			found = read_flac(file, 0, tags_);
+		}
+
+		if (!found) {
+			tags_ = Tags();
+			found = read_mp4(file, tags_);
+		}
+
+		if (!found) {
+			tags_ = Tags();
+			found = read_id3(file, tags_);
+		}
+
+		if (!found) {
+			dprint("No native reader for %s", uri.c_str());
+			tags_ = Tags();
+		}
+
+		return found;
+	}
+
+	/*
+		Indicates whether the file has an audio stream
+	*/
+	bool TagReaderPrivate::audio() const {
+		return tags_.audio;
+	}
+
+	/*
+		Indicates whether the file has a video stream
+	*/
+	bool TagReaderPrivate::video() const {
+		return tags_.video;
+	}
+
+	/*
+		Returns any detected track title
+	*/
+	std::string TagReaderPrivate::title() const {
+		return tags_.title;
+	}
+
+	/*
+		Returns any detected album name
+	*/
+	std::string TagReaderPrivate::album() const {
+		return tags_.album;
+	}
+
+	/*
+		Returns everything else that was found about the streams and tags
+	*/
+	toolkit::MediaDetails TagReaderPrivate::details() const {
+		return tags_.details;
+	}
+
+	TagReader::TagReader()
+		: p(new TagReaderPrivate()) {}
+
+	TagReader::~TagReader() {
+		delete p;
+	}
+
+	/*
+		Asks the kernel to start reading the start and end of a local file in the background, which is where its
+		headers and tags are, so they are already in memory by the time it is read
+	*/
+	void TagReader::readAhead(std::string const & uri) {
+		std::string path(core::Path::fromUri(uri));
+		if (path.empty()) {
+			return;
+		}
+
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return;
+		}
+
+		struct stat info;
+		if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode)) {
+			unsigned long long size = info.st_size;
+			posix_fadvise(fd, 0, std::min(size, read_ahead_size), POSIX_FADV_WILLNEED);
+
+			if (size > read_ahead_size) {
+				unsigned long long tail = std::max(size - ogg_tail_size, read_ahead_size);
+				posix_fadvise(fd, tail, size - tail, POSIX_FADV_WILLNEED);
+			}
+		}
+
+		close(fd);
+	}
+
+	bool TagReader::read(std::string const & uri) const {
+		return p->read(uri);
+	}
+
+	bool TagReader::audio() const {
+		return p->audio();
+	}
+
+	bool TagReader::video() const {
+		return p->video();
+	}
+
+	std::string TagReader::album() const {
+		return p->album();
+	}
+
+	std::string TagReader::title() const {
+		return p->title();
+	}
+
+	MediaDetails TagReader::details() const {
+		return p->details();
+	}
+}
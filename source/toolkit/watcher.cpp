@@ -0,0 +1,467 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <debug.hpp>
+#include <core/filesystem.hpp>
+#include <toolkit/importer.hpp>
+#include <toolkit/library.hpp>
+#include <toolkit/watcher.hpp>
+
+extern "C" {
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+}
+
+namespace {
+	unsigned int const watch_mask(IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+	                              IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW);
+
+	// Longest a continuous burst of events can hold back changes, as a multiple of the delay
+	unsigned int const burst_limit(10);
+
+	/*
+		Returns the number of inotify watches each user may have, or 0 if it can't be found
+	*/
+	unsigned long long watch_limit() {
+		std::ifstream file("/proc/sys/fs/inotify/max_user_watches");
+		unsigned long long limit = 0;
+		file >> limit;
+		return limit;
+	}
+
+	/*
+		Returns a monotonic time in milliseconds
+	*/
+	long long now() {
+		timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return time.tv_sec * 1000LL + time.tv_nsec / 1000000LL;
+	}
+}
+
+namespace toolkit {
+	class WatcherPrivate {
+		Library & library_;
+		Importer & importer_;
+
+		long long delay_;
+
+		int fd_;
+
+		std::unordered_map< int, std::string > paths_;
+		std::map< std::string, int > descriptors_;
+		std::vector< std::string > roots_;
+
+		// Directories with changes waiting to be applied, and whether their subdirectories need scanning too
+		std::map< std::string, bool > dirty_;
+		long long first_change_;
+		long long last_change_;
+
+		unsigned long long limit_;
+		bool exhausted_;
+
+		bool add_watch(std::string const & path);
+		void add_watches(int parent, char const * name, std::string const & path);
+		void remove_watches(std::string const & path);
+		void rewatch();
+
+		void mark(std::string const & path, bool recursive);
+		void handle(inotify_event const * event);
+		void apply();
+
+	public:
+		WatcherPrivate(Library & library, Importer & importer, unsigned int delay);
+		~WatcherPrivate();
+
+		bool watch(std::string directory);
+
+		inline int descriptor() const;
+		bool process(int timeout);
+
+		inline unsigned long long watches() const;
+		inline unsigned long long limit() const;
+		inline bool exhausted() const;
+	};
+
+	WatcherPrivate::WatcherPrivate(Library & library, Importer & importer, unsigned int delay)
+		: library_(library), importer_(importer), delay_(delay), first_change_(0), last_change_(0),
+		  limit_(watch_limit()), exhausted_(false) {
+		fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd_ < 0) {
+			dprint("Unable to initialise inotify");
+		}
+	}
+
+	WatcherPrivate::~WatcherPrivate() {
+		if (fd_ >= 0) {
+			close(fd_);
+		}
+	}
+
+	/*
+		Watches a single directory, noting when the kernel's watch limit has been reached
+	*/
+	bool WatcherPrivate::add_watch(std::string const & path) {
+		int wd = inotify_add_watch(fd_, path.c_str(), watch_mask);
+
+		if (wd < 0) {
+			if ((errno == ENOSPC) && !exhausted_) {
+				dprint("Reached the limit of %llu inotify watches, changes beneath %s will only be found by rescanning",
+				       limit_, path.c_str());
+				exhausted_ = true;
+			}
+
+			return false;
+		}
+
+		// A directory replaced while events were lost gets a new watch in place of the old one
+		std::map< std::string, int >::iterator existing = descriptors_.find(path);
+		if ((existing != descriptors_.end()) && (existing->second != wd)) {
+			paths_.erase(existing->second);
+		}
+
+		paths_[wd] = path;
+		descriptors_[path] = wd;
+		return true;
+	}
+
+	/*
+		Watches a directory and all of its subdirectories
+	*/
+	void WatcherPrivate::add_watches(int parent, char const * name, std::string const & path) {
+		int fd = openat(parent, name, O_RDONLY | O_DIRECTORY);
+		if (fd < 0) {
+			return;
+		}
+
+		if (!add_watch(path)) {
+			close(fd);
+			return;
+		}
+
+		DIR * dir = fdopendir(fd);
+		if (dir == NULL) {
+			close(fd);
+			return;
+		}
+
+		dirent * entry;
+		struct stat status;
+
+		while ((entry = readdir(dir)) != NULL) {
+			if (entry->d_name[0] == '.') {
+				continue;
+			}
+
+			bool directory = entry->d_type == DT_DIR;
+			if (entry->d_type == DT_UNKNOWN) {
+				// Not all file systems fill in the type
+				directory = (fstatat(fd, entry->d_name, &status, AT_SYMLINK_NOFOLLOW) == 0) && S_ISDIR(status.st_mode);
+			}
+
+			if (directory) {
+				add_watches(fd, entry->d_name, path + "/" + entry->d_name);
+			}
+		}
+
+		closedir(dir);
+	}
+
+	/*
+		Stops watching a directory and all of its subdirectories
+	*/
+	void WatcherPrivate::remove_watches(std::string const & path) {
+		std::map< std::string, int >::iterator i = descriptors_.lower_bound(path);
+
+		while ((i != descriptors_.end()) && (i->first.compare(0, path.size(), path) == 0)) {
+			if ((i->first.size() > path.size()) && (i->first[path.size()] != '/')) {
+				// A sibling sharing the same prefix
+				++i;
+				continue;
+			}
+
+			inotify_rm_watch(fd_, i->second);
+			paths_.erase(i->second);
+			descriptors_.erase(i++);
+		}
+	}
+
+	/*
+		Walks the roots again after events have been lost, watching any directory created in the meantime and
+		forgetting those that have gone
+	*/
+	void WatcherPrivate::rewatch() {
+		struct stat status;
+
+		for (std::map< std::string, int >::iterator i = descriptors_.begin(); i != descriptors_.end();) {
+			if ((stat(i->first.c_str(), &status) != 0) || !S_ISDIR(status.st_mode)) {
+				// The kernel has already dropped the watch along with the directory
+				paths_.erase(i->second);
+				descriptors_.erase(i++);
+			} else {
+				++i;
+			}
+		}
+
+		unsigned long long before = descriptors_.size();
+		for (std::vector< std::string >::const_iterator i = roots_.begin(); i != roots_.end(); ++i) {
+			add_watches(AT_FDCWD, i->c_str(), *i);
+		}
+
+		dprint("Watching %llu new directories", descriptors_.size() - before);
+	}
+
+	/*
+		Notes that a directory needs to be scanned once the current burst of events is over
+	*/
+	void WatcherPrivate::mark(std::string const & path, bool recursive) {
+		long long time = now();
+
+		if (dirty_.empty()) {
+			first_change_ = time;
+		}
+
+		last_change_ = time;
+
+		std::pair< std::map< std::string, bool >::iterator, bool > inserted = dirty_.insert(std::make_pair(path, recursive));
+		if (!inserted.second) {
+			inserted.first->second = inserted.first->second || recursive;
+		}
+	}
+
+	/*
+		Works out which directories a single event affects
+	*/
+	void WatcherPrivate::handle(inotify_event const * event) {
+		if ((event->mask & IN_Q_OVERFLOW) != 0) {
+			// Events have been lost, fall back to checking everything
+			dprint("inotify queue overflowed, rescanning watched directories");
+			rewatch();
+
+			for (std::vector< std::string >::const_iterator i = roots_.begin(); i != roots_.end(); ++i) {
+				mark(*i, true);
+			}
+			return;
+		}
+
+		std::unordered_map< int, std::string >::iterator watched = paths_.find(event->wd);
+		if (watched == paths_.end()) {
+			return;
+		}
+
+		if ((event->mask & IN_IGNORED) != 0) {
+			// The watch was removed, either explicitly or because the directory was deleted
+			std::map< std::string, int >::iterator descriptor = descriptors_.find(watched->second);
+			if ((descriptor != descriptors_.end()) && (descriptor->second == event->wd)) {
+				descriptors_.erase(descriptor);
+			}
+
+			paths_.erase(watched);
+			return;
+		}
+
+		std::string const & directory = watched->second;
+
+		if ((event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) != 0) {
+			// Only matters for watched roots, other directories are handled through their parent's events
+			mark(directory, true);
+			return;
+		}
+
+		if ((event->len == 0) || (event->name[0] == '.')) {
+			return;
+		}
+
+		std::string path = directory + "/" + event->name;
+
+		if ((event->mask & IN_ISDIR) != 0) {
+			if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+				add_watches(AT_FDCWD, path.c_str(), path);
+			} else if ((event->mask & IN_MOVED_FROM) != 0) {
+				remove_watches(path);
+			}
+
+			mark(path, true);
+		} else {
+			mark(directory, false);
+		}
+	}
+
+	/*
+		Rescans every directory with changes in a single transaction
+	*/
+	void WatcherPrivate::apply() {
+		dprint("Applying changes to %zu directories", dirty_.size());
+		library_.begin();
+
+		for (std::map< std::string, bool >::const_iterator i = dirty_.begin(); i != dirty_.end(); ++i) {
+			// Skip directories that will be covered by a recursive scan of a parent
+			bool covered = false;
+
+			for (std::string::size_type separator = i->first.find('/', 1); !covered && (separator != std::string::npos);
+			        separator = i->first.find('/', separator + 1)) {
+				std::map< std::string, bool >::const_iterator parent = dirty_.find(i->first.substr(0, separator));
+				covered = (parent != dirty_.end()) && parent->second;
+			}
+
+			if (!covered) {
+				importer_.scan(i->first, Importer::Mode::Incremental, i->second);
+			}
+		}
+
+		library_.commit();
+		dirty_.clear();
+	}
+
+	/*
+		Starts watching a directory and everything beneath it
+	*/
+	bool WatcherPrivate::watch(std::string directory) {
+		if (fd_ < 0) {
+			return false;
+		}
+
+		core::Path root(directory);
+		if (!root.makeAbsolute()) {
+			return false;
+		}
+
+		directory = root.toString();
+		roots_.push_back(directory);
+
+		unsigned long long before = descriptors_.size();
+		add_watches(AT_FDCWD, directory.c_str(), directory);
+		dprint("Watching %llu directories beneath %s", descriptors_.size() - before, directory.c_str());
+
+		return descriptors_.find(directory) != descriptors_.end();
+	}
+
+	/*
+		Returns the inotify file descriptor, which becomes readable when there are events to process
+	*/
+	int WatcherPrivate::descriptor() const {
+		return fd_;
+	}
+
+	/*
+		Reads any pending events, waiting up to timeout milliseconds for some to arrive, and applies them to the
+		library once no more have arrived for the delay. Returns whether the library was changed.
+	*/
+	bool WatcherPrivate::process(int timeout) {
+		if (fd_ < 0) {
+			return false;
+		}
+
+		if (!dirty_.empty()) {
+			// Don't wait beyond the point that the changes are due to be applied
+			long long due = std::min(last_change_ + delay_, first_change_ + burst_limit * delay_) - now();
+			if ((timeout < 0) || (due < timeout)) {
+				timeout = due > 0 ? static_cast< int >(due) : 0;
+			}
+		}
+
+		pollfd events = {fd_, POLLIN, 0};
+		if (poll(&events, 1, timeout) > 0) {
+			char buffer[64 * 1024] __attribute__((aligned(__alignof__(inotify_event))));
+			ssize_t length;
+
+			while ((length = read(fd_, buffer, sizeof(buffer))) > 0) {
+				for (char * position = buffer; position < buffer + length;) {
+					inotify_event const * event = reinterpret_cast< inotify_event const * >(position);
+					handle(event);
+					position += sizeof(inotify_event) + event->len;
+				}
+			}
+		}
+
+		if (dirty_.empty()) {
+			return false;
+		}
+
+		long long time = now();
+		if ((time - last_change_ < delay_) && (time - first_change_ < burst_limit * delay_)) {
+			// Still in a burst of changes
+			return false;
+		}
+
+		apply();
+		return true;
+	}
+
+	/*
+		Returns the number of directories being watched
+	*/
+	unsigned long long WatcherPrivate::watches() const {
+		return descriptors_.size();
+	}
+
+	/*
+		Returns the kernel's limit on the number of watches per user, or 0 if unknown
+	*/
+	unsigned long long WatcherPrivate::limit() const {
+		return limit_;
+	}
+
+	/*
+		Indicates whether some directories couldn't be watched because the kernel's limit was reached
+	*/
+	bool WatcherPrivate::exhausted() const {
+		return exhausted_;
+	}
+
+	Watcher::Watcher(Library & library, Importer & importer, unsigned int delay)
+		: p(new WatcherPrivate(library, importer, delay)) {}
+
+	Watcher::~Watcher() {
+		delete p;
+	}
+
+	bool Watcher::watch(std::string directory) const {
+		return p->watch(std::move(directory));
+	}
+
+	int Watcher::descriptor() const {
+		return p->descriptor();
+	}
+
+	bool Watcher::process(int timeout) const {
+		return p->process(timeout);
+	}
+
+	unsigned long long Watcher::watches() const {
+		return p->watches();
+	}
+
+	unsigned long long Watcher::limit() const {
+		return p->limit();
+	}
+
+	bool Watcher::exhausted() const {
+		return p->exhausted();
+	}
+}
@@ -197,6 +197,41 @@ namespace test {
 			tables = db.tables();
 			equal(tables.size(), 1u);
 			equal(tables.at(0), "test2");
+
+			db.clear();
+			isTrue(db.tables().empty());
+		}
+
+		/*
+			Test grouping changes into transactions
+		*/
+		void transactions() {
+			::core::Database db;
+			::core::Statement create(db, "CREATE TABLE test (col1 PRIMARY KEY)");
+			isTrue(create.execute());
+
+			::core::Statement insert(db, "INSERT INTO test (col1) VALUES (?)");
+			::core::Statement count(db, "SELECT COUNT(*) FROM test");
+
+			isFalse(db.commit());
+			isFalse(db.rollback());
+
+			isTrue(db.begin());
+			isTrue(insert.bind(1u, 1LL));
+			isTrue(insert.execute());
+			isTrue(db.rollback());
+			isTrue(count.execute());
+			equal(count.toInteger(0u), 0LL);
+
+			isTrue(db.begin());
+			isTrue(db.begin());
+			isTrue(insert.bind(1u, 2LL));
+			isTrue(insert.execute());
+			isTrue(db.commit());
+			isTrue(db.commit());
+			count.reset();
+			isTrue(count.execute());
+			equal(count.toInteger(0u), 1LL);
 		}
 
 		void timeDb() {
@@ -252,6 +287,7 @@ namespace test {
 			insertData();
 			bindValues();
 			checkTables();
+			transactions();
 
 			time(timeDb, 50);
 		}
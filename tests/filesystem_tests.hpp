@@ -60,6 +60,21 @@ namespace test {
 			isFalse(multiple_dots.absolute());
 		}
 
+		/*
+			Test converting paths to URIs
+		*/
+		void pathUris() {
+			::core::Path plain("/media/music/track.ogg");
+			equal(plain.toUri(), "file:///media/music/track.ogg");
+
+			::core::Path reserved("/media/My Music/100% #1.ogg");
+			equal(reserved.toUri(), "file:///media/My%20Music/100%25%20%231.ogg");
+
+			equal(::core::Path::fromUri(reserved.toUri()), "/media/My Music/100% #1.ogg");
+			equal(::core::Path::fromUri("file:///media/music/track.ogg"), "/media/music/track.ogg");
+			equal(::core::Path::fromUri("http://example.com/track.ogg"), "");
+		}
+
 		/*
 			Test for path checking
 		*/
@@ -121,6 +136,7 @@ namespace test {
 			std::cout << "Current working directory: " << ::core::Path::current() << std::endl;
 
 			createPaths();
+			pathUris();
 			checkPaths();
 			absolutePaths();
 			makeDir();
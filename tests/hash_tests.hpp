@@ -0,0 +1,80 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <core/hash.hpp>
+
+namespace test {
+	namespace hash {
+		/*
+			Test hashing memory against known values
+		*/
+		void hashData() {
+			equal(::core::Hash::data("", 0), 0xEF46DB3751D8E999ULL);
+			equal(::core::Hash::data("a", 1), 0xD24EC4F1A98C6E5BULL);
+			notEqual(::core::Hash::data("a", 1, 1), ::core::Hash::data("a", 1));
+
+			std::string text("The quick brown fox jumps over the lazy dog");
+			equal(::core::Hash::data(text.data(), text.size()), ::core::Hash::data(text.data(), text.size()));
+			notEqual(::core::Hash::data(text.data(), text.size()), ::core::Hash::data(text.data(), text.size() - 1));
+		}
+
+		/*
+			Test fingerprinting files
+		*/
+		void hashFiles() {
+			equal(::core::Hash::file("aaaaaaaaaaaaaaaaaaaaaaa"), 0ULL);
+
+			unsigned long long audio = ::core::Hash::file("./tests/audio.ogg");
+			notEqual(audio, 0ULL);
+			equal(::core::Hash::file("./tests/audio.ogg"), audio);
+			notEqual(::core::Hash::file("./tests/video.ogg"), audio);
+
+			// Small files are always hashed in full
+			equal(::core::Hash::file("./tests/audio.ogg", true), audio);
+
+			// Larger files are sampled, so only a full fingerprint sees a change between the samples
+			std::vector< char > block(1024 * 1024, 'a');
+			std::ofstream("./tests/large.bin", std::ios::binary).write(&block[0], block.size());
+			unsigned long long sampled = ::core::Hash::file("./tests/large.bin");
+			unsigned long long full = ::core::Hash::file("./tests/large.bin", true);
+			notEqual(sampled, full);
+
+			block[200 * 1024] = 'b';
+			std::ofstream("./tests/large.bin", std::ios::binary).write(&block[0], block.size());
+			equal(::core::Hash::file("./tests/large.bin"), sampled);
+			notEqual(::core::Hash::file("./tests/large.bin", true), full);
+
+			equal(std::remove("./tests/large.bin"), 0);
+		}
+
+		void timeHash() {
+			static std::vector< unsigned char > const block(1024 * 1024, 0x5A);
+			::core::Hash::data(&block[0], block.size());
+		}
+
+		void runTests() {
+			hashData();
+			hashFiles();
+
+			time(timeHash, 100);
+		}
+	}
+}
@@ -0,0 +1,118 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <core/filesystem.hpp>
+#include <toolkit/history.hpp>
+#include <toolkit/library.hpp>
+
+namespace test {
+	namespace history {
+		/*
+			Test that events are written in batches and counted
+		*/
+		void batches() {
+			::toolkit::Library library("");
+			long long song = library.add("Song", "file:///song.ogg", ::toolkit::Library::Type::Music);
+			long long film = library.add("Film", "file:///film.ogg", ::toolkit::Library::Type::Movies);
+			library.add("Unplayed", "file:///unplayed.ogg", ::toolkit::Library::Type::Music);
+
+			{
+				::toolkit::History history(library, "", 4, 50);
+				history.played("file:///song.ogg");
+				history.skipped("file:///film.ogg");
+				history.played("file:///song.ogg");
+				equal(history.pending(), 3u);
+				equal(library.statistics(song).plays(), 0u);
+
+				// Reaching the threshold writes the batch
+				history.played("file:///film.ogg");
+				equal(history.pending(), 0u);
+				equal(library.statistics(song).plays(), 2u);
+				equal(library.statistics(film).plays(), 1u);
+				equal(library.statistics(film).skips(), 1u);
+				isTrue(library.statistics(film).lastPlayed() > 0);
+
+				// As does waiting for longer than the interval
+				history.played("file:///missing.ogg");
+				isFalse(history.process());
+				std::this_thread::sleep_for(std::chrono::milliseconds(60));
+				isTrue(history.process());
+				equal(history.pending(), 0u);
+
+				history.skipped("file:///song.ogg");
+			}
+
+			// Anything left is written when the history is destroyed
+			equal(library.statistics(song).skips(), 1u);
+
+			::toolkit::LibraryItemTable items = library.mostPlayed(10);
+			equal(items.size(), 2u);
+			equal(items[0].title(), "Song");
+			equal(library.recentlyPlayed(1).size(), 1u);
+			equal(library.statistics(0).plays(), 0u);
+		}
+
+		/*
+			Test that events left in the journal are written once, and only once
+		*/
+		void journal() {
+			::toolkit::Library library("");
+			long long song = library.add("Song", "file:///song.ogg", ::toolkit::Library::Type::Music);
+
+			{
+				// As left by a programme that stopped before writing its events
+				std::ofstream file("tests/history.journal");
+				file << "1 0 1000 file:///song.ogg\n2 1 1001 file:///song.ogg\n3 0 100";
+			}
+
+			{
+				::toolkit::History history(library, "tests/history.journal");
+				equal(history.pending(), 0u);
+				equal(library.statistics(song).plays(), 1u);
+				equal(library.statistics(song).skips(), 1u);
+				equal(library.statistics(song).lastPlayed(), 1000LL);
+				equal(library.playSequence(), 2u);
+
+				history.played("file:///song.ogg");
+				equal(history.pending(), 1u);
+			}
+
+			{
+				// Events already written are ignored if the journal wasn't emptied
+				std::ofstream file("tests/history.journal");
+				file << "2 1 1001 file:///song.ogg\n3 0 1002 file:///song.ogg\n";
+			}
+
+			{
+				::toolkit::History history(library, "tests/history.journal");
+				equal(library.statistics(song).plays(), 2u);
+				equal(library.statistics(song).skips(), 1u);
+			}
+
+			equal(std::remove("tests/history.journal"), 0);
+		}
+
+		void runTests() {
+			batches();
+			journal();
+		}
+	}
+}
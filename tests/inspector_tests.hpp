@@ -15,8 +15,23 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <core/filesystem.hpp>
 #include <toolkit/inspector.hpp>
+#include <toolkit/inspector_cache.hpp>
+#include <toolkit/inspector_pool.hpp>
+#include <toolkit/inspector_queue.hpp>
 
 namespace test {
 	namespace inspector {
@@ -62,11 +77,339 @@ namespace test {
 			isTrue(inspect.video());
 		}
 
+		/*
+			Test inspecting several files at once
+		*/
+		void poolTest() {
+			std::vector< std::string > uris;
+			uris.push_back("file://" + ::core::Path::current() + "/tests/audio.ogg");
+			uris.push_back("file://" + ::core::Path::current() + "/tests/video.ogg");
+			uris.push_back("file://" + ::core::Path::current() + "/tests/multi.ogg");
+			uris.push_back("asdf://asdf");
+
+			::toolkit::InspectorPool pool(2u, 1u);
+			isTrue(pool.threads() == 2u);
+
+			std::vector< bool > seen(uris.size(), false);
+			pool.inspect(uris, [&](::toolkit::InspectorResult const & result) {
+				seen.at(result.index()) = true;
+				equal(result.uri(), uris.at(result.index()));
+
+				switch (result.index()) {
+				case 0:
+					isTrue(result.valid());
+					isTrue(result.audio());
+					equal(result.title(), "Test Audio");
+					break;
+				case 1:
+					isTrue(result.video());
+					isFalse(result.audio());
+					break;
+				case 2:
+					isTrue(result.audio());
+					isTrue(result.video());
+					break;
+				default:
+					isFalse(result.valid());
+				}
+			});
+
+			isTrue(std::find(seen.begin(), seen.end(), false) == seen.end());
+		}
+
+		/*
+			Test inspecting a batch of files with one inspector
+		*/
+		void batchTest() {
+			std::vector< std::string > uris;
+			uris.push_back("file://" + ::core::Path::current() + "/tests/audio.ogg");
+			uris.push_back("asdf://asdf");
+			uris.push_back("file://" + ::core::Path::current() + "/tests/video.ogg");
+			uris.push_back("file://" + ::core::Path::current() + "/tests/multi.ogg");
+			uris.push_back("file://" + ::core::Path::current() + "/tests/audio.ogg");
+
+			std::shared_ptr< ::toolkit::InspectorCache > cache = std::make_shared< ::toolkit::InspectorCache >("");
+			::toolkit::Inspector inspect(0);
+
+			for (unsigned int pass = 0; pass < 3; ++pass) {
+				// The first pass goes without the cache, and the last has everything local in it already
+				if (pass == 1) {
+					inspect.setCache(cache);
+				}
+
+				std::vector< unsigned int > seen(uris.size(), 0);
+				inspect.inspectMany(uris, [&](::toolkit::InspectorResult const & result) {
+					++seen.at(result.index());
+					equal(result.uri(), uris.at(result.index()));
+
+					switch (result.index()) {
+					case 0:
+					case 4:
+						isTrue(result.valid());
+						isTrue(result.audio());
+						isFalse(result.video());
+						equal(result.title(), "Test Audio");
+						equal(result.details().duration(), 44412LL);
+						break;
+					case 2:
+						isTrue(result.video());
+						isFalse(result.audio());
+						break;
+					case 3:
+						isTrue(result.audio());
+						isTrue(result.video());
+						break;
+					default:
+						isFalse(result.valid());
+					}
+				});
+
+				isTrue(seen == std::vector< unsigned int >(uris.size(), 1u));
+			}
+
+			// The copy of the first file in the same batch is found in the cache
+			equal(cache->misses(), 3u);
+			equal(cache->hits(), 5u);
+
+			unsigned int calls = 0;
+			inspect.inspectMany(std::vector< std::string >(), [&](::toolkit::InspectorResult const &) {
+				++calls;
+			});
+			equal(calls, 0u);
+		}
+
+		/*
+			Test inspecting one file after another with the same inspector
+		*/
+		void reuseTest() {
+			::toolkit::Inspector inspect(0, false);
+			isFalse(inspect.valid());
+
+			isTrue(inspect.inspect("file://" + ::core::Path::current() + "/tests/audio.ogg"));
+			isTrue(inspect.audio());
+			equal(inspect.title(), "Test Audio");
+
+			// Nothing is carried over from the previous file
+			isTrue(inspect.inspect("file://" + ::core::Path::current() + "/tests/video.ogg"));
+			isFalse(inspect.audio());
+			isTrue(inspect.video());
+			isTrue(inspect.title().empty());
+			isTrue(inspect.album().empty());
+
+			isFalse(inspect.inspect("asdf://asdf"));
+			isFalse(inspect.audio());
+			isFalse(inspect.video());
+
+			// A failure doesn't stop the next file being read
+			isTrue(inspect.inspect("file://" + ::core::Path::current() + "/tests/multi.ogg"));
+			isTrue(inspect.audio());
+			isTrue(inspect.video());
+		}
+
+		/*
+			Test inspecting files without waiting for them
+		*/
+		void queueTest() {
+			std::vector< std::string > uris;
+			uris.push_back("file://" + ::core::Path::current() + "/tests/audio.ogg");
+			uris.push_back("file://" + ::core::Path::current() + "/tests/video.ogg");
+			uris.push_back("file://" + ::core::Path::current() + "/tests/multi.ogg");
+			uris.push_back("asdf://asdf");
+
+			::toolkit::InspectorQueue queue(5000u, 2u);
+			isTrue(queue.pending() == 0);
+
+			std::vector< unsigned long long > ids;
+			std::vector< bool > seen(uris.size(), false);
+
+			for (std::vector< std::string >::const_iterator uri = uris.begin(); uri != uris.end(); ++uri) {
+				unsigned int index = uri - uris.begin();
+				ids.push_back(queue.inspect(*uri, [&, index](::toolkit::InspectorResult const & result) {
+					isFalse(seen.at(index));
+					seen.at(index) = true;
+					isTrue(result.index() == ids.at(index));
+					equal(result.uri(), uris.at(index));
+
+					switch (index) {
+					case 0:
+						isTrue(result.valid());
+						isTrue(result.audio());
+						equal(result.title(), "Test Audio");
+						break;
+					case 1:
+						isTrue(result.valid());
+						isTrue(result.video());
+						isFalse(result.audio());
+						break;
+					case 2:
+						isTrue(result.audio());
+						isTrue(result.video());
+						break;
+					default:
+						isFalse(result.valid());
+						isTrue(result.title().empty());
+					}
+				}));
+			}
+
+			// Nothing is read until the main context runs
+			isTrue(queue.pending() == uris.size());
+			std::vector< unsigned long long > sorted(ids);
+			std::sort(sorted.begin(), sorted.end());
+			isTrue(std::unique(sorted.begin(), sorted.end()) == sorted.end());
+
+			bool cancelled_called = false;
+			unsigned long long cancelled = queue.inspect(uris.at(0), [&](::toolkit::InspectorResult const &) {
+				cancelled_called = true;
+			});
+			isTrue(queue.cancel(cancelled));
+			isFalse(queue.cancel(cancelled));
+
+			queue.wait();
+			isTrue(queue.pending() == 0);
+			isTrue(std::find(seen.begin(), seen.end(), false) == seen.end());
+			isFalse(cancelled_called);
+		}
+
+		/*
+			Test that a source that never responds is given up on without holding up the others
+		*/
+		void deadlineTest() {
+			// Connections are accepted by the kernel but never answered
+			int server = socket(AF_INET, SOCK_STREAM, 0);
+			isTrue(server >= 0);
+
+			sockaddr_in address = sockaddr_in();
+			address.sin_family = AF_INET;
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			socklen_t length = sizeof(address);
+			isTrue(bind(server, reinterpret_cast< sockaddr * >(&address), length) == 0);
+			isTrue(listen(server, 4) == 0);
+			isTrue(getsockname(server, reinterpret_cast< sockaddr * >(&address), &length) == 0);
+
+			std::string stalled = "http://127.0.0.1:" + std::to_string(ntohs(address.sin_port)) + "/stalled.ogg";
+			unsigned int const timeout = 500;
+
+			::toolkit::InspectorQueue queue(5000u, 2u);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			double stalled_seconds = -1;
+			queue.inspect(stalled, [&](::toolkit::InspectorResult const & result) {
+				stalled_seconds = std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+				isFalse(result.valid());
+				isFalse(result.audio());
+				equal(result.uri(), stalled);
+			}, timeout);
+
+			unsigned int completed = 0;
+			for (unsigned int i = 0; i < 3; ++i) {
+				queue.inspect("file://" + ::core::Path::current() + "/tests/multi.ogg",
+				[&](::toolkit::InspectorResult const & result) {
+					isTrue(result.valid());
+					++completed;
+				});
+			}
+
+			queue.wait();
+			close(server);
+
+			equal(completed, 3u);
+			isTrue(stalled_seconds >= timeout / 1e3);
+			isTrue(stalled_seconds < timeout / 1e3 + 2);
+
+			std::cout << "Gave up on an unresponsive source after " << stalled_seconds * 1e3 << " millisecond(s)" <<
+			          std::endl;
+		}
+
+		/*
+			Test what was found by inspecting a file is kept until the file changes
+		*/
+		void cacheTest() {
+			std::string uri("file://" + ::core::Path::current() + "/tests/cached.ogg");
+			{
+				std::ifstream source("tests/audio.ogg", std::ios::binary);
+				std::ofstream destination("tests/cached.ogg", std::ios::binary);
+				destination << source.rdbuf();
+			}
+
+			::toolkit::LibraryFile file = ::toolkit::InspectorCache::identify(uri);
+			equal(file.path(), ::core::Path::current() + "/tests/cached.ogg");
+			notEqual(file.inode(), 0u);
+			isTrue(::toolkit::InspectorCache::identify("http://localhost/audio.ogg").path().empty());
+			isTrue(::toolkit::InspectorCache::identify(uri + ".missing").path().empty());
+
+			::toolkit::MediaDetails details;
+			details.setDuration(44412);
+			details.setArtist("Artist");
+
+			{
+				::toolkit::InspectorCache cache("./tests/cache.db");
+				::toolkit::InspectorResult result(7, uri);
+				isFalse(cache.find(file, result));
+				equal(cache.misses(), 1u);
+
+				cache.store(file, ::toolkit::InspectorResult(0, uri, true, true, false, "Title", "", details));
+				isTrue(cache.find(file, result));
+				equal(cache.hits(), 1u);
+				equal(result.index(), 7u);
+				equal(result.uri(), uri);
+				isTrue(result.valid());
+				isTrue(result.audio());
+				isFalse(result.video());
+				equal(result.title(), "Title");
+				isTrue(result.album().empty());
+				equal(result.details().duration(), 44412LL);
+				equal(result.details().artist(), "Artist");
+			}
+
+			{
+				// Kept between runs, but not once the file has changed
+				::toolkit::InspectorCache cache("./tests/cache.db");
+				::toolkit::InspectorResult result(0, uri);
+				isTrue(cache.find(file, result));
+
+				::toolkit::LibraryFile changed(file.path(), file.device(), file.inode(), file.size() + 1, file.modified());
+				isFalse(cache.find(changed, result));
+				equal(cache.hits(), 1u);
+				equal(cache.misses(), 1u);
+			}
+
+			{
+				// An inspector with a cache only reads a file the first time
+				std::shared_ptr< ::toolkit::InspectorCache > cache = std::make_shared< ::toolkit::InspectorCache >("");
+				::toolkit::Inspector inspect(0);
+				inspect.setCache(cache);
+
+				for (unsigned int i = 0; i < 3; ++i) {
+					isTrue(inspect.inspect(uri));
+					isTrue(inspect.audio());
+					equal(inspect.title(), "Test Audio");
+					equal(inspect.album(), "Test Album");
+				}
+
+				equal(cache->misses(), 1u);
+				equal(cache->hits(), 2u);
+
+				// Sources that aren't local files go straight to the pipeline
+				isFalse(inspect.inspect("asdf://asdf"));
+				equal(cache->misses() + cache->hits(), 3u);
+			}
+
+			equal(std::remove("tests/cached.ogg"), 0);
+			equal(std::remove("tests/cache.db"), 0);
+		}
+
 		void runTests() {
 			invalidTest();
 			audioTest();
 			videoTest();
 			multiTest();
+			reuseTest();
+			poolTest();
+			batchTest();
+			queueTest();
+			deadlineTest();
+			cacheTest();
 		}
 	}
 }
@@ -0,0 +1,1123 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <core/database.hpp>
+#include <core/filesystem.hpp>
+#include <toolkit/importer.hpp>
+#include <toolkit/inspector_cache.hpp>
+#include <toolkit/library.hpp>
+#include <toolkit/library_search.hpp>
+#include <toolkit/watcher.hpp>
+
+namespace test {
+	namespace library {
+		/*
+			Test adding and listing items
+		*/
+		void addItems() {
+			::toolkit::Library library("");
+
+			notEqual(library.add("Song", "file:///song.ogg", ::toolkit::Library::Type::Music, "", "Album"), 0LL);
+			notEqual(library.add("Film", "file:///film.ogg", ::toolkit::Library::Type::Movies), 0LL);
+			equal(library.add("All", "file:///all.ogg", ::toolkit::Library::Type::All), 0LL);
+
+			::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+			equal(items.size(), 2u);
+
+			items = library.list(::toolkit::Library::Type::Music);
+			equal(items.size(), 1u);
+			equal(items.at(0).title(), "Song");
+			equal(items.at(0).uri(), "file:///song.ogg");
+
+			items = library.search(::toolkit::Library::Type::All, "Alb");
+			equal(items.size(), 1u);
+			equal(items.at(0).title(), "Song");
+		}
+
+		/*
+			Finds the count of a facet, or 0 if it isn't listed
+		*/
+		unsigned long long facetCount(std::vector< ::toolkit::LibraryFacet > const & facets,
+		                              ::toolkit::LibraryFacet::Kind kind, std::string const & name) {
+			for (std::vector< ::toolkit::LibraryFacet >::const_iterator i = facets.begin(); i != facets.end(); ++i) {
+				if ((i->kind() == kind) && (i->name() == name)) {
+					return i->count();
+				}
+			}
+
+			return 0;
+		}
+
+		/*
+			Test that counts follow items being added, moved and removed
+		*/
+		void facets() {
+			::toolkit::Library library("");
+			equal(library.count(::toolkit::Library::Type::All), 0u);
+
+			long long song = library.add("Song", "file:///music/album/song.ogg", ::toolkit::Library::Type::Music, "",
+			                             "Album");
+			library.addFile(::toolkit::LibraryFile("/music/album/song.ogg", 1u, 1u, 1u, 1LL), song);
+			library.add("Other", "file:///music/album/other.ogg", ::toolkit::Library::Type::Music, "", "Album");
+			library.add("Film", "file:///films/film.ogg", ::toolkit::Library::Type::Movies);
+
+			equal(library.count(::toolkit::Library::Type::All), 3u);
+			equal(library.count(::toolkit::Library::Type::Music), 2u);
+			equal(library.count(::toolkit::Library::Type::Movies), 1u);
+
+			std::vector< ::toolkit::LibraryFacet > facets = library.facets();
+			equal(facets.size(), 5u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Type, "music"), 2u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Type, "movies"), 1u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Album, "Album"), 2u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Directory, "file:///music/album/"), 2u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Directory, "file:///films/"), 1u);
+
+			// Moving the only copy to another directory moves the item
+			library.addFile(::toolkit::LibraryFile("/music/moved/song.ogg", 1u, 1u, 1u, 1LL), song);
+			library.removeFiles(std::vector< std::string >(1, "/music/album/song.ogg"));
+			facets = library.facets();
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Directory, "file:///music/album/"), 1u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Directory, "file:///music/moved/"), 1u);
+
+			// Empty albums and directories are no longer listed
+			library.removeFiles(std::vector< std::string >(1, "/music/moved/song.ogg"));
+			facets = library.facets();
+			equal(facets.size(), 5u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Directory, "file:///music/moved/"), 0u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Album, "Album"), 1u);
+			equal(library.count(::toolkit::Library::Type::Music), 1u);
+
+			// Items on a volume are counted along with the rest while it is attached
+			isTrue(library.attachVolume("drive", "file:///media/drive/", "./tests/volume.db"));
+			library.add("Drive", "file:///media/drive/music/drive.ogg", ::toolkit::Library::Type::Music, "", "Album");
+			library.add("Loose", "file:///media/drive/loose.ogg", ::toolkit::Library::Type::Music, "", "Drive Album");
+			facets = library.facets();
+			equal(facets.size(), 8u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Type, "music"), 3u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Album, "Album"), 2u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Album, "Drive Album"), 1u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Directory, "file:///media/drive/music/"), 1u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Directory, "file:///media/drive/"), 1u);
+
+			isTrue(library.detachVolume("drive"));
+			facets = library.facets();
+			equal(facets.size(), 5u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Type, "music"), 1u);
+			equal(facetCount(facets, ::toolkit::LibraryFacet::Kind::Album, "Drive Album"), 0u);
+
+			equal(std::remove("./tests/volume.db"), 0);
+		}
+
+		/*
+			Test finding items despite spelling mistakes
+		*/
+		void fuzzySearch() {
+			::toolkit::Library library("");
+			library.add("Come Together", "file:///come.ogg", ::toolkit::Library::Type::Music, "", "Abbey Road (The Beatles)");
+			library.add("The Godfather", "file:///godfather.ogg", ::toolkit::Library::Type::Movies);
+			library.add("The Godfather Part II", "file:///godfather2.ogg", ::toolkit::Library::Type::Movies);
+			library.add("Father Ted", "file:///ted.ogg", ::toolkit::Library::Type::Movies);
+
+			isTrue(library.search(::toolkit::Library::Type::All, "beetles").empty());
+
+			::toolkit::LibraryItemTable items = library.search(::toolkit::Library::Type::All, "beetles",
+			                                    ::toolkit::Library::Match::Fuzzy);
+			equal(items.size(), 1u);
+			equal(items[0].title(), "Come Together");
+
+			items = library.search(::toolkit::Library::Type::Movies, "Godfater", ::toolkit::Library::Match::Fuzzy);
+			equal(items.size(), 2u);
+			equal(items[0].title(), "The Godfather");
+
+			equal(library.search(::toolkit::Library::Type::Music, "Godfater", ::toolkit::Library::Match::Fuzzy).size(), 0u);
+			equal(library.search(::toolkit::Library::Type::All, "godfather", ::toolkit::Library::Match::Fuzzy, 1).size(), 1u);
+			isTrue(library.search(::toolkit::Library::Type::All, "xyzzy", ::toolkit::Library::Match::Fuzzy).empty());
+
+			// The index follows changes to the library
+			library.add("Beetlejuice", "file:///beetlejuice.ogg", ::toolkit::Library::Type::Movies);
+			items = library.search(::toolkit::Library::Type::All, "beetles", ::toolkit::Library::Match::Fuzzy);
+			equal(items.size(), 2u);
+		}
+
+		/*
+			Test searching as a term is typed and corrected
+		*/
+		void incrementalSearch() {
+			::toolkit::Library library("");
+			library.add("Summer Nights", "file:///summer.ogg", ::toolkit::Library::Type::Music, "", "Grease");
+			library.add("Summertime", "file:///summertime.ogg", ::toolkit::Library::Type::Music, "", "Porgy and Bess");
+			library.add("Night of the Living Dead", "file:///night.ogg", ::toolkit::Library::Type::Movies);
+
+			::toolkit::LibrarySearch search(library);
+			equal(search.search(::toolkit::Library::Type::All, "").size(), 3u);
+			equal(search.search(::toolkit::Library::Type::All, "s").size(), 2u);
+			equal(search.search(::toolkit::Library::Type::All, "summer").size(), 2u);
+			equal(search.search(::toolkit::Library::Type::All, "summer ").size(), 2u);
+			equal(search.search(::toolkit::Library::Type::All, "summer n").size(), 1u);
+			equal(search.search(::toolkit::Library::Type::All, "summer n")[0].title(), "Summer Nights");
+
+			// Deleting characters goes back to a wider search
+			equal(search.search(::toolkit::Library::Type::All, "n").size(), 2u);
+			equal(search.search(::toolkit::Library::Type::Movies, "n").size(), 1u);
+			equal(search.search(::toolkit::Library::Type::All, "GREASE").size(), 1u);
+			equal(search.search(::toolkit::Library::Type::All, "ummer").size(), 0u);
+
+			// New items are found straight away
+			library.add("Summer of '69", "file:///69.ogg", ::toolkit::Library::Type::Music);
+			equal(search.search(::toolkit::Library::Type::All, "summer").size(), 3u);
+			equal(search.search(::toolkit::Library::Type::All, "summer 69").size(), 1u);
+		}
+
+		/*
+			Test that smart playlists list the items matching their rules
+		*/
+		void smartPlaylists() {
+			typedef ::toolkit::LibraryRule Rule;
+
+			{
+				::toolkit::Library library("./tests/smart.db");
+				long long song = library.add("Song", "file:///music/song.ogg", ::toolkit::Library::Type::Music, "", "Album");
+				library.add("Other Song", "file:///music/other.ogg", ::toolkit::Library::Type::Music, "", "Album");
+				library.add("Single", "file:///music/single.ogg", ::toolkit::Library::Type::Music, "", "Single");
+				library.add("Film", "file:///movies/film.ogg", ::toolkit::Library::Type::Movies);
+
+				isTrue(library.setSmartPlaylist("Music", std::vector< Rule >(1, Rule(Rule::Field::Type, Rule::Comparison::Is,
+				                                "music"))));
+				equal(library.smartPlaylist("Music").size(), 3u);
+
+				// Changing the items returned leaves those the playlist keeps alone
+				::toolkit::LibraryItemTable music = library.smartPlaylist("Music");
+				music.add(100, "Added", "file:///added.ogg");
+				equal(music.size(), 4u);
+				equal(library.smartPlaylist("Music").size(), 3u);
+
+				// Rules that don't make sense for their field are refused
+				isFalse(library.setSmartPlaylist("Bad", std::vector< Rule >(1, Rule(Rule::Field::Type,
+				                                 Rule::Comparison::Less, 1LL))));
+				equal(library.smartPlaylists().size(), 1u);
+
+				std::vector< Rule > rules;
+				rules.push_back(Rule(Rule::Field::Album, Rule::Comparison::Is, "Album"));
+				rules.push_back(Rule(Rule::Field::Title, Rule::Comparison::Contains, "other"));
+				library.setSmartPlaylist("Either", rules, false);
+				library.setSmartPlaylist("Both", rules, true);
+				equal(library.smartPlaylist("Either").size(), 2u);
+				equal(library.smartPlaylist("Both").size(), 1u);
+				equal(library.smartPlaylist("Both")[0].title(), "Other Song");
+
+				// Items without an album aren't in any album
+				library.setSmartPlaylist("Not album", std::vector< Rule >(1, Rule(Rule::Field::Album, Rule::Comparison::IsNot,
+				                         "Album")));
+				equal(library.smartPlaylist("Not album").size(), 2u);
+
+				// Items that have never been played count as played no times
+				library.setSmartPlaylist("Unplayed", std::vector< Rule >(1, Rule(Rule::Field::Plays, Rule::Comparison::Less,
+				                         1LL)));
+				library.setSmartPlaylist("Played", std::vector< Rule >(1, Rule(Rule::Field::Plays, Rule::Comparison::Greater,
+				                         0LL)));
+				library.setSmartPlaylist("Recent", std::vector< Rule >(1, Rule(Rule::Field::LastPlayed,
+				                         Rule::Comparison::Within, 3600LL)));
+				library.setSmartPlaylist("New", std::vector< Rule >(1, Rule(Rule::Field::Added, Rule::Comparison::Within,
+				                         3600LL)));
+				equal(library.smartPlaylist("Unplayed").size(), 4u);
+				equal(library.smartPlaylist("Played").size(), 0u);
+				equal(library.smartPlaylist("Recent").size(), 0u);
+				equal(library.smartPlaylist("New").size(), 4u);
+
+				// Cached results are replaced once the statistics they use change
+				library.addPlays(std::vector< ::toolkit::LibraryPlay >(1, ::toolkit::LibraryPlay(library.playSequence() + 1,
+				                 "file:///music/song.ogg", false, std::chrono::duration_cast< std::chrono::seconds >(
+				                     std::chrono::system_clock::now().time_since_epoch()).count())));
+				equal(library.statistics(song).plays(), 1u);
+				equal(library.smartPlaylist("Unplayed").size(), 3u);
+				equal(library.smartPlaylist("Played").size(), 1u);
+				equal(library.smartPlaylist("Played")[0].id(), song);
+				equal(library.smartPlaylist("Recent").size(), 1u);
+
+				// And when items are added
+				library.add("Another Film", "file:///movies/another.ogg", ::toolkit::Library::Type::Movies);
+				equal(library.smartPlaylist("Music").size(), 3u);
+				equal(library.smartPlaylist("Unplayed").size(), 4u);
+
+				library.setSmartPlaylist("Limited", std::vector< Rule >(), true, 2);
+				equal(library.smartPlaylist("Limited").size(), 2u);
+
+				library.removeSmartPlaylist("Limited");
+				equal(library.smartPlaylist("Limited").size(), 0u);
+				equal(library.smartPlaylist("Missing").size(), 0u);
+			}
+
+			{
+				// Rules are kept in the database
+				::toolkit::Library library("./tests/smart.db");
+				equal(library.smartPlaylists().size(), 8u);
+				equal(library.smartPlaylist("Both").size(), 1u);
+				equal(library.smartPlaylist("Either").size(), 3u);
+				equal(library.smartPlaylist("Played").size(), 1u);
+			}
+
+			equal(std::remove("./tests/smart.db"), 0);
+			std::remove("./tests/smart.db.snapshot");
+		}
+
+		/*
+			Test storing items relative to roots and moving them
+		*/
+		void roots() {
+			{
+				::toolkit::Library library("./tests/roots.db");
+				library.add("Before", "file:///media/drive/music/before.ogg", ::toolkit::Library::Type::Music, "", "Album");
+				library.add("Elsewhere", "file:///home/music/elsewhere.ogg", ::toolkit::Library::Type::Music);
+
+				long long root = library.addRoot("file:///media/drive/");
+				notEqual(root, 0LL);
+				equal(library.addRoot("file:///media/drive/music/"), root);
+				equal(library.roots().size(), 1u);
+
+				long long after = library.add("After", "file:///media/drive/music/after.ogg", ::toolkit::Library::Type::Music, "",
+				                              "Album");
+				library.addPlays(std::vector< ::toolkit::LibraryPlay >(1, ::toolkit::LibraryPlay(1, "file:///media/drive/music/after.ogg",
+				                 false, 10)));
+				equal(library.statistics(after).plays(), 1u);
+
+				library.addFile(::toolkit::LibraryFile("/media/drive/music/after.ogg", 1u, 2u, 3u, 4LL), after);
+				library.addFile(::toolkit::LibraryFile("/media/drivers/notes.txt", 1u, 5u, 6u, 7LL));
+
+				isTrue(library.relocateRoot("file:///media/drive/", "file:///mnt/drive/"));
+				isFalse(library.relocateRoot("file:///media/drive/", "file:///mnt/other/"));
+				equal(library.roots()[0], "file:///mnt/drive/");
+
+				// Recorded files move with their root so they aren't inspected again
+				std::vector< ::toolkit::LibraryFile > moved = library.files("/mnt/drive");
+				equal(moved.size(), 1u);
+				equal(moved.at(0).path(), "/mnt/drive/music/after.ogg");
+				isTrue(::toolkit::LibraryFile("/mnt/drive/music/after.ogg", 1u, 2u, 3u, 4LL).unchanged(moved.at(0)));
+				isTrue(library.files("/media/drive").empty());
+				equal(library.files("/media/drivers").size(), 1u);
+
+				std::vector< std::string > uris;
+				::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+				for (std::size_t i = 0; i < items.size(); ++i) {
+					uris.push_back(items[i].uri());
+				}
+				std::sort(uris.begin(), uris.end());
+				equal(uris.size(), 3u);
+				equal(uris[0], "file:///home/music/elsewhere.ogg");
+				equal(uris[1], "file:///mnt/drive/music/after.ogg");
+				equal(uris[2], "file:///mnt/drive/music/before.ogg");
+
+				// Directories follow their root
+				std::vector< ::toolkit::LibraryFacet > counts = library.facets();
+				equal(facetCount(counts, ::toolkit::LibraryFacet::Kind::Directory, "file:///mnt/drive/music/"), 2ULL);
+				equal(facetCount(counts, ::toolkit::LibraryFacet::Kind::Directory, "file:///media/drive/music/"), 0ULL);
+
+				// Plays are found at the new location
+				library.addPlays(std::vector< ::toolkit::LibraryPlay >(1, ::toolkit::LibraryPlay(2, "file:///mnt/drive/music/after.ogg",
+				                 false, 20)));
+				equal(library.statistics(after).plays(), 2u);
+
+				// A wider root carries the roots beneath it when moved
+				library.addRoot("file:///mnt/");
+				isTrue(library.relocateRoot("file:///mnt/", "file:///media/"));
+				equal(library.roots().size(), 2u);
+				equal(library.items(std::vector< long long >(1, after))[0].uri(), "file:///media/drive/music/after.ogg");
+
+				// Only a root itself can be moved, and only what is beneath it as a directory moves with it
+				isFalse(library.relocateRoot("file:///", "file:///elsewhere/"));
+				isFalse(library.relocateRoot("file:///media/dri", "file:///elsewhere/"));
+				long long music = library.addRoot("file:///srv/music");
+				long long musicals = library.add("Musical", "file:///srv/musicals/song.ogg", ::toolkit::Library::Type::Music);
+				isTrue(library.relocateRoot("file:///srv/music", "file:///srv/songs"));
+				equal(library.roots().size(), 3u);
+				equal(library.addRoot("file:///srv/songs"), music);
+				equal(library.items(std::vector< long long >(1, musicals))[0].uri(), "file:///srv/musicals/song.ogg");
+			}
+
+			equal(std::remove("./tests/roots.db"), 0);
+			std::remove("./tests/roots.db.snapshot");
+		}
+
+		/*
+			Test keeping the items on a drive in a database of its own
+		*/
+		void volumes() {
+			std::vector< long long > ids;
+
+			{
+				::toolkit::Library library("./tests/main.db");
+				library.add("Local", "file:///home/music/local.ogg", ::toolkit::Library::Type::Music, "", "B");
+				long long generation = library.generation();
+
+				isTrue(library.attachVolume("drive", "file:///media/drive/", "./tests/volume.db"));
+				isFalse(library.attachVolume("drive", "file:///media/other/", "./tests/volume.db"));
+				equal(library.volumes().size(), 1u);
+				isTrue(library.generation() > generation);
+
+				ids.push_back(library.add("First", "file:///media/drive/first.ogg", ::toolkit::Library::Type::Music, "", "A"));
+				ids.push_back(library.add("Second", "file:///media/drive/second.ogg", ::toolkit::Library::Type::Movies, "",
+				                          "C"));
+				notEqual(ids[0], ids[1]);
+				isTrue(ids[0] > (1LL << 40));
+
+				equal(library.count(::toolkit::Library::Type::All), 3u);
+				equal(library.count(::toolkit::Library::Type::Music), 2u);
+
+				// Merged in album order
+				::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+				equal(items.size(), 3u);
+				equal(items[0].title(), "First");
+				equal(items[0].uri(), "file:///media/drive/first.ogg");
+				equal(items[1].title(), "Local");
+				equal(items[2].title(), "Second");
+				equal(items[2].id(), ids[1]);
+
+				equal(library.search(::toolkit::Library::Type::Music, "ir").size(), 1u);
+				equal(library.identifiers(::toolkit::Library::Type::All).size(), 3u);
+				equal(library.items(ids).size(), 2u);
+				equal(library.items(ids)[1].title(), "Second");
+
+				generation = library.generation();
+				isTrue(library.detachVolume("drive"));
+				isFalse(library.detachVolume("drive"));
+				isTrue(library.generation() > generation);
+
+				equal(library.count(::toolkit::Library::Type::All), 1u);
+				equal(library.list(::toolkit::Library::Type::All).size(), 1u);
+				isTrue(library.items(ids).empty());
+			}
+
+			{
+				// Mounted somewhere else next time, the items come straight back with the same IDs
+				::toolkit::Library library("./tests/main.db");
+				equal(library.list(::toolkit::Library::Type::All).size(), 1u);
+
+				isTrue(library.attachVolume("drive", "file:///mnt/drive/", "./tests/volume.db"));
+				::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+				equal(items.size(), 3u);
+				equal(items[0].id(), ids[0]);
+				equal(items[0].uri(), "file:///mnt/drive/first.ogg");
+
+				// Everything from the volume is listed by the snapshot too
+				isTrue(library.writeSnapshot());
+				equal(library.list(::toolkit::Library::Type::All).size(), 3u);
+			}
+
+			equal(std::remove("./tests/main.db"), 0);
+			equal(std::remove("./tests/main.db.snapshot"), 0);
+			equal(std::remove("./tests/volume.db"), 0);
+		}
+
+		/*
+			Check items are listed ignoring case, accents and leading articles, and are keyed again when that changes
+		*/
+		void collation() {
+			::toolkit::LibraryCollation collation;
+			isTrue(collation.key("The Beatles") == collation.key("beatles"));
+			isTrue(collation.key("Émile") == collation.key("EMILE"));
+			isTrue(collation.key("AC/DC") == collation.key("ac  dc"));
+			isTrue(collation.key("The") == collation.key("the"));
+			isTrue(collation.key("The") != collation.key(""));
+			isTrue(collation.key("apple") < collation.key("Banana"));
+			notEqual(collation.name(), ::toolkit::LibraryCollation("C", std::vector< std::string >()).name());
+
+			{
+				::toolkit::Library library("");
+				library.add("cherry", "file:///cherry.ogg", ::toolkit::Library::Type::Music);
+				library.add("Éclair", "file:///eclair.ogg", ::toolkit::Library::Type::Music);
+				library.add("The Banana", "file:///banana.ogg", ::toolkit::Library::Type::Music);
+				library.add("Zebra", "file:///zebra.ogg", ::toolkit::Library::Type::Music, "", "An Album");
+				library.add("apple", "file:///apple.ogg", ::toolkit::Library::Type::Music);
+				isTrue(library.attachVolume("drive", "file:///media/drive/", "./tests/volume.db"));
+				library.add("Dates", "file:///media/drive/dates.ogg", ::toolkit::Library::Type::Music);
+				isFalse(library.rekey());
+
+				// Items without an album come before those in one
+				::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+				equal(items.size(), 6u);
+				equal(items[0].title(), "apple");
+				equal(items[1].title(), "The Banana");
+				equal(items[2].title(), "cherry");
+				equal(items[3].title(), "Dates");
+				equal(items[4].title(), "Éclair");
+				equal(items[5].title(), "Zebra");
+				equal(library.search(::toolkit::Library::Type::All, "a")[0].title(), "apple");
+
+				// Without articles the banana moves to the end, once its key has been made again
+				library.setCollation(std::make_shared< ::toolkit::LibraryCollation >("C", std::vector< std::string >()));
+				library.add("Fig", "file:///fig.ogg", ::toolkit::Library::Type::Music);
+
+				unsigned int batches = 0;
+				while (library.rekey(2)) {
+					++batches;
+				}
+
+				isTrue(batches >= 3);
+				isFalse(library.rekey());
+
+				items = library.list(::toolkit::Library::Type::All);
+				equal(items.size(), 7u);
+				equal(items[0].title(), "apple");
+				equal(items[1].title(), "cherry");
+				equal(items[4].title(), "Fig");
+				equal(items[5].title(), "The Banana");
+				equal(items[6].title(), "Zebra");
+
+				// Setting the same collation again has nothing to do
+				library.setCollation(std::make_shared< ::toolkit::LibraryCollation >("C", std::vector< std::string >()));
+				isFalse(library.rekey());
+			}
+
+			equal(std::remove("./tests/volume.db"), 0);
+		}
+
+		/*
+			Check the details found when inspecting an item are kept with it, and order the tracks of an album
+		*/
+		void details() {
+			::toolkit::MediaDetails song;
+			song.setDuration(215000);
+			song.setArtist("The Beatles");
+			song.setTrackNumber(10);
+			song.setTrackCount(17);
+			song.setAudioCodec("Vorbis");
+			song.setBitrate(160000);
+			song.setSampleRate(44100);
+			song.setChannels(2);
+
+			::toolkit::MediaDetails film;
+			film.setDuration(10500000);
+			film.setVideoCodec("Theora");
+			film.setResolution(1920, 1080);
+			film.setFrameRate(23.976);
+
+			::toolkit::MediaDetails first;
+			first.setTrackNumber(2);
+
+			{
+				::toolkit::Library library("");
+				isTrue(library.attachVolume("drive", "file:///media/drive/", "./tests/volume.db"));
+
+				long long song_id = library.add("Something", "file:///something.ogg", ::toolkit::Library::Type::Music, "",
+				                                "Abbey Road", song);
+				long long film_id = library.add("Film", "file:///media/drive/film.ogg", ::toolkit::Library::Type::Movies, "",
+				                                "", film);
+				long long plain_id = library.add("Plain", "file:///plain.ogg", ::toolkit::Library::Type::Music);
+				library.add("Come Together", "file:///come.ogg", ::toolkit::Library::Type::Music, "", "Abbey Road", first);
+
+				::toolkit::MediaDetails found = library.details(song_id);
+				equal(found.duration(), 215000LL);
+				equal(found.artist(), "The Beatles");
+				equal(found.trackNumber(), 10u);
+				equal(found.trackCount(), 17u);
+				equal(found.audioCodec(), "Vorbis");
+				isTrue(found.videoCodec().empty());
+				equal(found.bitrate(), 160000u);
+				equal(found.sampleRate(), 44100u);
+				equal(found.channels(), 2u);
+				equal(found.width(), 0u);
+
+				found = library.details(film_id);
+				equal(found.duration(), 10500000LL);
+				equal(found.videoCodec(), "Theora");
+				equal(found.width(), 1920u);
+				equal(found.height(), 1080u);
+				equal(found.frameRate(), 23.976, 0.0001);
+				isTrue(found.artist().empty());
+
+				// Unknown details are stored as NULL and read back as nothing
+				found = library.details(plain_id);
+				equal(found.duration(), 0LL);
+				isTrue(found.artist().empty());
+				equal(found.frameRate(), 0.0, 0.0001);
+				equal(library.details(film_id + 1000).duration(), 0LL);
+
+				// Tracks of an album are listed in order of their number rather than their title
+				::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::Music);
+				equal(items.size(), 3u);
+				equal(items[0].title(), "Plain");
+				equal(items[1].title(), "Come Together");
+				equal(items[2].title(), "Something");
+
+				// And still are once their keys are made again
+				library.setCollation(std::make_shared< ::toolkit::LibraryCollation >("C", std::vector< std::string >()));
+				while (library.rekey()) {}
+
+				items = library.list(::toolkit::Library::Type::Music);
+				equal(items[1].title(), "Come Together");
+				equal(items[2].title(), "Something");
+			}
+
+			equal(std::remove("./tests/volume.db"), 0);
+		}
+
+		/*
+			Check a database from an older version is started afresh
+		*/
+		void upgrade() {
+			{
+				::toolkit::Library library("./tests/main.db");
+				isTrue(library.attachVolume("drive", "file:///media/drive/", "./tests/volume.db"));
+				library.add("Local", "file:///local.ogg", ::toolkit::Library::Type::Music, "", "Album");
+				library.add("Drive", "file:///media/drive/drive.ogg", ::toolkit::Library::Type::Music);
+			}
+
+			{
+				::core::Database main("./tests/main.db");
+				::core::Statement set_version(main, "UPDATE version SET version = 1");
+				isTrue(set_version.execute());
+
+				::core::Database volume("./tests/volume.db");
+				::core::Statement set_volume_version(volume, "UPDATE version SET version = 0");
+				isTrue(set_volume_version.execute());
+			}
+
+			{
+				::toolkit::Library library("./tests/main.db");
+				equal(library.count(::toolkit::Library::Type::All), 0u);
+				isTrue(library.attachVolume("drive", "file:///media/drive/", "./tests/volume.db"));
+				equal(library.count(::toolkit::Library::Type::All), 0u);
+
+				notEqual(library.add("Local", "file:///local.ogg", ::toolkit::Library::Type::Music, "", "Album"), 0LL);
+				notEqual(library.add("Drive", "file:///media/drive/drive.ogg", ::toolkit::Library::Type::Music), 0LL);
+				equal(library.list(::toolkit::Library::Type::All).size(), 2u);
+			}
+
+			equal(std::remove("./tests/main.db"), 0);
+			equal(std::remove("./tests/main.db.snapshot"), 0);
+			equal(std::remove("./tests/volume.db"), 0);
+		}
+
+		/*
+			Test storing items in a table
+		*/
+		void itemTables() {
+			::toolkit::LibraryItemTable table;
+			isTrue(table.empty());
+
+			table.add(1, "Song", "file:///music/album/song.ogg", "file:///music/album/cover.png");
+			table.add(2, "Other", "file:///music/album/other.ogg", "file:///music/album/cover.png");
+			table.add(3, "Film", "film.ogg");
+			equal(table.size(), 3u);
+
+			equal(table[0].id(), 1LL);
+			equal(table[0].title(), "Song");
+			equal(table[0].uri(), "file:///music/album/song.ogg");
+			equal(table[1].uri(), "file:///music/album/other.ogg");
+			equal(table[1].thumbnailFile(), "file:///music/album/cover.png");
+			equal(table[2].uri(), "film.ogg");
+			equal(table[2].thumbnailFile(), "");
+
+			// Copies stop sharing items once either of them changes
+			::toolkit::LibraryItemTable copy = table;
+			table.add(4, "Extra", "extra.ogg");
+			copy.add(5, "Copy", "copy.ogg");
+			equal(table.size(), 4u);
+			equal(copy.size(), 4u);
+			equal(table[3].title(), "Extra");
+			equal(copy[3].title(), "Copy");
+			equal(copy[1].thumbnailFile(), "file:///music/album/cover.png");
+
+			// Items outlive the table they came from
+			::toolkit::LibraryItem item = table.at(1);
+			table = ::toolkit::LibraryItemTable();
+			equal(item.title(), "Other");
+
+			bool thrown = false;
+			try {
+				table.at(0);
+			} catch (std::out_of_range const &) {
+				thrown = true;
+			}
+			isTrue(thrown);
+		}
+
+		/*
+			Copies a file for tests that need to change files on disk
+		*/
+		void copyFile(char const * from, char const * to) {
+			std::ifstream source(from, std::ios::binary);
+			std::ofstream destination(to, std::ios::binary);
+			destination << source.rdbuf();
+		}
+
+		/*
+			Test listing items from a snapshot
+		*/
+		void snapshots() {
+			{
+				::toolkit::Library library("./tests/library.db");
+				library.add("Song", "file:///song.ogg", ::toolkit::Library::Type::Music, "", "Album");
+				library.add("Film", "file:///film.ogg", ::toolkit::Library::Type::Movies, "file:///film.png");
+			}
+
+			isTrue(::core::Path::exists("./tests/library.db.snapshot"));
+
+			{
+				::toolkit::Library library("./tests/library.db");
+				::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+				equal(items.size(), 2u);
+
+				items = library.list(::toolkit::Library::Type::Movies);
+				equal(items.size(), 1u);
+				equal(items.at(0).title(), "Film");
+				equal(items.at(0).uri(), "file:///film.ogg");
+				equal(items.at(0).thumbnailFile(), "file:///film.png");
+
+				// Changes aren't hidden by the snapshot
+				library.add("Other", "file:///other.ogg", ::toolkit::Library::Type::Movies);
+				equal(library.list(::toolkit::Library::Type::Movies).size(), 2u);
+				isTrue(library.writeSnapshot());
+				equal(library.list(::toolkit::Library::Type::Movies).size(), 2u);
+			}
+
+			// A snapshot left by a database that has gone isn't used for the one that replaces it
+			copyFile("./tests/library.db.snapshot", "./tests/old.snapshot");
+			equal(std::remove("./tests/library.db"), 0);
+
+			{
+				::toolkit::Library library("./tests/library.db");
+				isFalse(::core::Path::exists("./tests/library.db.snapshot"));
+				library.add("New", "file:///new.ogg", ::toolkit::Library::Type::Movies);
+				library.add("Newer", "file:///newer.ogg", ::toolkit::Library::Type::Movies);
+				library.add("Newest", "file:///newest.ogg", ::toolkit::Library::Type::Movies);
+			}
+
+			// Even one that has reached the same generation
+			equal(std::rename("./tests/old.snapshot", "./tests/library.db.snapshot"), 0);
+
+			{
+				::toolkit::Library library("./tests/library.db");
+				::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+				equal(items.size(), 3u);
+				equal(items.at(0).title(), "New");
+			}
+
+			// Nor one taken with a volume that is no longer attached
+			{
+				::toolkit::Library library("./tests/library.db");
+				isTrue(library.attachVolume("drive", "file:///media/drive/", "./tests/volume.db"));
+				library.add("Drive", "file:///media/drive/drive.ogg", ::toolkit::Library::Type::Music);
+				isTrue(library.writeSnapshot());
+				equal(library.list(::toolkit::Library::Type::All).size(), 4u);
+			}
+
+			{
+				::toolkit::Library library("./tests/library.db");
+				equal(library.list(::toolkit::Library::Type::All).size(), 3u);
+			}
+
+			equal(std::remove("./tests/library.db"), 0);
+			equal(std::remove("./tests/library.db.snapshot"), 0);
+			equal(std::remove("./tests/volume.db"), 0);
+		}
+
+		/*
+			Test recording and forgetting file states
+		*/
+		void fileStates() {
+			::toolkit::Library library("");
+
+			long long item = library.add("Song", "file:///music/song.ogg", ::toolkit::Library::Type::Music);
+			library.addFile(::toolkit::LibraryFile("/music/song.ogg", 1u, 2u, 3u, 4LL), item);
+			library.addFile(::toolkit::LibraryFile("/music/notes.txt", 1u, 5u, 6u, 7LL));
+			library.addFile(::toolkit::LibraryFile("/musical/other.ogg", 1u, 8u, 9u, 10LL));
+
+			std::vector< ::toolkit::LibraryFile > files = library.files("/music/");
+			equal(files.size(), 2u);
+
+			::toolkit::LibraryFile same("/music/song.ogg", 1u, 2u, 3u, 4LL);
+			::toolkit::LibraryFile modified("/music/song.ogg", 1u, 2u, 3u, 5LL);
+			isTrue(same.unchanged(files.at(0).path() == same.path() ? files.at(0) : files.at(1)));
+			isFalse(modified.unchanged(same));
+
+			library.removeFiles(std::vector< std::string >(1, "/music/song.ogg"));
+			equal(library.files("/music").size(), 1u);
+			isTrue(library.list(::toolkit::Library::Type::All).empty());
+		}
+
+		/*
+			Test that a rescan only inspects changed files, and that items it updates keep their play statistics
+		*/
+		void rescan() {
+			::toolkit::Library library("");
+			::toolkit::Importer importer(library);
+
+			isTrue(importer.scan("tests") > 0u);
+			equal(library.list(::toolkit::Library::Type::All).size(), 3u);
+			equal(importer.scan("tests"), 0u);
+			equal(library.list(::toolkit::Library::Type::All).size(), 3u);
+
+			::toolkit::LibraryItem played = library.list(::toolkit::Library::Type::All)[0];
+			library.addPlays(std::vector< ::toolkit::LibraryPlay >(1, ::toolkit::LibraryPlay(library.playSequence() + 1,
+			                 played.uri(), false, 1000LL)));
+			equal(library.statistics(played.id()).plays(), 1u);
+			long long duration = library.details(played.id()).duration();
+
+			isTrue(importer.scan("tests", ::toolkit::Importer::Mode::Full) > 0u);
+			equal(library.list(::toolkit::Library::Type::All).size(), 3u);
+			equal(library.statistics(played.id()).plays(), 1u);
+			equal(library.statistics(played.id()).lastPlayed(), 1000LL);
+			equal(library.details(played.id()).duration(), duration);
+		}
+
+		/*
+			Test importing an unchanged directory into a new library takes everything from the inspector cache
+		*/
+		void cachedImport() {
+			std::shared_ptr< ::toolkit::InspectorCache > cache = std::make_shared< ::toolkit::InspectorCache >("");
+			std::vector< std::string > titles;
+
+			{
+				::toolkit::Library library("");
+				::toolkit::Importer importer(library, 0, false, cache);
+				isTrue(importer.scan("tests") > 0u);
+
+				::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+				equal(items.size(), 3u);
+				for (std::size_t i = 0; i < items.size(); ++i) {
+					titles.push_back(items[i].title());
+				}
+			}
+
+			unsigned long long misses = cache->misses();
+			equal(cache->hits(), 0u);
+			isTrue(misses >= 3u);
+
+			::toolkit::Library library("");
+			::toolkit::Importer importer(library, 0, false, cache);
+			isTrue(importer.scan("tests") > 0u);
+
+			equal(cache->misses(), misses);
+			equal(cache->hits(), misses);
+
+			::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+			equal(items.size(), titles.size());
+			for (std::size_t i = 0; i < items.size() && i < titles.size(); ++i) {
+				equal(items[i].title(), titles[i]);
+			}
+		}
+
+		/*
+			Test that copies of a file share one item
+		*/
+		void duplicates() {
+			::core::Path first("tests/copies/first");
+			::core::Path second("tests/copies/second");
+			isTrue(first.create());
+			isTrue(second.create());
+
+			copyFile("tests/audio.ogg", "tests/copies/first/audio.ogg");
+			copyFile("tests/audio.ogg", "tests/copies/second/audio.ogg");
+
+			::toolkit::Library library("");
+			::toolkit::Importer importer(library);
+
+			equal(importer.scan("tests/copies"), 2u);
+			::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+			equal(items.size(), 1u);
+
+			equal(std::remove("tests/copies/first/audio.ogg"), 0);
+			equal(importer.scan("tests/copies"), 0u);
+			items = library.list(::toolkit::Library::Type::All);
+			equal(items.size(), 1u);
+			equal(items.at(0).uri(), ::core::Path(::core::Path::current() + "/tests/copies/second/audio.ogg").toUri());
+
+			equal(std::remove("tests/copies/second/audio.ogg"), 0);
+			equal(importer.scan("tests/copies"), 0u);
+			isTrue(library.list(::toolkit::Library::Type::All).empty());
+
+			isTrue(::core::Path::remove("tests/copies/first"));
+			isTrue(::core::Path::remove("tests/copies/second"));
+			isTrue(::core::Path::remove("tests/copies"));
+		}
+
+		/*
+			Test removing items whose files have gone
+		*/
+		void prune() {
+			isTrue(::core::Path("tests/prune/kept").create());
+			isTrue(::core::Path("tests/prune/gone").create());
+			copyFile("tests/audio.ogg", "tests/prune/kept/audio.ogg");
+			copyFile("tests/audio.ogg", "tests/prune/gone/audio.ogg");
+			copyFile("tests/audio.ogg", "tests/prune/kept/deleted.ogg");
+			copyFile("tests/audio.ogg", "tests/prune/gone/other.ogg");
+
+			::toolkit::Library library("");
+			::toolkit::Importer importer(library);
+			equal(importer.scan("tests/prune"), 4u);
+			equal(library.count(::toolkit::Library::Type::All), 1u);
+
+			std::string const directory = ::core::Path::current() + "/tests/prune/";
+			library.add("Deleted", ::core::Path(directory + "kept/deleted.ogg").toUri(), ::toolkit::Library::Type::Music);
+			library.add("Other", ::core::Path(directory + "gone/other.ogg").toUri(), ::toolkit::Library::Type::Music);
+			library.add("Stream", "http://example.com/stream.ogg", ::toolkit::Library::Type::Music);
+			library.add("Unmounted", "file:///nonexistent/drive/song.ogg", ::toolkit::Library::Type::Music);
+			library.addRoot("file:///nonexistent/drive/");
+
+			// Items that aren't beneath a root are kept while the drive they were on isn't mounted
+			isTrue(::core::Path("tests/prune/mount").create());
+			std::string const elsewhere = directory + "elsewhere/song.ogg";
+			long long other_drive = library.add("Other drive", ::core::Path(elsewhere).toUri(), ::toolkit::Library::Type::Music);
+			library.addFile(::toolkit::LibraryFile(elsewhere, 0xdeadbeef, 1, 1, 0), other_drive);
+			library.add("Mount point", ::core::Path(directory + "mount/song.ogg").toUri(), ::toolkit::Library::Type::Music);
+
+			// Nothing has gone yet
+			equal(library.prune(), 0u);
+			equal(library.count(::toolkit::Library::Type::All), 7u);
+
+			equal(std::remove("tests/prune/kept/deleted.ogg"), 0);
+			equal(std::remove("tests/prune/gone/audio.ogg"), 0);
+			equal(std::remove("tests/prune/gone/other.ogg"), 0);
+			isTrue(::core::Path::remove("tests/prune/gone"));
+
+			unsigned long long last_checked = 0;
+			unsigned long long last_total = 0;
+			equal(library.prune([&](unsigned long long checked, unsigned long long total) {
+				isTrue(checked >= last_checked);
+				last_checked = checked;
+				last_total = total;
+			}, 2), 2u);
+			equal(last_checked, 5u);
+			equal(last_total, 5u);
+
+			// The remaining copy is used in place of the one that went, and items that can't be checked are kept
+			std::vector< std::string > uris;
+			::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+			for (std::size_t i = 0; i < items.size(); ++i) {
+				uris.push_back(items[i].uri());
+			}
+			std::sort(uris.begin(), uris.end());
+			equal(uris.size(), 5u);
+			equal(uris[0], "file:///nonexistent/drive/song.ogg");
+			equal(uris[1], ::core::Path(elsewhere).toUri());
+			equal(uris[2], ::core::Path(directory + "kept/audio.ogg").toUri());
+			equal(uris[3], ::core::Path(directory + "mount/song.ogg").toUri());
+			equal(uris[4], "http://example.com/stream.ogg");
+
+			equal(std::remove("tests/prune/kept/audio.ogg"), 0);
+			isTrue(::core::Path::remove("tests/prune/kept"));
+			isTrue(::core::Path::remove("tests/prune/mount"));
+			isTrue(::core::Path::remove("tests/prune"));
+		}
+
+		/*
+			Check the files and plays of the items on a volume are kept in its database, and are forgotten from there
+		*/
+		void volumeFiles() {
+			isTrue(::core::Path("tests/drive/album").create());
+			copyFile("tests/audio.ogg", "tests/drive/album/first.ogg");
+			copyFile("tests/audio.ogg", "tests/drive/album/second.ogg");
+
+			std::string const directory = ::core::Path::current() + "/tests/drive/";
+			std::string const root = ::core::Path(::core::Path::current() + "/tests/drive").toUri() + "/";
+
+			{
+				::toolkit::Library library("./tests/main.db");
+				isTrue(library.attachVolume("drive", root, "./tests/volume.db"));
+
+				// Both copies go to the one item, on the volume
+				::toolkit::Importer importer(library);
+				equal(importer.scan("tests/drive"), 2u);
+				::toolkit::LibraryItemTable items = library.list(::toolkit::Library::Type::All);
+				equal(items.size(), 1u);
+				isTrue(items[0].id() > (1LL << 40));
+				equal(library.files(directory).size(), 2u);
+				equal(library.files("").size(), 2u);
+
+				long long added = library.add("Added", root + "added.ogg", ::toolkit::Library::Type::Music);
+				library.addFile(::toolkit::LibraryFile(directory + "added.ogg", 1, 1, 1, 0), added);
+				equal(library.files(directory).size(), 3u);
+
+				// Plays of an item on the volume are counted there
+				std::vector< ::toolkit::LibraryPlay > plays;
+				plays.push_back(::toolkit::LibraryPlay(1, items[0].uri(), false, 100));
+				plays.push_back(::toolkit::LibraryPlay(2, items[0].uri(), true, 200));
+				plays.push_back(::toolkit::LibraryPlay(3, root + "added.ogg", false, 300));
+				plays.push_back(::toolkit::LibraryPlay(4, items[0].uri(), false, 400));
+				library.addPlays(plays);
+				equal(library.playSequence(), 4ULL);
+				equal(library.statistics(items[0].id()).plays(), 2ULL);
+				equal(library.statistics(items[0].id()).skips(), 1ULL);
+				equal(library.statistics(items[0].id()).lastPlayed(), 400LL);
+				equal(library.mostPlayed(10).size(), 2u);
+				equal(library.mostPlayed(10)[0].id(), items[0].id());
+				equal(library.recentlyPlayed(1)[0].id(), items[0].id());
+
+				// Forgetting the only file of an item removes it from the volume
+				library.removeFiles(std::vector< std::string >(1, directory + "added.ogg"));
+				equal(library.count(::toolkit::Library::Type::All), 1u);
+				equal(library.files(directory).size(), 2u);
+
+				// As does pruning once every copy has gone
+				equal(std::remove("tests/drive/album/first.ogg"), 0);
+				equal(library.prune(), 0u);
+				equal(library.count(::toolkit::Library::Type::All), 1u);
+				equal(library.files(directory).size(), 1u);
+
+				copyFile("tests/audio.ogg", "tests/drive/kept.ogg");
+				equal(std::remove("tests/drive/album/second.ogg"), 0);
+				equal(library.prune(), 1u);
+				equal(library.count(::toolkit::Library::Type::All), 0u);
+				isTrue(library.files(directory).empty());
+			}
+
+			{
+				// None of it was written to the library's own tables
+				::core::Database main("./tests/main.db");
+				::core::Statement files(main, "SELECT COUNT(*) FROM files");
+				isTrue(files.execute());
+				equal(files.toInteger(0u), 0LL);
+				::core::Statement plays(main, "SELECT COUNT(*) FROM play_stats");
+				isTrue(plays.execute());
+				equal(plays.toInteger(0u), 0LL);
+			}
+
+			equal(std::remove("tests/drive/kept.ogg"), 0);
+			isTrue(::core::Path::remove("tests/drive/album"));
+			isTrue(::core::Path::remove("tests/drive"));
+			equal(std::remove("./tests/main.db"), 0);
+			std::remove("./tests/main.db.snapshot");
+			equal(std::remove("./tests/volume.db"), 0);
+		}
+
+
+		/*
+			Waits for a watcher to apply a burst of changes
+		*/
+		bool waitForChanges(::toolkit::Watcher & watcher) {
+			for (unsigned int i = 0; i < 50; ++i) {
+				if (watcher.process(100)) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		/*
+			Test that changes to watched directories reach the library
+		*/
+		void watchChanges() {
+			::core::Path directory("tests/watched");
+			isTrue(directory.create());
+
+			::toolkit::Library library("");
+			::toolkit::Importer importer(library);
+			::toolkit::Watcher watcher(library, importer, 50u);
+
+			isTrue(watcher.watch("tests/watched"));
+			equal(watcher.watches(), 1u);
+			isFalse(watcher.exhausted());
+			isFalse(watcher.process());
+
+			copyFile("tests/audio.ogg", "tests/watched/audio.ogg");
+			isTrue(waitForChanges(watcher));
+			equal(library.list(::toolkit::Library::Type::Music).size(), 1u);
+
+			::core::Path subdirectory("tests/watched/sub");
+			isTrue(subdirectory.create());
+			copyFile("tests/video.ogg", "tests/watched/sub/video.ogg");
+			isTrue(waitForChanges(watcher));
+			equal(watcher.watches(), 2u);
+			equal(library.list(::toolkit::Library::Type::All).size(), 2u);
+
+			equal(std::rename("tests/watched/sub/video.ogg", "tests/watched/video.ogg"), 0);
+			isTrue(::core::Path::remove("tests/watched/sub"));
+			isTrue(waitForChanges(watcher));
+			equal(watcher.watches(), 1u);
+			equal(library.list(::toolkit::Library::Type::All).size(), 2u);
+
+			equal(std::remove("tests/watched/audio.ogg"), 0);
+			equal(std::remove("tests/watched/video.ogg"), 0);
+			isTrue(waitForChanges(watcher));
+			isTrue(library.list(::toolkit::Library::Type::All).empty());
+
+			isTrue(::core::Path::remove("tests/watched"));
+		}
+
+		/*
+			Test that directories changed while the kernel was dropping events are watched again
+		*/
+		void watchOverflow() {
+			isTrue(::core::Path("tests/overflow/gone").create());
+
+			::toolkit::Library library("");
+			::toolkit::Importer importer(library);
+			::toolkit::Watcher watcher(library, importer, 50u);
+
+			isTrue(watcher.watch("tests/overflow"));
+			equal(watcher.watches(), 2u);
+
+			// Queue more events than the kernel keeps, so the changes after them are lost
+			unsigned long long queued = 0;
+			std::ifstream("/proc/sys/fs/inotify/max_queued_events") >> queued;
+			for (unsigned long long i = 0; i <= queued; ++i) {
+				std::ofstream("tests/overflow/churn");
+				std::remove("tests/overflow/churn");
+			}
+
+			isTrue(::core::Path::remove("tests/overflow/gone"));
+			isTrue(::core::Path("tests/overflow/sub").create());
+			copyFile("tests/audio.ogg", "tests/overflow/sub/audio.ogg");
+
+			isTrue(waitForChanges(watcher));
+			equal(watcher.watches(), 2u);
+			equal(library.list(::toolkit::Library::Type::All).size(), 1u);
+
+			// The new directory is watched from now on
+			copyFile("tests/video.ogg", "tests/overflow/sub/video.ogg");
+			isTrue(waitForChanges(watcher));
+			equal(library.list(::toolkit::Library::Type::All).size(), 2u);
+
+			equal(std::remove("tests/overflow/sub/audio.ogg"), 0);
+			equal(std::remove("tests/overflow/sub/video.ogg"), 0);
+			isTrue(::core::Path::remove("tests/overflow/sub"));
+			isTrue(::core::Path::remove("tests/overflow"));
+		}
+
+		void runTests() {
+			addItems();
+			itemTables();
+			facets();
+			fuzzySearch();
+			incrementalSearch();
+			smartPlaylists();
+			roots();
+			volumes();
+			collation();
+			details();
+			upgrade();
+			snapshots();
+			fileStates();
+			rescan();
+			cachedImport();
+			duplicates();
+			prune();
+			volumeFiles();
+			watchChanges();
+			watchOverflow();
+		}
+	}
+}
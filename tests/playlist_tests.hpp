@@ -0,0 +1,139 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <core/filesystem.hpp>
+#include <toolkit/library.hpp>
+#include <toolkit/playlist.hpp>
+
+namespace test {
+	namespace playlist {
+		/*
+			Test adding, moving and removing entries
+		*/
+		void orderEntries() {
+			::toolkit::Library library("");
+			::toolkit::Playlist playlist(library, "Test");
+			isTrue(playlist.empty());
+
+			playlist.append("file:///b.ogg", "B");
+			playlist.append("file:///d.ogg", "D");
+			playlist.insert(0, "file:///a.ogg", "A");
+			playlist.insert(2, "file:///c.ogg", "C");
+			equal(playlist.size(), 4u);
+			equal(playlist.at(0).title(), "A");
+			equal(playlist.at(1).title(), "B");
+			equal(playlist.at(2).title(), "C");
+			equal(playlist.at(3).title(), "D");
+
+			playlist.move(0, 3);
+			equal(playlist.at(0).title(), "B");
+			equal(playlist.at(3).title(), "A");
+
+			playlist.remove(1);
+			equal(playlist.size(), 3u);
+			equal(playlist.at(1).title(), "D");
+
+			// The database is in the same order as the copy in memory
+			::toolkit::Playlist reopened(library, "Test");
+			equal(reopened.size(), 3u);
+			equal(reopened.at(0).title(), "B");
+			equal(reopened.at(1).title(), "D");
+			equal(reopened.at(2).title(), "A");
+			equal(reopened.at(2).uri(), "file:///a.ogg");
+
+			playlist.clear();
+			isTrue(playlist.empty());
+			isTrue(::toolkit::Playlist(library, "Test").empty());
+		}
+
+		/*
+			Test inserting into the same place until the gaps between positions run out
+		*/
+		void fillGaps() {
+			::toolkit::Library library("");
+			::toolkit::Playlist playlist(library, "Test");
+
+			playlist.append("file:///first.ogg", "First");
+			playlist.append("file:///last.ogg", "Last");
+			for (unsigned int i = 0; i < 100; ++i) {
+				playlist.insert(1, "file:///" + std::to_string(i) + ".ogg", std::to_string(i));
+			}
+
+			equal(playlist.size(), 102u);
+			equal(playlist.at(0).title(), "First");
+			equal(playlist.at(1).title(), "99");
+			equal(playlist.at(100).title(), "0");
+			equal(playlist.at(101).title(), "Last");
+
+			bool ordered = true;
+			for (std::size_t i = 1; i < playlist.size(); ++i) {
+				ordered = ordered && (playlist.at(i - 1).position() < playlist.at(i).position());
+			}
+			isTrue(ordered);
+
+			::toolkit::Playlist reopened(library, "Test");
+			equal(reopened.at(1).title(), "99");
+			equal(reopened.at(100).title(), "0");
+		}
+
+		/*
+			Test importing M3U and PLS playlists
+		*/
+		void importFiles() {
+			{
+				std::ofstream m3u("tests/import.m3u");
+				m3u << "#EXTM3U\n#EXTINF:123,Artist - Song\nmusic/song.ogg\n\n/music/other.ogg\r\n"
+				    << "http://example.com/stream\n";
+			}
+
+			{
+				std::ofstream pls("tests/import.pls");
+				pls << "[playlist]\nNumberOfEntries=2\nFile2=/music/second.ogg\nTitle1=First\nFile1=../first.ogg\n"
+				    << "Version=2\n";
+			}
+
+			::toolkit::Library library("");
+			::toolkit::Playlist playlist(library, "Imported");
+
+			equal(playlist.import("tests/import.m3u"), 3u);
+			equal(playlist.at(0).title(), "Artist - Song");
+			equal(playlist.at(0).uri(), "file://" + ::core::Path::current() + "/tests/music/song.ogg");
+			equal(playlist.at(1).title(), "other");
+			equal(playlist.at(1).uri(), "file:///music/other.ogg");
+			equal(playlist.at(2).uri(), "http://example.com/stream");
+
+			equal(playlist.import("tests/import.pls"), 2u);
+			equal(playlist.size(), 5u);
+			equal(playlist.at(3).title(), "First");
+			equal(playlist.at(3).uri(), ::core::Path(::core::Path::current() + "/first.ogg").toUri());
+			equal(playlist.at(4).uri(), "file:///music/second.ogg");
+
+			equal(playlist.import("tests/missing.m3u"), 0u);
+
+			equal(std::remove("tests/import.m3u"), 0);
+			equal(std::remove("tests/import.pls"), 0);
+		}
+
+		void runTests() {
+			orderEntries();
+			fillGaps();
+			importFiles();
+		}
+	}
+}
@@ -0,0 +1,172 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+#include <toolkit/library.hpp>
+#include <toolkit/shuffle.hpp>
+
+namespace test {
+	namespace shuffle {
+		/*
+			Adds count music items, with every tenth one a film
+		*/
+		void addItems(::toolkit::Library & library, unsigned int count) {
+			library.begin();
+			for (unsigned int i = 0; i < count; ++i) {
+				library.add("Item " + std::to_string(i), "file:///media/" + std::to_string(i) + ".ogg",
+				            (i % 10 == 9) ? ::toolkit::Library::Type::Movies : ::toolkit::Library::Type::Music);
+			}
+			library.commit();
+		}
+
+		/*
+			Test that every item is played once before any is repeated
+		*/
+		void permutation() {
+			::toolkit::Library library("");
+			addItems(library, 1000);
+
+			::toolkit::Shuffle shuffle(library, ::toolkit::Library::Type::Music, "", 42);
+			equal(shuffle.seed(), 42ULL);
+
+			std::set< long long > played;
+			std::vector< long long > order;
+			for (unsigned int i = 0; i < 9; ++i) {
+				::toolkit::LibraryItemTable items = shuffle.next(100);
+				equal(items.size(), 100u);
+
+				for (std::size_t j = 0; j < items.size(); ++j) {
+					played.insert(items[j].id());
+					order.push_back(items[j].id());
+				}
+			}
+
+			// All 900 songs and no films
+			equal(played.size(), 900u);
+			isTrue(*played.begin() >= 1);
+			isTrue(*played.rbegin() <= 1000);
+			equal(library.items(std::vector< long long >(played.begin(), played.end())).size(), 900u);
+			equal(library.list(::toolkit::Library::Type::Music).size(), 900u);
+
+			// Not just listed in order
+			bool sorted = true;
+			for (std::size_t i = 1; i < order.size(); ++i) {
+				sorted = sorted && (order[i - 1] < order[i]);
+			}
+			isFalse(sorted);
+
+			// The next round is in a different order
+			std::vector< long long > again;
+			for (unsigned int i = 0; i < 900; ++i) {
+				again.push_back(shuffle.next()[0].id());
+			}
+			equal(std::set< long long >(again.begin(), again.end()).size(), 900u);
+			isFalse(again == order);
+
+			// The same seed gives the same order
+			::toolkit::Shuffle same(library, ::toolkit::Library::Type::Music, "", 42);
+			::toolkit::LibraryItemTable items = same.next(900);
+			bool equal_order = items.size() == 900u;
+			for (std::size_t i = 0; equal_order && (i < items.size()); ++i) {
+				equal_order = items[i].id() == order[i];
+			}
+			isTrue(equal_order);
+
+			::toolkit::Shuffle different(library, ::toolkit::Library::Type::Music, "", 43);
+			notEqual(different.next()[0].id() * 1000 + different.next()[0].id(), order[0] * 1000 + order[1]);
+
+			::toolkit::Library empty("");
+			::toolkit::Shuffle nothing(empty);
+			isTrue(nothing.next().empty());
+		}
+
+		/*
+			Test carrying on with the same order after restarting
+		*/
+		void restart() {
+			std::set< long long > played;
+
+			{
+				::toolkit::Library library("./tests/shuffle.db");
+				addItems(library, 200);
+
+				::toolkit::Shuffle shuffle(library, ::toolkit::Library::Type::All, "tests/shuffle.state");
+				::toolkit::LibraryItemTable items = shuffle.next(120);
+				for (std::size_t i = 0; i < items.size(); ++i) {
+					played.insert(items[i].id());
+				}
+			}
+
+			{
+				::toolkit::Library library("./tests/shuffle.db");
+
+				// Items added part way through wait for the next round
+				library.add("Late", "file:///media/late.ogg", ::toolkit::Library::Type::Music);
+
+				::toolkit::Shuffle shuffle(library, ::toolkit::Library::Type::All, "tests/shuffle.state");
+				::toolkit::LibraryItemTable items = shuffle.next(80);
+				equal(items.size(), 80u);
+
+				for (std::size_t i = 0; i < items.size(); ++i) {
+					isTrue(played.insert(items[i].id()).second);
+				}
+				equal(played.size(), 200u);
+
+				// Now the round is over the new item is included
+				std::set< std::string > titles;
+				items = shuffle.next(201);
+				for (std::size_t i = 0; i < items.size(); ++i) {
+					titles.insert(items[i].title());
+				}
+				equal(titles.size(), 201u);
+				equal(titles.count("Late"), 1u);
+
+				// A state saved for one type of item isn't carried on with for another
+				::toolkit::Shuffle music(library, ::toolkit::Library::Type::Music, "tests/shuffle.state");
+				equal(music.next(50).size(), 50u);
+			}
+
+			{
+				::toolkit::Library library("./tests/shuffle.db");
+				::toolkit::Shuffle shuffle(library, ::toolkit::Library::Type::All, "tests/shuffle.state");
+				::toolkit::LibraryItemTable items = shuffle.next(201);
+
+				std::set< long long > ids;
+				for (std::size_t i = 0; i < items.size(); ++i) {
+					ids.insert(items[i].id());
+				}
+				equal(ids.size(), 201u);
+			}
+
+			equal(std::remove("tests/shuffle.state"), 0);
+			equal(std::remove("tests/shuffle.state.index"), 0);
+			equal(std::remove("./tests/shuffle.db"), 0);
+			std::remove("./tests/shuffle.db.snapshot");
+		}
+
+		/*
+			Test shuffling items
+		*/
+		void runTests() {
+			permutation();
+			restart();
+		}
+	}
+}
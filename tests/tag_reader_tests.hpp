@@ -0,0 +1,375 @@
+/*
+	Copyright (C) 2011  Wade Smith
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <core/filesystem.hpp>
+#include <toolkit/inspector.hpp>
+#include <toolkit/tag_reader.hpp>
+
+namespace test {
+	namespace tag_reader {
+		std::string uri(std::string const & name) {
+			return "file://" + ::core::Path::current() + "/tests/" + name;
+		}
+
+		void write(std::string const & name, std::string const & data) {
+			std::ofstream file(("tests/" + name).c_str(), std::ios::binary);
+			file.write(data.data(), data.size());
+		}
+
+		std::string be16(unsigned int value) {
+			return std::string(1, static_cast< char >(value >> 8)) + static_cast< char >(value & 0xff);
+		}
+
+		std::string be32(unsigned long value) {
+			std::string bytes;
+			for (int shift = 24; shift >= 0; shift -= 8) {
+				bytes.push_back(static_cast< char >((value >> shift) & 0xff));
+			}
+			return bytes;
+		}
+
+		std::string le32(unsigned long value) {
+			std::string bytes;
+			for (int shift = 0; shift < 32; shift += 8) {
+				bytes.push_back(static_cast< char >((value >> shift) & 0xff));
+			}
+			return bytes;
+		}
+
+		std::string synchsafe(unsigned long value) {
+			std::string bytes;
+			for (int shift = 21; shift >= 0; shift -= 7) {
+				bytes.push_back(static_cast< char >((value >> shift) & 0x7f));
+			}
+			return bytes;
+		}
+
+		/*
+			Builds a Vorbis comment block
+		*/
+		std::string comments(std::vector< std::string > const & fields) {
+			std::string block = le32(6) + "tester" + le32(fields.size());
+			for (std::vector< std::string >::const_iterator i = fields.begin(); i != fields.end(); ++i) {
+				block += le32(i->size()) + *i;
+			}
+			return block;
+		}
+
+		/*
+			Builds an ID3v2.3 or ID3v2.4 frame
+		*/
+		std::string id3_frame(unsigned int version, std::string const & id, std::string const & content) {
+			return id + (version == 3 ? be32(content.size()) : synchsafe(content.size())) + std::string(2, '\0') + content;
+		}
+
+		std::string id3_tag(unsigned int version, std::string const & frames) {
+			return std::string("ID3") + static_cast< char >(version) + std::string(2, '\0') + synchsafe(frames.size() + 16) +
+			       frames + std::string(16, '\0');
+		}
+
+		/*
+			Builds a run of MPEG-1 layer III frames at 128 kbit/s and 44.1 kHz, each 417 bytes long
+		*/
+		std::string mpeg_frames(unsigned int count) {
+			std::string frames;
+			for (unsigned int i = 0; i < count; ++i) {
+				frames += std::string("\xff\xfb\x90\x00", 4) + std::string(413, '\0');
+			}
+			return frames;
+		}
+
+		std::string id3v1_tag(std::string const & title, std::string const & album) {
+			std::string tag = "TAG" + title + std::string(30 - title.size(), '\0') + std::string(30, ' ') + album +
+			                  std::string(30 - album.size(), '\0');
+			return tag + std::string(128 - tag.size(), '\0');
+		}
+
+		std::string atom(std::string const & type, std::string const & content) {
+			return be32(content.size() + 8) + type + content;
+		}
+
+		std::string mp4_text(std::string const & type, std::string const & value) {
+			return atom(type, atom("data", be32(1) + be32(0) + value));
+		}
+
+		std::string mp4_track(std::string const & handler) {
+			return atom("trak", atom("mdia", atom("hdlr", be32(0) + be32(0) + handler + std::string(12, '\0') + "name")));
+		}
+
+		/*
+			Test reading the Ogg fixtures gives the same results as inspecting them with a pipeline
+		*/
+		void oggTest() {
+			char const * samples[] = {"audio.ogg", "video.ogg", "multi.ogg"};
+			::toolkit::TagReader reader;
+			::toolkit::Inspector inspect(0, false);
+
+			for (unsigned int i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+				isTrue(reader.read(uri(samples[i])));
+				isTrue(inspect.inspect(uri(samples[i])));
+
+				equal(reader.audio(), inspect.audio());
+				equal(reader.video(), inspect.video());
+				equal(reader.title(), inspect.title());
+				equal(reader.album(), inspect.album());
+			}
+
+			isTrue(reader.read(uri("audio.ogg")));
+			isTrue(reader.audio());
+			isFalse(reader.video());
+			equal(reader.title(), "Test Audio");
+			equal(reader.album(), "Test Album");
+
+			isTrue(reader.read(uri("multi.ogg")));
+			isTrue(reader.audio());
+			isTrue(reader.video());
+			isTrue(reader.title().empty());
+		}
+
+		/*
+			Test reading FLAC, MP3 and MP4 files built here
+		*/
+		void formatsTest() {
+			::toolkit::TagReader reader;
+
+			std::vector< std::string > fields;
+			fields.push_back("title=Flac Title");
+			fields.push_back("ALBUM=First");
+			fields.push_back("Album=Second");
+			std::string streaminfo = std::string(1, '\0') + std::string("\0\0\x22", 3) + std::string(34, '\0');
+			std::string comment_block = comments(fields);
+			write("tag.flac", "fLaC" + streaminfo + static_cast< char >(0x84) + be32(comment_block.size()).substr(1) +
+			      comment_block + std::string(64, '\0'));
+
+			isTrue(reader.read(uri("tag.flac")));
+			isTrue(reader.audio());
+			isFalse(reader.video());
+			equal(reader.title(), "Flac Title");
+			equal(reader.album(), "First, Second");
+
+			// ID3v2.3 with Latin-1 text, falling back to ID3v1 for the album
+			write("tag3.mp3", id3_tag(3, id3_frame(3, "TIT2", std::string("\0Caf\xe9", 5))) + mpeg_frames(3) +
+			      id3v1_tag("Ignored", "Version One"));
+
+			isTrue(reader.read(uri("tag3.mp3")));
+			isTrue(reader.audio());
+			equal(reader.title(), "Caf\xc3\xa9");
+			equal(reader.album(), "Version One");
+
+			// ID3v2.4 with UTF-16 and UTF-8 text
+			write("tag4.mp3", id3_tag(4, id3_frame(4, "TIT2", std::string("\x01\xff\xfeH\0i\0", 7)) +
+			                          id3_frame(4, "TALB", std::string("\x03" "One\0Two", 8))) + mpeg_frames(3));
+
+			isTrue(reader.read(uri("tag4.mp3")));
+			isTrue(reader.audio());
+			isFalse(reader.video());
+			equal(reader.title(), "Hi");
+			equal(reader.album(), "One, Two");
+
+			// No ID3v2 tag at all
+			write("tag1.mp3", mpeg_frames(3) + id3v1_tag("Only Title", ""));
+			isTrue(reader.read(uri("tag1.mp3")));
+			equal(reader.title(), "Only Title");
+			isTrue(reader.album().empty());
+
+			// Movie atom after the media data, as many encoders leave it
+			std::string ilst = atom("ilst", mp4_text("\xa9nam", "Mp4 Title") + mp4_text("\xa9" "alb", "Mp4 Album"));
+			std::string meta = atom("meta", be32(0) + atom("hdlr", std::string(25, '\0')) + ilst);
+			write("tag.m4a", atom("ftyp", "M4A " + be32(0)) + atom("mdat", std::string(1000, '\x55')) +
+			      atom("moov", mp4_track("soun") + atom("udta", meta)));
+
+			isTrue(reader.read(uri("tag.m4a")));
+			isTrue(reader.audio());
+			isFalse(reader.video());
+			equal(reader.title(), "Mp4 Title");
+			equal(reader.album(), "Mp4 Album");
+
+			write("tag.mp4", atom("ftyp", "isom" + be32(0)) + atom("moov", mp4_track("vide") + mp4_track("soun")));
+			isTrue(reader.read(uri("tag.mp4")));
+			isTrue(reader.audio());
+			isTrue(reader.video());
+			isTrue(reader.title().empty());
+
+			// Anything else is left to the inspector
+			write("tag.txt", "Not a media file at all");
+			isFalse(reader.read(uri("tag.txt")));
+			isFalse(reader.audio());
+			isFalse(reader.read(uri("missing.ogg")));
+			isFalse(reader.read("http://localhost/audio.ogg"));
+
+			// An MPEG program stream carries MPEG audio frames in its packets, but isn't MPEG audio itself
+			std::string start_code("\0\0\x01", 3);
+			std::string mp2_frames;
+			for (unsigned int i = 0; i < 3; ++i) {
+				mp2_frames += std::string("\xff\xfd\x80\x00", 4) + std::string(413, '\0');
+			}
+			std::string sequence = start_code + "\xb3" + std::string("\x28\x01\xe0\x14\xff\xff\xe0\x18", 8);
+			write("tag.mpg", start_code + "\xba" + std::string("\x44\0\x04\0\x04\x01\x01\x89\xc3\xf8", 10) +
+			      start_code + "\xe0" + be16(3 + sequence.size()) + std::string("\x80\0\0", 3) + sequence +
+			      start_code + "\xc0" + be16(3 + mp2_frames.size()) + std::string("\x80\0\0", 3) + mp2_frames +
+			      start_code + "\xb9");
+
+			isFalse(reader.read(uri("tag.mpg")));
+			isFalse(reader.audio());
+
+			// As are frames that don't start the file
+			write("tag.bin", "junk" + mpeg_frames(3));
+			isFalse(reader.read(uri("tag.bin")));
+
+			char const * files[] = {"tag.flac", "tag3.mp3", "tag4.mp3", "tag1.mp3", "tag.m4a", "tag.mp4", "tag.txt", "tag.mpg",
+			                        "tag.bin"};
+			for (unsigned int i = 0; i < sizeof(files) / sizeof(files[0]); ++i) {
+				equal(std::remove(("tests/" + std::string(files[i])).c_str()), 0);
+			}
+		}
+
+		/*
+			Test the rest of what is found in the fixtures and in files built here
+		*/
+		void detailsTest() {
+			::toolkit::TagReader reader;
+
+			isTrue(reader.read(uri("audio.ogg")));
+			::toolkit::MediaDetails details = reader.details();
+			equal(details.audioCodec(), "Vorbis");
+			isTrue(details.videoCodec().empty());
+			equal(details.sampleRate(), 44100u);
+			equal(details.channels(), 1u);
+			equal(details.bitrate(), 80000u);
+			equal(details.duration(), 44412LL);
+
+			isTrue(reader.read(uri("video.ogg")));
+			details = reader.details();
+			equal(details.videoCodec(), "Theora");
+			equal(details.width(), 320u);
+			equal(details.height(), 240u);
+			equal(details.frameRate(), 30.0, 0.001);
+			equal(details.duration(), 3333LL);
+
+			// The longest stream gives the length
+			isTrue(reader.read(uri("multi.ogg")));
+			details = reader.details();
+			equal(details.audioCodec(), "Vorbis");
+			equal(details.videoCodec(), "Theora");
+			equal(details.duration(), 1466LL);
+
+			// Ten seconds of 44.1 kHz stereo
+			std::vector< std::string > fields;
+			fields.push_back("ARTIST=Flac Artist");
+			fields.push_back("TRACKNUMBER=3/12");
+			std::string streaminfo = std::string(10, '\0') + be32((44100 << 12) | (1 << 9) | (15 << 4)) + be32(441000) +
+			                         std::string(16, '\0');
+			std::string comment_block = comments(fields);
+			write("details.flac", "fLaC" + std::string("\0\0\0\x22", 4) + streaminfo +
+			      static_cast< char >(0x84) + be32(comment_block.size()).substr(1) + comment_block + std::string(64, '\0'));
+
+			isTrue(reader.read(uri("details.flac")));
+			details = reader.details();
+			equal(details.audioCodec(), "Free Lossless Audio Codec (FLAC)");
+			equal(details.sampleRate(), 44100u);
+			equal(details.channels(), 2u);
+			equal(details.duration(), 10000LL);
+			notEqual(details.bitrate(), 0u);
+			equal(details.artist(), "Flac Artist");
+			equal(details.trackNumber(), 3u);
+			equal(details.trackCount(), 12u);
+
+			// A constant bitrate stream is as long as its size allows
+			write("details.mp3", id3_tag(3, id3_frame(3, "TPE1", std::string("\0Mp3 Artist", 11)) +
+			                             id3_frame(3, "TRCK", std::string("\0" "5/9", 4))) + mpeg_frames(3));
+
+			isTrue(reader.read(uri("details.mp3")));
+			details = reader.details();
+			equal(details.audioCodec(), "MPEG-1 Layer 3 (MP3)");
+			equal(details.sampleRate(), 44100u);
+			equal(details.channels(), 2u);
+			equal(details.bitrate(), 128000u);
+			equal(details.duration(), 417LL * 3 * 8000 / 128000);
+			equal(details.artist(), "Mp3 Artist");
+			equal(details.trackNumber(), 5u);
+			equal(details.trackCount(), 9u);
+
+			// A variable bitrate stream counts its frames in a Xing header, and ID3v1.1 has a track number
+			std::string xing = std::string("\xff\xfb\x90\x00", 4) + std::string(32, '\0') + "Xing" + be32(1) + be32(1000);
+			std::string id3v1 = "TAG" + std::string(30, '\0') + "V1 Artist" + std::string(21, '\0') + std::string(65, '\0');
+			id3v1[126] = 7;
+			write("xing.mp3", xing + std::string(417 - xing.size(), '\0') + mpeg_frames(2) + id3v1);
+
+			isTrue(reader.read(uri("xing.mp3")));
+			details = reader.details();
+			equal(details.duration(), 1000LL * 1152 * 1000 / 44100);
+			equal(details.artist(), "V1 Artist");
+			equal(details.trackNumber(), 7u);
+
+			// Thirty frames a second of 640x480 video, with AAC audio
+			std::string video_entry = atom("avc1", std::string(24, '\0') + be16(640) + be16(480) + std::string(42, '\0'));
+			std::string audio_entry = atom("mp4a", std::string(16, '\0') + be16(2) + be16(16) + be32(0) +
+			                               be32(48000UL << 16));
+			std::string movie = atom("mvhd", be32(0) + be32(0) + be32(0) + be32(1000) + be32(10010) + std::string(80, '\0'));
+
+			std::string const tracks[][3] = {{"vide", video_entry, be32(30000)}, {"soun", audio_entry, be32(48000)}};
+			for (unsigned int i = 0; i < 2; ++i) {
+				std::string stbl = atom("stbl", atom("stsd", be32(0) + be32(1) + tracks[i][1]) +
+				                        atom("stts", be32(0) + be32(1) + be32(300) + be32(1001)));
+				movie += atom("trak", atom("mdia", atom("mdhd", be32(0) + be32(0) + be32(0) + tracks[i][2] + be32(0) +
+				                                        be32(0)) +
+				                                   atom("hdlr", be32(0) + be32(0) + tracks[i][0] + std::string(12, '\0')) +
+				                                   atom("minf", stbl)));
+			}
+
+			std::string ilst = atom("ilst", mp4_text("\xa9" "ART", "Mp4 Artist") +
+			                        atom("trkn", atom("data", be32(0) + be32(0) + be16(0) + be16(4) + be16(10) + be16(0))));
+			movie += atom("udta", atom("meta", be32(0) + atom("hdlr", std::string(25, '\0')) + ilst));
+			write("details.mp4", atom("ftyp", "isom" + be32(0)) + atom("moov", movie));
+
+			isTrue(reader.read(uri("details.mp4")));
+			details = reader.details();
+			equal(details.duration(), 10010LL);
+			equal(details.videoCodec(), "H.264 / AVC");
+			equal(details.width(), 640u);
+			equal(details.height(), 480u);
+			equal(details.frameRate(), 29.97, 0.001);
+			equal(details.audioCodec(), "MPEG-4 AAC audio");
+			equal(details.channels(), 2u);
+			equal(details.sampleRate(), 48000u);
+			notEqual(details.bitrate(), 0u);
+			equal(details.artist(), "Mp4 Artist");
+			equal(details.trackNumber(), 4u);
+			equal(details.trackCount(), 10u);
+
+			// Inspecting natively passes the details on
+			::toolkit::Inspector inspect(0);
+			isTrue(inspect.inspect(uri("details.flac")));
+			equal(inspect.details().duration(), 10000LL);
+
+			char const * files[] = {"details.flac", "details.mp3", "xing.mp3", "details.mp4"};
+			for (unsigned int i = 0; i < sizeof(files) / sizeof(files[0]); ++i) {
+				equal(std::remove(("tests/" + std::string(files[i])).c_str()), 0);
+			}
+		}
+
+		void runTests() {
+			oggTest();
+			formatsTest();
+			detailsTest();
+		}
+	}
+}
@@ -225,7 +225,13 @@ namespace {
 
 #include "database_tests.hpp"
 #include "filesystem_tests.hpp"
+#include "hash_tests.hpp"
+#include "history_tests.hpp"
 #include "inspector_tests.hpp"
+#include "library_tests.hpp"
+#include "playlist_tests.hpp"
+#include "shuffle_tests.hpp"
+#include "tag_reader_tests.hpp"
 
 int main(int, char **) {
 	std::cout << "Programme Name: " << NAME << std::endl;
@@ -239,9 +245,33 @@ int main(int, char **) {
 	test::filesystem::runTests();
 	printResults();
 
+	std::cout << "\nRunning hash tests" << std::endl;
+	test::hash::runTests();
+	printResults();
+
+	std::cout << "\nRunning history tests" << std::endl;
+	test::history::runTests();
+	printResults();
+
 	std::cout << "\nRunning inspector tests" << std::endl;
 	test::inspector::runTests();
 	printResults();
 
+	std::cout << "\nRunning library tests" << std::endl;
+	test::library::runTests();
+	printResults();
+
+	std::cout << "\nRunning playlist tests" << std::endl;
+	test::playlist::runTests();
+	printResults();
+
+	std::cout << "\nRunning shuffle tests" << std::endl;
+	test::shuffle::runTests();
+	printResults();
+
+	std::cout << "\nRunning tag reader tests" << std::endl;
+	test::tag_reader::runTests();
+	printResults();
+
 	return 0;
 }